@@ -25,6 +25,35 @@ extern "C" {
 #define XF_YMODEM_XSHELL_ENABLE         CONFIG_XF_YMODEM_XSHELL_ENABLE
 #define XF_YMODEM_DEBUG_ENABLE          CONFIG_XF_YMODEM_DEBUG_ENABLE
 
+/* 取值见 xf_ymodem_config_internel.h 中的 XF_YMODEM_CRC_BACKEND_* */
+#if defined(CONFIG_XF_YMODEM_CRC_BACKEND_BITWISE)
+#   define XF_YMODEM_CRC_BACKEND        (0)
+#elif defined(CONFIG_XF_YMODEM_CRC_BACKEND_SLICING4)
+#   define XF_YMODEM_CRC_BACKEND        (2)
+#elif defined(CONFIG_XF_YMODEM_CRC_BACKEND_SLICING8)
+#   define XF_YMODEM_CRC_BACKEND        (3)
+#else
+#   define XF_YMODEM_CRC_BACKEND        (1)
+#endif
+#define XF_YMODEM_CRC_CLMUL_ENABLE      CONFIG_XF_YMODEM_CRC_CLMUL_ENABLE
+#define XF_YMODEM_WINDOW_ENABLE         CONFIG_XF_YMODEM_WINDOW_ENABLE
+#if defined(CONFIG_XF_YMODEM_WINDOW_MAX)
+#   define XF_YMODEM_WINDOW_MAX         CONFIG_XF_YMODEM_WINDOW_MAX
+#endif
+#define XF_YMODEM_RX_CACHE_ENABLE       CONFIG_XF_YMODEM_RX_CACHE_ENABLE
+#if defined(CONFIG_XF_YMODEM_RX_CACHE_SIZE)
+#   define XF_YMODEM_RX_CACHE_SIZE      CONFIG_XF_YMODEM_RX_CACHE_SIZE
+#endif
+#define XF_YMODEM_STATS_ENABLE          CONFIG_XF_YMODEM_STATS_ENABLE
+#define XF_YMODEM_TRACE_ENABLE          CONFIG_XF_YMODEM_TRACE_ENABLE
+#if defined(CONFIG_XF_YMODEM_TRACE_SIZE)
+#   define XF_YMODEM_TRACE_SIZE         CONFIG_XF_YMODEM_TRACE_SIZE
+#endif
+#define XF_YMODEM_RTO_ENABLE            CONFIG_XF_YMODEM_RTO_ENABLE
+#if defined(CONFIG_XF_YMODEM_RTO_MIN_MS)
+#   define XF_YMODEM_RTO_MIN_MS         CONFIG_XF_YMODEM_RTO_MIN_MS
+#endif
+
 /* ==================== [Typedefs] ========================================== */
 
 /* ==================== [Global Prototypes] ================================= */
@@ -32,6 +32,14 @@ void xf_main(void)
     xf_ymodem_example_receiver();
 #elif defined(CONFIG_XF_YMODEM_EXAMPLE_SENDER)
     xf_ymodem_example_sender();
+#elif defined(CONFIG_XF_YMODEM_EXAMPLE_CRC_BENCH)
+    xf_ymodem_example_crc_bench();
+#elif defined(CONFIG_XF_YMODEM_EXAMPLE_PIPELINE_BENCH)
+    xf_ymodem_example_pipeline_bench();
+#elif defined(CONFIG_XF_YMODEM_EXAMPLE_ADAPTIVE_BENCH)
+    xf_ymodem_example_adaptive_bench();
+#elif defined(CONFIG_XF_YMODEM_EXAMPLE_RECV_BENCH)
+    xf_ymodem_example_recv_bench();
 #endif
 }
 
@@ -27,6 +27,7 @@ extern "C" {
 #define UART_BAUDRATE   CONFIG_XF_YMODEM_EXAMPLE_UART_BAUDRATE
 #define UART_TX_PIN     CONFIG_XF_YMODEM_EXAMPLE_UART_TX_PIN
 #define UART_RX_PIN     CONFIG_XF_YMODEM_EXAMPLE_UART_RX_PIN
+#define CPU_FREQ_MHZ    CONFIG_XF_YMODEM_EXAMPLE_CPU_FREQ_MHZ
 
 /* ==================== [Typedefs] ========================================== */
 
@@ -34,6 +35,10 @@ extern "C" {
 
 void xf_ymodem_example_receiver(void);
 void xf_ymodem_example_sender(void);
+void xf_ymodem_example_crc_bench(void);
+void xf_ymodem_example_pipeline_bench(void);
+void xf_ymodem_example_adaptive_bench(void);
+void xf_ymodem_example_recv_bench(void);
 
 /* ==================== [Macros] ============================================ */
 
@@ -0,0 +1,170 @@
+/**
+ * @file xf_ymodem_example_adaptive_bench.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 在模拟的误码链路上比较固定包长与自适应包长(XF_YMODEM_FLAG_ADAPTIVE)的有效吞吐。
+ * @version 1.0
+ * @date 2025-01-02
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_utils.h"
+#include "xf_osal.h"
+#include "xf_ymodem.h"
+#include "xf_ymodem_internel.h"
+
+#include "xf_ymodem_example.h"
+
+/* ==================== [Defines] =========================================== */
+
+/* 模拟传输的文件长度 */
+#define BENCH_FILE_LEN                  (1024 * 1024)
+/* 模拟的链路: 波特率，每字节 10 bit(8N1) */
+#define BENCH_BAUDRATE                  (912600)
+#define BENCH_BITS_PER_BYTE             (10)
+/* 每包的应答往返时间，含对端处理时间，单位 us */
+#define BENCH_TURNAROUND_US             (2000)
+/* 每包最多重发次数，超过时认为该配置下无法完成传输 */
+#define BENCH_RETRY_MAX                 (1000)
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static uint32_t app_rand(void);
+static float app_frame_error_rate(float ber, uint32_t bits);
+static uint32_t app_simulate_kbps(float ber, uint32_t buf_size, uint32_t flags);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "adaptive_bench";
+
+/* 误码率 = 1 / sc_ber_inv[i], 0 为无误码 */
+static const uint32_t sc_ber_inv[] = {
+    0, 10000000, 1000000, 300000, 100000, 30000, 10000,
+};
+
+static const uint32_t sc_frame_size[] = {
+    XF_YMODEM_SOH_DATA_SIZE,
+    XF_YMODEM_STX_1K_DATA_SIZE,
+    XF_YMODEM_STX_2K_DATA_SIZE,
+    XF_YMODEM_STX_4K_DATA_SIZE,
+    XF_YMODEM_STX_8K_DATA_SIZE,
+};
+
+static uint32_t s_rand_state = 0x12345678;
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+void xf_ymodem_example_adaptive_bench(void)
+{
+    float    ber;
+    uint32_t kbps[ARRAY_SIZE(sc_frame_size) + 1];
+    uint32_t i;
+    uint32_t j;
+
+    XF_LOGI(TAG, "link:         %d baud, turnaround %d us, file %d bytes",
+            (int)BENCH_BAUDRATE, (int)BENCH_TURNAROUND_US, (int)BENCH_FILE_LEN);
+    XF_LOGI(TAG, "goodput in kbit/s, 0 means the transfer did not complete");
+    XF_LOGI(TAG, "%12s %7s %7s %7s %7s %7s %9s",
+            "ber", "128", "1K", "2K", "4K", "8K", "adaptive");
+
+    for (i = 0; i < ARRAY_SIZE(sc_ber_inv); i++) {
+        ber = (sc_ber_inv[i] == 0) ? 0.0f : (1.0f / (float)sc_ber_inv[i]);
+        /* 固定包长: buf_size 恰好容纳该包长 */
+        for (j = 0; j < ARRAY_SIZE(sc_frame_size); j++) {
+            kbps[j] = app_simulate_kbps(ber, sc_frame_size[j] + XF_YMODEM_PROT_SEG_SIZE, 0);
+        }
+        /* 自适应: buf_size 允许 8K 包 */
+        kbps[j] = app_simulate_kbps(ber, XF_YMODEM_STX_8K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE,
+                                    XF_YMODEM_FLAG_ADAPTIVE);
+        XF_LOGI(TAG, "%2s1/%-8d %7d %7d %7d %7d %7d %9d", "",
+                (int)sc_ber_inv[i], (int)kbps[0], (int)kbps[1], (int)kbps[2],
+                (int)kbps[3], (int)kbps[4], (int)kbps[5]);
+    }
+
+    while (1) {
+        xf_osal_delay_ms(1000);
+    }
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static uint32_t app_rand(void)
+{
+    /* xorshift32 */
+    s_rand_state ^= s_rand_state << 13;
+    s_rand_state ^= s_rand_state >> 17;
+    s_rand_state ^= s_rand_state << 5;
+    return s_rand_state;
+}
+
+static float app_frame_error_rate(float ber, uint32_t bits)
+{
+    /* 1 - (1 - ber)^bits, 平方求幂，不依赖 libm */
+    float ok    = 1.0f;
+    float base  = 1.0f - ber;
+
+    while (bits > 0) {
+        if (bits & 1) {
+            ok *= base;
+        }
+        base *= base;
+        bits >>= 1;
+    }
+
+    return 1.0f - ok;
+}
+
+static uint32_t app_simulate_kbps(float ber, uint32_t buf_size, uint32_t flags)
+{
+    xf_ymodem_t ym          = {0};
+    uint64_t    us_total    = 0;
+    uint32_t    data_len    = 0;
+    uint32_t    bits        = 0;
+    uint32_t    retry       = 0;
+    float       fer         = 0.0f;
+    uint32_t    i;
+
+    /*
+        使用 xf_ymodem 的包长选择及自适应控制，只模拟链路:
+            每包(含协议段)按 fer 的概率出错并收到 NAK, 重发同一包；
+            每次发送耗时为包的线路时间加应答往返时间。
+     */
+    ym.buf_size     = buf_size;
+    ym.flags        = flags;
+    ym.state        = XF_YMODEM_SEND_FILE_DATA;
+    ym.frame_lvl    = XF_YMODEM_ADAPT_LVL_INIT;
+    ym.frame_max    = XF_YMODEM_STX_8K_DATA_SIZE;   /*!< 视为已协商非标包长 */
+    ym.file_len     = BENCH_FILE_LEN;
+
+    s_rand_state = 0x12345678;
+    while (ym.file_len_transmitted < ym.file_len) {
+        xf_ymodem_send_get_packet_data_len(&ym, &data_len);
+        /* 最后一包不足时按帧长填充 */
+        for (i = 0; sc_frame_size[i] < data_len; i++) {}
+        bits = (sc_frame_size[i] + XF_YMODEM_PROT_SEG_SIZE) * BENCH_BITS_PER_BYTE;
+        fer  = app_frame_error_rate(ber, bits);
+
+        for (retry = 0; ; retry++) {
+            if (retry > BENCH_RETRY_MAX) {
+                return 0;
+            }
+            us_total += (uint64_t)bits * 1000000 / BENCH_BAUDRATE + BENCH_TURNAROUND_US;
+            if (((float)app_rand() / 4294967296.0f) >= fer) {
+                break;
+            }
+            xf_ymodem_send_adapt(&ym, true);
+        }
+        xf_ymodem_send_adapt(&ym, false);
+        ym.file_len_transmitted += data_len;
+    }
+
+    /* kbit/s = bytes * 8 / us * 1000 */
+    return (uint32_t)((uint64_t)BENCH_FILE_LEN * 8 * 1000 / us_total);
+}
@@ -0,0 +1,167 @@
+/**
+ * @file xf_ymodem_example_crc_bench.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 校验并测量当前配置的 crc16 实现(XF_YMODEM_CRC_BACKEND)。
+ * @version 1.0
+ * @date 2025-01-02
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_utils.h"
+#include "xf_osal.h"
+#include "xf_sys.h"
+#include "xf_ymodem.h"
+#include "xf_ymodem_internel.h"
+
+#include "xf_ymodem_example.h"
+
+/* ==================== [Defines] =========================================== */
+
+/* 每种包长累计计算的字节数 */
+#define BENCH_BYTES_PER_FRAME_SIZE      (1024 * 1024)
+/* 每种包长随机校验的次数 */
+#define BENCH_VERIFY_ROUNDS             (64)
+
+/* ==================== [Typedefs] ========================================== */
+
+typedef uint16_t (*app_crc16_fn_t)(uint16_t crc_start, const uint8_t *buf, uint32_t len);
+
+/* ==================== [Static Prototypes] ================================= */
+
+static uint32_t app_rand(void);
+static xf_err_t app_crc_verify(uint32_t frame_size);
+static uint32_t app_crc_measure_us(app_crc16_fn_t fn, uint32_t frame_size);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "crc_bench";
+
+static const uint32_t sc_frame_size[] = {
+    XF_YMODEM_SOH_DATA_SIZE,
+    XF_YMODEM_STX_1K_DATA_SIZE,
+    XF_YMODEM_STX_2K_DATA_SIZE,
+    XF_YMODEM_STX_4K_DATA_SIZE,
+    XF_YMODEM_STX_8K_DATA_SIZE,
+};
+
+static const char *const sc_backend_name[] = {
+    [XF_YMODEM_CRC_BACKEND_BITWISE]     = "bitwise",
+    [XF_YMODEM_CRC_BACKEND_TABLE]       = "table",
+    [XF_YMODEM_CRC_BACKEND_SLICING4]    = "slicing-by-4",
+    [XF_YMODEM_CRC_BACKEND_SLICING8]    = "slicing-by-8",
+};
+
+/* 多留 8 字节用于测试非对齐的起始地址 */
+static uint8_t s_bench_buf[XF_YMODEM_STX_8K_DATA_SIZE + 8] = {0};
+static uint32_t s_rand_state = 0x12345678;
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+void xf_ymodem_example_crc_bench(void)
+{
+    xf_err_t xf_ret     = XF_OK;
+    uint32_t us_ref     = 0;
+    uint32_t us_sel     = 0;
+    uint32_t i;
+
+    xf_sys_watchdog_disable();
+
+    for (i = 0; i < ARRAY_SIZE(s_bench_buf); i++) {
+        s_bench_buf[i] = (uint8_t)app_rand();
+    }
+
+    XF_LOGI(TAG, "backend:      %s", sc_backend_name[XF_YMODEM_CRC_BACKEND_SEL]);
+#if XF_YMODEM_CRC_CLMUL_IS_ENABLE
+    XF_LOGI(TAG, "pclmul:       %s",
+            xf_ymodem_crc16_clmul_is_supported() ? "enabled" : "not supported by cpu");
+#endif
+    XF_LOGI(TAG, "cpu:          %d MHz", (int)CPU_FREQ_MHZ);
+
+    /* 1. 与逐位计算的参考实现比较 */
+    for (i = 0; i < ARRAY_SIZE(sc_frame_size); i++) {
+        xf_ret = app_crc_verify(sc_frame_size[i]);
+        if (xf_ret != XF_OK) {
+            XF_LOGE(TAG, "frame %d: result differs from bitwise reference!",
+                    (int)sc_frame_size[i]);
+            return;
+        }
+    }
+    XF_LOGI(TAG, "verify:       identical to bitwise reference");
+
+    /* 2. 测量每字节耗时 */
+    XF_LOGI(TAG, "%8s %16s %16s %10s", "frame", "bitwise(cyc/B)", "selected(cyc/B)", "speedup");
+    for (i = 0; i < ARRAY_SIZE(sc_frame_size); i++) {
+        us_ref = app_crc_measure_us(xf_ymodem_crc16_bitwise, sc_frame_size[i]);
+        us_sel = app_crc_measure_us(xf_ymodem_crc16, sc_frame_size[i]);
+        if (us_sel == 0) {
+            us_sel = 1;
+        }
+        /* cycles/byte = us * MHz / bytes, 放大 100 倍保留两位小数 */
+        XF_LOGI(TAG, "%8d %13d.%02d %13d.%02d %7d.%02d",
+                (int)sc_frame_size[i],
+                (int)((uint64_t)us_ref * CPU_FREQ_MHZ * 100 / BENCH_BYTES_PER_FRAME_SIZE / 100),
+                (int)((uint64_t)us_ref * CPU_FREQ_MHZ * 100 / BENCH_BYTES_PER_FRAME_SIZE % 100),
+                (int)((uint64_t)us_sel * CPU_FREQ_MHZ * 100 / BENCH_BYTES_PER_FRAME_SIZE / 100),
+                (int)((uint64_t)us_sel * CPU_FREQ_MHZ * 100 / BENCH_BYTES_PER_FRAME_SIZE % 100),
+                (int)((uint64_t)us_ref * 100 / us_sel / 100),
+                (int)((uint64_t)us_ref * 100 / us_sel % 100));
+    }
+
+    while (1) {
+        xf_osal_delay_ms(1000);
+    }
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static uint32_t app_rand(void)
+{
+    /* xorshift32 */
+    s_rand_state ^= s_rand_state << 13;
+    s_rand_state ^= s_rand_state >> 17;
+    s_rand_state ^= s_rand_state << 5;
+    return s_rand_state;
+}
+
+static xf_err_t app_crc_verify(uint32_t frame_size)
+{
+    uint32_t round;
+    uint32_t offset;
+    uint32_t len;
+    uint16_t crc_start;
+
+    for (round = 0; round < BENCH_VERIFY_ROUNDS; round++) {
+        /* 随机的非对齐起始地址、长度(含不满一组的尾部)及起始值 */
+        offset      = app_rand() % 8;
+        len         = (round == 0) ? frame_size : (app_rand() % (frame_size + 1));
+        crc_start   = (round & 1) ? (uint16_t)app_rand() : XF_YMODEM_CRC_START_VAL_DEFAULT;
+        if (xf_ymodem_crc16(crc_start, &s_bench_buf[offset], len)
+                != xf_ymodem_crc16_bitwise(crc_start, &s_bench_buf[offset], len)) {
+            return XF_FAIL;
+        }
+    }
+
+    return XF_OK;
+}
+
+static uint32_t app_crc_measure_us(app_crc16_fn_t fn, uint32_t frame_size)
+{
+    uint32_t loops      = BENCH_BYTES_PER_FRAME_SIZE / frame_size;
+    volatile uint16_t crc_sink = 0;
+    uint64_t us_start;
+    uint32_t i;
+
+    us_start = (uint64_t)xf_sys_time_get_us();
+    for (i = 0; i < loops; i++) {
+        crc_sink ^= fn(XF_YMODEM_CRC_START_VAL_DEFAULT, s_bench_buf, frame_size);
+    }
+    UNUSED(crc_sink);
+
+    return (uint32_t)((uint64_t)xf_sys_time_get_us() - us_start);
+}
@@ -0,0 +1,330 @@
+/**
+ * @file xf_ymodem_example_pipeline_bench.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 在模拟链路上比较逐包应答发送与流水发送(XF_YMODEM_FLAG_PIPELINE)的吞吐。
+ * @version 1.0
+ * @date 2025-01-02
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_utils.h"
+#include "xf_osal.h"
+#include "xf_sys.h"
+#include "xf_ymodem.h"
+#include "xf_ymodem_internel.h"
+
+#include "xf_ymodem_example.h"
+
+/* ==================== [Defines] =========================================== */
+
+/* 模拟传输的文件长度 */
+#define BENCH_FILE_LEN                  (256 * 1024)
+/* 模拟的链路: 波特率，每字节 10 bit(8N1), 用于换算虚拟时间 */
+#define BENCH_BAUDRATE                  (912600)
+#define BENCH_BITS_PER_BYTE             (10)
+/* 包发送完毕到应答到达发送端的时间，含接收端处理时间，单位 us */
+#define BENCH_TURNAROUND_US             (2000)
+/* 每隔多少个数据包对首次发送的副本回复 NAK, 验证从上一包的缓冲区重发 */
+#define BENCH_NAK_INTERVAL              (64)
+/* 发送端的 timeout_ms, 与示例一致 */
+#define BENCH_TIMEOUT_MS                (50)
+
+/* 同时在途的应答字节数上限 */
+#define BENCH_ANSWER_NUM                (8)
+
+/* ==================== [Typedefs] ========================================== */
+
+/* 模拟接收端的阶段 */
+typedef enum _app_rx_stage_t {
+    APP_RX_FILE_INFO,                   /*!< 等待起始帧 */
+    APP_RX_DATA,                        /*!< 等待数据包或 EOT */
+    APP_RX_EOT2,                        /*!< 已 NAK 第一个 EOT, 等待第二个 */
+    APP_RX_NULL_INFO,                   /*!< 等待空起始帧 */
+    APP_RX_END,
+} app_rx_stage_t;
+
+/* 在途的应答字节 */
+typedef struct _app_answer_t {
+    uint64_t    arrive_us;              /*!< 到达发送端的虚拟时间 */
+    uint8_t     ch;
+} app_answer_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int32_t app_read(void *dst, uint32_t size, uint32_t timeout_ms);
+static int32_t app_write(const void *src, uint32_t size, uint32_t timeout_ms);
+static void app_flush(void);
+static void app_delay_ms(uint32_t ms);
+
+static void app_answer(uint8_t ch, uint64_t arrive_us);
+static void app_rx_input(const uint8_t *p_buf, uint32_t len, uint64_t arrive_us);
+static uint32_t app_bench_run(uint32_t frame_size, uint32_t fill_us, uint32_t flags);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "pipeline_bench";
+
+/* 用户填充一包数据(如从 flash 或文件系统读取)耗时，单位 us */
+static const uint32_t sc_fill_us[] = {
+    0, 1000, 2000, 5000, 10000, 20000,
+};
+
+static const uint32_t sc_frame_size[] = {
+    XF_YMODEM_SOH_DATA_SIZE,
+    XF_YMODEM_STX_1K_DATA_SIZE,
+};
+
+static const xf_ymodem_ops_t sc_ops = {
+    .read       = app_read,
+    .write      = app_write,
+    .flush      = app_flush,
+    .delay_ms   = app_delay_ms,
+};
+
+static uint8_t s_buf[XF_YMODEM_STX_1K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE] = {0};
+static uint8_t s_buf_alt[XF_YMODEM_STX_1K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE] = {0};
+
+static xf_ymodem_t      s_tx;
+static uint64_t         s_now_us;       /*!< 发送端的虚拟时间 */
+static uint64_t         s_wire_free_us; /*!< 发送方向线路空闲的时刻 */
+static app_answer_t     s_answer[BENCH_ANSWER_NUM];
+static uint32_t         s_answer_rd;
+static uint32_t         s_answer_wr;
+static app_rx_stage_t   s_rx_stage;
+static uint8_t          s_rx_pn;        /*!< 模拟接收端期望的包号 */
+static uint8_t          s_nak_pn;       /*!< 最近一次回复 NAK 的包号 */
+static uint32_t         s_rx_len;       /*!< 模拟接收端已确认的文件数据 */
+static uint32_t         s_naks;
+static uint32_t         s_bad;          /*!< 内容与文件不符的数据包 */
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+void xf_ymodem_example_pipeline_bench(void)
+{
+    uint32_t kbps[2 * ARRAY_SIZE(sc_frame_size)];
+    uint32_t i;
+    uint32_t j;
+
+    xf_sys_watchdog_disable();
+
+    XF_LOGI(TAG, "link: %d baud, turnaround %d us, file %d bytes, NAK every %d packets",
+            (int)BENCH_BAUDRATE, (int)BENCH_TURNAROUND_US, (int)BENCH_FILE_LEN,
+            (int)BENCH_NAK_INTERVAL);
+    XF_LOGI(TAG, "goodput in kbit/s, 0 means the transfer failed");
+    XF_LOGI(TAG, "%9s %9s %9s %9s %9s",
+            "fill(us)", "128", "128 pipe", "1K", "1K pipe");
+
+    for (i = 0; i < ARRAY_SIZE(sc_fill_us); i++) {
+        for (j = 0; j < ARRAY_SIZE(sc_frame_size); j++) {
+            kbps[2 * j]     = app_bench_run(sc_frame_size[j], sc_fill_us[i], 0);
+            kbps[2 * j + 1] = app_bench_run(sc_frame_size[j], sc_fill_us[i],
+                                            XF_YMODEM_FLAG_PIPELINE);
+        }
+        XF_LOGI(TAG, "%9d %9d %9d %9d %9d",
+                (int)sc_fill_us[i], (int)kbps[0], (int)kbps[1], (int)kbps[2], (int)kbps[3]);
+    }
+
+    while (1) {
+        xf_osal_delay_ms(1000);
+    }
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static uint32_t app_bench_run(uint32_t frame_size, uint32_t fill_us, uint32_t flags)
+{
+    xf_err_t                xf_ret          = XF_OK;
+    xf_ymodem_file_info_t   file_info       = {0};
+    char                    file_name[]     = {"bench.bin"};
+    uint8_t                *p_data          = NULL;
+    uint32_t                data_len        = 0;
+    uint32_t                i;
+
+    /*
+        真实的发送端对接模拟的接收端及链路:
+            ops->write 立即返回，数据在线路上按波特率依次传输；
+            接收端收完一包后经过 BENCH_TURNAROUND_US 应答到达发送端，
+            ops->read 等待应答时推进虚拟时间；
+            每包填充数据耗时 fill_us, 流水发送时与上一包的传输及应答重叠。
+     */
+    xf_memset(&s_tx, 0, sizeof(s_tx));
+    s_tx.p_buf          = s_buf;
+    s_tx.p_buf_alt      = s_buf_alt;
+    s_tx.buf_size       = frame_size + XF_YMODEM_PROT_SEG_SIZE;
+    s_tx.retry_num      = 10;
+    s_tx.timeout_ms     = BENCH_TIMEOUT_MS;
+    s_tx.flags          = flags;
+    s_tx.ops            = &sc_ops;
+    s_now_us            = 0;
+    s_wire_free_us      = 0;
+    s_answer_rd         = 0;
+    s_answer_wr         = 0;
+    s_rx_stage          = APP_RX_FILE_INFO;
+    s_rx_pn             = 1;
+    s_nak_pn            = 0;
+    s_rx_len            = 0;
+    s_naks              = 0;
+    s_bad               = 0;
+
+    app_answer(XF_YMODEM_C, 0);
+
+    file_info.p_name_buf    = file_name;
+    file_info.buf_size      = xf_strlen(file_name);
+    file_info.file_len      = BENCH_FILE_LEN;
+    xf_ret = xf_ymodem_send_handshake(&s_tx, &file_info);
+    if (xf_ret != XF_OK) {
+        return 0;
+    }
+    while (1) {
+        xf_ret = xf_ymodem_send_get_buf_and_len(&s_tx, &p_data, &data_len);
+        if (xf_ret != XF_OK) {
+            break;
+        }
+        for (i = 0; i < data_len; i++) {
+            p_data[i] = (uint8_t)(s_tx.file_len_transmitted + i);
+        }
+        s_now_us += fill_us;
+        xf_ret = xf_ymodem_send_data(&s_tx);
+        if (xf_ret != XF_OK) {
+            break;
+        }
+    }
+
+    if ((xf_ret != XF_ERR_RESOURCE) || (s_tx.error_code != XF_YMODEM_OK)
+            || (s_rx_stage != APP_RX_END) || (s_rx_len != BENCH_FILE_LEN)
+            || (s_bad > 0) || (s_naks == 0)) {
+        XF_LOGE(TAG, "frame %d fill %d flags 0x%x: %s, stage %d, %d bytes, %d bad",
+                (int)frame_size, (int)fill_us, (int)flags, xf_err_to_name(xf_ret),
+                (int)s_rx_stage, (int)s_rx_len, (int)s_bad);
+        return 0;
+    }
+
+    /* kbit/s = bytes * 8 / us * 1000 */
+    return (uint32_t)((uint64_t)BENCH_FILE_LEN * 8 * 1000 / s_now_us);
+}
+
+static int32_t app_read(void *dst, uint32_t size, uint32_t timeout_ms)
+{
+    uint8_t *p_dst  = (uint8_t *)dst;
+    uint32_t len    = 0;
+
+    if ((s_answer_rd == s_answer_wr)
+            || (s_answer[s_answer_rd % BENCH_ANSWER_NUM].arrive_us
+                > s_now_us + (uint64_t)timeout_ms * 1000)) {
+        /* 超时前没有应答到达 */
+        s_now_us += (uint64_t)timeout_ms * 1000;
+        return 0;
+    }
+    if (s_answer[s_answer_rd % BENCH_ANSWER_NUM].arrive_us > s_now_us) {
+        s_now_us = s_answer[s_answer_rd % BENCH_ANSWER_NUM].arrive_us;
+    }
+    while ((len < size) && (s_answer_rd != s_answer_wr)
+            && (s_answer[s_answer_rd % BENCH_ANSWER_NUM].arrive_us <= s_now_us)) {
+        p_dst[len++] = s_answer[s_answer_rd % BENCH_ANSWER_NUM].ch;
+        s_answer_rd++;
+    }
+    return (int32_t)len;
+}
+
+static int32_t app_write(const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    uint64_t start_us;
+
+    UNUSED(timeout_ms);
+    /* 写入发送 FIFO 后立即返回，线路忙时排在前一包之后 */
+    start_us        = (s_wire_free_us > s_now_us) ? s_wire_free_us : s_now_us;
+    s_wire_free_us  = start_us + (uint64_t)size * BENCH_BITS_PER_BYTE * 1000000 / BENCH_BAUDRATE;
+    app_rx_input((const uint8_t *)src, size, s_wire_free_us + BENCH_TURNAROUND_US);
+    return (int32_t)size;
+}
+
+static void app_flush(void)
+{
+    while ((s_answer_rd != s_answer_wr)
+            && (s_answer[s_answer_rd % BENCH_ANSWER_NUM].arrive_us <= s_now_us)) {
+        s_answer_rd++;
+    }
+}
+
+static void app_delay_ms(uint32_t ms)
+{
+    s_now_us += (uint64_t)ms * 1000;
+}
+
+static void app_answer(uint8_t ch, uint64_t arrive_us)
+{
+    if (s_answer_wr - s_answer_rd >= BENCH_ANSWER_NUM) {
+        return;
+    }
+    s_answer[s_answer_wr % BENCH_ANSWER_NUM].arrive_us  = arrive_us;
+    s_answer[s_answer_wr % BENCH_ANSWER_NUM].ch         = ch;
+    s_answer_wr++;
+}
+
+static void app_rx_input(const uint8_t *p_buf, uint32_t len, uint64_t arrive_us)
+{
+    uint32_t data_len;
+    uint32_t i;
+
+    /* 发送端每次 write 一个完整的包或一个控制字节 */
+    if ((len == 1) && (p_buf[0] == XF_YMODEM_EOT)) {
+        if (s_rx_stage == APP_RX_DATA) {
+            s_rx_stage = APP_RX_EOT2;
+            app_answer(XF_YMODEM_NAK, arrive_us);
+        } else if (s_rx_stage == APP_RX_EOT2) {
+            s_rx_stage = APP_RX_NULL_INFO;
+            app_answer(XF_YMODEM_ACK, arrive_us);
+            app_answer(XF_YMODEM_C, arrive_us);
+        }
+        return;
+    }
+    if (len < XF_YMODEM_PROT_SEG_SIZE) {
+        return;
+    }
+    data_len = len - XF_YMODEM_PROT_SEG_SIZE;
+
+    switch (s_rx_stage) {
+    case APP_RX_FILE_INFO: {
+        app_answer(XF_YMODEM_ACK, arrive_us);
+        app_answer(XF_YMODEM_C, arrive_us);
+        s_rx_stage = APP_RX_DATA;
+    } break;
+    case APP_RX_DATA: {
+        if (p_buf[XF_YMODEM_PN_IDX] != s_rx_pn) {
+            /* 重发的上一包 */
+            app_answer(XF_YMODEM_ACK, arrive_us);
+            break;
+        }
+        if (((s_rx_pn % BENCH_NAK_INTERVAL) == 0) && (s_nak_pn != s_rx_pn)) {
+            s_nak_pn = s_rx_pn;
+            s_naks++;
+            app_answer(XF_YMODEM_NAK, arrive_us);
+            break;
+        }
+        if (data_len > BENCH_FILE_LEN - s_rx_len) {
+            data_len = BENCH_FILE_LEN - s_rx_len;   /*!< 最后一包的填充字节不检查 */
+        }
+        for (i = 0; i < data_len; i++) {
+            if (p_buf[XF_YMODEM_DATA_IDX + i] != (uint8_t)(s_rx_len + i)) {
+                s_bad++;
+                break;
+            }
+        }
+        s_rx_len += data_len;
+        s_rx_pn++;
+        app_answer(XF_YMODEM_ACK, arrive_us);
+    } break;
+    case APP_RX_NULL_INFO: {
+        s_rx_stage = APP_RX_END;
+        app_answer(XF_YMODEM_ACK, arrive_us);
+    } break;
+    default:
+        break;
+    }
+}
@@ -125,6 +125,9 @@ void xf_ymodem_example_receiver(void)
                 XF_LOGW(TAG, "p_ym->error_code:%d", (int)p_ym->error_code);
             } break;
             }
+        } else if (xf_ret == XF_ERR_NOT_FINISHED) {
+            /* 批量传输，已收到下一个文件的起始帧，下一次 xf_ymodem_recv_handshake() 直接解析 */
+            XF_LOGI(TAG, "File received, next file follows.");
         } else if (xf_ret == XF_ERR_TIMEOUT) {
             /* 指定时间内未收到数据，对方已离线 */
             XF_LOGW(TAG, "The peer end is offline.");
@@ -139,7 +142,9 @@ void xf_ymodem_example_receiver(void)
         }
         XF_LOGI(TAG, "Computed MD5 hash: %s", digest_str);
 
-        xf_osal_delay_ms(3 * 1000);
+        if (xf_ret != XF_ERR_NOT_FINISHED) {
+            xf_osal_delay_ms(3 * 1000);
+        }
     }
 }
 
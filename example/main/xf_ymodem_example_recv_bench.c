@@ -0,0 +1,382 @@
+/**
+ * @file xf_ymodem_example_recv_bench.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 在内存链路上测量接收端每收一字节的读取、清空开销，及突发误码后的重传延迟。
+ * @version 1.0
+ * @date 2025-01-02
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_utils.h"
+#include "xf_osal.h"
+#include "xf_sys.h"
+#include "xf_ymodem.h"
+#include "xf_ymodem_internel.h"
+
+#include "xf_ymodem_example.h"
+
+/* ==================== [Defines] =========================================== */
+
+/* 模拟传输的文件长度 */
+#define BENCH_FILE_LEN                  (1024 * 1024)
+/* 每隔多少个数据包注入一次突发误码(首次发送时)，0 为不注入 */
+#define BENCH_ERR_INTERVAL              (64)
+/* 突发误码的长度，起始位置随次数变化，可能落在包头上 */
+#define BENCH_BURST_LEN                 (16)
+/* 模拟的链路: 波特率，每字节 10 bit(8N1), 用于换算虚拟时间 */
+#define BENCH_BAUDRATE                  (912600)
+#define BENCH_BITS_PER_BYTE             (10)
+/* 接收端的 timeout_ms, 与示例一致 */
+#define BENCH_TIMEOUT_MS                (50)
+
+/* 线路上最多同时有一个出错包的剩余部分及其重发包 */
+#define BENCH_LINE_SIZE                 (2 * (XF_YMODEM_STX_8K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE))
+
+/* ==================== [Typedefs] ========================================== */
+
+/* 模拟发送端的阶段 */
+typedef enum _app_tx_stage_t {
+    APP_TX_WAIT_C,                      /*!< 等待 C, 发送起始帧 */
+    APP_TX_INFO,                        /*!< 已发送起始帧，等待 ACK 及 C */
+    APP_TX_DATA,                        /*!< 已发送数据包，等待 ACK 或 NAK */
+    APP_TX_EOT,                         /*!< 已发送 EOT, 等待 NAK 或 ACK */
+    APP_TX_NULL_INFO,                   /*!< 等待 C, 发送空起始帧 */
+    APP_TX_END,
+} app_tx_stage_t;
+
+/* 接收端调用 ops 的统计 */
+typedef struct _app_stat_t {
+    uint32_t    read_calls;
+    uint32_t    read_bytes;
+    uint32_t    flush_calls;
+    uint32_t    flush_bytes;            /*!< flush 丢弃的字节 */
+    uint32_t    packets;                /*!< 发送的数据包，含重发 */
+    uint32_t    errors;                 /*!< 注入的突发误码 */
+    uint32_t    recv_bytes;             /*!< 交付给用户的文件数据 */
+    uint64_t    line_us;                /*!< 虚拟时间: 线路传输 */
+    uint64_t    idle_us;                /*!< 虚拟时间: 读取超时及 delay_ms */
+} app_stat_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int32_t app_read(void *dst, uint32_t size, uint32_t timeout_ms);
+static int32_t app_write(const void *src, uint32_t size, uint32_t timeout_ms);
+static void app_flush(void);
+static void app_delay_ms(uint32_t ms);
+
+static void app_tx_input(uint8_t ch);
+static void app_tx_queue(const uint8_t *p_buf, uint32_t len);
+static void app_tx_build_data(void);
+static xf_err_t app_bench_run(uint32_t frame_size, uint32_t flags);
+static void app_bench_print(uint32_t frame_size, const char *p_mode);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "recv_bench";
+
+static const uint32_t sc_frame_size[] = {
+    XF_YMODEM_SOH_DATA_SIZE,
+    XF_YMODEM_STX_1K_DATA_SIZE,
+    XF_YMODEM_STX_8K_DATA_SIZE,
+};
+
+static const xf_ymodem_ops_t sc_rx_ops = {
+    .read       = app_read,
+    .write      = app_write,
+    .flush      = app_flush,
+    .delay_ms   = app_delay_ms,
+};
+
+/* 模拟发送端只用于组包，不会调用 ops */
+static const xf_ymodem_ops_t sc_tx_ops = {0};
+
+static uint8_t s_rx_buf[XF_YMODEM_STX_8K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE] = {0};
+static uint8_t s_tx_buf[XF_YMODEM_STX_8K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE] = {0};
+static uint8_t s_line[BENCH_LINE_SIZE] = {0};
+
+static xf_ymodem_t      s_rx;
+static xf_ymodem_t      s_tx;
+static app_tx_stage_t   s_tx_stage;
+static uint32_t         s_line_rd;      /*!< 接收端下一次读取的位置 */
+static uint32_t         s_line_wr;
+static uint32_t         s_line_arrived; /*!< 已到达的数据末尾，应答后发出的数据在下一次读取时才到达 */
+static uint32_t         s_corrupt_pn;   /*!< 最近一次注入误码的包号 */
+static app_stat_t       s_stat;
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+void xf_ymodem_example_recv_bench(void)
+{
+    xf_err_t xf_ret     = XF_OK;
+    uint32_t i;
+
+    xf_sys_watchdog_disable();
+
+    XF_LOGI(TAG, "file %d bytes, a %d-byte burst every %d packets, timeout %d ms",
+            (int)BENCH_FILE_LEN, (int)BENCH_BURST_LEN, (int)BENCH_ERR_INTERVAL,
+            (int)BENCH_TIMEOUT_MS);
+    XF_LOGI(TAG, "%6s %8s %10s %12s %10s %10s %10s",
+            "frame", "resync", "reads/pkt", "wire(B/B)", "flush/pkt", "link(ms)", "ms/err");
+
+    for (i = 0; i < ARRAY_SIZE(sc_frame_size); i++) {
+        xf_ret = app_bench_run(sc_frame_size[i], 0);
+        if (xf_ret != XF_OK) {
+            XF_LOGE(TAG, "frame %d: %s", (int)sc_frame_size[i], xf_err_to_name(xf_ret));
+            continue;
+        }
+        app_bench_print(sc_frame_size[i], "classic");
+
+        xf_ret = app_bench_run(sc_frame_size[i], XF_YMODEM_FLAG_FAST_RESYNC);
+        if (xf_ret != XF_OK) {
+            XF_LOGE(TAG, "frame %d: %s", (int)sc_frame_size[i], xf_err_to_name(xf_ret));
+            continue;
+        }
+        app_bench_print(sc_frame_size[i], "fast");
+    }
+
+    while (1) {
+        xf_osal_delay_ms(1000);
+    }
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static void app_bench_print(uint32_t frame_size, const char *p_mode)
+{
+    uint32_t errors = (s_stat.errors > 0) ? s_stat.errors : 1;
+
+    /*
+        wire(B/B):  每交付 1 字节文件数据，接收端从链路读取及丢弃的字节数。
+        link(ms):   虚拟时间，线路传输加上读取超时及 delay_ms.
+        ms/err:     每次误码带来的读取超时及 delay_ms, 不含重发包本身的传输时间。
+     */
+    XF_LOGI(TAG, "%6d %8s %7d.%02d %9d.%03d %7d.%02d %10d %10d",
+            (int)frame_size, p_mode,
+            (int)(s_stat.read_calls / s_stat.packets),
+            (int)(s_stat.read_calls * 100 / s_stat.packets % 100),
+            (int)((uint64_t)(s_stat.read_bytes + s_stat.flush_bytes) / s_stat.recv_bytes),
+            (int)((uint64_t)(s_stat.read_bytes + s_stat.flush_bytes) * 1000 / s_stat.recv_bytes % 1000),
+            (int)(s_stat.flush_calls / s_stat.packets),
+            (int)(s_stat.flush_calls * 100 / s_stat.packets % 100),
+            (int)((s_stat.line_us + s_stat.idle_us) / 1000),
+            (int)(s_stat.idle_us / 1000 / errors));
+}
+
+static xf_err_t app_bench_run(uint32_t frame_size, uint32_t flags)
+{
+    xf_err_t                xf_ret          = XF_OK;
+    xf_ymodem_file_info_t   file_info       = {0};
+    char                    file_name[32]   = {0};
+    uint8_t                *p_data          = NULL;
+    uint32_t                data_len        = 0;
+
+    xf_memset(&s_stat, 0, sizeof(s_stat));
+    xf_memset(&s_rx, 0, sizeof(s_rx));
+    xf_memset(&s_tx, 0, sizeof(s_tx));
+    s_rx.p_buf          = s_rx_buf;
+    s_rx.buf_size       = frame_size + XF_YMODEM_PROT_SEG_SIZE;
+    s_rx.retry_num      = 10;
+    s_rx.timeout_ms     = BENCH_TIMEOUT_MS;
+    s_rx.flags          = flags;
+    s_rx.ops            = &sc_rx_ops;
+    s_tx.p_buf          = s_tx_buf;
+    s_tx.p_pkt          = s_tx_buf;
+    s_tx.buf_size       = frame_size + XF_YMODEM_PROT_SEG_SIZE;
+    s_tx.frame_max      = frame_size;   /*!< 视为已协商非标包长 */
+    s_tx.ops            = &sc_tx_ops;
+    s_tx_stage          = APP_TX_WAIT_C;
+    s_line_rd           = 0;
+    s_line_wr           = 0;
+    s_line_arrived      = 0;
+    s_corrupt_pn        = 0;
+
+    file_info.p_name_buf    = file_name;
+    file_info.buf_size      = ARRAY_SIZE(file_name);
+    xf_ret = xf_ymodem_recv_handshake(&s_rx, &file_info);
+    if (xf_ret != XF_OK) {
+        return xf_ret;
+    }
+    while (1) {
+        xf_ret = xf_ymodem_recv_data(&s_rx, &p_data, &data_len);
+        if (xf_ret != XF_OK) {
+            break;
+        }
+        s_stat.recv_bytes += data_len;
+    }
+
+    if ((xf_ret != XF_ERR_RESOURCE) || (s_stat.recv_bytes != BENCH_FILE_LEN)) {
+        return XF_FAIL;
+    }
+    return XF_OK;
+}
+
+static int32_t app_read(void *dst, uint32_t size, uint32_t timeout_ms)
+{
+    uint32_t len;
+
+    s_stat.read_calls++;
+    s_line_arrived = s_line_wr;
+    len = s_line_wr - s_line_rd;
+    if (len == 0) {
+        /* 没有数据时真实的 read 会等待到超时 */
+        s_stat.idle_us += (uint64_t)timeout_ms * 1000;
+        return 0;
+    }
+    if (len > size) {
+        len = size;
+    }
+    xf_memcpy(dst, &s_line[s_line_rd], len);
+    s_line_rd          += len;
+    s_stat.read_bytes  += len;
+    s_stat.line_us     += (uint64_t)len * BENCH_BITS_PER_BYTE * 1000000 / BENCH_BAUDRATE;
+    return (int32_t)len;
+}
+
+static int32_t app_write(const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    uint32_t i;
+
+    UNUSED(timeout_ms);
+    for (i = 0; i < size; i++) {
+        app_tx_input(((const uint8_t *)src)[i]);
+    }
+    return (int32_t)size;
+}
+
+static void app_flush(void)
+{
+    s_stat.flush_calls++;
+    if (s_line_arrived > s_line_rd) {
+        /* 被丢弃的数据也占用了线路 */
+        s_stat.flush_bytes += s_line_arrived - s_line_rd;
+        s_stat.line_us     += (uint64_t)(s_line_arrived - s_line_rd)
+                              * BENCH_BITS_PER_BYTE * 1000000 / BENCH_BAUDRATE;
+        s_line_rd = s_line_arrived;
+    }
+}
+
+static void app_delay_ms(uint32_t ms)
+{
+    s_stat.idle_us += (uint64_t)ms * 1000;
+}
+
+static void app_tx_queue(const uint8_t *p_buf, uint32_t len)
+{
+    /* 追加到线路上，出错包未读完的部分仍在重发包之前 */
+    if (s_line_rd > 0) {
+        xf_memmove(s_line, &s_line[s_line_rd], s_line_wr - s_line_rd);
+        s_line_wr          -= s_line_rd;
+        s_line_arrived      = (s_line_arrived > s_line_rd) ? (s_line_arrived - s_line_rd) : 0;
+        s_line_rd           = 0;
+    }
+    if (s_line_wr + len > BENCH_LINE_SIZE) {
+        return;
+    }
+    xf_memcpy(&s_line[s_line_wr], p_buf, len);
+    s_line_wr += len;
+}
+
+static void app_tx_build_data(void)
+{
+    uint32_t data_len   = 0;
+    uint32_t i;
+
+    xf_ymodem_send_get_packet_data_len(&s_tx, &data_len);
+    for (i = 0; i < data_len; i++) {
+        s_tx.p_pkt[XF_YMODEM_DATA_IDX + i] = (uint8_t)(s_tx.file_len_transmitted + i);
+    }
+    xf_ymodem_send_regular_packet_data(&s_tx, data_len);
+    xf_ymodem_send_prepare_packet_protocol_segment(&s_tx);
+    s_tx.data_len = data_len;   /*!< 应答后累计的是有效长度 */
+}
+
+static void app_tx_input(uint8_t ch)
+{
+    xf_ymodem_file_info_t   info    = {0};
+    uint8_t                 eot     = XF_YMODEM_EOT;
+    uint32_t                offset;
+    uint32_t                i;
+
+    switch (s_tx_stage) {
+    case APP_TX_WAIT_C: {
+        if (ch != XF_YMODEM_C) {
+            break;
+        }
+        info.p_name_buf = "bench.bin";
+        info.buf_size   = sizeof("bench.bin");
+        info.file_len   = BENCH_FILE_LEN;
+        xf_ymodem_prepare_file_info(&s_tx, &info);
+        xf_ymodem_send_prepare_packet_protocol_segment(&s_tx);
+        s_tx.state = XF_YMODEM_SEND_FILE_DATA;
+        app_tx_queue(s_tx.p_pkt, s_tx.packet_len);
+        s_tx_stage = APP_TX_INFO;
+    } break;
+    case APP_TX_INFO: {
+        if (ch != XF_YMODEM_C) {
+            break;
+        }
+        s_tx.packet_num = 1;
+        app_tx_build_data();
+        s_tx_stage = APP_TX_DATA;
+        goto l_send_data;
+    }
+    case APP_TX_DATA: {
+        if (ch == XF_YMODEM_NAK) {
+            goto l_send_data;
+        }
+        if (ch != XF_YMODEM_ACK) {
+            break;
+        }
+        s_tx.packet_num++;
+        s_tx.file_len_transmitted += s_tx.data_len;
+        if (s_tx.file_len_transmitted >= s_tx.file_len) {
+            app_tx_queue(&eot, 1);
+            s_tx_stage = APP_TX_EOT;
+            break;
+        }
+        app_tx_build_data();
+        goto l_send_data;
+    }
+    case APP_TX_EOT: {
+        if (ch == XF_YMODEM_NAK) {
+            app_tx_queue(&eot, 1);
+        } else if (ch == XF_YMODEM_ACK) {
+            s_tx_stage = APP_TX_NULL_INFO;
+        }
+    } break;
+    case APP_TX_NULL_INFO: {
+        if (ch != XF_YMODEM_C) {
+            break;
+        }
+        s_tx.packet_num = 0;
+        xf_memset(&s_tx.p_pkt[XF_YMODEM_DATA_IDX], 0, XF_YMODEM_SOH_DATA_SIZE);
+        xf_ymodem_send_regular_packet_data(&s_tx, XF_YMODEM_SOH_DATA_SIZE);
+        xf_ymodem_send_prepare_packet_protocol_segment(&s_tx);
+        app_tx_queue(s_tx.p_pkt, s_tx.packet_len);
+        s_tx_stage = APP_TX_END;
+    } break;
+    default:
+        break;
+    }
+    return;
+
+l_send_data:;
+    s_stat.packets++;
+    app_tx_queue(s_tx.p_pkt, s_tx.packet_len);
+    if ((BENCH_ERR_INTERVAL > 0) && ((s_tx.packet_num % BENCH_ERR_INTERVAL) == 0)
+            && (s_corrupt_pn != s_tx.packet_num)) {
+        /* 只破坏线路上首次发送的副本 */
+        offset = (s_stat.errors * 131) % s_tx.packet_len;
+        for (i = offset; (i < offset + BENCH_BURST_LEN) && (i < s_tx.packet_len); i++) {
+            s_line[s_line_wr - s_tx.packet_len + i] ^= 0x55;
+        }
+        s_stat.errors++;
+        s_corrupt_pn = s_tx.packet_num;
+    }
+}
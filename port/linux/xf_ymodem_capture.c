@@ -0,0 +1,669 @@
+/**
+ * @file xf_ymodem_capture.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem 链路记录与回放: 包装 xf_ymodem_ops_t, 把每次 read/write/flush/delay_ms
+ *        的参数、结果、读到的数据及时间写入文件，之后在工作站上按记录重新驱动一端。
+ * @version 1.0
+ * @date 2025-01-07
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "xf_ymodem_capture.h"
+
+/* ==================== [Defines] =========================================== */
+
+#if XF_YMODEM_CAPTURE_NUM > 4
+#   error "XF_YMODEM_CAPTURE_NUM must not exceed 4"
+#endif
+
+#if !defined(min)
+#   define min(x, y)                    (((x) < (y)) ? (x) : (y))
+#endif
+
+/* 记录中数据之前部分的最大长度: 操作 + 5 个 64 位变长整数 */
+#define XF_YMODEM_CAPTURE_REC_MAX       (1 + 5 * 10)
+
+/* ==================== [Typedefs] ========================================== */
+
+/* 解析出的一条记录 */
+typedef struct _xf_ymodem_capture_rec_t {
+    uint8_t         op;
+    uint64_t        dt_us;
+    uint64_t        size;           /*!< READ/WRITE: size; DELAY: ms */
+    uint64_t        timeout_ms;
+    uint64_t        dur_us;
+    int64_t         ret;
+    const uint8_t  *p_data;         /*!< READ: 读到的数据; WRITE: 保存的数据 */
+    uint32_t        data_len;
+    uint32_t        next;           /*!< 下一条记录的位置 */
+} xf_ymodem_capture_rec_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int32_t xf_ymodem_capture_read(
+    xf_ymodem_capture_t *p_cap, void *dst, uint32_t size, uint32_t timeout_ms);
+static int32_t xf_ymodem_capture_write(
+    xf_ymodem_capture_t *p_cap, const void *src, uint32_t size, uint32_t timeout_ms);
+static void xf_ymodem_capture_flush(xf_ymodem_capture_t *p_cap);
+static void xf_ymodem_capture_delay_ms(xf_ymodem_capture_t *p_cap, uint32_t ms);
+
+static int32_t xf_ymodem_replay_read(
+    xf_ymodem_capture_t *p_cap, void *dst, uint32_t size, uint32_t timeout_ms);
+static int32_t xf_ymodem_replay_write(
+    xf_ymodem_capture_t *p_cap, const void *src, uint32_t size, uint32_t timeout_ms);
+static void xf_ymodem_replay_op(xf_ymodem_capture_t *p_cap, uint8_t op, uint32_t arg);
+static bool xf_ymodem_replay_find(
+    xf_ymodem_capture_t *p_cap, uint8_t op, xf_ymodem_capture_rec_t *p_rec);
+static bool xf_ymodem_replay_parse(
+    const xf_ymodem_capture_t *p_cap, uint32_t pos, xf_ymodem_capture_rec_t *p_rec);
+static void xf_ymodem_replay_count(xf_ymodem_capture_t *p_cap, const xf_ymodem_capture_rec_t *p_rec);
+static void xf_ymodem_replay_diverge(xf_ymodem_capture_t *p_cap, const char *p_what);
+
+static uint64_t xf_ymodem_capture_now_us(xf_ymodem_capture_t *p_cap);
+static void xf_ymodem_capture_io(
+    xf_ymodem_capture_t *p_cap, uint8_t op, uint64_t t0_us, uint32_t size,
+    uint32_t timeout_ms, int32_t ret, const void *p_data, uint32_t data_len);
+static void xf_ymodem_capture_emit(
+    xf_ymodem_capture_t *p_cap, uint8_t op, uint64_t t0_us,
+    const uint64_t *p_args, uint32_t arg_num, const void *p_data, uint32_t data_len);
+static uint32_t xf_ymodem_capture_put_varint(uint8_t *p_buf, uint64_t val);
+static bool xf_ymodem_capture_get_varint(
+    const uint8_t *p_buf, uint32_t size, uint32_t *p_pos, uint64_t *p_val);
+static void xf_ymodem_capture_put_u32(uint8_t *p_buf, uint32_t val);
+static uint32_t xf_ymodem_capture_get_u32(const uint8_t *p_buf);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_capture";
+
+static xf_ymodem_capture_t *sp_slots[XF_YMODEM_CAPTURE_NUM];
+
+/* ==================== [Macros] ============================================ */
+
+/* 每个回调组把调用转给绑定的链路，按链路是记录还是回放分别处理 */
+#define XF_YMODEM_CAPTURE_SLOT_DEFINE(n) \
+    static int32_t xf_ymodem_capture_read_##n(void *dst, uint32_t size, uint32_t timeout_ms) \
+    { \
+        return (sp_slots[n]->is_replay) \
+               ? xf_ymodem_replay_read(sp_slots[n], dst, size, timeout_ms) \
+               : xf_ymodem_capture_read(sp_slots[n], dst, size, timeout_ms); \
+    } \
+    static int32_t xf_ymodem_capture_write_##n(const void *src, uint32_t size, uint32_t timeout_ms) \
+    { \
+        return (sp_slots[n]->is_replay) \
+               ? xf_ymodem_replay_write(sp_slots[n], src, size, timeout_ms) \
+               : xf_ymodem_capture_write(sp_slots[n], src, size, timeout_ms); \
+    } \
+    static void xf_ymodem_capture_flush_##n(void) \
+    { \
+        if (sp_slots[n]->is_replay) { \
+            xf_ymodem_replay_op(sp_slots[n], XF_YMODEM_CAPTURE_OP_FLUSH, 0); \
+        } else { \
+            xf_ymodem_capture_flush(sp_slots[n]); \
+        } \
+    } \
+    static void xf_ymodem_capture_delay_ms_##n(uint32_t ms) \
+    { \
+        if (sp_slots[n]->is_replay) { \
+            xf_ymodem_replay_op(sp_slots[n], XF_YMODEM_CAPTURE_OP_DELAY, ms); \
+        } else { \
+            xf_ymodem_capture_delay_ms(sp_slots[n], ms); \
+        } \
+    }
+
+#define XF_YMODEM_CAPTURE_SLOT_OPS(n) \
+    { \
+        .read           = xf_ymodem_capture_read_##n, \
+        .write          = xf_ymodem_capture_write_##n, \
+        .flush          = xf_ymodem_capture_flush_##n, \
+        .delay_ms       = xf_ymodem_capture_delay_ms_##n, \
+        .user_parse     = NULL, \
+        .user_file_info = NULL, \
+    }
+
+XF_YMODEM_CAPTURE_SLOT_DEFINE(0)
+XF_YMODEM_CAPTURE_SLOT_DEFINE(1)
+XF_YMODEM_CAPTURE_SLOT_DEFINE(2)
+XF_YMODEM_CAPTURE_SLOT_DEFINE(3)
+
+static const xf_ymodem_ops_t sc_slot_ops[4] = {
+    XF_YMODEM_CAPTURE_SLOT_OPS(0), XF_YMODEM_CAPTURE_SLOT_OPS(1),
+    XF_YMODEM_CAPTURE_SLOT_OPS(2), XF_YMODEM_CAPTURE_SLOT_OPS(3),
+};
+
+/* ==================== [Global Functions] ================================== */
+
+xf_err_t xf_ymodem_capture_open(
+    xf_ymodem_capture_t *p_cap, const char *p_path,
+    const xf_ymodem_ops_t *p_ops, const xf_ymodem_t *p_ym, bool is_send)
+{
+    uint8_t hdr[XF_YMODEM_CAPTURE_HDR_SIZE] = {0};
+
+    if ((NULL == p_cap) || (NULL == p_path) || (NULL == p_ops) || (NULL == p_ym)) {
+        return XF_ERR_INVALID_ARG;
+    }
+
+    p_cap->p_ops            = p_ops;
+    p_cap->p_data           = NULL;
+    p_cap->is_replay        = false;
+    p_cap->slot             = -1;
+    p_cap->hdr.is_send      = is_send;
+    p_cap->hdr.flags        = p_ym->flags;
+    p_cap->hdr.buf_size     = p_ym->buf_size;
+    p_cap->hdr.timeout_ms   = p_ym->timeout_ms;
+    p_cap->hdr.retry_num    = p_ym->retry_num;
+    memset(&p_cap->stat, 0, sizeof(p_cap->stat));
+
+    p_cap->p_fp = fopen(p_path, "wb");
+    if (NULL == p_cap->p_fp) {
+        XF_LOGE(TAG, "open %s failed", p_path);
+        return XF_FAIL;
+    }
+
+    memcpy(hdr, XF_YMODEM_CAPTURE_MAGIC, 4);
+    hdr[4] = (uint8_t)(XF_YMODEM_CAPTURE_VERSION);
+    hdr[5] = (uint8_t)(XF_YMODEM_CAPTURE_VERSION >> 8);
+    hdr[6] = p_cap->hdr.is_send;
+    xf_ymodem_capture_put_u32(&hdr[8],  p_cap->hdr.flags);
+    xf_ymodem_capture_put_u32(&hdr[12], p_cap->hdr.buf_size);
+    xf_ymodem_capture_put_u32(&hdr[16], p_cap->hdr.timeout_ms);
+    xf_ymodem_capture_put_u32(&hdr[20], p_cap->hdr.retry_num);
+    fwrite(hdr, 1, sizeof(hdr), p_cap->p_fp);
+
+    p_cap->t_last_us = xf_ymodem_capture_now_us(p_cap);
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_replay_open(
+    xf_ymodem_capture_t *p_cap, const char *p_path, xf_ymodem_replay_mode_t mode)
+{
+    FILE   *p_fp;
+    long    len;
+
+    if ((NULL == p_cap) || (NULL == p_path)) {
+        return XF_ERR_INVALID_ARG;
+    }
+
+    memset(p_cap, 0, sizeof(*p_cap));
+    p_cap->slot         = -1;
+    p_cap->is_replay    = true;
+    p_cap->mode         = (uint8_t)mode;
+
+    p_fp = fopen(p_path, "rb");
+    if (NULL == p_fp) {
+        XF_LOGE(TAG, "open %s failed", p_path);
+        return XF_FAIL;
+    }
+    fseek(p_fp, 0, SEEK_END);
+    len = ftell(p_fp);
+    fseek(p_fp, 0, SEEK_SET);
+    if ((len < XF_YMODEM_CAPTURE_HDR_SIZE) || (len > INT32_MAX)) {
+        fclose(p_fp);
+        return XF_ERR_NOT_SUPPORTED;
+    }
+    p_cap->p_data = (uint8_t *)malloc((size_t)len);
+    if ((NULL == p_cap->p_data)
+            || (fread(p_cap->p_data, 1, (size_t)len, p_fp) != (size_t)len)) {
+        fclose(p_fp);
+        free(p_cap->p_data);
+        p_cap->p_data = NULL;
+        return XF_FAIL;
+    }
+    fclose(p_fp);
+    p_cap->size = (uint32_t)len;
+
+    if ((memcmp(p_cap->p_data, XF_YMODEM_CAPTURE_MAGIC, 4) != 0)
+            || ((p_cap->p_data[4] | (p_cap->p_data[5] << 8)) != XF_YMODEM_CAPTURE_VERSION)) {
+        free(p_cap->p_data);
+        p_cap->p_data = NULL;
+        return XF_ERR_NOT_SUPPORTED;
+    }
+    p_cap->hdr.is_send      = p_cap->p_data[6];
+    p_cap->hdr.flags        = xf_ymodem_capture_get_u32(&p_cap->p_data[8]);
+    p_cap->hdr.buf_size     = xf_ymodem_capture_get_u32(&p_cap->p_data[12]);
+    p_cap->hdr.timeout_ms   = xf_ymodem_capture_get_u32(&p_cap->p_data[16]);
+    p_cap->hdr.retry_num    = xf_ymodem_capture_get_u32(&p_cap->p_data[20]);
+
+    xf_ymodem_replay_rewind(p_cap);
+
+    return XF_OK;
+}
+
+void xf_ymodem_replay_rewind(xf_ymodem_capture_t *p_cap)
+{
+    if ((NULL == p_cap) || (!p_cap->is_replay)) {
+        return;
+    }
+    p_cap->pos          = XF_YMODEM_CAPTURE_HDR_SIZE;
+    p_cap->stream_off   = 0;
+    memset(&p_cap->stat, 0, sizeof(p_cap->stat));
+}
+
+xf_err_t xf_ymodem_replay_file_info(
+    xf_ymodem_capture_t *p_cap, const uint8_t **pp_data, uint32_t *p_size)
+{
+    xf_ymodem_capture_rec_t rec;
+    uint32_t pos;
+
+    if ((NULL == p_cap) || (!p_cap->is_replay) || (NULL == pp_data) || (NULL == p_size)) {
+        return XF_ERR_INVALID_ARG;
+    }
+
+    for (pos = XF_YMODEM_CAPTURE_HDR_SIZE;
+            xf_ymodem_replay_parse(p_cap, pos, &rec); pos = rec.next) {
+        if ((rec.op == XF_YMODEM_CAPTURE_OP_WRITE)
+                && (rec.data_len == XF_YMODEM_SOH_PACKET_SIZE)
+                && (rec.p_data[XF_YMODEM_HEADER_IDX] == XF_YMODEM_SOH)
+                && (rec.p_data[XF_YMODEM_PN_IDX] == 0)) {
+            *pp_data    = &rec.p_data[XF_YMODEM_DATA_IDX];
+            *p_size     = XF_YMODEM_SOH_DATA_SIZE;
+            return XF_OK;
+        }
+    }
+
+    return XF_ERR_NOT_FOUND;
+}
+
+xf_err_t xf_ymodem_capture_close(xf_ymodem_capture_t *p_cap)
+{
+    if (NULL == p_cap) {
+        return XF_ERR_INVALID_ARG;
+    }
+
+    if (p_cap->p_fp != NULL) {
+        fclose(p_cap->p_fp);
+        p_cap->p_fp = NULL;
+    }
+    free(p_cap->p_data);
+    p_cap->p_data = NULL;
+    if ((p_cap->slot >= 0) && (sp_slots[p_cap->slot] == p_cap)) {
+        sp_slots[p_cap->slot] = NULL;
+    }
+    p_cap->slot = -1;
+
+    return XF_OK;
+}
+
+const xf_ymodem_ops_t *xf_ymodem_capture_get_ops(xf_ymodem_capture_t *p_cap)
+{
+    int i;
+
+    if ((NULL == p_cap) || ((NULL == p_cap->p_fp) && (NULL == p_cap->p_data))) {
+        return NULL;
+    }
+    if ((p_cap->slot >= 0) && (sp_slots[p_cap->slot] == p_cap)) {
+        return &sc_slot_ops[p_cap->slot];
+    }
+
+    for (i = 0; i < XF_YMODEM_CAPTURE_NUM; i++) {
+        if (NULL == sp_slots[i]) {
+            sp_slots[i]     = p_cap;
+            p_cap->slot     = (int8_t)i;
+            return &sc_slot_ops[i];
+        }
+    }
+
+    XF_LOGE(TAG, "no free slot, XF_YMODEM_CAPTURE_NUM:%d", XF_YMODEM_CAPTURE_NUM);
+
+    return NULL;
+}
+
+/* ==================== [Static Functions] ================================== */
+
+/* capture */
+
+static int32_t xf_ymodem_capture_read(
+    xf_ymodem_capture_t *p_cap, void *dst, uint32_t size, uint32_t timeout_ms)
+{
+    uint64_t    t0      = xf_ymodem_capture_now_us(p_cap);
+    int32_t     ret     = p_cap->p_ops->read(dst, size, timeout_ms);
+
+    xf_ymodem_capture_io(p_cap, XF_YMODEM_CAPTURE_OP_READ, t0, size, timeout_ms, ret,
+                         dst, (ret > 0) ? min((uint32_t)ret, size) : 0);
+    p_cap->stat.reads++;
+    p_cap->stat.read_timeouts  += (ret == 0) ? 1 : 0;
+    p_cap->stat.read_bytes     += (ret > 0) ? (uint32_t)ret : 0;
+
+    return ret;
+}
+
+static int32_t xf_ymodem_capture_write(
+    xf_ymodem_capture_t *p_cap, const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    uint64_t    t0      = xf_ymodem_capture_now_us(p_cap);
+    int32_t     ret     = p_cap->p_ops->write(src, size, timeout_ms);
+
+    xf_ymodem_capture_io(p_cap, XF_YMODEM_CAPTURE_OP_WRITE, t0, size, timeout_ms, ret,
+                         src, (size <= XF_YMODEM_CAPTURE_WRITE_KEEP) ? size : min(size, 1));
+    p_cap->stat.writes++;
+    p_cap->stat.write_bytes    += (ret > 0) ? (uint32_t)ret : 0;
+
+    return ret;
+}
+
+static void xf_ymodem_capture_flush(xf_ymodem_capture_t *p_cap)
+{
+    uint64_t t0 = xf_ymodem_capture_now_us(p_cap);
+
+    p_cap->p_ops->flush();
+    xf_ymodem_capture_emit(p_cap, XF_YMODEM_CAPTURE_OP_FLUSH, t0, NULL, 0, NULL, 0);
+}
+
+static void xf_ymodem_capture_delay_ms(xf_ymodem_capture_t *p_cap, uint32_t ms)
+{
+    uint64_t t0     = xf_ymodem_capture_now_us(p_cap);
+    uint64_t arg    = ms;
+
+    p_cap->p_ops->delay_ms(ms);
+    xf_ymodem_capture_emit(p_cap, XF_YMODEM_CAPTURE_OP_DELAY, t0, &arg, 1, NULL, 0);
+}
+
+/* replay */
+
+static int32_t xf_ymodem_replay_read(
+    xf_ymodem_capture_t *p_cap, void *dst, uint32_t size, uint32_t timeout_ms)
+{
+    xf_ymodem_capture_rec_t rec;
+    uint32_t len;
+
+    if (p_cap->mode == XF_YMODEM_REPLAY_STREAM) {
+        /* 从当前 READ 记录中剩余的数据交出，用完时前进到下一条 READ 记录 */
+        while (xf_ymodem_replay_parse(p_cap, p_cap->pos, &rec)) {
+            if (rec.op != XF_YMODEM_CAPTURE_OP_READ) {
+                xf_ymodem_replay_count(p_cap, &rec);
+                p_cap->pos = rec.next;
+                continue;
+            }
+            if (rec.ret <= 0) {
+                /* 记录中的超时: 在相同位置返回 0 */
+                xf_ymodem_replay_count(p_cap, &rec);
+                p_cap->pos = rec.next;
+                return 0;
+            }
+            len = min(size, rec.data_len - p_cap->stream_off);
+            memcpy(dst, &rec.p_data[p_cap->stream_off], len);
+            p_cap->stream_off += len;
+            if (p_cap->stream_off >= rec.data_len) {
+                xf_ymodem_replay_count(p_cap, &rec);
+                p_cap->stream_off   = 0;
+                p_cap->pos          = rec.next;
+            }
+            return (int32_t)len;
+        }
+        return 0;
+    }
+
+    if (!xf_ymodem_replay_find(p_cap, XF_YMODEM_CAPTURE_OP_READ, &rec)) {
+        /* 记录已用完，对方不再有数据 */
+        return 0;
+    }
+    if ((rec.size != size) || (rec.timeout_ms != timeout_ms)) {
+        xf_ymodem_replay_diverge(p_cap, "read size/timeout");
+    }
+    if (rec.ret <= 0) {
+        return (int32_t)rec.ret;
+    }
+    len = min(size, rec.data_len);
+    memcpy(dst, rec.p_data, len);
+
+    return (int32_t)len;
+}
+
+static int32_t xf_ymodem_replay_write(
+    xf_ymodem_capture_t *p_cap, const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    xf_ymodem_capture_rec_t rec;
+
+    (void)timeout_ms;
+    if (p_cap->mode == XF_YMODEM_REPLAY_STREAM) {
+        p_cap->stat.writes++;
+        p_cap->stat.write_bytes += size;
+        return (int32_t)size;
+    }
+
+    if (!xf_ymodem_replay_find(p_cap, XF_YMODEM_CAPTURE_OP_WRITE, &rec)) {
+        return (int32_t)size;
+    }
+    if ((rec.size != size)
+            || ((size > 0) && (rec.data_len > 0)
+                && (rec.p_data[0] != ((const uint8_t *)src)[0]))) {
+        xf_ymodem_replay_diverge(p_cap, "write size/header");
+    }
+
+    return (int32_t)rec.ret;
+}
+
+static void xf_ymodem_replay_op(xf_ymodem_capture_t *p_cap, uint8_t op, uint32_t arg)
+{
+    xf_ymodem_capture_rec_t rec;
+
+    (void)arg;
+    if (p_cap->mode == XF_YMODEM_REPLAY_STREAM) {
+        return;
+    }
+    if (!xf_ymodem_replay_parse(p_cap, p_cap->pos, &rec)) {
+        return;
+    }
+    if (rec.op != op) {
+        /* 不消耗记录，之后的 read/write 仍能对上 */
+        xf_ymodem_replay_diverge(p_cap, (op == XF_YMODEM_CAPTURE_OP_FLUSH) ? "flush" : "delay");
+        return;
+    }
+    xf_ymodem_replay_count(p_cap, &rec);
+    p_cap->pos = rec.next;
+}
+
+/* 取下一条 op 记录，跳过的其他记录计为不一致 */
+static bool xf_ymodem_replay_find(
+    xf_ymodem_capture_t *p_cap, uint8_t op, xf_ymodem_capture_rec_t *p_rec)
+{
+    while (xf_ymodem_replay_parse(p_cap, p_cap->pos, p_rec)) {
+        xf_ymodem_replay_count(p_cap, p_rec);
+        p_cap->pos = p_rec->next;
+        if (p_rec->op == op) {
+            return true;
+        }
+        /* 回放中没有对应调用的 FLUSH/DELAY 只是时序不同，不影响数据 */
+        if ((p_rec->op == XF_YMODEM_CAPTURE_OP_READ) || (p_rec->op == XF_YMODEM_CAPTURE_OP_WRITE)) {
+            xf_ymodem_replay_diverge(p_cap, "skipped record");
+        }
+    }
+
+    return false;
+}
+
+static bool xf_ymodem_replay_parse(
+    const xf_ymodem_capture_t *p_cap, uint32_t pos, xf_ymodem_capture_rec_t *p_rec)
+{
+    const uint8_t  *p_buf   = p_cap->p_data;
+    uint32_t        size    = p_cap->size;
+    uint64_t        zz      = 0;
+    uint32_t        keep    = 0;
+
+    if (pos >= size) {
+        return false;
+    }
+    memset(p_rec, 0, sizeof(*p_rec));
+    p_rec->op = p_buf[pos++];
+    if (!xf_ymodem_capture_get_varint(p_buf, size, &pos, &p_rec->dt_us)) {
+        return false;
+    }
+
+    switch (p_rec->op) {
+    case XF_YMODEM_CAPTURE_OP_READ:
+    case XF_YMODEM_CAPTURE_OP_WRITE: {
+        if (!xf_ymodem_capture_get_varint(p_buf, size, &pos, &p_rec->size)
+                || !xf_ymodem_capture_get_varint(p_buf, size, &pos, &p_rec->timeout_ms)
+                || !xf_ymodem_capture_get_varint(p_buf, size, &pos, &p_rec->dur_us)
+                || !xf_ymodem_capture_get_varint(p_buf, size, &pos, &zz)) {
+            return false;
+        }
+        p_rec->ret = (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+        if (p_rec->op == XF_YMODEM_CAPTURE_OP_READ) {
+            keep = (p_rec->ret > 0) ? (uint32_t)min((uint64_t)p_rec->ret, p_rec->size) : 0;
+        } else {
+            keep = (p_rec->size <= XF_YMODEM_CAPTURE_WRITE_KEEP)
+                   ? (uint32_t)p_rec->size : min((uint32_t)p_rec->size, 1);
+        }
+        if (keep > size - pos) {
+            return false;
+        }
+        p_rec->p_data   = &p_buf[pos];
+        p_rec->data_len = keep;
+        pos            += keep;
+    } break;
+    case XF_YMODEM_CAPTURE_OP_FLUSH: {
+    } break;
+    case XF_YMODEM_CAPTURE_OP_DELAY: {
+        if (!xf_ymodem_capture_get_varint(p_buf, size, &pos, &p_rec->size)) {
+            return false;
+        }
+    } break;
+    default:
+        XF_LOGE(TAG, "bad record op %d at %u", (int)p_rec->op, (unsigned)(pos - 1));
+        return false;
+    }
+    p_rec->next = pos;
+
+    return true;
+}
+
+/* 按记录中的时间累计统计 */
+static void xf_ymodem_replay_count(xf_ymodem_capture_t *p_cap, const xf_ymodem_capture_rec_t *p_rec)
+{
+    p_cap->stat.records++;
+    p_cap->stat.total_us += p_rec->dt_us + p_rec->dur_us;
+    if (p_rec->op == XF_YMODEM_CAPTURE_OP_READ) {
+        p_cap->stat.reads++;
+        p_cap->stat.read_timeouts  += (p_rec->ret == 0) ? 1 : 0;
+        p_cap->stat.read_bytes     += p_rec->data_len;
+        p_cap->stat.read_us        += p_rec->dur_us;
+    } else if ((p_rec->op == XF_YMODEM_CAPTURE_OP_WRITE) && (p_cap->mode != XF_YMODEM_REPLAY_STREAM)) {
+        p_cap->stat.writes++;
+        p_cap->stat.write_bytes    += (p_rec->ret > 0) ? (uint64_t)p_rec->ret : 0;
+    }
+}
+
+static void xf_ymodem_replay_diverge(xf_ymodem_capture_t *p_cap, const char *p_what)
+{
+    if (p_cap->stat.diverged == 0) {
+        XF_LOGE(TAG, "replay diverged at record %llu (offset %u): %s",
+                (unsigned long long)p_cap->stat.records, (unsigned)p_cap->pos, p_what);
+    }
+    p_cap->stat.diverged++;
+}
+
+/* file */
+
+static uint64_t xf_ymodem_capture_now_us(xf_ymodem_capture_t *p_cap)
+{
+    struct timespec ts;
+
+    if (p_cap->now_us != NULL) {
+        return p_cap->now_us();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+/* READ/WRITE 记录: 在 p_ops 返回后调用，耗时为 t0_us 到现在 */
+static void xf_ymodem_capture_io(
+    xf_ymodem_capture_t *p_cap, uint8_t op, uint64_t t0_us, uint32_t size,
+    uint32_t timeout_ms, int32_t ret, const void *p_data, uint32_t data_len)
+{
+    uint64_t args[4];
+
+    args[0] = size;
+    args[1] = timeout_ms;
+    args[2] = xf_ymodem_capture_now_us(p_cap) - t0_us;
+    args[3] = ((uint64_t)(int64_t)ret << 1) ^ (uint64_t)((int64_t)ret >> 63);
+    xf_ymodem_capture_emit(p_cap, op, t0_us, args, ARRAY_SIZE(args), p_data, data_len);
+}
+
+/* 写入一条记录: 操作，距上一条记录结束的时间，p_args, 数据; 记录结束时刻为现在 */
+static void xf_ymodem_capture_emit(
+    xf_ymodem_capture_t *p_cap, uint8_t op, uint64_t t0_us,
+    const uint64_t *p_args, uint32_t arg_num, const void *p_data, uint32_t data_len)
+{
+    uint8_t     buf[XF_YMODEM_CAPTURE_REC_MAX];
+    uint32_t    len = 0;
+    uint32_t    i;
+
+    buf[len++]  = op;
+    len        += xf_ymodem_capture_put_varint(&buf[len],
+                  (t0_us > p_cap->t_last_us) ? (t0_us - p_cap->t_last_us) : 0);
+    for (i = 0; i < arg_num; i++) {
+        len    += xf_ymodem_capture_put_varint(&buf[len], p_args[i]);
+    }
+    fwrite(buf, 1, len, p_cap->p_fp);
+    if (data_len > 0) {
+        fwrite(p_data, 1, data_len, p_cap->p_fp);
+    }
+    t0_us               = p_cap->t_last_us;
+    p_cap->t_last_us    = xf_ymodem_capture_now_us(p_cap);
+    p_cap->stat.records++;
+    p_cap->stat.total_us += p_cap->t_last_us - t0_us;
+    if (op == XF_YMODEM_CAPTURE_OP_READ) {
+        p_cap->stat.read_us += p_args[2];
+    }
+}
+
+static uint32_t xf_ymodem_capture_put_varint(uint8_t *p_buf, uint64_t val)
+{
+    uint32_t len = 0;
+
+    do {
+        p_buf[len] = (uint8_t)(val & 0x7F);
+        val >>= 7;
+        if (val != 0) {
+            p_buf[len] |= 0x80;
+        }
+        len++;
+    } while (val != 0);
+
+    return len;
+}
+
+static bool xf_ymodem_capture_get_varint(
+    const uint8_t *p_buf, uint32_t size, uint32_t *p_pos, uint64_t *p_val)
+{
+    uint64_t    val     = 0;
+    uint32_t    shift   = 0;
+    uint8_t     byte;
+
+    do {
+        if ((*p_pos >= size) || (shift >= 64)) {
+            return false;
+        }
+        byte    = p_buf[(*p_pos)++];
+        val    |= (uint64_t)(byte & 0x7F) << shift;
+        shift  += 7;
+    } while (byte & 0x80);
+    *p_val = val;
+
+    return true;
+}
+
+static void xf_ymodem_capture_put_u32(uint8_t *p_buf, uint32_t val)
+{
+    p_buf[0] = (uint8_t)(val);
+    p_buf[1] = (uint8_t)(val >> 8);
+    p_buf[2] = (uint8_t)(val >> 16);
+    p_buf[3] = (uint8_t)(val >> 24);
+}
+
+static uint32_t xf_ymodem_capture_get_u32(const uint8_t *p_buf)
+{
+    return (uint32_t)p_buf[0] | ((uint32_t)p_buf[1] << 8)
+           | ((uint32_t)p_buf[2] << 16) | ((uint32_t)p_buf[3] << 24);
+}
@@ -0,0 +1,204 @@
+/**
+ * @file xf_ymodem_capture.h
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem 链路记录与回放: 包装 xf_ymodem_ops_t, 把每次 read/write/flush/delay_ms
+ *        的参数、结果、读到的数据及时间写入文件，之后在工作站上按记录重新驱动一端。
+ * @version 1.0
+ * @date 2025-01-07
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 文件格式(小端):
+ *      文件头 24 字节: "XFYC", 版本(u16), 角色(u8, 0 接收 / 1 发送), 保留(u8),
+ *                      flags, buf_size, timeout_ms, retry_num (u32)
+ *      记录:   操作(u8), 距上一条记录结束的时间(us), 之后按操作:
+ *              READ    size, timeout_ms, 耗时(us), 结果(zigzag), 读到的数据
+ *              WRITE   size, timeout_ms, 耗时(us), 结果(zigzag), 数据
+ *              FLUSH   -
+ *              DELAY   ms
+ *      除操作外的整数均为 LEB128 变长编码。
+ *      WRITE 的数据不超过 XF_YMODEM_CAPTURE_WRITE_KEEP 字节时完整保存(控制字符、128 字节包，
+ *      含起始帧)，更长时只保存首字节(包头)，回放只比较这一部分。
+ */
+
+#ifndef __XF_YMODEM_CAPTURE_H__
+#define __XF_YMODEM_CAPTURE_H__
+
+/* ==================== [Includes] ========================================== */
+
+#include <stdio.h>
+
+#include "xf_utils.h"
+#include "xf_ymodem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ==================== [Defines] =========================================== */
+
+/**
+ * @brief 可以同时记录或回放的链路数，用法同 XF_YMODEM_POSIX_PORT_NUM, 最大 4.
+ */
+#if !defined(XF_YMODEM_CAPTURE_NUM)
+#   define XF_YMODEM_CAPTURE_NUM        (4)
+#endif
+
+/**
+ * @brief 完整保存的写入的最大长度: 一个 128 字节包。
+ */
+#define XF_YMODEM_CAPTURE_WRITE_KEEP    (XF_YMODEM_SOH_PACKET_SIZE)
+
+#define XF_YMODEM_CAPTURE_MAGIC         "XFYC"
+#define XF_YMODEM_CAPTURE_VERSION       (1)
+#define XF_YMODEM_CAPTURE_HDR_SIZE      (24)
+
+/* ==================== [Typedefs] ========================================== */
+
+/**
+ * @brief 记录中的操作。
+ */
+typedef enum _xf_ymodem_capture_op_t {
+    XF_YMODEM_CAPTURE_OP_READ = 1,
+    XF_YMODEM_CAPTURE_OP_WRITE,
+    XF_YMODEM_CAPTURE_OP_FLUSH,
+    XF_YMODEM_CAPTURE_OP_DELAY,
+} xf_ymodem_capture_op_t;
+
+/**
+ * @brief 回放方式。
+ */
+typedef enum _xf_ymodem_replay_mode_t {
+    /**
+     * @brief 逐次调用对照: 每次调用取下一条同类记录，参数不同时计为不一致。
+     * 库及配置与记录时相同时结果完全一致，用于复现及性能分析。
+     */
+    XF_YMODEM_REPLAY_STRICT = 0,
+    /**
+     * @brief 字节流: 把记录中读到的数据按顺序交给 read, 不要求每次读取的长度相同，
+     * 记录中超时的 read 在相同位置返回 0; 忽略写入。
+     * 用于在修改过的库(如读缓存、包长设置不同)上回归测试实际的线路数据。
+     */
+    XF_YMODEM_REPLAY_STREAM,
+} xf_ymodem_replay_mode_t;
+
+/**
+ * @brief 记录文件头中的会话参数。
+ */
+typedef struct _xf_ymodem_capture_hdr_t {
+    uint8_t     is_send;            /*!< 记录的一端: 0 接收，1 发送 */
+    uint32_t    flags;              /*!< xf_ymodem_t.flags */
+    uint32_t    buf_size;           /*!< xf_ymodem_t.buf_size */
+    uint32_t    timeout_ms;         /*!< xf_ymodem_t.timeout_ms */
+    uint32_t    retry_num;          /*!< xf_ymodem_t.retry_num */
+} xf_ymodem_capture_hdr_t;
+
+/**
+ * @brief 记录或回放的统计。
+ */
+typedef struct _xf_ymodem_capture_stat_t {
+    uint64_t    records;            /*!< 已写入或已回放的记录数 */
+    uint64_t    reads;              /*!< read 次数 */
+    uint64_t    read_timeouts;      /*!< 返回 0 的 read 次数 */
+    uint64_t    read_bytes;         /*!< 读到的字节数 */
+    uint64_t    writes;             /*!< write 次数 */
+    uint64_t    write_bytes;        /*!< 写出的字节数 */
+    uint64_t    read_us;            /*!< 记录中 read 的总耗时(含等待) */
+    uint64_t    total_us;           /*!< 记录中第一条到最后一条记录的时间 */
+    uint64_t    diverged;           /*!< 回放: 与记录不一致的调用数 */
+} xf_ymodem_capture_stat_t;
+
+/**
+ * @brief 一条记录或回放中的链路。
+ */
+typedef struct _xf_ymodem_capture_t {
+    /**
+     * @brief 记录时的时钟(us)，NULL 时为 CLOCK_MONOTONIC. 在模拟链路上可以换成虚拟时钟。
+     */
+    uint64_t              (*now_us)(void);
+    const xf_ymodem_ops_t  *p_ops;      /*!< 记录: 被包装的 ops */
+    FILE                   *p_fp;       /*!< 记录: 输出文件 */
+    uint64_t                t_last_us;  /*!< 记录: 上一条记录结束的时刻 */
+    uint8_t                *p_data;     /*!< 回放: 整个记录文件 */
+    uint32_t                size;       /*!< 回放: p_data 的大小 */
+    uint32_t                pos;        /*!< 回放: 下一条记录的位置 */
+    uint32_t                stream_off; /*!< 回放(字节流): 当前 READ 记录中已交出的字节数 */
+    uint8_t                 mode;       /*!< 回放方式，见 xf_ymodem_replay_mode_t */
+    uint8_t                 is_replay;  /*!< 0 记录，1 回放 */
+    int8_t                  slot;       /*!< 占用的回调组，-1 表示未取得 ops */
+    xf_ymodem_capture_hdr_t hdr;        /*!< 文件头 */
+    xf_ymodem_capture_stat_t stat;      /*!< 统计 */
+} xf_ymodem_capture_t;
+
+/* ==================== [Global Prototypes] ================================= */
+
+/**
+ * @brief 开始记录: 写入文件头，之后通过 xf_ymodem_capture_get_ops() 的调用转给 p_ops 并记录。
+ *
+ * @param p_cap                 链路对象指针，now_us 之外的成员由此函数初始化。
+ * @param p_path                输出文件路径。
+ * @param p_ops                 被包装的 ops, 如 xf_ymodem_posix_get_ops() 的返回值。
+ * @param p_ym                  记录的一端，文件头中保存其 flags, buf_size, timeout_ms, retry_num.
+ * @param is_send               p_ym 是否为发送端。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_FAIL               打开文件失败
+ */
+xf_err_t xf_ymodem_capture_open(
+    xf_ymodem_capture_t *p_cap, const char *p_path,
+    const xf_ymodem_ops_t *p_ops, const xf_ymodem_t *p_ym, bool is_send);
+
+/**
+ * @brief 载入记录文件准备回放。
+ *
+ * @param p_cap                 链路对象指针。
+ * @param p_path                记录文件路径。
+ * @param mode                  回放方式，见 xf_ymodem_replay_mode_t.
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_ERR_NOT_SUPPORTED  不是记录文件或版本不支持
+ *      - XF_FAIL               读取失败
+ */
+xf_err_t xf_ymodem_replay_open(
+    xf_ymodem_capture_t *p_cap, const char *p_path, xf_ymodem_replay_mode_t mode);
+
+/**
+ * @brief 回放: 从头重新开始，清零统计。
+ */
+void xf_ymodem_replay_rewind(xf_ymodem_capture_t *p_cap);
+
+/**
+ * @brief 回放: 取得记录中的起始帧，用于以相同的文件名及长度回放发送端。
+ *
+ * @param p_cap                 回放中的链路对象指针。
+ * @param[out] pp_data          起始帧的数据段(文件名、'\0'、文件长度...).
+ * @param[out] p_size           数据段长。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_NOT_FOUND      记录中没有完整的起始帧
+ */
+xf_err_t xf_ymodem_replay_file_info(
+    xf_ymodem_capture_t *p_cap, const uint8_t **pp_data, uint32_t *p_size);
+
+/**
+ * @brief 结束记录(写出缓冲并关闭文件)或回放(释放载入的记录)，释放 ops 回调组。
+ */
+xf_err_t xf_ymodem_capture_close(xf_ymodem_capture_t *p_cap);
+
+/**
+ * @brief 取得绑定到此链路的 ops, 赋给 xf_ymodem_t.ops. 记录时 user_parse 及
+ *        user_file_info 不经过包装，需要时复制一份再填写。
+ *        不提供 now_ms 及 wait_readable: 每次等待的时间只取决于记录内容，回放才能与记录一致。
+ *
+ * @param p_cap                 已打开的链路对象指针。
+ * @return const xf_ymodem_ops_t* ops; 参数无效或 XF_YMODEM_CAPTURE_NUM 组回调都已占用时为 NULL.
+ */
+const xf_ymodem_ops_t *xf_ymodem_capture_get_ops(xf_ymodem_capture_t *p_cap);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __XF_YMODEM_CAPTURE_H__ */
@@ -0,0 +1,351 @@
+/**
+ * @file xf_ymodem_co.cpp
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem C++20 协程前端: executor 及 session 的实现。
+ * @version 1.0
+ * @date 2025-01-04
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <cerrno>
+#include <chrono>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "xf_ymodem_co.hpp"
+
+namespace xf_ymodem_co
+{
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_YMODEM_CO_EP_EVENTS_MAX      (64)    /*!< 一次 epoll_wait 最多取出的事件数 */
+
+/* ==================== [Static Variables] ================================== */
+
+/* epoll_event.data.ptr 为此地址时表示 eventfd 唤醒 */
+static char s_wakeup_tag;
+
+/* ==================== [Global Functions] ================================== */
+
+executor::executor()
+{
+    struct epoll_event ev = {};
+
+    m_epfd      = epoll_create1(EPOLL_CLOEXEC);
+    m_evfd      = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ev.events   = EPOLLIN;
+    ev.data.ptr = &s_wakeup_tag;
+    epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_evfd, &ev);
+}
+
+executor::~executor()
+{
+    close(m_evfd);
+    close(m_epfd);
+}
+
+void executor::spawn(task<void> t)
+{
+    m_live.fetch_add(1);
+    post(run_detached(this, std::move(t)).h);
+}
+
+void executor::run()
+{
+    struct epoll_event evs[XF_YMODEM_CO_EP_EVENTS_MAX];
+    std::vector<std::coroutine_handle<>> ready;
+    io_state   *p_st;
+    uint64_t    now;
+    uint64_t    cnt;
+    int         wait_ms;
+    int         n;
+    int         i;
+
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(m_inbox_mtx);
+            m_ready.insert(m_ready.end(), m_inbox.begin(), m_inbox.end());
+            m_inbox.clear();
+        }
+        /* 恢复过程中可能有新的就绪协程，按批处理 */
+        while (!m_ready.empty()) {
+            ready.swap(m_ready);
+            for (auto h : ready) {
+                h.resume();
+            }
+            ready.clear();
+        }
+
+        if (0 == m_live.load()) {
+            break;
+        }
+
+        wait_ms = -1;
+        if (!m_timers.empty()) {
+            now     = now_ms();
+            wait_ms = (m_timers.begin()->first > now)
+                      ? static_cast<int>(m_timers.begin()->first - now) : 0;
+        }
+
+        n = epoll_wait(m_epfd, evs, XF_YMODEM_CO_EP_EVENTS_MAX, wait_ms);
+        for (i = 0; i < n; i++) {
+            if (evs[i].data.ptr == &s_wakeup_tag) {
+                (void)!read(m_evfd, &cnt, sizeof(cnt));
+                continue;
+            }
+            p_st = static_cast<io_state *>(evs[i].data.ptr);
+            /* 超时后 EPOLLONESHOT 已失效，但 EPOLLHUP/EPOLLERR 仍可能上报 */
+            if (!p_st->waiting) {
+                continue;
+            }
+            if (p_st->has_timer) {
+                m_timers.erase(p_st->timer);
+                p_st->has_timer = false;
+            }
+            p_st->waiting   = false;
+            p_st->timed_out = false;
+            m_ready.push_back(p_st->h);
+        }
+
+        now = now_ms();
+        while (!m_timers.empty() && (m_timers.begin()->first <= now)) {
+            p_st = m_timers.begin()->second;
+            m_timers.erase(m_timers.begin());
+            p_st->has_timer = false;
+            p_st->waiting   = false;
+            p_st->timed_out = true;
+            m_ready.push_back(p_st->h);
+        }
+    }
+}
+
+uint64_t executor::now_ms()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void executor::forget(io_state &st)
+{
+    if (st.has_timer) {
+        m_timers.erase(st.timer);
+        st.has_timer = false;
+    }
+    if (st.registered) {
+        epoll_ctl(m_epfd, EPOLL_CTL_DEL, st.fd, nullptr);
+        st.registered = false;
+    }
+    st.waiting = false;
+}
+
+executor::detached executor::run_detached(executor *p_ex, task<void> t)
+{
+    co_await std::move(t);
+    p_ex->m_live.fetch_sub(1);
+}
+
+void executor::post(std::coroutine_handle<> h)
+{
+    uint64_t one = 1;
+
+    {
+        std::lock_guard<std::mutex> lock(m_inbox_mtx);
+        m_inbox.push_back(h);
+    }
+    (void)!write(m_evfd, &one, sizeof(one));
+}
+
+void executor::arm(io_state &st, uint32_t events, uint32_t timeout_ms, std::coroutine_handle<> h)
+{
+    struct epoll_event ev = {};
+
+    ev.events   = events | EPOLLONESHOT;
+    ev.data.ptr = &st;
+    if (st.registered) {
+        epoll_ctl(m_epfd, EPOLL_CTL_MOD, st.fd, &ev);
+    } else {
+        st.registered = (epoll_ctl(m_epfd, EPOLL_CTL_ADD, st.fd, &ev) == 0);
+    }
+
+    st.h            = h;
+    st.waiting      = true;
+    st.timed_out    = false;
+    if (timeout_ms != XF_YMODEM_NB_WAIT_FOREVER) {
+        st.timer        = m_timers.emplace(now_ms() + timeout_ms, &st);
+        st.has_timer    = true;
+    }
+}
+
+executor_pool::executor_pool(size_t thread_num)
+{
+    thread_num = (thread_num > 0) ? thread_num : 1;
+    for (size_t i = 0; i < thread_num; i++) {
+        m_exs.push_back(std::make_unique<executor>());
+    }
+}
+
+executor &executor_pool::next()
+{
+    executor &ex = *m_exs[m_next];
+
+    m_next = (m_next + 1) % m_exs.size();
+
+    return ex;
+}
+
+void executor_pool::run()
+{
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < m_exs.size(); i++) {
+        threads.emplace_back([this, i]() { m_exs[i]->run(); });
+    }
+    m_exs[0]->run();
+    for (auto &th : threads) {
+        th.join();
+    }
+}
+
+session::session(executor &ex, int fd, std::span<uint8_t> pkt_buf,
+                 uint32_t retry_num, uint32_t timeout_ms)
+    : m_ex(ex)
+{
+    m_io.fd             = fd;
+    m_ym.p_buf          = pkt_buf.data();
+    m_ym.buf_size       = static_cast<uint32_t>(pkt_buf.size());
+    m_ym.retry_num      = retry_num;
+    m_ym.timeout_ms     = timeout_ms;
+}
+
+session::~session()
+{
+    m_ex.forget(m_io);
+}
+
+task<xf_ymodem_nb_event_t> session::next_event()
+{
+    xf_ymodem_nb_event_t    ev;
+    const uint8_t          *p_tx = nullptr;
+    uint8_t                *p_rx = nullptr;
+    uint32_t                len;
+    uint32_t                n;
+    ssize_t                 ret;
+    bool                    writable;
+
+    for (;;) {
+        xf_ymodem_nb_tick(&m_ym, now_ms());
+
+        /* 先写出待发送的字节，事件(如 XF_YMODEM_NB_EV_END)在最后的应答发出后才交给用户 */
+        while ((len = xf_ymodem_nb_tx_peek(&m_ym, &p_tx)) > 0) {
+            ret = write(m_io.fd, p_tx, len);
+            if (ret > 0) {
+                xf_ymodem_nb_tx_consume(&m_ym, static_cast<uint32_t>(ret));
+                continue;
+            }
+            if ((ret < 0) && (EINTR == errno)) {
+                continue;
+            }
+            if ((ret < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno))) {
+                writable = co_await m_ex.wait(m_io, EPOLLOUT, m_ym.timeout_ms);
+                if (writable) {
+                    continue;
+                }
+            }
+            co_return link_fail();
+        }
+
+        ev = xf_ymodem_nb_poll(&m_ym);
+        if (ev != XF_YMODEM_NB_EV_NONE) {
+            co_return ev;
+        }
+        if ((XF_YMODEM_RECV_END == m_ym.state) || (XF_YMODEM_SEND_END == m_ym.state)) {
+            co_return XF_YMODEM_NB_EV_NONE;
+        }
+
+        /* 先喂入上一次读到的剩余字节 */
+        if (m_rx_off < m_rx_len) {
+            m_rx_off += xf_ymodem_nb_feed(&m_ym, &m_rx[m_rx_off], m_rx_len - m_rx_off);
+            if (m_rx_off == m_rx_len) {
+                m_rx_off = 0;
+                m_rx_len = 0;
+            }
+            continue;
+        }
+
+        /* 数据包中途直接读入包缓冲区 */
+        len = xf_ymodem_nb_rx_buf(&m_ym, &p_rx);
+        if (0 == len) {
+            p_rx    = m_rx.data();
+            len     = static_cast<uint32_t>(m_rx.size());
+        }
+        ret = read(m_io.fd, p_rx, len);
+        if (ret > 0) {
+            n = xf_ymodem_nb_feed(&m_ym, p_rx, static_cast<uint32_t>(ret));
+            if (p_rx == m_rx.data()) {
+                m_rx_off = n;
+                m_rx_len = static_cast<uint32_t>(ret);
+            }
+            continue;
+        }
+        if ((ret < 0) && (EINTR == errno)) {
+            continue;
+        }
+        if ((ret < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno))) {
+            /* 超时与否都回到循环开头，由 xf_ymodem_nb_tick() 处理 */
+            co_await m_ex.wait(m_io, EPOLLIN, xf_ymodem_nb_timeout(&m_ym));
+            continue;
+        }
+        co_return link_fail();
+    }
+}
+
+std::span<const uint8_t> session::data()
+{
+    uint8_t    *p_data  = nullptr;
+    uint32_t    size    = 0;
+
+    if (xf_ymodem_nb_recv_get_data(&m_ym, &p_data, &size) != XF_OK) {
+        return {};
+    }
+
+    return {p_data, size};
+}
+
+std::span<uint8_t> session::send_buf()
+{
+    uint8_t    *p_buf   = nullptr;
+    uint32_t    size    = 0;
+
+    if (xf_ymodem_nb_send_get_buf(&m_ym, &p_buf, &size) != XF_OK) {
+        return {};
+    }
+
+    return {p_buf, size};
+}
+
+/* ==================== [Static Functions] ================================== */
+
+/**
+ * @brief 链路出错或对端关闭: 结束会话(排队的 CAN 不再发送)。
+ */
+xf_ymodem_nb_event_t session::link_fail()
+{
+    bool notify = (m_ym.state != XF_YMODEM_RECV_END) && (m_ym.state != XF_YMODEM_SEND_END);
+
+    xf_ymodem_nb_cancel(&m_ym);
+    if (!notify) {
+        return XF_YMODEM_NB_EV_NONE;
+    }
+    m_ym.error_code = XF_YMODEM_ERR_NO_DATA;
+
+    return XF_YMODEM_NB_EV_ERROR;
+}
+
+} /* namespace xf_ymodem_co */
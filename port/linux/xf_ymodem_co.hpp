@@ -0,0 +1,419 @@
+/**
+ * @file xf_ymodem_co.hpp
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem C++20 协程前端: 在非阻塞内核之上提供可 co_await 的 recv_file()/send_file().
+ * @version 1.0
+ * @date 2025-01-04
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 链路无数据时会话挂起，不占用线程；一个 executor 是一个单线程的 epoll 循环，
+ * executor_pool 把会话分到若干线程上。数据包以 std::span 指向 xf_ymodem_t.p_buf 直接交给用户，不拷贝。
+ *
+ * @code{cpp}
+ * xf_ymodem_co::executor ex;
+ * xf_ymodem_co::session sess(ex, fd, buf);                // buf: 至少 XF_YMODEM_STX_PACKET_SIZE
+ * ex.spawn([](xf_ymodem_co::session &s) -> xf_ymodem_co::task<> {
+ *     xf_ymodem_file_info_t info = {name, sizeof(name), 0};
+ *     xf_err_t xf_ret = co_await s.recv_file(info,
+ *         [](const xf_ymodem_file_info_t &info) { ... },  // 每个文件开始
+ *         [](std::span<const uint8_t> data) { ... });      // 每个数据包，data 指向包缓冲区
+ * }(sess));
+ * ex.run();                                               // 所有任务结束后返回
+ * @endcode
+ */
+
+#ifndef __XF_YMODEM_CO_HPP__
+#define __XF_YMODEM_CO_HPP__
+
+/* ==================== [Includes] ========================================== */
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "xf_ymodem.h"
+
+namespace xf_ymodem_co
+{
+
+/* ==================== [Defines] =========================================== */
+
+/**
+ * @brief 每个会话的读缓冲区大小，同 XF_YMODEM_SERVER_RX_SIZE.
+ */
+#if !defined(XF_YMODEM_CO_RX_SIZE)
+#   define XF_YMODEM_CO_RX_SIZE         (4096)
+#endif
+
+/* ==================== [Typedefs] ========================================== */
+
+template <typename T = void> class task;
+
+namespace detail
+{
+
+struct promise_base {
+    std::coroutine_handle<>     m_cont = std::noop_coroutine();
+    std::exception_ptr          m_exc;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    /* 结束时对称转移到等待者 */
+    struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            return h.promise().m_cont;
+        }
+        void await_resume() noexcept {}
+    };
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { m_exc = std::current_exception(); }
+};
+
+template <typename T>
+struct promise : promise_base {
+    std::optional<T>            m_value;
+
+    task<T> get_return_object() noexcept;
+    void return_value(T value) { m_value = std::move(value); }
+    T result()
+    {
+        if (m_exc) {
+            std::rethrow_exception(m_exc);
+        }
+        return std::move(*m_value);
+    }
+};
+
+template <>
+struct promise<void> : promise_base {
+    task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void result()
+    {
+        if (m_exc) {
+            std::rethrow_exception(m_exc);
+        }
+    }
+};
+
+} /* namespace detail */
+
+/**
+ * @brief 惰性协程任务: 被 co_await 或交给 executor::spawn() 后才开始执行。
+ */
+template <typename T>
+class task
+{
+public:
+    using promise_type = detail::promise<T>;
+
+    explicit task(std::coroutine_handle<promise_type> h) noexcept : m_h(h) {}
+    task(task &&other) noexcept : m_h(std::exchange(other.m_h, {})) {}
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+    task &operator=(task &&) = delete;
+    ~task()
+    {
+        if (m_h) {
+            m_h.destroy();
+        }
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct awaiter {
+            std::coroutine_handle<promise_type> h;
+
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> cont) noexcept
+            {
+                h.promise().m_cont = cont;
+                return h;
+            }
+            T await_resume() { return h.promise().result(); }
+        };
+        return awaiter{m_h};
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_h;
+};
+
+namespace detail
+{
+
+template <typename T>
+inline task<T> promise<T>::get_return_object() noexcept
+{
+    return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() noexcept
+{
+    return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+} /* namespace detail */
+
+/**
+ * @brief 一个 fd 上的等待状态，由 session 持有。
+ */
+struct io_state {
+    int                         fd          = -1;
+    bool                        registered  = false;    /*!< 已加入 epoll */
+    bool                        waiting     = false;    /*!< 协程正在等待 */
+    bool                        timed_out   = false;    /*!< 上一次等待以超时结束 */
+    std::coroutine_handle<>     h;
+    std::multimap<uint64_t, io_state *>::iterator timer;
+    bool                        has_timer   = false;
+};
+
+/**
+ * @brief 单线程执行器: 一个 epoll 循环，按截止时间管理等待中的会话。
+ *        spawn() 可以在任意线程调用，其余接口只能在 run() 所在线程(即协程内)使用。
+ */
+class executor
+{
+public:
+    executor();
+    ~executor();
+    executor(const executor &) = delete;
+    executor &operator=(const executor &) = delete;
+
+    /**
+     * @brief 提交任务，run() 中开始执行。任务内的异常会终止进程。
+     */
+    void spawn(task<void> t);
+
+    /**
+     * @brief 运行直到所有已提交的任务结束。
+     */
+    void run();
+
+    /**
+     * @brief 执行器的时钟(steady_clock), 单位 ms.
+     */
+    static uint64_t now_ms();
+
+    /**
+     * @brief 等待 fd 可读或可写，最长 timeout_ms(XF_YMODEM_NB_WAIT_FOREVER 表示不限)。
+     *        co_await 的结果为 false 表示超时。timeout_ms 为 0 时不挂起，直接返回 false.
+     */
+    auto wait(io_state &st, uint32_t events, uint32_t timeout_ms)
+    {
+        struct awaiter {
+            executor   &ex;
+            io_state   &st;
+            uint32_t    events;
+            uint32_t    timeout_ms;
+
+            bool await_ready() noexcept
+            {
+                st.timed_out = (0 == timeout_ms);
+                return st.timed_out;
+            }
+            void await_suspend(std::coroutine_handle<> h) { ex.arm(st, events, timeout_ms, h); }
+            bool await_resume() noexcept { return !st.timed_out; }
+        };
+        return awaiter{*this, st, events, timeout_ms};
+    }
+
+    /**
+     * @brief 会话析构时从 epoll 移除 fd.
+     */
+    void forget(io_state &st);
+
+private:
+    struct detached {
+        struct promise_type {
+            detached get_return_object() noexcept
+            {
+                return {std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+        std::coroutine_handle<> h;
+    };
+
+    static detached run_detached(executor *p_ex, task<void> t);
+    void post(std::coroutine_handle<> h);
+    void arm(io_state &st, uint32_t events, uint32_t timeout_ms, std::coroutine_handle<> h);
+
+    int                                     m_epfd = -1;
+    int                                     m_evfd = -1;    /*!< 跨线程 spawn() 的唤醒 */
+    std::vector<std::coroutine_handle<>>    m_ready;
+    std::mutex                              m_inbox_mtx;
+    std::vector<std::coroutine_handle<>>    m_inbox;
+    std::multimap<uint64_t, io_state *>     m_timers;
+    std::atomic<size_t>                     m_live{0};      /*!< 未结束的任务数 */
+};
+
+/**
+ * @brief 线程池: 每个线程运行一个 executor, 会话按轮转分配。
+ */
+class executor_pool
+{
+public:
+    explicit executor_pool(size_t thread_num);
+
+    /**
+     * @brief 取下一个 executor, 会话及其任务应放在同一个 executor 上。
+     */
+    executor &next();
+
+    /**
+     * @brief 在各自的线程中运行所有 executor, 全部结束后返回。
+     */
+    void run();
+
+private:
+    std::vector<std::unique_ptr<executor>>  m_exs;
+    size_t                                  m_next = 0;
+};
+
+/**
+ * @brief 一条链路上的 xf_ymodem 会话。fd 必须是 O_NONBLOCK 的，会话及 pkt_buf 在任务结束前必须有效。
+ */
+class session
+{
+public:
+    /**
+     * @param ex            会话所在的 executor.
+     * @param fd            链路 fd.
+     * @param pkt_buf       包缓冲区，即 xf_ymodem_t.p_buf, 至少 XF_YMODEM_STX_PACKET_SIZE
+     *                      (接收端更大时可接收 2K/4K/8K 包)。
+     * @param retry_num     同 xf_ymodem_t.retry_num.
+     * @param timeout_ms    同 xf_ymodem_t.timeout_ms.
+     */
+    session(executor &ex, int fd, std::span<uint8_t> pkt_buf,
+            uint32_t retry_num = 10, uint32_t timeout_ms = 1000);
+    ~session();
+    session(const session &) = delete;
+    session &operator=(const session &) = delete;
+
+    /**
+     * @brief 推进会话直到产生下一个事件：写出待发送的字节，链路无数据时挂起。
+     * @return 事件；链路出错或对端关闭时为 XF_YMODEM_NB_EV_ERROR,
+     *         会话已结束时为 XF_YMODEM_NB_EV_NONE.
+     */
+    task<xf_ymodem_nb_event_t> next_event();
+
+    /**
+     * @brief XF_YMODEM_NB_EV_DATA 事件的数据，指向包缓冲区，下一次 next_event() 前有效。
+     */
+    std::span<const uint8_t> data();
+
+    /**
+     * @brief XF_YMODEM_NB_EV_SEND_READY 事件后需要填充的包缓冲区，填充后调用 send_commit().
+     */
+    std::span<uint8_t> send_buf();
+
+    xf_err_t send_commit() { return xf_ymodem_nb_send_commit(&m_ym); }
+    xf_err_t send_next(xf_ymodem_file_info_t *p_info) { return xf_ymodem_nb_send_next(&m_ym, p_info); }
+    xf_err_t cancel() { return xf_ymodem_nb_cancel(&m_ym); }
+    xf_ymodem_t &ym() { return m_ym; }
+
+    /**
+     * @brief 接收一批文件，直到对端发送空起始帧。
+     *
+     * @param info          传出文件信息，p_name_buf 及 buf_size 由用户初始化。
+     * @param on_file       每个文件开始时调用，参数为 const xf_ymodem_file_info_t &.
+     * @param on_data       每个数据包调用，参数为 std::span<const uint8_t>, 已去除最后一包的填充。
+     * @return xf_err_t
+     *      - XF_OK                 成功
+     *      - XF_ERR_INVALID_ARG    无效参数
+     *      - XF_FAIL               传输失败，原因见 ym().error_code
+     */
+    template <typename OnFile, typename OnData>
+    task<xf_err_t> recv_file(xf_ymodem_file_info_t &info, OnFile on_file, OnData on_data)
+    {
+        if (xf_ymodem_nb_recv_start(&m_ym, &info, now_ms()) != XF_OK) {
+            co_return XF_ERR_INVALID_ARG;
+        }
+        for (;;) {
+            xf_ymodem_nb_event_t ev = co_await next_event();
+            switch (ev) {
+            case XF_YMODEM_NB_EV_FILE_INFO:
+                on_file(static_cast<const xf_ymodem_file_info_t &>(info));
+                break;
+            case XF_YMODEM_NB_EV_DATA:
+                on_data(data());
+                break;
+            case XF_YMODEM_NB_EV_FILE_END:
+                break;
+            case XF_YMODEM_NB_EV_END:
+                co_return XF_OK;
+            default:
+                co_return XF_FAIL;
+            }
+        }
+    }
+
+    /**
+     * @brief 发送一个文件并结束会话。
+     *
+     * @param info          文件信息，会话期间必须有效。
+     * @param fill          参数为 (std::span<uint8_t> dst, uint32_t offset),
+     *                      把文件中 offset 起的 dst.size() 个字节直接填入包缓冲区。
+     * @return xf_err_t
+     *      - XF_OK                 成功
+     *      - XF_ERR_INVALID_ARG    无效参数
+     *      - XF_FAIL               传输失败，原因见 ym().error_code
+     */
+    template <typename Fill>
+    task<xf_err_t> send_file(xf_ymodem_file_info_t &info, Fill fill)
+    {
+        if (xf_ymodem_nb_send_start(&m_ym, &info, now_ms()) != XF_OK) {
+            co_return XF_ERR_INVALID_ARG;
+        }
+        for (;;) {
+            xf_ymodem_nb_event_t ev = co_await next_event();
+            switch (ev) {
+            case XF_YMODEM_NB_EV_SEND_READY:
+                fill(send_buf(), m_ym.file_len_transmitted);
+                send_commit();
+                break;
+            case XF_YMODEM_NB_EV_FILE_END:
+                send_next(nullptr);
+                break;
+            case XF_YMODEM_NB_EV_END:
+                co_return XF_OK;
+            default:
+                co_return XF_FAIL;
+            }
+        }
+    }
+
+private:
+    uint32_t now_ms() const { return static_cast<uint32_t>(executor::now_ms()); }
+    xf_ymodem_nb_event_t link_fail();
+
+    executor                                   &m_ex;
+    io_state                                    m_io;
+    xf_ymodem_t                                 m_ym{};
+    uint32_t                                    m_rx_off = 0;   /*!< m_rx 中下一个待喂入的字节 */
+    uint32_t                                    m_rx_len = 0;   /*!< m_rx 中有效字节的末尾 */
+    std::array<uint8_t, XF_YMODEM_CO_RX_SIZE>   m_rx;
+};
+
+} /* namespace xf_ymodem_co */
+
+#endif /* __XF_YMODEM_CO_HPP__ */
@@ -0,0 +1,248 @@
+/**
+ * @file xf_ymodem_co_bench.cpp
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 协程前端基准: 在 pty 对上以若干线程运行大量收发协程，统计总吞吐及 CPU 占用。
+ * @version 1.0
+ * @date 2025-01-04
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 用法: xf_ymodem_co_bench [文件长度(KiB)] [线程数] [会话对数 ...]
+ *      默认 256 KiB, 4 线程，会话对数依次为 1 16 256 1024.
+ *      每对会话占用一个 pty, 发送及接收协程放在同一个 executor 上。
+ *      会话对数较大时注意 ulimit -n 及 /proc/sys/kernel/pty/max.
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "xf_ymodem_co.hpp"
+
+/* ==================== [Defines] =========================================== */
+
+#define BENCH_FILE_KIB_DEFAULT          (256)
+#define BENCH_THREAD_NUM_DEFAULT        (4)
+#define BENCH_BUF_SIZE                  (XF_YMODEM_STX_PACKET_SIZE)
+#define BENCH_RETRY_NUM                 (10)
+#define BENCH_TIMEOUT_MS                (1000)
+#define BENCH_NAME                      "bench.bin"
+
+/* ==================== [Typedefs] ========================================== */
+
+/* 一对收发会话 */
+struct bench_pair_t {
+    int                     master  = -1;
+    int                     slave   = -1;
+    char                    tx_name[sizeof(BENCH_NAME)] = BENCH_NAME;
+    char                    rx_name[64] = {0};
+    xf_ymodem_file_info_t   tx_info = {};
+    xf_ymodem_file_info_t   rx_info = {};
+    uint8_t                 tx_buf[BENCH_BUF_SIZE];
+    uint8_t                 rx_buf[BENCH_BUF_SIZE];
+    uint32_t                rx_total = 0;
+    bool                    ok = false;
+    std::unique_ptr<xf_ymodem_co::session> tx;
+    std::unique_ptr<xf_ymodem_co::session> rx;
+};
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int bench_run(uint32_t thread_num, uint32_t pair_num);
+static int bench_open_pty(int *p_master, int *p_slave);
+static xf_ymodem_co::task<> bench_sender(bench_pair_t &pair);
+static xf_ymodem_co::task<> bench_receiver(bench_pair_t &pair);
+static double bench_now_s();
+static double bench_cpu_s();
+
+/* ==================== [Static Variables] ================================== */
+
+static std::vector<uint8_t> s_file_data;
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t sc_pair_nums[] = {1, 16, 256, 1024};
+    uint32_t    file_kib    = BENCH_FILE_KIB_DEFAULT;
+    uint32_t    thread_num  = BENCH_THREAD_NUM_DEFAULT;
+    int         ret         = 0;
+
+    if (argc > 1) {
+        file_kib = static_cast<uint32_t>(strtoul(argv[1], nullptr, 0));
+    }
+    if (argc > 2) {
+        thread_num = static_cast<uint32_t>(strtoul(argv[2], nullptr, 0));
+    }
+
+    /* 所有会话发送同一份数据，接收端逐包比对 */
+    s_file_data.resize(file_kib * 1024);
+    srand(1);
+    for (auto &b : s_file_data) {
+        b = static_cast<uint8_t>(rand());
+    }
+
+    printf("file_len: %u bytes, threads: %u\n",
+           static_cast<unsigned>(s_file_data.size()), static_cast<unsigned>(thread_num));
+    printf("%8s %8s %10s %10s %10s %12s\n",
+           "pairs", "ok", "wall(s)", "MB/s", "cpu(%)", "cpu_us/KB");
+
+    if (argc > 3) {
+        for (int i = 3; i < argc; i++) {
+            ret |= bench_run(thread_num, static_cast<uint32_t>(strtoul(argv[i], nullptr, 0)));
+        }
+    } else {
+        for (auto pair_num : sc_pair_nums) {
+            ret |= bench_run(thread_num, pair_num);
+        }
+    }
+
+    return ret;
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static int bench_run(uint32_t thread_num, uint32_t pair_num)
+{
+    std::vector<std::unique_ptr<bench_pair_t>> pairs;
+    xf_ymodem_co::executor_pool pool(thread_num);
+    uint32_t    ok_num = 0;
+    double      wall;
+    double      cpu;
+    double      mb;
+
+    /* 先打开全部 pty, 不计入耗时 */
+    for (uint32_t i = 0; i < pair_num; i++) {
+        auto p = std::make_unique<bench_pair_t>();
+        if (bench_open_pty(&p->master, &p->slave) != 0) {
+            fprintf(stderr, "open pty %u: %d\n", static_cast<unsigned>(i), errno);
+            break;
+        }
+        xf_ymodem_co::executor &ex = pool.next();
+        p->tx = std::make_unique<xf_ymodem_co::session>(
+                    ex, p->master, std::span<uint8_t>(p->tx_buf), BENCH_RETRY_NUM, BENCH_TIMEOUT_MS);
+        p->rx = std::make_unique<xf_ymodem_co::session>(
+                    ex, p->slave, std::span<uint8_t>(p->rx_buf), BENCH_RETRY_NUM, BENCH_TIMEOUT_MS);
+        ex.spawn(bench_sender(*p));
+        ex.spawn(bench_receiver(*p));
+        pairs.push_back(std::move(p));
+    }
+
+    wall    = bench_now_s();
+    cpu     = bench_cpu_s();
+    pool.run();
+    wall    = bench_now_s() - wall;
+    cpu     = bench_cpu_s() - cpu;
+
+    for (auto &p : pairs) {
+        ok_num += p->ok ? 1 : 0;
+        p->tx.reset();
+        p->rx.reset();
+        close(p->master);
+        close(p->slave);
+    }
+
+    mb = static_cast<double>(ok_num) * s_file_data.size() / (1024.0 * 1024.0);
+    printf("%8u %8u %10.3f %10.2f %10.1f %12.3f\n",
+           static_cast<unsigned>(pairs.size()), static_cast<unsigned>(ok_num), wall,
+           (wall > 0) ? (mb / wall) : 0.0,
+           (wall > 0) ? (100.0 * cpu / wall) : 0.0,
+           (mb > 0) ? (1e6 * cpu / (mb * 1024.0)) : 0.0);
+
+    return (ok_num == pair_num) ? 0 : 1;
+}
+
+static int bench_open_pty(int *p_master, int *p_slave)
+{
+    struct termios tio;
+    int master;
+    int slave;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master < 0) {
+        return -1;
+    }
+    if ((grantpt(master) != 0) || (unlockpt(master) != 0)) {
+        close(master);
+        return -1;
+    }
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (slave < 0) {
+        close(master);
+        return -1;
+    }
+
+    /* 原始模式: 不回显，不转换 CR/LF, 不处理控制字符 */
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    *p_master   = master;
+    *p_slave    = slave;
+
+    return 0;
+}
+
+static xf_ymodem_co::task<> bench_sender(bench_pair_t &pair)
+{
+    pair.tx_info.p_name_buf = pair.tx_name;
+    pair.tx_info.buf_size   = sizeof(BENCH_NAME) - 1;
+    pair.tx_info.file_len   = static_cast<int32_t>(s_file_data.size());
+
+    co_await pair.tx->send_file(pair.tx_info,
+    [](std::span<uint8_t> dst, uint32_t offset) {
+        std::memcpy(dst.data(), &s_file_data[offset], dst.size());
+    });
+}
+
+static xf_ymodem_co::task<> bench_receiver(bench_pair_t &pair)
+{
+    xf_err_t xf_ret;
+    bool     match = true;
+
+    pair.rx_info.p_name_buf = pair.rx_name;
+    pair.rx_info.buf_size   = sizeof(pair.rx_name);
+
+    xf_ret = co_await pair.rx->recv_file(pair.rx_info,
+    [&pair](const xf_ymodem_file_info_t &info) {
+        (void)info;
+        pair.rx_total = 0;
+    },
+    [&pair, &match](std::span<const uint8_t> data) {
+        if ((pair.rx_total + data.size() > s_file_data.size())
+                || (std::memcmp(data.data(), &s_file_data[pair.rx_total], data.size()) != 0)) {
+            match = false;
+        }
+        pair.rx_total += static_cast<uint32_t>(data.size());
+    });
+
+    pair.ok = (XF_OK == xf_ret) && match
+              && (pair.rx_total == s_file_data.size())
+              && (0 == std::strcmp(pair.rx_name, BENCH_NAME));
+}
+
+static double bench_now_s()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double bench_cpu_s()
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return static_cast<double>(ru.ru_utime.tv_sec) + ru.ru_utime.tv_usec * 1e-6
+           + static_cast<double>(ru.ru_stime.tv_sec) + ru.ru_stime.tv_usec * 1e-6;
+}
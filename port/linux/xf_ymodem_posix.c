@@ -0,0 +1,591 @@
+/**
+ * @file xf_ymodem_posix.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem posix 链路: termios 串口、pty 及 TCP, 实现 xf_ymodem_ops_t.
+ * @version 1.0
+ * @date 2025-01-05
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "xf_ymodem_posix.h"
+
+/* ==================== [Defines] =========================================== */
+
+#if XF_YMODEM_POSIX_PORT_NUM > 8
+#   error "XF_YMODEM_POSIX_PORT_NUM must not exceed 8"
+#endif
+
+#define XF_YMODEM_POSIX_FLUSH_BUF_SIZE  (256)
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static xf_err_t xf_ymodem_posix_setup(
+    xf_ymodem_posix_t *p_port, int fd, const xf_ymodem_posix_cfg_t *p_cfg);
+static int xf_ymodem_posix_speed(uint32_t baudrate, speed_t *p_speed);
+static int xf_ymodem_posix_wait(int fd, short events, int64_t deadline_ms);
+static int64_t xf_ymodem_posix_now_ms(void);
+static uint32_t xf_ymodem_posix_clock_ms(void);
+static void xf_ymodem_posix_delay_ms(uint32_t ms);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_posix";
+
+static xf_ymodem_posix_t *sp_slots[XF_YMODEM_POSIX_PORT_NUM];
+
+/* ==================== [Macros] ============================================ */
+
+/* 每个回调组把调用转给绑定的链路 */
+#define XF_YMODEM_POSIX_SLOT_DEFINE(n) \
+    static int32_t xf_ymodem_posix_read_##n(void *dst, uint32_t size, uint32_t timeout_ms) \
+    { \
+        return xf_ymodem_posix_read(sp_slots[n], dst, size, timeout_ms); \
+    } \
+    static int32_t xf_ymodem_posix_write_##n(const void *src, uint32_t size, uint32_t timeout_ms) \
+    { \
+        return xf_ymodem_posix_write(sp_slots[n], src, size, timeout_ms); \
+    } \
+    static void xf_ymodem_posix_flush_##n(void) \
+    { \
+        xf_ymodem_posix_flush(sp_slots[n]); \
+    } \
+    static int32_t xf_ymodem_posix_wait_readable_##n(uint32_t deadline_ms) \
+    { \
+        return xf_ymodem_posix_wait_readable(sp_slots[n], deadline_ms); \
+    }
+
+#define XF_YMODEM_POSIX_SLOT_OPS(n) \
+    { \
+        .read           = xf_ymodem_posix_read_##n, \
+        .write          = xf_ymodem_posix_write_##n, \
+        .flush          = xf_ymodem_posix_flush_##n, \
+        .delay_ms       = xf_ymodem_posix_delay_ms, \
+        .user_parse     = NULL, \
+        .user_file_info = NULL, \
+        .now_ms         = xf_ymodem_posix_clock_ms, \
+        .wait_readable  = xf_ymodem_posix_wait_readable_##n, \
+    }
+
+XF_YMODEM_POSIX_SLOT_DEFINE(0)
+XF_YMODEM_POSIX_SLOT_DEFINE(1)
+XF_YMODEM_POSIX_SLOT_DEFINE(2)
+XF_YMODEM_POSIX_SLOT_DEFINE(3)
+XF_YMODEM_POSIX_SLOT_DEFINE(4)
+XF_YMODEM_POSIX_SLOT_DEFINE(5)
+XF_YMODEM_POSIX_SLOT_DEFINE(6)
+XF_YMODEM_POSIX_SLOT_DEFINE(7)
+
+static const xf_ymodem_ops_t sc_slot_ops[8] = {
+    XF_YMODEM_POSIX_SLOT_OPS(0), XF_YMODEM_POSIX_SLOT_OPS(1),
+    XF_YMODEM_POSIX_SLOT_OPS(2), XF_YMODEM_POSIX_SLOT_OPS(3),
+    XF_YMODEM_POSIX_SLOT_OPS(4), XF_YMODEM_POSIX_SLOT_OPS(5),
+    XF_YMODEM_POSIX_SLOT_OPS(6), XF_YMODEM_POSIX_SLOT_OPS(7),
+};
+
+/* ==================== [Global Functions] ================================== */
+
+xf_err_t xf_ymodem_posix_open_serial(
+    xf_ymodem_posix_t *p_port, const char *p_path, const xf_ymodem_posix_cfg_t *p_cfg)
+{
+    xf_err_t xf_ret = XF_OK;
+    int fd;
+
+    XF_CHECK(NULL == p_port, XF_ERR_INVALID_ARG,
+             TAG, "p_port:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_path, XF_ERR_INVALID_ARG,
+             TAG, "p_path:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    fd = open(p_path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    XF_CHECK(fd < 0, XF_FAIL,
+             TAG, "open(%s):%d", p_path, errno);
+
+    xf_ret = xf_ymodem_posix_setup(p_port, fd, p_cfg);
+    if (xf_ret != XF_OK) {
+        close(fd);
+    }
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_posix_open_pty(
+    xf_ymodem_posix_t *p_port, char *p_name_buf, uint32_t name_size,
+    const xf_ymodem_posix_cfg_t *p_cfg)
+{
+    xf_err_t xf_ret = XF_OK;
+    int fd;
+
+    XF_CHECK(NULL == p_port, XF_ERR_INVALID_ARG,
+             TAG, "p_port:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((NULL == p_name_buf) || (0 == name_size), XF_ERR_INVALID_ARG,
+             TAG, "p_name_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    XF_CHECK(fd < 0, XF_FAIL,
+             TAG, "posix_openpt:%d", errno);
+
+    if ((grantpt(fd) != 0) || (unlockpt(fd) != 0)
+            || (ptsname_r(fd, p_name_buf, name_size) != 0)) {
+        XF_LOGE(TAG, "pty:%d", errno);
+        close(fd);
+        return XF_FAIL;
+    }
+
+    xf_ret = xf_ymodem_posix_setup(p_port, fd, p_cfg);
+    if (xf_ret != XF_OK) {
+        close(fd);
+    }
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_posix_connect_tcp(
+    xf_ymodem_posix_t *p_port, const char *p_host, const char *p_service,
+    const xf_ymodem_posix_cfg_t *p_cfg)
+{
+    xf_err_t xf_ret = XF_FAIL;
+    struct addrinfo hints = {0};
+    struct addrinfo *p_res = NULL;
+    struct addrinfo *p_ai;
+    int fd = -1;
+
+    XF_CHECK(NULL == p_port, XF_ERR_INVALID_ARG,
+             TAG, "p_port:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((NULL == p_host) || (NULL == p_service), XF_ERR_INVALID_ARG,
+             TAG, "addr:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    hints.ai_family     = AF_UNSPEC;
+    hints.ai_socktype   = SOCK_STREAM;
+    XF_CHECK(getaddrinfo(p_host, p_service, &hints, &p_res) != 0, XF_FAIL,
+             TAG, "getaddrinfo(%s:%s)", p_host, p_service);
+
+    for (p_ai = p_res; p_ai != NULL; p_ai = p_ai->ai_next) {
+        fd = socket(p_ai->ai_family, p_ai->ai_socktype | SOCK_CLOEXEC, p_ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, p_ai->ai_addr, p_ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(p_res);
+    XF_CHECK(fd < 0, XF_FAIL,
+             TAG, "connect(%s:%s):%d", p_host, p_service, errno);
+
+    xf_ret = xf_ymodem_posix_setup(p_port, fd, p_cfg);
+    if (xf_ret != XF_OK) {
+        close(fd);
+    }
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_posix_accept_tcp(
+    xf_ymodem_posix_t *p_port, const char *p_service, const xf_ymodem_posix_cfg_t *p_cfg)
+{
+    xf_err_t xf_ret = XF_FAIL;
+    struct addrinfo hints = {0};
+    static const int sc_families[] = {AF_INET6, AF_INET};
+    struct addrinfo *p_res = NULL;
+    uint32_t i;
+    int lfd = -1;
+    int fd;
+    int on = 1;
+
+    XF_CHECK(NULL == p_port, XF_ERR_INVALID_ARG,
+             TAG, "p_port:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_service, XF_ERR_INVALID_ARG,
+             TAG, "p_service:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    /* 先尝试 IPv6 双栈，不可用时退回 IPv4 */
+    for (i = 0; (i < ARRAY_SIZE(sc_families)) && (lfd < 0); i++) {
+        hints.ai_family     = sc_families[i];
+        hints.ai_socktype   = SOCK_STREAM;
+        hints.ai_flags      = AI_PASSIVE;
+        if (getaddrinfo(NULL, p_service, &hints, &p_res) != 0) {
+            continue;
+        }
+        lfd = socket(p_res->ai_family, p_res->ai_socktype | SOCK_CLOEXEC, p_res->ai_protocol);
+        if (lfd >= 0) {
+            setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            if ((bind(lfd, p_res->ai_addr, p_res->ai_addrlen) != 0) || (listen(lfd, 1) != 0)) {
+                close(lfd);
+                lfd = -1;
+            }
+        }
+        freeaddrinfo(p_res);
+    }
+    XF_CHECK(lfd < 0, XF_FAIL,
+             TAG, "listen(%s):%d", p_service, errno);
+
+    do {
+        fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+    } while ((fd < 0) && (EINTR == errno));
+    close(lfd);
+    XF_CHECK(fd < 0, XF_FAIL,
+             TAG, "accept:%d", errno);
+
+    xf_ret = xf_ymodem_posix_setup(p_port, fd, p_cfg);
+    if (xf_ret != XF_OK) {
+        close(fd);
+    }
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_posix_open_fd(
+    xf_ymodem_posix_t *p_port, int fd, const xf_ymodem_posix_cfg_t *p_cfg)
+{
+    XF_CHECK(NULL == p_port, XF_ERR_INVALID_ARG,
+             TAG, "p_port:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(fd < 0, XF_ERR_INVALID_ARG,
+             TAG, "fd:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    return xf_ymodem_posix_setup(p_port, fd, p_cfg);
+}
+
+xf_err_t xf_ymodem_posix_close(xf_ymodem_posix_t *p_port)
+{
+    XF_CHECK(NULL == p_port, XF_ERR_INVALID_ARG,
+             TAG, "p_port:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    if ((p_port->slot >= 0) && (sp_slots[p_port->slot] == p_port)) {
+        sp_slots[p_port->slot] = NULL;
+    }
+    p_port->slot = -1;
+
+    if (p_port->fd < 0) {
+        return XF_OK;
+    }
+
+    if (p_port->is_tty) {
+        /* 最后的 ACK 或 CAN 可能还在发送队列中，等发完再恢复设置、关闭 */
+        tcdrain(p_port->fd);
+        if (p_port->restore) {
+            tcsetattr(p_port->fd, TCSADRAIN, &p_port->tio_saved);
+        }
+    }
+    close(p_port->fd);
+    p_port->fd = -1;
+
+    return XF_OK;
+}
+
+const xf_ymodem_ops_t *xf_ymodem_posix_get_ops(xf_ymodem_posix_t *p_port)
+{
+    int i;
+
+    if ((NULL == p_port) || (p_port->fd < 0)) {
+        return NULL;
+    }
+    if ((p_port->slot >= 0) && (sp_slots[p_port->slot] == p_port)) {
+        return &sc_slot_ops[p_port->slot];
+    }
+
+    for (i = 0; i < XF_YMODEM_POSIX_PORT_NUM; i++) {
+        if (NULL == sp_slots[i]) {
+            sp_slots[i]     = p_port;
+            p_port->slot    = (int8_t)i;
+            return &sc_slot_ops[i];
+        }
+    }
+
+    XF_LOGE(TAG, "no free slot, XF_YMODEM_POSIX_PORT_NUM:%d", XF_YMODEM_POSIX_PORT_NUM);
+
+    return NULL;
+}
+
+int32_t xf_ymodem_posix_read(
+    xf_ymodem_posix_t *p_port, void *dst, uint32_t size, uint32_t timeout_ms)
+{
+    int64_t     deadline    = xf_ymodem_posix_now_ms() + timeout_ms;
+    uint32_t    rlen_real   = 0;
+    ssize_t     rlen;
+    int         ret;
+
+    if ((NULL == p_port) || (NULL == dst) || (p_port->fd < 0)) {
+        return -1;
+    }
+
+    /* vmin 非 0 时 fd 是阻塞的: 先等到可读，再由内核按 VMIN/VTIME 攒批，一次读完 */
+    if (p_port->is_tty && p_port->cfg.vmin) {
+        ret = xf_ymodem_posix_wait(p_port->fd, POLLIN, deadline);
+        if (ret <= 0) {
+            return ret;
+        }
+        do {
+            rlen = read(p_port->fd, dst, size);
+        } while ((rlen < 0) && (EINTR == errno));
+        return (rlen > 0) ? (int32_t)rlen : -1;
+    }
+
+    while (rlen_real < size) {
+        rlen = read(p_port->fd, (uint8_t *)dst + rlen_real, size - rlen_real);
+        if (rlen > 0) {
+            rlen_real += (uint32_t)rlen;
+            continue;
+        }
+        if ((rlen < 0) && (EINTR == errno)) {
+            continue;
+        }
+        if ((0 == rlen) || ((errno != EAGAIN) && (errno != EWOULDBLOCK))) {
+            /* 对端关闭或出错，先交出已读到的数据 */
+            return (rlen_real > 0) ? (int32_t)rlen_real : -1;
+        }
+
+        /* 已到达的数据取完了: 有数据即返回，否则等待到截止时间 */
+        if (rlen_real > 0) {
+            break;
+        }
+        ret = xf_ymodem_posix_wait(p_port->fd, POLLIN, deadline);
+        if (ret <= 0) {
+            return ret;
+        }
+    }
+
+    return (int32_t)rlen_real;
+}
+
+int32_t xf_ymodem_posix_wait_readable(xf_ymodem_posix_t *p_port, uint32_t deadline_ms)
+{
+    int32_t     left_ms     = 0;
+
+    if ((NULL == p_port) || (p_port->fd < 0)) {
+        return -1;
+    }
+
+    /* 截止时刻是 32 位 ms 时钟，按有符号差换算回 64 位时钟 */
+    left_ms = (int32_t)(deadline_ms - xf_ymodem_posix_clock_ms());
+    if (left_ms < 0) {
+        left_ms = 0;
+    }
+
+    return xf_ymodem_posix_wait(p_port->fd, POLLIN, xf_ymodem_posix_now_ms() + left_ms);
+}
+
+int32_t xf_ymodem_posix_write(
+    xf_ymodem_posix_t *p_port, const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    int64_t     deadline    = -1;
+    uint32_t    wlen_real   = 0;
+    ssize_t     wlen;
+
+    UNUSED(timeout_ms);
+
+    if ((NULL == p_port) || (NULL == src) || (p_port->fd < 0)) {
+        return -1;
+    }
+    if (p_port->cfg.write_timeout_ms > 0) {
+        deadline = xf_ymodem_posix_now_ms() + p_port->cfg.write_timeout_ms;
+    }
+
+    while (wlen_real < size) {
+        wlen = write(p_port->fd, (const uint8_t *)src + wlen_real, size - wlen_real);
+        if (wlen > 0) {
+            wlen_real += (uint32_t)wlen;
+            continue;
+        }
+        if ((wlen < 0) && (EINTR == errno)) {
+            continue;
+        }
+        if ((wlen < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+                && (xf_ymodem_posix_wait(p_port->fd, POLLOUT, deadline) > 0)) {
+            continue;
+        }
+        break;
+    }
+
+    return (wlen_real > 0) ? (int32_t)wlen_real : -1;
+}
+
+void xf_ymodem_posix_flush(xf_ymodem_posix_t *p_port)
+{
+    uint8_t dummy_buf[XF_YMODEM_POSIX_FLUSH_BUF_SIZE];
+    struct pollfd pfd;
+
+    if ((NULL == p_port) || (p_port->fd < 0)) {
+        return;
+    }
+
+    /* 只丢弃输入；尚未发出的输出(如刚写出的 NAK)不受影响 */
+    if (p_port->is_tty) {
+        tcflush(p_port->fd, TCIFLUSH);
+        if (p_port->cfg.vmin) {
+            /* 阻塞的 fd 不能再读空，以免等待 VTIME */
+            return;
+        }
+    }
+
+    pfd.fd      = p_port->fd;
+    pfd.events  = POLLIN;
+    while ((poll(&pfd, 1, 0) > 0) && (pfd.revents & POLLIN)) {
+        if (read(p_port->fd, dummy_buf, sizeof(dummy_buf)) <= 0) {
+            break;
+        }
+    }
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static xf_err_t xf_ymodem_posix_setup(
+    xf_ymodem_posix_t *p_port, int fd, const xf_ymodem_posix_cfg_t *p_cfg)
+{
+    static const xf_ymodem_posix_cfg_t sc_cfg_default = XF_YMODEM_POSIX_CFG_DEFAULT();
+    struct termios tio;
+    speed_t speed;
+    int fl;
+    int on = 1;
+
+    xf_memset(p_port, 0, sizeof(xf_ymodem_posix_t));
+    p_port->fd      = -1;
+    p_port->slot    = -1;
+    p_port->cfg     = (p_cfg != NULL) ? *p_cfg : sc_cfg_default;
+    p_port->is_tty  = isatty(fd) ? 1 : 0;
+
+    if (p_port->is_tty) {
+        XF_CHECK(tcgetattr(fd, &p_port->tio_saved) != 0, XF_FAIL,
+                 TAG, "tcgetattr:%d", errno);
+        tio = p_port->tio_saved;
+        cfmakeraw(&tio);
+        tio.c_cflag |= (CLOCAL | CREAD);
+        /*
+            非阻塞模式也要 VMIN=1: VMIN=0 且 VTIME=0 时没有数据的 read 返回 0 而不是 EAGAIN,
+            无法与挂断区分。
+         */
+        tio.c_cc[VMIN]  = p_port->cfg.vmin ? p_port->cfg.vmin : 1;
+        tio.c_cc[VTIME] = p_port->cfg.vmin ? p_port->cfg.vtime : 0;
+        if (p_port->cfg.baudrate) {
+            XF_CHECK(xf_ymodem_posix_speed(p_port->cfg.baudrate, &speed) != 0,
+                     XF_ERR_NOT_SUPPORTED,
+                     TAG, "baudrate:%u", (unsigned)p_port->cfg.baudrate);
+            cfsetispeed(&tio, speed);
+            cfsetospeed(&tio, speed);
+        }
+        /* 等已排队的输出按旧设置发完再切换 */
+        XF_CHECK(tcsetattr(fd, TCSADRAIN, &tio) != 0, XF_FAIL,
+                 TAG, "tcsetattr:%d", errno);
+        p_port->restore = 1;
+    } else {
+        /* TCP: 单字节的 ACK/NAK/C 不能等 Nagle 攒包 */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    fl = fcntl(fd, F_GETFL);
+    if (p_port->is_tty && p_port->cfg.vmin) {
+        fl &= ~O_NONBLOCK;
+    } else {
+        fl |= O_NONBLOCK;
+    }
+    fcntl(fd, F_SETFL, fl);
+
+    p_port->fd = fd;
+
+    return XF_OK;
+}
+
+static int xf_ymodem_posix_speed(uint32_t baudrate, speed_t *p_speed)
+{
+    static const struct {
+        uint32_t    baudrate;
+        speed_t     speed;
+    } sc_speeds[] = {
+        {9600, B9600},          {19200, B19200},        {38400, B38400},
+        {57600, B57600},        {115200, B115200},      {230400, B230400},
+#if defined(B460800)
+        {460800, B460800},
+#endif
+#if defined(B921600)
+        {921600, B921600},
+#endif
+#if defined(B1000000)
+        {1000000, B1000000},    {1500000, B1500000},    {2000000, B2000000},
+        {3000000, B3000000},    {4000000, B4000000},
+#endif
+    };
+    uint32_t i;
+
+    for (i = 0; i < ARRAY_SIZE(sc_speeds); i++) {
+        if (sc_speeds[i].baudrate == baudrate) {
+            *p_speed = sc_speeds[i].speed;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief 等待 fd 就绪直到截止时间，deadline_ms 小于 0 表示一直等待。
+ *
+ * @return int                  大于 0 就绪，0 超时，小于 0 出错或对端挂断。
+ */
+static int xf_ymodem_posix_wait(int fd, short events, int64_t deadline_ms)
+{
+    struct pollfd pfd;
+    int64_t remain;
+    int ret;
+
+    pfd.fd      = fd;
+    pfd.events  = events;
+
+    for (;;) {
+        remain = -1;
+        if (deadline_ms >= 0) {
+            remain = deadline_ms - xf_ymodem_posix_now_ms();
+            if (remain < 0) {
+                remain = 0;
+            }
+        }
+        ret = poll(&pfd, 1, (int)remain);
+        if ((ret < 0) && (EINTR == errno)) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ret;
+        }
+        /* POLLHUP 时仍可能有剩余数据，交给 read 返回 0 或数据 */
+        if (pfd.revents & (events | POLLHUP)) {
+            return 1;
+        }
+        return -1;
+    }
+}
+
+static int64_t xf_ymodem_posix_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* xf_ymodem_ops_t.now_ms: 与 xf_ymodem_posix_now_ms() 同一时钟，截为 32 位 */
+static uint32_t xf_ymodem_posix_clock_ms(void)
+{
+    return (uint32_t)xf_ymodem_posix_now_ms();
+}
+
+static void xf_ymodem_posix_delay_ms(uint32_t ms)
+{
+    poll(NULL, 0, (int)ms);
+}
@@ -0,0 +1,210 @@
+/**
+ * @file xf_ymodem_posix.h
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem posix 链路: termios 串口、pty 及 TCP, 实现 xf_ymodem_ops_t.
+ * @version 1.0
+ * @date 2025-01-05
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+#ifndef __XF_YMODEM_POSIX_H__
+#define __XF_YMODEM_POSIX_H__
+
+/* ==================== [Includes] ========================================== */
+
+#include <termios.h>
+
+#include "xf_utils.h"
+#include "xf_ymodem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ==================== [Defines] =========================================== */
+
+/**
+ * @brief 可以同时取得 ops 的链路数。
+ * xf_ymodem_ops_t 的回调不带上下文，每条链路占用一组预先生成的回调，最大 8.
+ */
+#if !defined(XF_YMODEM_POSIX_PORT_NUM)
+#   define XF_YMODEM_POSIX_PORT_NUM     (8)
+#endif
+
+/**
+ * @brief 默认配置: 不修改波特率，非阻塞读取，一直等待可写。
+ */
+#define XF_YMODEM_POSIX_CFG_DEFAULT() \
+    { \
+        .baudrate           = 0, \
+        .vmin               = 0, \
+        .vtime              = 0, \
+        .write_timeout_ms   = 0, \
+    }
+
+/* ==================== [Typedefs] ========================================== */
+
+/**
+ * @brief 链路配置。
+ */
+typedef struct _xf_ymodem_posix_cfg_t {
+    uint32_t    baudrate;           /*!< 串口波特率，0 表示不修改；只支持 termios 的标准波特率 */
+    /**
+     * @brief 串口 VMIN.
+     *  - 0: fd 为非阻塞的，read 等到有数据后取走内核中已到达的全部数据(不超过 size)。
+     *  - 非 0: fd 为阻塞的，等到有数据后由内核按 VMIN/VTIME 攒够一批再返回，
+     *    减少每包的唤醒次数，但最后不足 VMIN 的部分要等 VTIME 的字节间隔超时。
+     */
+    uint8_t     vmin;
+    uint8_t     vtime;              /*!< 串口 VTIME, 单位 0.1 s, 仅 vmin 非 0 时使用 */
+    uint32_t    write_timeout_ms;   /*!< 等待可写的超时，0 表示一直等待(xf_ymodem 默认输出一定成功) */
+} xf_ymodem_posix_cfg_t;
+
+/**
+ * @brief 一条 posix 链路。
+ */
+typedef struct _xf_ymodem_posix_t {
+    int                     fd;         /*!< 链路 fd, 未打开时为 -1 */
+    xf_ymodem_posix_cfg_t   cfg;        /*!< 打开时的配置 */
+    uint8_t                 is_tty;     /*!< fd 是终端(串口或 pty) */
+    uint8_t                 restore;    /*!< 关闭时恢复 tio_saved */
+    int8_t                  slot;       /*!< 占用的回调组，-1 表示未取得 ops */
+    struct termios          tio_saved;  /*!< 打开前的终端设置 */
+} xf_ymodem_posix_t;
+
+/* ==================== [Global Prototypes] ================================= */
+
+/**
+ * @brief 打开串口，设置为原始模式及 cfg 中的波特率、VMIN/VTIME.
+ *
+ * @param p_port                链路对象指针。
+ * @param p_path                设备路径，如 "/dev/ttyUSB0".
+ * @param p_cfg                 配置，NULL 时使用 XF_YMODEM_POSIX_CFG_DEFAULT().
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_ERR_NOT_SUPPORTED  不支持的波特率
+ *      - XF_FAIL               打开或设置失败
+ */
+xf_err_t xf_ymodem_posix_open_serial(
+    xf_ymodem_posix_t *p_port, const char *p_path, const xf_ymodem_posix_cfg_t *p_cfg);
+
+/**
+ * @brief 打开 pty 主端(原始模式)，传出从端路径，供其他程序(如 lrzsz)连接。
+ *
+ * @param p_port                链路对象指针。
+ * @param[out] p_name_buf       传出从端路径，如 "/dev/pts/3".
+ * @param name_size             p_name_buf 的大小。
+ * @param p_cfg                 配置，NULL 时使用默认配置；不使用 baudrate.
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_FAIL               打开失败
+ */
+xf_err_t xf_ymodem_posix_open_pty(
+    xf_ymodem_posix_t *p_port, char *p_name_buf, uint32_t name_size,
+    const xf_ymodem_posix_cfg_t *p_cfg);
+
+/**
+ * @brief 连接 TCP 服务端，关闭 Nagle 算法以免单字节应答被延迟。
+ *
+ * @param p_port                链路对象指针。
+ * @param p_host                主机名或地址。
+ * @param p_service             端口号或服务名。
+ * @param p_cfg                 配置，NULL 时使用默认配置；只使用 write_timeout_ms.
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_FAIL               连接失败
+ */
+xf_err_t xf_ymodem_posix_connect_tcp(
+    xf_ymodem_posix_t *p_port, const char *p_host, const char *p_service,
+    const xf_ymodem_posix_cfg_t *p_cfg);
+
+/**
+ * @brief 在端口上监听并接受一个 TCP 连接(阻塞)，之后关闭监听。
+ *
+ * @param p_port                链路对象指针。
+ * @param p_service             端口号或服务名。
+ * @param p_cfg                 配置，同 xf_ymodem_posix_connect_tcp().
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_FAIL               监听或接受失败
+ */
+xf_err_t xf_ymodem_posix_accept_tcp(
+    xf_ymodem_posix_t *p_port, const char *p_service, const xf_ymodem_posix_cfg_t *p_cfg);
+
+/**
+ * @brief 接管已打开的 fd(如 pty 从端、socketpair), 关闭链路时一并关闭。
+ *        fd 是终端时同 xf_ymodem_posix_open_serial() 设置为原始模式。
+ *
+ * @param p_port                链路对象指针。
+ * @param fd                    已打开的 fd.
+ * @param p_cfg                 配置，NULL 时使用默认配置。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_ERR_NOT_SUPPORTED  不支持的波特率
+ *      - XF_FAIL               设置失败
+ */
+xf_err_t xf_ymodem_posix_open_fd(
+    xf_ymodem_posix_t *p_port, int fd, const xf_ymodem_posix_cfg_t *p_cfg);
+
+/**
+ * @brief 关闭链路: 等待输出发完(tcdrain)，恢复终端设置，释放 ops 回调组。
+ *
+ * @param p_port                链路对象指针。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_posix_close(xf_ymodem_posix_t *p_port);
+
+/**
+ * @brief 取得绑定到此链路的 ops, 赋给 xf_ymodem_t.ops.
+ *        需要 user_parse 或 user_file_info 时复制一份再填写。
+ *
+ * @param p_port                已打开的链路对象指针。
+ * @return const xf_ymodem_ops_t* ops; 参数无效或 XF_YMODEM_POSIX_PORT_NUM 组回调都已占用时为 NULL.
+ */
+const xf_ymodem_ops_t *xf_ymodem_posix_get_ops(xf_ymodem_posix_t *p_port);
+
+/**
+ * @brief 读取，语义同 xf_ymodem_ops_t.read: 最长等待 timeout_ms,
+ *        有数据到达后取走已到达的全部数据(不超过 size)即返回。
+ *
+ * @return int32_t              读取的字节数，超时为 0, 出错或对端关闭时小于 0.
+ */
+int32_t xf_ymodem_posix_read(
+    xf_ymodem_posix_t *p_port, void *dst, uint32_t size, uint32_t timeout_ms);
+
+/**
+ * @brief 等待可读，语义同 xf_ymodem_ops_t.wait_readable: 用 poll() 阻塞到有数据或截止时刻，
+ *        deadline_ms 与 ops 的 now_ms(CLOCK_MONOTONIC 的 ms 数，截为 32 位)为同一时钟。
+ *
+ * @return int32_t              可读时大于 0, 到达截止时刻为 0, 出错时小于 0;
+ *                              对端挂断时大于 0, 由之后的 read 返回剩余数据或错误。
+ */
+int32_t xf_ymodem_posix_wait_readable(xf_ymodem_posix_t *p_port, uint32_t deadline_ms);
+
+/**
+ * @brief 写出全部字节，语义同 xf_ymodem_ops_t.write; 不可写时最长等待 cfg.write_timeout_ms.
+ *
+ * @return int32_t              写出的字节数，出错时小于 0.
+ */
+int32_t xf_ymodem_posix_write(
+    xf_ymodem_posix_t *p_port, const void *src, uint32_t size, uint32_t timeout_ms);
+
+/**
+ * @brief 丢弃已收到及内核中排队的输入，语义同 xf_ymodem_ops_t.flush; 不影响尚未发出的输出。
+ */
+void xf_ymodem_posix_flush(xf_ymodem_posix_t *p_port);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __XF_YMODEM_POSIX_H__ */
@@ -0,0 +1,377 @@
+/**
+ * @file xf_ymodem_posix_tool.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 使用 posix 链路收发文件并统计吞吐的命令行工具。
+ * @version 1.0
+ * @date 2025-01-05
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 用法:
+ *      xf_ymodem_posix_tool [选项] send <链路> <文件>...
+ *      xf_ymodem_posix_tool [选项] recv <链路>
+ * 链路:
+ *      /dev/ttyUSB0[@921600]       串口及波特率
+ *      pty                         新建 pty, 打印从端路径供另一端连接
+ *      tcp:<主机>:<端口>            连接 TCP
+ *      tcp-listen:<端口>            等待一个 TCP 连接
+ * 选项:
+ *      -b <buf_size>               包缓冲区大小，默认 XF_YMODEM_STX_PACKET_SIZE
+ *      -f <flags>                  xf_ymodem_t.flags, 如 0x40 (XF_YMODEM_FLAG_LARGE_FRAME)
+ *      -t <timeout_ms>             xf_ymodem_t.timeout_ms, 默认 1000
+ *      -m <vmin> -v <vtime>        串口 VMIN/VTIME
+ * 接收的文件保存在当前目录，只取文件名的最后一级。
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/resource.h>
+
+#include "xf_ymodem_posix.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define TOOL_RETRY_NUM                  (10)
+#define TOOL_TIMEOUT_MS                 (1000)
+#define TOOL_HANDSHAKE_TRY_NUM          (30)    /*!< 等待对端启动的握手次数 */
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int tool_open_link(xf_ymodem_posix_t *p_port, char *p_link, xf_ymodem_posix_cfg_t *p_cfg);
+static int tool_send(xf_ymodem_t *p_ym, int file_num, char *file_paths[]);
+static int tool_recv(xf_ymodem_t *p_ym);
+static int tool_send_file(xf_ymodem_t *p_ym, const char *p_path);
+static void tool_wait_hangup(xf_ymodem_posix_t *p_port, uint32_t timeout_ms);
+static void tool_report(const char *p_name, uint64_t bytes, double t0, double c0);
+static double tool_now_s(void);
+static double tool_cpu_s(void);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_posix_tool";
+
+static uint8_t s_is_pty = 0;
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    xf_ymodem_posix_cfg_t cfg = XF_YMODEM_POSIX_CFG_DEFAULT();
+    xf_ymodem_posix_t port;
+    xf_ymodem_t ym = {0};
+    uint32_t buf_size = XF_YMODEM_STX_PACKET_SIZE;
+    int ret;
+    int opt;
+
+    /* pty 从端路径需要在等待对端时就能看到(输出可能被重定向) */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    ym.retry_num    = TOOL_RETRY_NUM;
+    ym.timeout_ms   = TOOL_TIMEOUT_MS;
+
+    while ((opt = getopt(argc, argv, "b:f:t:m:v:")) != -1) {
+        switch (opt) {
+        case 'b': buf_size      = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'f': ym.flags      = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 't': ym.timeout_ms = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'm': cfg.vmin      = (uint8_t)strtoul(optarg, NULL, 0);    break;
+        case 'v': cfg.vtime     = (uint8_t)strtoul(optarg, NULL, 0);    break;
+        default:
+            return 2;
+        }
+    }
+    if ((argc - optind < 2)
+            || (strcmp(argv[optind], "send") && strcmp(argv[optind], "recv"))
+            || (!strcmp(argv[optind], "send") && (argc - optind < 3))) {
+        fprintf(stderr, "usage: %s [-b buf_size] [-f flags] [-t timeout_ms] [-m vmin] [-v vtime]\n"
+                "       send <link> <file>... | recv <link>\n", argv[0]);
+        return 2;
+    }
+
+    if (tool_open_link(&port, argv[optind + 1], &cfg) != 0) {
+        return 1;
+    }
+
+    ym.p_buf    = (uint8_t *)malloc(buf_size);
+    ym.buf_size = buf_size;
+    ym.ops      = xf_ymodem_posix_get_ops(&port);
+    if ((NULL == ym.p_buf) || (xf_ymodem_check(&ym) != XF_OK)) {
+        xf_ymodem_posix_close(&port);
+        return 1;
+    }
+
+    if (!strcmp(argv[optind], "send")) {
+        ret = tool_send(&ym, argc - optind - 2, &argv[optind + 2]);
+    } else {
+        ret = tool_recv(&ym);
+    }
+
+    if (s_is_pty) {
+        tool_wait_hangup(&port, ym.timeout_ms);
+    }
+    xf_ymodem_posix_close(&port);
+    free(ym.p_buf);
+
+    return ret;
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static int tool_open_link(xf_ymodem_posix_t *p_port, char *p_link, xf_ymodem_posix_cfg_t *p_cfg)
+{
+    char pts_name[64];
+    char *p_sep;
+    xf_err_t xf_ret;
+
+    if (!strcmp(p_link, "pty")) {
+        xf_ret = xf_ymodem_posix_open_pty(p_port, pts_name, sizeof(pts_name), p_cfg);
+        if (XF_OK == xf_ret) {
+            XF_LOGI(TAG, "pty: %s", pts_name);
+            s_is_pty = 1;
+        }
+    } else if (!strncmp(p_link, "tcp-listen:", 11)) {
+        xf_ret = xf_ymodem_posix_accept_tcp(p_port, p_link + 11, p_cfg);
+    } else if (!strncmp(p_link, "tcp:", 4)) {
+        p_sep = strrchr(p_link + 4, ':');
+        if (NULL == p_sep) {
+            return -1;
+        }
+        *p_sep = '\0';
+        xf_ret = xf_ymodem_posix_connect_tcp(p_port, p_link + 4, p_sep + 1, p_cfg);
+    } else {
+        p_sep = strrchr(p_link, '@');
+        if (p_sep != NULL) {
+            *p_sep = '\0';
+            p_cfg->baudrate = (uint32_t)strtoul(p_sep + 1, NULL, 0);
+        }
+        xf_ret = xf_ymodem_posix_open_serial(p_port, p_link, p_cfg);
+    }
+
+    if (xf_ret != XF_OK) {
+        XF_LOGE(TAG, "open %s: %s", p_link, xf_err_to_name(xf_ret));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int tool_send(xf_ymodem_t *p_ym, int file_num, char *file_paths[])
+{
+    int i;
+
+    /* 多个文件时批量发送，最后统一发送空起始帧 */
+    if (file_num > 1) {
+        p_ym->flags |= XF_YMODEM_FLAG_BATCH;
+    }
+
+    for (i = 0; i < file_num; i++) {
+        if (tool_send_file(p_ym, file_paths[i]) != 0) {
+            return 1;
+        }
+    }
+
+    if ((file_num > 1) && (xf_ymodem_send_finish(p_ym) != XF_OK)) {
+        XF_LOGE(TAG, "finish: error_code:%d", (int)p_ym->error_code);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int tool_send_file(xf_ymodem_t *p_ym, const char *p_path)
+{
+    xf_ymodem_file_info_t file_info = {0};
+    xf_err_t    xf_ret      = XF_OK;
+    const char *p_name;
+    uint8_t    *p_buf       = NULL;
+    uint32_t    buf_size    = 0;
+    FILE       *fp;
+    long        len;
+    double      t0;
+    double      c0;
+    int         i;
+
+    fp = fopen(p_path, "rb");
+    if (NULL == fp) {
+        XF_LOGE(TAG, "fopen %s: %d", p_path, errno);
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    p_name = strrchr(p_path, '/');
+    p_name = (p_name != NULL) ? (p_name + 1) : p_path;
+    file_info.p_name_buf    = (char *)p_name;
+    file_info.buf_size      = (uint32_t)strlen(p_name);
+    file_info.file_len      = (int32_t)len;
+
+    for (i = 0; i < TOOL_HANDSHAKE_TRY_NUM; i++) {
+        xf_ret = xf_ymodem_send_handshake(p_ym, &file_info);
+        if (xf_ret == XF_OK) {
+            break;
+        }
+    }
+    if (xf_ret != XF_OK) {
+        XF_LOGE(TAG, "handshake: %s", xf_err_to_name(xf_ret));
+        fclose(fp);
+        return -1;
+    }
+
+    t0 = tool_now_s();
+    c0 = tool_cpu_s();
+    while ((xf_ret = xf_ymodem_send_get_buf_and_len(p_ym, &p_buf, &buf_size)) == XF_OK) {
+        fseek(fp, p_ym->file_len_transmitted, SEEK_SET);
+        if (fread(p_buf, 1, buf_size, fp) != buf_size) {
+            XF_LOGE(TAG, "fread %s", p_path);
+            xf_ymodem_cancel(p_ym);
+            fclose(fp);
+            return -1;
+        }
+        xf_ret = xf_ymodem_send_data(p_ym);
+        if (xf_ret != XF_OK) {
+            break;
+        }
+    }
+    fclose(fp);
+
+    if ((xf_ret != XF_ERR_RESOURCE) || (p_ym->error_code != XF_YMODEM_OK)) {
+        XF_LOGE(TAG, "send %s: %s, error_code:%d",
+                p_name, xf_err_to_name(xf_ret), (int)p_ym->error_code);
+        return -1;
+    }
+    tool_report(p_name, (uint64_t)len, t0, c0);
+
+    return 0;
+}
+
+static int tool_recv(xf_ymodem_t *p_ym)
+{
+    char file_name[256] = {0};
+    xf_ymodem_file_info_t file_info = {0};
+    xf_err_t    xf_ret      = XF_OK;
+    const char *p_name;
+    uint8_t    *p_data      = NULL;
+    uint32_t    data_size   = 0;
+    uint64_t    bytes;
+    FILE       *fp;
+    double      t0;
+    double      c0;
+    int         i;
+
+    file_info.p_name_buf    = file_name;
+    file_info.buf_size      = sizeof(file_name);
+
+    for (;;) {
+        for (i = 0; i < TOOL_HANDSHAKE_TRY_NUM; i++) {
+            xf_ret = xf_ymodem_recv_handshake(p_ym, &file_info);
+            if (xf_ret != XF_ERR_TIMEOUT) {
+                break;
+            }
+        }
+        if ((xf_ret == XF_ERR_RESOURCE) && (p_ym->error_code == XF_YMODEM_OK)) {
+            /* 收到空起始帧，会话结束 */
+            return 0;
+        }
+        if (xf_ret != XF_OK) {
+            XF_LOGE(TAG, "handshake: %s", xf_err_to_name(xf_ret));
+            return 1;
+        }
+
+        p_name = strrchr(file_name, '/');
+        p_name = (p_name != NULL) ? (p_name + 1) : file_name;
+        fp = fopen(p_name, "wb");
+        if (NULL == fp) {
+            XF_LOGE(TAG, "fopen %s: %d", p_name, errno);
+            xf_ymodem_cancel(p_ym);
+            return 1;
+        }
+
+        bytes   = 0;
+        t0      = tool_now_s();
+        c0      = tool_cpu_s();
+        while ((xf_ret = xf_ymodem_recv_data(p_ym, &p_data, &data_size)) == XF_OK) {
+            fwrite(p_data, 1, data_size, fp);
+            bytes += data_size;
+        }
+        fclose(fp);
+
+        if ((xf_ret == XF_ERR_NOT_FINISHED)
+                || ((xf_ret == XF_ERR_RESOURCE) && (p_ym->error_code == XF_YMODEM_OK))) {
+            tool_report(p_name, bytes, t0, c0);
+        } else {
+            XF_LOGE(TAG, "recv %s: %s, error_code:%d",
+                    p_name, xf_err_to_name(xf_ret), (int)p_ym->error_code);
+            return 1;
+        }
+        if (xf_ret != XF_ERR_NOT_FINISHED) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief 等待 pty 从端关闭。
+ *        主端关闭会挂断从端并丢弃从端未读的输入，最后的 ACK 可能还没被对端读走。
+ */
+static void tool_wait_hangup(xf_ymodem_posix_t *p_port, uint32_t timeout_ms)
+{
+    uint8_t dummy_buf[64];
+    struct pollfd pfd;
+    double deadline = tool_now_s() + timeout_ms / 1000.0;
+    double remain;
+
+    pfd.fd      = p_port->fd;
+    pfd.events  = POLLIN;
+    while ((remain = deadline - tool_now_s()) > 0) {
+        if (poll(&pfd, 1, (int)(remain * 1000.0) + 1) <= 0) {
+            break;
+        }
+        if (pfd.revents & (POLLHUP | POLLERR)) {
+            break;
+        }
+        if (read(p_port->fd, dummy_buf, sizeof(dummy_buf)) < 0) {
+            break;
+        }
+    }
+}
+
+static void tool_report(const char *p_name, uint64_t bytes, double t0, double c0)
+{
+    double wall = tool_now_s() - t0;
+    double cpu  = tool_cpu_s() - c0;
+
+    XF_LOGI(TAG, "%s: %llu bytes, %.3f s, %.1f KB/s, cpu %.1f%%",
+            p_name, (unsigned long long)bytes, wall,
+            (wall > 0) ? (bytes / 1024.0 / wall) : 0.0,
+            (wall > 0) ? (100.0 * cpu / wall) : 0.0);
+}
+
+static double tool_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double tool_cpu_s(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec * 1e-6
+           + (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec * 1e-6;
+}
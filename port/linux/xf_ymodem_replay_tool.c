@@ -0,0 +1,241 @@
+/**
+ * @file xf_ymodem_replay_tool.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 用 xf_ymodem_capture 的记录文件重新驱动记录中的一端，
+ *        打印与记录的差异、记录中的链路时间及回放的主机耗时。
+ * @version 1.0
+ * @date 2025-01-07
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 用法: xf_ymodem_replay_tool [选项] <记录文件>
+ *      -S                  字节流回放(XF_YMODEM_REPLAY_STREAM)，默认逐次调用对照
+ *      -n <num>            重复回放次数，默认 1, 用于在 perf 等工具下取得足够的样本
+ * 会话参数(flags, buf_size, timeout_ms, retry_num)取自文件头;
+ * 回放发送端时文件名及长度取自记录中的起始帧，文件内容不影响回放，填 0.
+ * 结果失败或与记录不一致时退出码为 1.
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "xf_ymodem_capture.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define TOOL_HANDSHAKE_TRY_NUM          (3)
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static xf_err_t tool_send(xf_ymodem_t *p_ym, xf_ymodem_capture_t *p_cap, uint64_t *p_bytes);
+static xf_err_t tool_recv(xf_ymodem_t *p_ym, uint64_t *p_bytes);
+static double tool_now_s(void);
+static double tool_cpu_s(void);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_replay_tool";
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    xf_ymodem_capture_t     cap;
+    xf_ymodem_t             ym;
+    xf_ymodem_replay_mode_t mode        = XF_YMODEM_REPLAY_STRICT;
+    xf_err_t                xf_ret      = XF_OK;
+    uint64_t                bytes       = 0;
+    uint8_t                *p_buf       = NULL;
+    uint8_t                *p_buf_alt   = NULL;
+    uint32_t                repeat      = 1;
+    uint32_t                i;
+    double                  wall;
+    double                  cpu;
+    double                  rec_s;
+    uint8_t                 ok          = true;
+    int                     opt;
+
+    while ((opt = getopt(argc, argv, "Sn:")) != -1) {
+        switch (opt) {
+        case 'S': mode      = XF_YMODEM_REPLAY_STREAM;                  break;
+        case 'n': repeat    = (uint32_t)strtoul(optarg, NULL, 0);       break;
+        default:
+            fprintf(stderr, "usage: %s [-S] [-n repeat] capture_file\n", argv[0]);
+            return 2;
+        }
+    }
+    if ((optind >= argc) || (repeat == 0)) {
+        fprintf(stderr, "usage: %s [-S] [-n repeat] capture_file\n", argv[0]);
+        return 2;
+    }
+
+    xf_ret = xf_ymodem_replay_open(&cap, argv[optind], mode);
+    if (xf_ret != XF_OK) {
+        XF_LOGE(TAG, "load %s failed: %s", argv[optind], xf_err_to_name(xf_ret));
+        return 2;
+    }
+
+    p_buf = (uint8_t *)malloc(cap.hdr.buf_size);
+    if (cap.hdr.flags & (XF_YMODEM_FLAG_EARLY_ACK | XF_YMODEM_FLAG_PIPELINE)) {
+        p_buf_alt = (uint8_t *)malloc(cap.hdr.buf_size);
+    }
+
+    wall    = tool_now_s();
+    cpu     = tool_cpu_s();
+    for (i = 0; i < repeat; i++) {
+        /* 每次回放都从全新的会话开始 */
+        xf_ymodem_replay_rewind(&cap);
+        memset(&ym, 0, sizeof(ym));
+        ym.flags        = cap.hdr.flags;
+        ym.buf_size     = cap.hdr.buf_size;
+        ym.timeout_ms   = cap.hdr.timeout_ms;
+        ym.retry_num    = cap.hdr.retry_num;
+        ym.ops          = xf_ymodem_capture_get_ops(&cap);
+        ym.p_buf        = p_buf;
+        ym.p_buf_alt    = p_buf_alt;
+        bytes           = 0;
+        xf_ret          = (cap.hdr.is_send) ? tool_send(&ym, &cap, &bytes) : tool_recv(&ym, &bytes);
+        ok              = ok && (xf_ret == XF_ERR_RESOURCE) && (ym.error_code == XF_YMODEM_OK)
+                          && (cap.stat.diverged == 0);
+    }
+    wall    = tool_now_s() - wall;
+    cpu     = tool_cpu_s() - cpu;
+
+    rec_s   = (double)cap.stat.total_us * 1e-6;
+    XF_LOGI(TAG, "result:     %s, %s %s/%d, %llu bytes",
+            ok ? "ok" : "FAIL", (cap.hdr.is_send) ? "tx" : "rx",
+            xf_err_to_name(xf_ret), (int)ym.error_code, (unsigned long long)bytes);
+    XF_LOGI(TAG, "mode:       %s, flags 0x%x, buf_size %u, timeout %u ms, retry %u",
+            (mode == XF_YMODEM_REPLAY_STREAM) ? "stream" : "strict",
+            (unsigned)cap.hdr.flags, (unsigned)cap.hdr.buf_size,
+            (unsigned)cap.hdr.timeout_ms, (unsigned)cap.hdr.retry_num);
+    XF_LOGI(TAG, "records:    %llu, reads %llu (%llu timed out, %llu bytes), writes %llu (%llu bytes), "
+            "diverged %llu",
+            (unsigned long long)cap.stat.records, (unsigned long long)cap.stat.reads,
+            (unsigned long long)cap.stat.read_timeouts, (unsigned long long)cap.stat.read_bytes,
+            (unsigned long long)cap.stat.writes, (unsigned long long)cap.stat.write_bytes,
+            (unsigned long long)cap.stat.diverged);
+    /* 记录中的时间: 读等待占比高说明瓶颈在线路或对方，低说明在本端的处理 */
+    XF_LOGI(TAG, "recorded:   %.3f s, read wait %.3f s (%.1f%%), goodput %.1f KB/s",
+            rec_s, (double)cap.stat.read_us * 1e-6,
+            (rec_s > 0) ? (100.0 * (double)cap.stat.read_us * 1e-6 / rec_s) : 0.0,
+            (rec_s > 0) ? (bytes / 1024.0 / rec_s) : 0.0);
+    XF_LOGI(TAG, "replay:     %u run(s), %.3f s wall, %.3f s cpu, %.1f MB/s",
+            (unsigned)repeat, wall, cpu,
+            (wall > 0) ? ((double)bytes * repeat / 1048576.0 / wall) : 0.0);
+
+    xf_ymodem_capture_close(&cap);
+    free(p_buf);
+    free(p_buf_alt);
+
+    return ok ? 0 : 1;
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static xf_err_t tool_send(xf_ymodem_t *p_ym, xf_ymodem_capture_t *p_cap, uint64_t *p_bytes)
+{
+    xf_ymodem_file_info_t   file_info   = {0};
+    xf_err_t                xf_ret      = XF_OK;
+    const uint8_t          *p_info      = NULL;
+    uint32_t                info_size   = 0;
+    uint32_t                name_len;
+    uint8_t                *p_buf       = NULL;
+    uint32_t                buf_size    = 0;
+    uint32_t                len_size;
+    char                    len_str[16] = {0};
+    int                     i;
+
+    /* 起始帧: 文件名 '\0' 文件长度(十进制) ' ' ... */
+    xf_ret = xf_ymodem_replay_file_info(p_cap, &p_info, &info_size);
+    if (xf_ret != XF_OK) {
+        XF_LOGE(TAG, "no file info packet in capture");
+        return xf_ret;
+    }
+    name_len = (uint32_t)strnlen((const char *)p_info, info_size);
+    if (name_len + 1 < info_size) {
+        len_size = info_size - name_len - 1;
+        len_size = (len_size < sizeof(len_str) - 1) ? len_size : (uint32_t)sizeof(len_str) - 1;
+        memcpy(len_str, &p_info[name_len + 1], len_size);
+    }
+    file_info.p_name_buf    = (char *)p_info;
+    file_info.buf_size      = name_len;
+    file_info.file_len      = (int32_t)strtol(len_str, NULL, 10);
+
+    for (i = 0; i < TOOL_HANDSHAKE_TRY_NUM; i++) {
+        xf_ret = xf_ymodem_send_handshake(p_ym, &file_info);
+        if (xf_ret == XF_OK) {
+            break;
+        }
+    }
+    while ((xf_ret == XF_OK)
+            && ((xf_ret = xf_ymodem_send_get_buf_and_len(p_ym, &p_buf, &buf_size)) == XF_OK)) {
+        memset(p_buf, 0, buf_size);
+        xf_ret = xf_ymodem_send_data(p_ym);
+    }
+    /* 发送完毕时 file_len_transmitted 已清零 */
+    *p_bytes = (xf_ret == XF_ERR_RESOURCE)
+               ? (uint64_t)file_info.file_len : (uint64_t)p_ym->file_len_transmitted;
+    if ((xf_ret == XF_ERR_RESOURCE) && (p_ym->state == XF_YMODEM_SEND_FILE_END)) {
+        xf_ret = xf_ymodem_send_finish(p_ym);
+        xf_ret = (xf_ret == XF_OK) ? XF_ERR_RESOURCE : xf_ret;
+    }
+
+    return xf_ret;
+}
+
+static xf_err_t tool_recv(xf_ymodem_t *p_ym, uint64_t *p_bytes)
+{
+    xf_ymodem_file_info_t   file_info   = {0};
+    char                    file_name[XF_YMODEM_SOH_DATA_SIZE];
+    xf_err_t                xf_ret      = XF_OK;
+    uint8_t                *p_data      = NULL;
+    uint32_t                data_size   = 0;
+    int                     i;
+
+    file_info.p_name_buf    = file_name;
+    file_info.buf_size      = sizeof(file_name);
+
+    for (i = 0; i < TOOL_HANDSHAKE_TRY_NUM; i++) {
+        xf_ret = xf_ymodem_recv_handshake(p_ym, &file_info);
+        if (xf_ret != XF_ERR_TIMEOUT) {
+            break;
+        }
+    }
+    while ((xf_ret == XF_OK)
+            && ((xf_ret = xf_ymodem_recv_data(p_ym, &p_data, &data_size)) == XF_OK)) {
+        *p_bytes += data_size;
+        if (p_ym->p_buf_alt != NULL) {
+            xf_ymodem_recv_release(p_ym, p_data);
+        }
+    }
+
+    return xf_ret;
+}
+
+static double tool_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double tool_cpu_s(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec * 1e-6
+           + (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec * 1e-6;
+}
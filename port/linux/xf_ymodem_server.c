@@ -0,0 +1,500 @@
+/**
+ * @file xf_ymodem_server.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem linux 多会话服务: 一个 epoll 循环驱动多个非阻塞 xf_ymodem 会话。
+ * @version 1.0
+ * @date 2025-01-03
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "xf_ymodem_server.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_YMODEM_SERVER_EP_EVENTS_MAX  (64)    /*!< 一次 epoll_wait 最多取出的事件数 */
+#define XF_YMODEM_SERVER_HEAP_CAP_MIN   (16)    /*!< 定时器堆的初始容量 */
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static void xf_ymodem_server_service(xf_ymodem_session_t *p_sess, uint32_t now_ms);
+static bool xf_ymodem_server_flush(xf_ymodem_session_t *p_sess, bool *p_progress);
+static bool xf_ymodem_server_read(xf_ymodem_session_t *p_sess, bool *p_progress);
+static void xf_ymodem_server_link_fail(xf_ymodem_session_t *p_sess);
+static void xf_ymodem_server_update(xf_ymodem_session_t *p_sess, uint32_t now_ms);
+static uint32_t xf_ymodem_server_tx_pending(xf_ymodem_t *p_ym);
+
+static xf_err_t xf_ymodem_server_heap_reserve(xf_ymodem_server_t *p_srv, uint32_t num);
+static void xf_ymodem_server_heap_set(
+    xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess, uint32_t idx);
+static void xf_ymodem_server_heap_up(xf_ymodem_server_t *p_srv, uint32_t idx);
+static void xf_ymodem_server_heap_down(xf_ymodem_server_t *p_srv, uint32_t idx);
+static void xf_ymodem_server_heap_remove(xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_server";
+
+/* ==================== [Macros] ============================================ */
+
+/* 时间允许回绕: a 是否早于 b */
+#define XF_YMODEM_SERVER_TIME_BEFORE(a, b)  ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+
+#define XF_YMODEM_SERVER_IS_END(p_ym) \
+    ((XF_YMODEM_RECV_END == (p_ym)->state) || (XF_YMODEM_SEND_END == (p_ym)->state))
+
+/* ==================== [Global Functions] ================================== */
+
+xf_err_t xf_ymodem_server_init(xf_ymodem_server_t *p_srv)
+{
+    XF_CHECK(NULL == p_srv, XF_ERR_INVALID_ARG,
+             TAG, "p_srv:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    xf_memset(p_srv, 0, sizeof(xf_ymodem_server_t));
+    p_srv->epfd = epoll_create1(EPOLL_CLOEXEC);
+    XF_CHECK(p_srv->epfd < 0, XF_FAIL,
+             TAG, "epoll_create1:%d", errno);
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_server_deinit(xf_ymodem_server_t *p_srv)
+{
+    XF_CHECK(NULL == p_srv, XF_ERR_INVALID_ARG,
+             TAG, "p_srv:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    if (p_srv->epfd >= 0) {
+        close(p_srv->epfd);
+    }
+    free(p_srv->pp_heap);
+    xf_memset(p_srv, 0, sizeof(xf_ymodem_server_t));
+    p_srv->epfd = -1;
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_server_add(xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess)
+{
+    xf_err_t xf_ret = XF_OK;
+    struct epoll_event ev = {0};
+
+    XF_CHECK(NULL == p_srv, XF_ERR_INVALID_ARG,
+             TAG, "p_srv:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_sess, XF_ERR_INVALID_ARG,
+             TAG, "p_sess:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_sess->on_event, XF_ERR_INVALID_ARG,
+             TAG, "on_event:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(p_sess->fd < 0, XF_ERR_INVALID_ARG,
+             TAG, "fd:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    /* 预留定时器堆的位置，之后更新定时器时不会失败 */
+    xf_ret = xf_ymodem_server_heap_reserve(p_srv, p_srv->session_num + 1);
+    XF_CHECK(xf_ret != XF_OK, xf_ret,
+             TAG, "heap:%s", xf_err_to_name(xf_ret));
+
+    p_sess->p_srv       = p_srv;
+    p_sess->heap_idx    = -1;
+    p_sess->ep_events   = EPOLLIN;
+    p_sess->rx_off      = 0;
+    p_sess->rx_len      = 0;
+
+    ev.events           = p_sess->ep_events;
+    ev.data.ptr         = p_sess;
+    if (epoll_ctl(p_srv->epfd, EPOLL_CTL_ADD, p_sess->fd, &ev) < 0) {
+        XF_LOGE(TAG, "epoll_ctl:%d", errno);
+        p_sess->p_srv   = NULL;
+        return XF_FAIL;
+    }
+    p_srv->session_num++;
+
+    xf_ymodem_server_service(p_sess, xf_ymodem_server_now_ms());
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_server_remove(xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess)
+{
+    XF_CHECK(NULL == p_srv, XF_ERR_INVALID_ARG,
+             TAG, "p_srv:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((NULL == p_sess) || (p_sess->p_srv != p_srv), XF_ERR_INVALID_ARG,
+             TAG, "p_sess:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    xf_ymodem_server_heap_remove(p_srv, p_sess);
+    epoll_ctl(p_srv->epfd, EPOLL_CTL_DEL, p_sess->fd, NULL);
+    p_sess->p_srv = NULL;
+    p_srv->session_num--;
+
+    if (p_sess->on_close) {
+        p_sess->on_close(p_sess);
+    }
+
+    return XF_OK;
+}
+
+int32_t xf_ymodem_server_run_once(xf_ymodem_server_t *p_srv, int32_t max_wait_ms)
+{
+    struct epoll_event evs[XF_YMODEM_SERVER_EP_EVENTS_MAX];
+    xf_ymodem_session_t *p_sess;
+    uint32_t    now_ms;
+    uint32_t    num;
+    int32_t     wait_ms;
+    int         n;
+    int         i;
+
+    XF_CHECK(NULL == p_srv, -1,
+             TAG, "p_srv:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    if (0 == p_srv->session_num) {
+        return 0;
+    }
+
+    /* 等待时间取 max_wait_ms 与最近的会话超时中的较小者 */
+    wait_ms = max_wait_ms;
+    if (p_srv->heap_num > 0) {
+        now_ms = xf_ymodem_server_now_ms();
+        if (!XF_YMODEM_SERVER_TIME_BEFORE(now_ms, p_srv->pp_heap[0]->deadline)) {
+            wait_ms = 0;
+        } else if ((wait_ms < 0)
+                   || ((uint32_t)wait_ms > p_srv->pp_heap[0]->deadline - now_ms)) {
+            wait_ms = (int32_t)(p_srv->pp_heap[0]->deadline - now_ms);
+        }
+    }
+
+    n = epoll_wait(p_srv->epfd, evs, XF_YMODEM_SERVER_EP_EVENTS_MAX, wait_ms);
+    if ((n < 0) && (errno != EINTR)) {
+        XF_LOGE(TAG, "epoll_wait:%d", errno);
+        return -1;
+    }
+
+    now_ms = xf_ymodem_server_now_ms();
+    for (i = 0; i < n; i++) {
+        /* 同一轮中先处理的会话可能已在回调中移除了后面的会话 */
+        p_sess = (xf_ymodem_session_t *)evs[i].data.ptr;
+        if (p_sess->p_srv == p_srv) {
+            xf_ymodem_server_service(p_sess, now_ms);
+        }
+    }
+
+    /* 处理到期的定时器，每个会话处理后定时器后移或出堆；限制次数防止回调反复加入会话 */
+    num = p_srv->heap_num;
+    while ((num-- > 0) && (p_srv->heap_num > 0)
+            && !XF_YMODEM_SERVER_TIME_BEFORE(now_ms, p_srv->pp_heap[0]->deadline)) {
+        xf_ymodem_server_service(p_srv->pp_heap[0], now_ms);
+    }
+
+    return (int32_t)p_srv->session_num;
+}
+
+uint32_t xf_ymodem_server_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+/* ==================== [Static Functions] ================================== */
+
+/**
+ * @brief 处理一个会话: 推进时钟，交替写出、取出事件及喂入，直到没有进展。
+ */
+static void xf_ymodem_server_service(xf_ymodem_session_t *p_sess, uint32_t now_ms)
+{
+    xf_ymodem_server_t     *p_srv   = p_sess->p_srv;
+    xf_ymodem_t            *p_ym    = &p_sess->ym;
+    xf_ymodem_nb_event_t    ev;
+    bool                    progress = true;
+    uint32_t                n;
+
+    xf_ymodem_nb_tick(p_ym, now_ms);
+
+    while (progress) {
+        progress = false;
+
+        if (!xf_ymodem_server_flush(p_sess, &progress)) {
+            xf_ymodem_server_link_fail(p_sess);
+            return;
+        }
+
+        while ((ev = xf_ymodem_nb_poll(p_ym)) != XF_YMODEM_NB_EV_NONE) {
+            progress = true;
+            p_sess->on_event(p_sess, ev);
+            if (p_sess->p_srv != p_srv) {
+                /* 回调中已移除 */
+                return;
+            }
+        }
+
+        /* 先喂入上一次读到的剩余字节 */
+        if (p_sess->rx_off < p_sess->rx_len) {
+            n = xf_ymodem_nb_feed(p_ym, &p_sess->rx[p_sess->rx_off],
+                                  p_sess->rx_len - p_sess->rx_off);
+            p_sess->rx_off += n;
+            if (p_sess->rx_off == p_sess->rx_len) {
+                p_sess->rx_off = 0;
+                p_sess->rx_len = 0;
+            }
+            progress = progress || (n > 0);
+            continue;
+        }
+
+        if (XF_YMODEM_SERVER_IS_END(p_ym)) {
+            continue;
+        }
+
+        if (!xf_ymodem_server_read(p_sess, &progress)) {
+            xf_ymodem_server_link_fail(p_sess);
+            return;
+        }
+    }
+
+    /* 会话已结束且剩余字节已发出 */
+    if (XF_YMODEM_SERVER_IS_END(p_ym)
+            && (0 == xf_ymodem_server_tx_pending(p_ym))) {
+        xf_ymodem_server_remove(p_srv, p_sess);
+        return;
+    }
+
+    xf_ymodem_server_update(p_sess, now_ms);
+}
+
+/**
+ * @brief 写出待发送的字节，直到写完或 fd 不可写。
+ *
+ * @return bool                 false 表示链路出错。
+ */
+static bool xf_ymodem_server_flush(xf_ymodem_session_t *p_sess, bool *p_progress)
+{
+    xf_ymodem_t    *p_ym = &p_sess->ym;
+    const uint8_t  *p_tx = NULL;
+    uint32_t        len;
+    ssize_t         n;
+
+    while ((len = xf_ymodem_nb_tx_peek(p_ym, &p_tx)) > 0) {
+        n = write(p_sess->fd, p_tx, len);
+        if (n < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return ((EAGAIN == errno) || (EWOULDBLOCK == errno));
+        }
+        xf_ymodem_nb_tx_consume(p_ym, (uint32_t)n);
+        *p_progress = true;
+    }
+
+    return true;
+}
+
+/**
+ * @brief 读取一次并喂入。
+ *        数据包中途直接读入内核的包缓冲区，否则读入会话的 rx 缓冲区，喂不完的下一轮再喂。
+ *
+ * @return bool                 false 表示链路出错或已关闭。
+ */
+static bool xf_ymodem_server_read(xf_ymodem_session_t *p_sess, bool *p_progress)
+{
+    xf_ymodem_t    *p_ym = &p_sess->ym;
+    uint8_t        *p_rx = NULL;
+    uint32_t        len;
+    ssize_t         n;
+
+    len = xf_ymodem_nb_rx_buf(p_ym, &p_rx);
+    if (0 == len) {
+        p_rx    = p_sess->rx;
+        len     = XF_YMODEM_SERVER_RX_SIZE;
+    }
+
+    do {
+        n = read(p_sess->fd, p_rx, len);
+    } while ((n < 0) && (EINTR == errno));
+    if (0 == n) {
+        return false;
+    }
+    if (n < 0) {
+        return ((EAGAIN == errno) || (EWOULDBLOCK == errno));
+    }
+
+    *p_progress = true;
+    if (p_rx != p_sess->rx) {
+        xf_ymodem_nb_feed(p_ym, p_rx, (uint32_t)n);
+        return true;
+    }
+
+    p_sess->rx_len = (uint32_t)n;
+    p_sess->rx_off = xf_ymodem_nb_feed(p_ym, p_sess->rx, p_sess->rx_len);
+    if (p_sess->rx_off == p_sess->rx_len) {
+        p_sess->rx_off = 0;
+        p_sess->rx_len = 0;
+    }
+
+    return true;
+}
+
+/**
+ * @brief 链路出错或对端关闭: 结束会话，以 XF_YMODEM_NB_EV_ERROR 通知用户后移除。
+ */
+static void xf_ymodem_server_link_fail(xf_ymodem_session_t *p_sess)
+{
+    xf_ymodem_server_t *p_srv = p_sess->p_srv;
+    xf_ymodem_t        *p_ym  = &p_sess->ym;
+    bool                notify;
+
+    XF_LOGD(TAG, "fd:%d link fail:%d", p_sess->fd, errno);
+
+    /* 已经结束的会话(如最后的 ACK 未能发出)不再通知 */
+    notify = !XF_YMODEM_SERVER_IS_END(p_ym);
+    xf_ymodem_nb_cancel(p_ym);
+    if (notify) {
+        p_ym->error_code = XF_YMODEM_ERR_NO_DATA;
+        p_sess->on_event(p_sess, XF_YMODEM_NB_EV_ERROR);
+        if (p_sess->p_srv != p_srv) {
+            return;
+        }
+    }
+
+    xf_ymodem_server_remove(p_srv, p_sess);
+}
+
+/**
+ * @brief 按待发送字节更新 epoll 事件，按内核的超时更新定时器。
+ */
+static void xf_ymodem_server_update(xf_ymodem_session_t *p_sess, uint32_t now_ms)
+{
+    xf_ymodem_server_t *p_srv = p_sess->p_srv;
+    xf_ymodem_t        *p_ym  = &p_sess->ym;
+    struct epoll_event  ev    = {0};
+    uint32_t            timeout;
+
+    ev.events = EPOLLIN;
+    if (xf_ymodem_server_tx_pending(p_ym) > 0) {
+        ev.events |= EPOLLOUT;
+    }
+    if (ev.events != p_sess->ep_events) {
+        ev.data.ptr = p_sess;
+        if (epoll_ctl(p_srv->epfd, EPOLL_CTL_MOD, p_sess->fd, &ev) == 0) {
+            p_sess->ep_events = ev.events;
+        }
+    }
+
+    timeout = xf_ymodem_nb_timeout(p_ym);
+    if (XF_YMODEM_NB_WAIT_FOREVER == timeout) {
+        xf_ymodem_server_heap_remove(p_srv, p_sess);
+        return;
+    }
+
+    p_sess->deadline = now_ms + timeout;
+    if (p_sess->heap_idx < 0) {
+        xf_ymodem_server_heap_set(p_srv, p_sess, p_srv->heap_num++);
+        xf_ymodem_server_heap_up(p_srv, (uint32_t)p_sess->heap_idx);
+        return;
+    }
+    xf_ymodem_server_heap_up(p_srv, (uint32_t)p_sess->heap_idx);
+    xf_ymodem_server_heap_down(p_srv, (uint32_t)p_sess->heap_idx);
+}
+
+static uint32_t xf_ymodem_server_tx_pending(xf_ymodem_t *p_ym)
+{
+    const uint8_t *p_tx = NULL;
+
+    return xf_ymodem_nb_tx_peek(p_ym, &p_tx);
+}
+
+static xf_err_t xf_ymodem_server_heap_reserve(xf_ymodem_server_t *p_srv, uint32_t num)
+{
+    xf_ymodem_session_t **pp_heap;
+    uint32_t cap;
+
+    if (num <= p_srv->heap_cap) {
+        return XF_OK;
+    }
+
+    cap = (p_srv->heap_cap > 0) ? p_srv->heap_cap : XF_YMODEM_SERVER_HEAP_CAP_MIN;
+    while (cap < num) {
+        cap *= 2;
+    }
+    pp_heap = (xf_ymodem_session_t **)realloc(p_srv->pp_heap, cap * sizeof(pp_heap[0]));
+    if (NULL == pp_heap) {
+        return XF_ERR_NO_MEM;
+    }
+    p_srv->pp_heap  = pp_heap;
+    p_srv->heap_cap = cap;
+
+    return XF_OK;
+}
+
+static void xf_ymodem_server_heap_set(
+    xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess, uint32_t idx)
+{
+    p_srv->pp_heap[idx] = p_sess;
+    p_sess->heap_idx    = (int32_t)idx;
+}
+
+static void xf_ymodem_server_heap_up(xf_ymodem_server_t *p_srv, uint32_t idx)
+{
+    xf_ymodem_session_t *p_sess = p_srv->pp_heap[idx];
+    uint32_t parent;
+
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (!XF_YMODEM_SERVER_TIME_BEFORE(p_sess->deadline, p_srv->pp_heap[parent]->deadline)) {
+            break;
+        }
+        xf_ymodem_server_heap_set(p_srv, p_srv->pp_heap[parent], idx);
+        idx = parent;
+    }
+    xf_ymodem_server_heap_set(p_srv, p_sess, idx);
+}
+
+static void xf_ymodem_server_heap_down(xf_ymodem_server_t *p_srv, uint32_t idx)
+{
+    xf_ymodem_session_t *p_sess = p_srv->pp_heap[idx];
+    uint32_t child;
+
+    while ((child = idx * 2 + 1) < p_srv->heap_num) {
+        if ((child + 1 < p_srv->heap_num)
+                && XF_YMODEM_SERVER_TIME_BEFORE(p_srv->pp_heap[child + 1]->deadline,
+                                                p_srv->pp_heap[child]->deadline)) {
+            child++;
+        }
+        if (!XF_YMODEM_SERVER_TIME_BEFORE(p_srv->pp_heap[child]->deadline, p_sess->deadline)) {
+            break;
+        }
+        xf_ymodem_server_heap_set(p_srv, p_srv->pp_heap[child], idx);
+        idx = child;
+    }
+    xf_ymodem_server_heap_set(p_srv, p_sess, idx);
+}
+
+static void xf_ymodem_server_heap_remove(xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess)
+{
+    xf_ymodem_session_t *p_last;
+    uint32_t idx;
+
+    if (p_sess->heap_idx < 0) {
+        return;
+    }
+
+    idx = (uint32_t)p_sess->heap_idx;
+    p_sess->heap_idx = -1;
+    if (idx == --p_srv->heap_num) {
+        return;
+    }
+
+    /* 用堆尾填补空位，再按其截止时间上移或下移 */
+    p_last = p_srv->pp_heap[p_srv->heap_num];
+    xf_ymodem_server_heap_set(p_srv, p_last, idx);
+    xf_ymodem_server_heap_up(p_srv, idx);
+    xf_ymodem_server_heap_down(p_srv, (uint32_t)p_last->heap_idx);
+}
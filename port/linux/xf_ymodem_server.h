@@ -0,0 +1,181 @@
+/**
+ * @file xf_ymodem_server.h
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem linux 多会话服务: 一个 epoll 循环驱动多个非阻塞 xf_ymodem 会话。
+ * @version 1.0
+ * @date 2025-01-03
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+#ifndef __XF_YMODEM_SERVER_H__
+#define __XF_YMODEM_SERVER_H__
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_utils.h"
+#include "xf_ymodem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ==================== [Defines] =========================================== */
+
+/**
+ * @brief 每个会话的读缓冲区大小。
+ * 非阻塞内核有事件待取出时会暂停处理，一次 read 读到的剩余字节保存在此，下一轮再喂入。
+ */
+#if !defined(XF_YMODEM_SERVER_RX_SIZE)
+#   define XF_YMODEM_SERVER_RX_SIZE     (4096)
+#endif
+
+/* ==================== [Typedefs] ========================================== */
+
+struct _xf_ymodem_server_t;
+struct _xf_ymodem_session_t;
+
+/**
+ * @brief 会话事件回调。
+ *
+ * @param p_sess        产生事件的会话。
+ * @param ev            事件，见 xf_ymodem_nb_event_t.
+ *                      回调内按非阻塞内核的约定调用 xf_ymodem_nb_recv_get_data(),
+ *                      xf_ymodem_nb_send_get_buf(), xf_ymodem_nb_send_commit(),
+ *                      xf_ymodem_nb_send_next() 或 xf_ymodem_nb_cancel().
+ * @note 收到 XF_YMODEM_NB_EV_END 或 XF_YMODEM_NB_EV_ERROR 后，
+ *       服务在发完剩余字节(如最后的 ACK 或 CAN)后移除会话并调用 on_close.
+ */
+typedef void (*xf_ymodem_session_event_cb_t)(
+    struct _xf_ymodem_session_t *p_sess, xf_ymodem_nb_event_t ev);
+
+/**
+ * @brief 会话移除回调，之后服务不再访问会话，用户可以关闭 fd 并释放会话。
+ */
+typedef void (*xf_ymodem_session_close_cb_t)(struct _xf_ymodem_session_t *p_sess);
+
+/**
+ * @brief 服务中的一个会话。
+ */
+typedef struct _xf_ymodem_session_t {
+    /**
+     * @name 用户初始化区
+     * @{
+     */
+    /**
+     * @brief xf_ymodem 对象。用户初始化 p_buf, buf_size, retry_num, timeout_ms,
+     *        加入服务前调用 xf_ymodem_nb_recv_start() 或 xf_ymodem_nb_send_start(),
+     *        now_ms 使用 xf_ymodem_server_now_ms().
+     */
+    xf_ymodem_t                     ym;
+    int                             fd;             /*!< 链路 fd, 必须是 O_NONBLOCK 的 */
+    xf_ymodem_session_event_cb_t    on_event;       /*!< 事件回调，不能为 NULL */
+    xf_ymodem_session_close_cb_t    on_close;       /*!< 移除回调，可以为 NULL */
+    void                           *user_data;      /*!< 用户自定义数据 */
+    /**
+     * End of 用户初始化区
+     * @}
+     */
+
+    /**
+     * @name 私有区
+     * @brief 用户只能读取，禁止修改。
+     * @{
+     */
+    struct _xf_ymodem_server_t     *p_srv;          /*!< 所属服务 */
+    uint32_t                        deadline;       /*!< 定时器堆中的截止时间 */
+    int32_t                         heap_idx;       /*!< 在定时器堆中的下标，-1 表示不在堆中 */
+    uint32_t                        ep_events;      /*!< 当前向 epoll 注册的事件 */
+    uint32_t                        rx_off;         /*!< rx 中下一个待喂入的字节 */
+    uint32_t                        rx_len;         /*!< rx 中有效字节的末尾 */
+    uint8_t                         rx[XF_YMODEM_SERVER_RX_SIZE];
+    /**
+     * End of 私有区
+     * @}
+     */
+} xf_ymodem_session_t;
+
+/**
+ * @brief 多会话服务。
+ * 定时器为按截止时间排列的二叉最小堆，只含正在等待对方的会话。
+ */
+typedef struct _xf_ymodem_server_t {
+    int                             epfd;           /*!< epoll fd */
+    xf_ymodem_session_t           **pp_heap;        /*!< 定时器堆 */
+    uint32_t                        heap_num;       /*!< 堆中的会话数 */
+    uint32_t                        heap_cap;       /*!< pp_heap 的容量 */
+    uint32_t                        session_num;    /*!< 服务中的会话数 */
+} xf_ymodem_server_t;
+
+/* ==================== [Global Prototypes] ================================= */
+
+/**
+ * @brief 初始化服务。
+ *
+ * @param p_srv                 服务对象指针。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_FAIL               epoll 创建失败
+ */
+xf_err_t xf_ymodem_server_init(xf_ymodem_server_t *p_srv);
+
+/**
+ * @brief 反初始化服务，不关闭会话的 fd, 也不调用 on_close.
+ *
+ * @param p_srv                 服务对象指针。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_server_deinit(xf_ymodem_server_t *p_srv);
+
+/**
+ * @brief 向服务加入会话，立即写出已排队的字节(如接收端的第一个 C)。
+ *
+ * @param p_srv                 服务对象指针。
+ * @param p_sess                已初始化并已调用 xf_ymodem_nb_*_start() 的会话，移除前必须有效。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_ERR_NO_MEM         定时器堆扩容失败
+ *      - XF_FAIL               epoll 注册失败
+ */
+xf_err_t xf_ymodem_server_add(xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess);
+
+/**
+ * @brief 从服务移除会话并调用 on_close, 不发送 CAN.
+ *        需要通知对方时先调用 xf_ymodem_nb_cancel(), 会话发完 CAN 后自动移除。
+ *
+ * @param p_srv                 服务对象指针。
+ * @param p_sess                会话。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_server_remove(xf_ymodem_server_t *p_srv, xf_ymodem_session_t *p_sess);
+
+/**
+ * @brief 等待可读、可写或最近的会话超时，处理就绪及超时的会话。
+ *
+ * @param p_srv                 服务对象指针。
+ * @param max_wait_ms           最长等待时间，-1 表示只受会话超时限制。
+ * @return int32_t              处理后服务中剩余的会话数，出错时小于 0.
+ *
+ * @code{c}
+ * while (xf_ymodem_server_run_once(&srv, -1) > 0) {}
+ * @endcode
+ */
+int32_t xf_ymodem_server_run_once(xf_ymodem_server_t *p_srv, int32_t max_wait_ms);
+
+/**
+ * @brief 服务使用的时钟(CLOCK_MONOTONIC), 单位 ms, 允许回绕。
+ */
+uint32_t xf_ymodem_server_now_ms(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __XF_YMODEM_SERVER_H__ */
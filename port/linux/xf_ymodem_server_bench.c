@@ -0,0 +1,325 @@
+/**
+ * @file xf_ymodem_server_bench.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 多会话服务基准: 在 pty 对上同时运行 N 对收发会话，统计总吞吐及每会话 CPU 占用。
+ * @version 1.0
+ * @date 2025-01-03
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 用法: xf_ymodem_server_bench [文件长度(KiB)] [会话对数 ...]
+ *      默认 1024 KiB, 会话对数依次为 1 4 16 64 256.
+ *      每对会话占用一个 pty: 发送端在 master, 接收端在 slave, 全部由同一个 epoll 循环驱动。
+ *      会话对数较大时注意 ulimit -n 及 /proc/sys/kernel/pty/max.
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "xf_ymodem_server.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define BENCH_FILE_KIB_DEFAULT          (1024)
+#define BENCH_BUF_SIZE                  (XF_YMODEM_STX_PACKET_SIZE)
+#define BENCH_RETRY_NUM                 (10)
+/* 会话很多时单个会话可能较长时间得不到处理，超时取大一些 */
+#define BENCH_TIMEOUT_MS                (1000)
+#define BENCH_NAME                      "bench.bin"
+
+/* ==================== [Typedefs] ========================================== */
+
+/* 一对收发会话 */
+typedef struct _bench_pair_t {
+    xf_ymodem_session_t     tx;
+    xf_ymodem_session_t     rx;
+    xf_ymodem_file_info_t   tx_info;
+    xf_ymodem_file_info_t   rx_info;
+    char                    rx_name[64];
+    uint8_t                 tx_buf[BENCH_BUF_SIZE];
+    uint8_t                 rx_buf[BENCH_BUF_SIZE];
+    uint32_t                rx_total;       /*!< 接收端已收到的文件数据 */
+    uint8_t                 rx_ok;          /*!< 接收端收到的文件完整且内容一致 */
+    uint8_t                 fail;           /*!< 任一端出错 */
+} bench_pair_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int bench_run(uint32_t pair_num);
+static int bench_open_pty(int *p_master, int *p_slave);
+static void bench_on_tx_event(xf_ymodem_session_t *p_sess, xf_ymodem_nb_event_t ev);
+static void bench_on_rx_event(xf_ymodem_session_t *p_sess, xf_ymodem_nb_event_t ev);
+static void bench_on_close(xf_ymodem_session_t *p_sess);
+static double bench_now_s(void);
+static double bench_cpu_s(void);
+
+/* ==================== [Static Variables] ================================== */
+
+static uint8_t     *sp_file_data;
+static uint32_t     s_file_len;
+static char         s_name[] = BENCH_NAME;
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t sc_pair_nums[] = {1, 4, 16, 64, 256};
+    uint32_t    i;
+    int         ret = 0;
+
+    s_file_len = BENCH_FILE_KIB_DEFAULT * 1024;
+    if (argc > 1) {
+        s_file_len = (uint32_t)strtoul(argv[1], NULL, 0) * 1024;
+    }
+
+    /* 所有会话发送同一份数据，接收端逐包比对 */
+    sp_file_data = (uint8_t *)malloc(s_file_len);
+    if (NULL == sp_file_data) {
+        return 1;
+    }
+    srand(1);
+    for (i = 0; i < s_file_len; i++) {
+        sp_file_data[i] = (uint8_t)rand();
+    }
+
+    printf("file_len: %u bytes\n", (unsigned)s_file_len);
+    printf("%8s %8s %10s %10s %10s %12s %12s\n",
+           "pairs", "ok", "wall(s)", "MB/s", "cpu(%)", "cpu%/sess", "cpu_us/KB");
+
+    if (argc > 2) {
+        for (i = 2; (int)i < argc; i++) {
+            ret |= bench_run((uint32_t)strtoul(argv[i], NULL, 0));
+        }
+    } else {
+        for (i = 0; i < ARRAY_SIZE(sc_pair_nums); i++) {
+            ret |= bench_run(sc_pair_nums[i]);
+        }
+    }
+
+    free(sp_file_data);
+
+    return ret;
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static int bench_run(uint32_t pair_num)
+{
+    xf_ymodem_server_t  srv;
+    bench_pair_t       *p_pairs;
+    bench_pair_t       *p;
+    uint32_t    now_ms;
+    uint32_t    ok_num  = 0;
+    uint32_t    i;
+    int         master;
+    int         slave;
+    double      wall;
+    double      cpu;
+    double      mb;
+
+    p_pairs = (bench_pair_t *)calloc(pair_num, sizeof(bench_pair_t));
+    if ((NULL == p_pairs) || (xf_ymodem_server_init(&srv) != XF_OK)) {
+        free(p_pairs);
+        return 1;
+    }
+
+    /* 先打开全部 pty, 不计入耗时 */
+    for (i = 0; i < pair_num; i++) {
+        p = &p_pairs[i];
+        p->tx.fd = -1;
+        p->rx.fd = -1;
+        if (bench_open_pty(&master, &slave) != 0) {
+            fprintf(stderr, "open pty %u: %d\n", (unsigned)i, errno);
+            pair_num = i;
+            break;
+        }
+        p->tx.fd = master;
+        p->rx.fd = slave;
+    }
+
+    wall    = bench_now_s();
+    cpu     = bench_cpu_s();
+    now_ms  = xf_ymodem_server_now_ms();
+    for (i = 0; i < pair_num; i++) {
+        p = &p_pairs[i];
+
+        p->tx_info.p_name_buf   = s_name;
+        p->tx_info.buf_size     = sizeof(BENCH_NAME) - 1;
+        p->tx_info.file_len     = (int32_t)s_file_len;
+        p->rx_info.p_name_buf   = p->rx_name;
+        p->rx_info.buf_size     = sizeof(p->rx_name);
+
+        p->tx.ym.p_buf          = p->tx_buf;
+        p->tx.ym.buf_size       = BENCH_BUF_SIZE;
+        p->tx.ym.retry_num      = BENCH_RETRY_NUM;
+        p->tx.ym.timeout_ms     = BENCH_TIMEOUT_MS;
+        p->tx.on_event          = bench_on_tx_event;
+        p->tx.on_close          = bench_on_close;
+        p->tx.user_data         = p;
+        p->rx.ym                = p->tx.ym;
+        p->rx.ym.p_buf          = p->rx_buf;
+        p->rx.on_event          = bench_on_rx_event;
+        p->rx.on_close          = bench_on_close;
+        p->rx.user_data         = p;
+
+        xf_ymodem_nb_send_start(&p->tx.ym, &p->tx_info, now_ms);
+        xf_ymodem_nb_recv_start(&p->rx.ym, &p->rx_info, now_ms);
+        if ((xf_ymodem_server_add(&srv, &p->tx) != XF_OK)
+                || (xf_ymodem_server_add(&srv, &p->rx) != XF_OK)) {
+            p->fail = 1;
+        }
+    }
+
+    while (xf_ymodem_server_run_once(&srv, -1) > 0) {}
+
+    wall    = bench_now_s() - wall;
+    cpu     = bench_cpu_s() - cpu;
+
+    for (i = 0; i < pair_num; i++) {
+        p = &p_pairs[i];
+        ok_num += (p->rx_ok && !p->fail) ? 1 : 0;
+        if (p->tx.fd >= 0) {
+            close(p->tx.fd);
+        }
+        if (p->rx.fd >= 0) {
+            close(p->rx.fd);
+        }
+    }
+    xf_ymodem_server_deinit(&srv);
+    free(p_pairs);
+
+    /* 只统计成功的会话对的数据 */
+    mb = (double)ok_num * s_file_len / (1024.0 * 1024.0);
+    printf("%8u %8u %10.3f %10.2f %10.1f %12.3f %12.3f\n",
+           (unsigned)pair_num, (unsigned)ok_num, wall,
+           (wall > 0) ? (mb / wall) : 0.0,
+           (wall > 0) ? (100.0 * cpu / wall) : 0.0,
+           (wall > 0) ? (100.0 * cpu / wall / (2.0 * pair_num)) : 0.0,
+           (mb > 0) ? (1e6 * cpu / (mb * 1024.0)) : 0.0);
+
+    return (ok_num == pair_num) ? 0 : 1;
+}
+
+static int bench_open_pty(int *p_master, int *p_slave)
+{
+    struct termios tio;
+    int master;
+    int slave;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master < 0) {
+        return -1;
+    }
+    if ((grantpt(master) != 0) || (unlockpt(master) != 0)) {
+        close(master);
+        return -1;
+    }
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (slave < 0) {
+        close(master);
+        return -1;
+    }
+
+    /* 原始模式: 不回显，不转换 CR/LF, 不处理控制字符 */
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    *p_master   = master;
+    *p_slave    = slave;
+
+    return 0;
+}
+
+static void bench_on_tx_event(xf_ymodem_session_t *p_sess, xf_ymodem_nb_event_t ev)
+{
+    bench_pair_t   *p       = (bench_pair_t *)p_sess->user_data;
+    xf_ymodem_t    *p_ym    = &p_sess->ym;
+    uint8_t        *p_buf   = NULL;
+    uint32_t        size    = 0;
+
+    switch (ev) {
+    case XF_YMODEM_NB_EV_SEND_READY:
+        xf_ymodem_nb_send_get_buf(p_ym, &p_buf, &size);
+        xf_memcpy(p_buf, &sp_file_data[p_ym->file_len_transmitted], size);
+        xf_ymodem_nb_send_commit(p_ym);
+        break;
+    case XF_YMODEM_NB_EV_FILE_END:
+        xf_ymodem_nb_send_next(p_ym, NULL);
+        break;
+    case XF_YMODEM_NB_EV_ERROR:
+        p->fail = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+static void bench_on_rx_event(xf_ymodem_session_t *p_sess, xf_ymodem_nb_event_t ev)
+{
+    bench_pair_t   *p       = (bench_pair_t *)p_sess->user_data;
+    xf_ymodem_t    *p_ym    = &p_sess->ym;
+    uint8_t        *p_data  = NULL;
+    uint32_t        size    = 0;
+
+    switch (ev) {
+    case XF_YMODEM_NB_EV_FILE_INFO:
+        p->rx_total = 0;
+        p->rx_ok    = 0;
+        break;
+    case XF_YMODEM_NB_EV_DATA:
+        xf_ymodem_nb_recv_get_data(p_ym, &p_data, &size);
+        if ((p->rx_total + size > s_file_len)
+                || (xf_memcmp(p_data, &sp_file_data[p->rx_total], size) != 0)) {
+            p->fail = 1;
+        }
+        p->rx_total += size;
+        break;
+    case XF_YMODEM_NB_EV_FILE_END:
+        p->rx_ok = ((p->rx_total == s_file_len)
+                    && (p->rx_info.file_len == (int32_t)s_file_len)
+                    && (0 == xf_strcmp(p->rx_name, BENCH_NAME)));
+        break;
+    case XF_YMODEM_NB_EV_ERROR:
+        p->fail = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+static void bench_on_close(xf_ymodem_session_t *p_sess)
+{
+    /* fd 在统计耗时后统一关闭，避免先结束的一端关闭后另一端读到 EOF */
+    UNUSED(p_sess);
+}
+
+static double bench_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double bench_cpu_s(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec * 1e-6
+           + (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec * 1e-6;
+}
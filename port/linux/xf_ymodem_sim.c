@@ -0,0 +1,677 @@
+/**
+ * @file xf_ymodem_sim.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem 内存链路模拟器的实现。
+ * @version 1.0
+ * @date 2025-01-06
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "xf_ymodem_sim.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_YMODEM_SIM_WIRE_CAP_INIT     (4096)  /*!< 线路及接收环形缓冲的初始容量，按需加倍 */
+#define XF_YMODEM_SIM_SEG_CAP_INIT      (64)    /*!< 线路分段记录的初始容量，按需加倍 */
+#define XF_YMODEM_SIM_NEVER             (UINT64_MAX / 2)
+
+#if !defined(min)
+#   define min(x, y)                (((x) < (y)) ? (x) : (y))
+#endif
+
+/* ==================== [Typedefs] ========================================== */
+
+typedef enum _xf_ymodem_sim_end_state_t {
+    XF_YMODEM_SIM_END_READY,            /*!< 可以立即运行 */
+    XF_YMODEM_SIM_END_RUNNING,
+    XF_YMODEM_SIM_END_READ,             /*!< 等待数据或 wake_ns */
+    XF_YMODEM_SIM_END_WAIT,             /*!< 等待到 wake_ns (delay_ms 或发送缓冲满) */
+    XF_YMODEM_SIM_END_DONE,
+} xf_ymodem_sim_end_state_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int32_t xf_ymodem_sim_read(void *dst, uint32_t size, uint32_t timeout_ms);
+static int32_t xf_ymodem_sim_write(const void *src, uint32_t size, uint32_t timeout_ms);
+static void xf_ymodem_sim_flush(void);
+static void xf_ymodem_sim_delay_ms(uint32_t ms);
+static uint32_t xf_ymodem_sim_now_ms(void);
+
+static void xf_ymodem_sim_trampoline(void);
+static void xf_ymodem_sim_yield(xf_ymodem_sim_end_t *p_end);
+static uint64_t xf_ymodem_sim_end_wake(xf_ymodem_sim_end_t *p_end);
+
+static void xf_ymodem_sim_dir_init(
+    xf_ymodem_sim_dir_t *p_dir, const xf_ymodem_sim_link_cfg_t *p_cfg, uint64_t seed);
+static int xf_ymodem_sim_dir_send(
+    xf_ymodem_sim_dir_t *p_dir, uint64_t now_ns, const uint8_t *p_src, uint32_t size);
+static int xf_ymodem_sim_dir_arrive(xf_ymodem_sim_dir_t *p_dir, uint64_t now_ns);
+static int xf_ymodem_sim_wire_push(
+    xf_ymodem_sim_dir_t *p_dir, const uint8_t *p_src, uint32_t len, uint64_t arrive_ns);
+static int xf_ymodem_sim_ring_reserve(
+    uint8_t **pp_buf, uint32_t *p_cap, uint32_t *p_rd, uint32_t num, uint32_t need);
+static void xf_ymodem_sim_ring_put(
+    uint8_t *p_buf, uint32_t cap, uint32_t pos, const uint8_t *p_src, uint32_t len);
+static void xf_ymodem_sim_ring_get(
+    const uint8_t *p_buf, uint32_t cap, uint32_t pos, uint8_t *p_dst, uint32_t len);
+static uint64_t xf_ymodem_sim_rand(xf_ymodem_sim_dir_t *p_dir);
+static uint64_t xf_ymodem_sim_geom(xf_ymodem_sim_dir_t *p_dir, double p);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_sim";
+
+static const xf_ymodem_ops_t sc_sim_ops = {
+    .read           = xf_ymodem_sim_read,
+    .write          = xf_ymodem_sim_write,
+    .flush          = xf_ymodem_sim_flush,
+    .delay_ms       = xf_ymodem_sim_delay_ms,
+    .user_parse     = NULL,
+    .user_file_info = NULL,
+    .now_ms         = xf_ymodem_sim_now_ms,
+};
+
+/* 当前运行的一端；ops 不带上下文，由此找到对应的链路方向 */
+static __thread xf_ymodem_sim_end_t *stp_cur = NULL;
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+xf_err_t xf_ymodem_sim_init(
+    xf_ymodem_sim_t *p_sim,
+    const xf_ymodem_sim_link_cfg_t *p_a_to_b, const xf_ymodem_sim_link_cfg_t *p_b_to_a,
+    uint64_t seed)
+{
+    static const xf_ymodem_sim_link_cfg_t sc_cfg_default = XF_YMODEM_SIM_LINK_CFG_DEFAULT();
+
+    XF_CHECK(NULL == p_sim, XF_ERR_INVALID_ARG,
+             TAG, "p_sim:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    p_a_to_b = (p_a_to_b != NULL) ? p_a_to_b : &sc_cfg_default;
+    p_b_to_a = (p_b_to_a != NULL) ? p_b_to_a : p_a_to_b;
+    XF_CHECK((0 == p_a_to_b->baudrate) || (0 == p_b_to_a->baudrate)
+             || (0 == p_a_to_b->bits_per_byte) || (0 == p_b_to_a->bits_per_byte),
+             XF_ERR_INVALID_ARG,
+             TAG, "baudrate:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    xf_memset(p_sim, 0, sizeof(xf_ymodem_sim_t));
+    /* 两个方向的随机序列互不相关 */
+    xf_ymodem_sim_dir_init(&p_sim->dir[0], p_a_to_b, seed);
+    xf_ymodem_sim_dir_init(&p_sim->dir[1], p_b_to_a, seed ^ 0x9E3779B97F4A7C15ULL);
+
+    return XF_OK;
+}
+
+void xf_ymodem_sim_deinit(xf_ymodem_sim_t *p_sim)
+{
+    uint32_t i;
+
+    if (NULL == p_sim) {
+        return;
+    }
+    for (i = 0; i < ARRAY_SIZE(p_sim->dir); i++) {
+        free(p_sim->dir[i].p_wire);
+        free(p_sim->dir[i].p_seg);
+        free(p_sim->dir[i].p_fifo);
+        p_sim->dir[i].p_wire    = NULL;
+        p_sim->dir[i].p_seg     = NULL;
+        p_sim->dir[i].p_fifo    = NULL;
+    }
+}
+
+xf_err_t xf_ymodem_sim_run(
+    xf_ymodem_sim_t *p_sim,
+    xf_ymodem_sim_entry_t entry_a, void *user_data_a,
+    xf_ymodem_sim_entry_t entry_b, void *user_data_b)
+{
+    xf_err_t xf_ret = XF_OK;
+    xf_ymodem_sim_end_t *p_end;
+    xf_ymodem_sim_end_t *p_next;
+    uint64_t wake;
+    uint64_t best;
+    uint32_t i;
+
+    XF_CHECK((NULL == p_sim) || (NULL == entry_a) || (NULL == entry_b), XF_ERR_INVALID_ARG,
+             TAG, "args:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    p_sim->end[0].entry     = entry_a;
+    p_sim->end[0].user_data = user_data_a;
+    p_sim->end[1].entry     = entry_b;
+    p_sim->end[1].user_data = user_data_b;
+
+    for (i = 0; i < ARRAY_SIZE(p_sim->end); i++) {
+        p_end           = &p_sim->end[i];
+        p_end->p_sim    = p_sim;
+        p_end->idx      = (uint8_t)i;
+        p_end->state    = XF_YMODEM_SIM_END_READY;
+        p_end->p_stack  = malloc(XF_YMODEM_SIM_STACK_SIZE);
+        if (NULL == p_end->p_stack) {
+            XF_LOGE(TAG, "malloc stack failed");
+            xf_ret = XF_ERR_NO_MEM;
+            goto l_free;
+        }
+        getcontext(&p_end->ctx);
+        p_end->ctx.uc_stack.ss_sp   = p_end->p_stack;
+        p_end->ctx.uc_stack.ss_size = XF_YMODEM_SIM_STACK_SIZE;
+        p_end->ctx.uc_link          = &p_sim->sched_ctx;
+        makecontext(&p_end->ctx, xf_ymodem_sim_trampoline, 0);
+    }
+
+    /* 每次恢复最早能被唤醒的一端，时刻相同时 A 端优先 */
+    for (;;) {
+        p_next  = NULL;
+        best    = UINT64_MAX;
+        for (i = 0; i < ARRAY_SIZE(p_sim->end); i++) {
+            if (XF_YMODEM_SIM_END_DONE == p_sim->end[i].state) {
+                continue;
+            }
+            wake = xf_ymodem_sim_end_wake(&p_sim->end[i]);
+            if (wake < best) {
+                best    = wake;
+                p_next  = &p_sim->end[i];
+            }
+        }
+        if (NULL == p_next) {
+            break;
+        }
+        if (best > p_sim->now_ns) {
+            p_sim->now_ns = best;
+        }
+
+        p_next->state   = XF_YMODEM_SIM_END_RUNNING;
+        stp_cur         = p_next;
+        swapcontext(&p_sim->sched_ctx, &p_next->ctx);
+        stp_cur         = NULL;
+    }
+
+l_free:;
+    for (i = 0; i < ARRAY_SIZE(p_sim->end); i++) {
+        free(p_sim->end[i].p_stack);
+        p_sim->end[i].p_stack = NULL;
+    }
+
+    return xf_ret;
+}
+
+const xf_ymodem_ops_t *xf_ymodem_sim_get_ops(void)
+{
+    return &sc_sim_ops;
+}
+
+uint64_t xf_ymodem_sim_now_us(const xf_ymodem_sim_t *p_sim)
+{
+    return (NULL != p_sim) ? (p_sim->now_ns / 1000) : 0;
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static int32_t xf_ymodem_sim_read(void *dst, uint32_t size, uint32_t timeout_ms)
+{
+    xf_ymodem_sim_end_t *p_end = stp_cur;
+    xf_ymodem_sim_t     *p_sim;
+    xf_ymodem_sim_dir_t *p_dir;
+    uint32_t len;
+
+    if ((NULL == p_end) || (NULL == dst)) {
+        return -1;
+    }
+    if (0 == size) {
+        return 0;
+    }
+    p_sim = p_end->p_sim;
+    p_dir = &p_sim->dir[1 - p_end->idx];
+
+    if (xf_ymodem_sim_dir_arrive(p_dir, p_sim->now_ns) != 0) {
+        return -1;
+    }
+    if (0 == p_dir->fifo_num) {
+        p_end->state        = XF_YMODEM_SIM_END_READ;
+        p_end->read_size    = size;
+        p_end->wake_ns      = p_sim->now_ns + (uint64_t)timeout_ms * 1000000;
+        xf_ymodem_sim_yield(p_end);
+        if (xf_ymodem_sim_dir_arrive(p_dir, p_sim->now_ns) != 0) {
+            return -1;
+        }
+    }
+
+    /* 从接收缓冲中取出，可能回绕 */
+    len = min(size, p_dir->fifo_num);
+    xf_ymodem_sim_ring_get(p_dir->p_fifo, p_dir->fifo_cap, p_dir->fifo_rd, (uint8_t *)dst, len);
+    p_dir->fifo_rd          = (p_dir->fifo_rd + len) & (p_dir->fifo_cap - 1);
+    p_dir->fifo_num        -= len;
+    p_dir->stat.rx_bytes   += len;
+
+    return (int32_t)len;
+}
+
+static int32_t xf_ymodem_sim_write(const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    xf_ymodem_sim_end_t *p_end = stp_cur;
+    xf_ymodem_sim_t     *p_sim;
+    xf_ymodem_sim_dir_t *p_dir;
+    uint64_t backlog_ns;
+
+    UNUSED(timeout_ms);
+
+    if ((NULL == p_end) || (NULL == src)) {
+        return -1;
+    }
+    p_sim = p_end->p_sim;
+    p_dir = &p_sim->dir[p_end->idx];
+
+    if (xf_ymodem_sim_dir_send(p_dir, p_sim->now_ns, (const uint8_t *)src, size) != 0) {
+        return -1;
+    }
+
+    /* 未发出的字节超过发送缓冲时等待 */
+    backlog_ns = (uint64_t)p_dir->cfg.tx_fifo_size * p_dir->byte_ns;
+    if (p_dir->tx_end_ns > p_sim->now_ns + backlog_ns) {
+        p_end->state    = XF_YMODEM_SIM_END_WAIT;
+        p_end->wake_ns  = p_dir->tx_end_ns - backlog_ns;
+        xf_ymodem_sim_yield(p_end);
+    }
+
+    return (int32_t)size;
+}
+
+static void xf_ymodem_sim_flush(void)
+{
+    xf_ymodem_sim_end_t *p_end = stp_cur;
+    xf_ymodem_sim_dir_t *p_dir;
+
+    if (NULL == p_end) {
+        return;
+    }
+    p_dir = &p_end->p_sim->dir[1 - p_end->idx];
+
+    /* 只丢弃已到达的字节，仍在线路上的字节之后照常到达 */
+    xf_ymodem_sim_dir_arrive(p_dir, p_end->p_sim->now_ns);
+    p_dir->stat.flush_bytes    += p_dir->fifo_num;
+    p_dir->fifo_rd              = 0;
+    p_dir->fifo_num             = 0;
+}
+
+static void xf_ymodem_sim_delay_ms(uint32_t ms)
+{
+    xf_ymodem_sim_end_t *p_end = stp_cur;
+
+    if (NULL == p_end) {
+        return;
+    }
+    p_end->state    = XF_YMODEM_SIM_END_WAIT;
+    p_end->wake_ns  = p_end->p_sim->now_ns + (uint64_t)ms * 1000000;
+    xf_ymodem_sim_yield(p_end);
+}
+
+/* 虚拟时钟; read 已在虚拟时钟上阻塞，不需要 wait_readable */
+static uint32_t xf_ymodem_sim_now_ms(void)
+{
+    return (NULL != stp_cur) ? (uint32_t)(stp_cur->p_sim->now_ns / 1000000) : 0;
+}
+
+static void xf_ymodem_sim_trampoline(void)
+{
+    xf_ymodem_sim_end_t *p_end = stp_cur;
+
+    p_end->entry(p_end->user_data);
+    p_end->state = XF_YMODEM_SIM_END_DONE;
+    /* 返回后经 uc_link 回到调度器 */
+}
+
+static void xf_ymodem_sim_yield(xf_ymodem_sim_end_t *p_end)
+{
+    swapcontext(&p_end->ctx, &p_end->p_sim->sched_ctx);
+}
+
+/**
+ * @brief 计算一端最早的唤醒时刻。等待读取时取决于对端已写入的字节，所以每次调度都重新计算。
+ */
+static uint64_t xf_ymodem_sim_end_wake(xf_ymodem_sim_end_t *p_end)
+{
+    xf_ymodem_sim_dir_t *p_dir;
+    xf_ymodem_sim_seg_t *p_seg;
+    uint64_t idle_ns;
+    uint64_t last_ns    = 0;
+    uint64_t n;
+    uint32_t target;
+    uint32_t cnt;
+    uint32_t i;
+
+    switch (p_end->state) {
+    case XF_YMODEM_SIM_END_READY:
+        return p_end->p_sim->now_ns;
+    case XF_YMODEM_SIM_END_WAIT:
+        return p_end->wake_ns;
+    case XF_YMODEM_SIM_END_READ:
+        break;
+    default:
+        return UINT64_MAX;
+    }
+
+    /*
+        read 在以下时刻返回(不晚于截止时刻):
+            - 已到达 read_size 字节(受接收缓冲大小限制);
+            - 已有数据到达，且之后线路空闲超过 rx_idle_chars 个字符时间。
+     */
+    p_dir   = &p_end->p_sim->dir[1 - p_end->idx];
+    idle_ns = (uint64_t)p_dir->cfg.rx_idle_chars * p_dir->byte_ns;
+    target  = p_end->read_size;
+    if ((p_dir->cfg.fifo_size > 0) && (target > p_dir->cfg.fifo_size)) {
+        target = p_dir->cfg.fifo_size;
+    }
+    cnt = p_dir->fifo_num;
+    if (cnt >= target) {
+        return p_end->p_sim->now_ns;
+    }
+
+    for (i = 0; i < p_dir->seg_num; i++) {
+        p_seg = &p_dir->p_seg[(p_dir->seg_rd + i) & (p_dir->seg_cap - 1)];
+        if ((cnt > 0) && (p_seg->arrive_ns > last_ns + idle_ns)) {
+            return min(last_ns + idle_ns, p_end->wake_ns);
+        }
+        if (p_seg->arrive_ns > p_end->wake_ns) {
+            return p_end->wake_ns;
+        }
+        /* 段内字节间隔一个字节时间，空闲超时比它短时每个字节之后都算空闲 */
+        n = (idle_ns < p_dir->byte_ns) ? 1 : p_seg->len;
+        n = min(n, (p_end->wake_ns - p_seg->arrive_ns) / p_dir->byte_ns + 1);
+        if (cnt + n >= target) {
+            return p_seg->arrive_ns + (uint64_t)(target - cnt - 1) * p_dir->byte_ns;
+        }
+        cnt    += (uint32_t)n;
+        last_ns = p_seg->arrive_ns + (n - 1) * p_dir->byte_ns;
+        if (n < p_seg->len) {
+            return min(last_ns + idle_ns, p_end->wake_ns);
+        }
+    }
+    if (cnt > 0) {
+        return min(last_ns + idle_ns, p_end->wake_ns);
+    }
+
+    return p_end->wake_ns;
+}
+
+static void xf_ymodem_sim_dir_init(
+    xf_ymodem_sim_dir_t *p_dir, const xf_ymodem_sim_link_cfg_t *p_cfg, uint64_t seed)
+{
+    p_dir->cfg      = *p_cfg;
+    p_dir->byte_ns  = (uint64_t)p_cfg->bits_per_byte * 1000000000ULL / p_cfg->baudrate;
+    /* xorshift64* 的状态不能为 0 */
+    p_dir->rng      = (seed != 0) ? seed : 0x2545F4914F6CDD1DULL;
+
+    p_dir->ber_skip     = xf_ymodem_sim_geom(p_dir, p_cfg->ber);
+    p_dir->burst_skip   = xf_ymodem_sim_geom(p_dir, p_cfg->burst_rate);
+    p_dir->drop_skip    = xf_ymodem_sim_geom(p_dir, p_cfg->drop_rate);
+}
+
+/**
+ * @brief 写入字节: 排到线路上并注入误码。
+ *        误码按间隔抽样，两次误码之间的字节整段放上线路，只有出错的字节逐个处理。
+ */
+static int xf_ymodem_sim_dir_send(
+    xf_ymodem_sim_dir_t *p_dir, uint64_t now_ns, const uint8_t *p_src, uint32_t size)
+{
+    uint64_t    latency_ns  = (uint64_t)p_dir->cfg.latency_us * 1000;
+    uint64_t    clean;
+    uint32_t    i           = 0;
+    uint8_t     ch;
+
+    if (p_dir->tx_end_ns < now_ns) {
+        p_dir->tx_end_ns = now_ns;
+    }
+    p_dir->stat.tx_bytes   += size;
+    p_dir->stat.busy_ns    += (uint64_t)size * p_dir->byte_ns;
+
+    while (i < size) {
+        clean = (p_dir->burst_left > 0) ? 0 : (size - i);
+        clean = min(clean, p_dir->ber_skip / 8);
+        clean = min(clean, p_dir->burst_skip);
+        clean = min(clean, p_dir->drop_skip);
+        if (clean > 0) {
+            if (xf_ymodem_sim_wire_push(p_dir, &p_src[i], (uint32_t)clean,
+                                        p_dir->tx_end_ns + p_dir->byte_ns + latency_ns) != 0) {
+                return -1;
+            }
+            p_dir->tx_end_ns   += clean * p_dir->byte_ns;
+            p_dir->ber_skip    -= clean * 8;
+            p_dir->burst_skip  -= clean;
+            p_dir->drop_skip   -= clean;
+            i                  += (uint32_t)clean;
+            continue;
+        }
+
+        ch                  = p_src[i++];
+        p_dir->tx_end_ns   += p_dir->byte_ns;
+
+        /* 随机位翻转: ber_skip 为距下一个出错位的位数，只计数据位 */
+        while (p_dir->ber_skip < 8) {
+            ch ^= (uint8_t)(1U << p_dir->ber_skip);
+            p_dir->stat.bit_flips++;
+            p_dir->ber_skip += 1 + xf_ymodem_sim_geom(p_dir, p_dir->cfg.ber);
+        }
+        p_dir->ber_skip -= 8;
+
+        /* 突发误码: 连续 burst_len 字节替换为随机值 */
+        if (0 == p_dir->burst_left) {
+            if (0 == p_dir->burst_skip) {
+                p_dir->stat.bursts++;
+                p_dir->burst_left   = p_dir->cfg.burst_len;
+                p_dir->burst_skip   = xf_ymodem_sim_geom(p_dir, p_dir->cfg.burst_rate);
+            } else {
+                p_dir->burst_skip--;
+            }
+        }
+        if (p_dir->burst_left > 0) {
+            p_dir->burst_left--;
+            ch ^= (uint8_t)(1 + xf_ymodem_sim_rand(p_dir) % 255);
+        }
+
+        /* 丢失的字节不到达，但已占用线路时间 */
+        if (0 == p_dir->drop_skip) {
+            p_dir->stat.drop_bytes++;
+            p_dir->drop_skip = xf_ymodem_sim_geom(p_dir, p_dir->cfg.drop_rate);
+            continue;
+        }
+        p_dir->drop_skip--;
+
+        if (xf_ymodem_sim_wire_push(p_dir, &ch, 1, p_dir->tx_end_ns + latency_ns) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 把 now_ns 之前到达的字节移入接收缓冲，缓冲已满时丢弃(溢出)。
+ */
+static int xf_ymodem_sim_dir_arrive(xf_ymodem_sim_dir_t *p_dir, uint64_t now_ns)
+{
+    xf_ymodem_sim_seg_t *p_seg;
+    uint32_t    n;
+    uint32_t    accept;
+    uint32_t    chunk;
+    uint32_t    done;
+
+    while (p_dir->seg_num > 0) {
+        p_seg = &p_dir->p_seg[p_dir->seg_rd];
+        if (p_seg->arrive_ns > now_ns) {
+            break;
+        }
+        n       = (uint32_t)min((uint64_t)p_seg->len,
+                                (now_ns - p_seg->arrive_ns) / p_dir->byte_ns + 1);
+        accept  = n;
+        if (p_dir->cfg.fifo_size > 0) {
+            accept = (p_dir->fifo_num < p_dir->cfg.fifo_size)
+                     ? min(n, p_dir->cfg.fifo_size - p_dir->fifo_num) : 0;
+        }
+        if (accept > 0) {
+            if (xf_ymodem_sim_ring_reserve(&p_dir->p_fifo, &p_dir->fifo_cap, &p_dir->fifo_rd,
+                                           p_dir->fifo_num, p_dir->fifo_num + accept) != 0) {
+                return -1;
+            }
+            /* 线路缓冲可能回绕，分段搬移 */
+            for (done = 0; done < accept; done += chunk) {
+                chunk = min(accept - done,
+                            p_dir->wire_cap - ((p_dir->wire_rd + done) & (p_dir->wire_cap - 1)));
+                xf_ymodem_sim_ring_put(
+                    p_dir->p_fifo, p_dir->fifo_cap,
+                    (p_dir->fifo_rd + p_dir->fifo_num + done) & (p_dir->fifo_cap - 1),
+                    &p_dir->p_wire[(p_dir->wire_rd + done) & (p_dir->wire_cap - 1)], chunk);
+            }
+            p_dir->fifo_num += accept;
+        }
+        /* 缓冲满后到达的字节丢失 */
+        p_dir->stat.overrun_bytes  += n - accept;
+        p_dir->wire_rd              = (p_dir->wire_rd + n) & (p_dir->wire_cap - 1);
+        p_dir->wire_num            -= n;
+
+        p_seg->len         -= n;
+        p_seg->arrive_ns   += (uint64_t)n * p_dir->byte_ns;
+        if (0 == p_seg->len) {
+            p_dir->seg_rd = (p_dir->seg_rd + 1) & (p_dir->seg_cap - 1);
+            p_dir->seg_num--;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 把字节追加到线路上，与上一段首尾相接时合并为一段。
+ */
+static int xf_ymodem_sim_wire_push(
+    xf_ymodem_sim_dir_t *p_dir, const uint8_t *p_src, uint32_t len, uint64_t arrive_ns)
+{
+    xf_ymodem_sim_seg_t *p_seg;
+    xf_ymodem_sim_seg_t *p_last;
+    uint32_t cap;
+    uint32_t i;
+
+    if (xf_ymodem_sim_ring_reserve(&p_dir->p_wire, &p_dir->wire_cap, &p_dir->wire_rd,
+                                   p_dir->wire_num, p_dir->wire_num + len) != 0) {
+        return -1;
+    }
+    xf_ymodem_sim_ring_put(p_dir->p_wire, p_dir->wire_cap,
+                           (p_dir->wire_rd + p_dir->wire_num) & (p_dir->wire_cap - 1),
+                           p_src, len);
+    p_dir->wire_num += len;
+
+    if (p_dir->seg_num > 0) {
+        p_last = &p_dir->p_seg[(p_dir->seg_rd + p_dir->seg_num - 1) & (p_dir->seg_cap - 1)];
+        if ((p_last->arrive_ns + (uint64_t)p_last->len * p_dir->byte_ns == arrive_ns)
+                && (p_last->len <= UINT32_MAX - len)) {
+            p_last->len += len;
+            return 0;
+        }
+    }
+
+    if (p_dir->seg_num == p_dir->seg_cap) {
+        cap     = (p_dir->seg_cap > 0) ? (p_dir->seg_cap * 2) : XF_YMODEM_SIM_SEG_CAP_INIT;
+        p_seg   = (xf_ymodem_sim_seg_t *)malloc((size_t)cap * sizeof(xf_ymodem_sim_seg_t));
+        if (NULL == p_seg) {
+            return -1;
+        }
+        for (i = 0; i < p_dir->seg_num; i++) {
+            p_seg[i] = p_dir->p_seg[(p_dir->seg_rd + i) & (p_dir->seg_cap - 1)];
+        }
+        free(p_dir->p_seg);
+        p_dir->p_seg    = p_seg;
+        p_dir->seg_cap  = cap;
+        p_dir->seg_rd   = 0;
+    }
+    p_seg = &p_dir->p_seg[(p_dir->seg_rd + p_dir->seg_num) & (p_dir->seg_cap - 1)];
+    p_seg->arrive_ns    = arrive_ns;
+    p_seg->len          = len;
+    p_dir->seg_num++;
+
+    return 0;
+}
+
+/**
+ * @brief 保证环形缓冲至少能容纳 need 字节，容量按 2 的幂加倍，内容按顺序搬到新缓冲的开头。
+ */
+static int xf_ymodem_sim_ring_reserve(
+    uint8_t **pp_buf, uint32_t *p_cap, uint32_t *p_rd, uint32_t num, uint32_t need)
+{
+    uint8_t *p_buf;
+    uint32_t cap;
+
+    if (need <= *p_cap) {
+        return 0;
+    }
+    cap = (*p_cap > 0) ? *p_cap : XF_YMODEM_SIM_WIRE_CAP_INIT;
+    while (cap < need) {
+        cap *= 2;
+    }
+    p_buf = (uint8_t *)malloc(cap);
+    if (NULL == p_buf) {
+        return -1;
+    }
+    if (num > 0) {
+        xf_ymodem_sim_ring_get(*pp_buf, *p_cap, *p_rd, p_buf, num);
+    }
+    free(*pp_buf);
+    *pp_buf = p_buf;
+    *p_cap  = cap;
+    *p_rd   = 0;
+
+    return 0;
+}
+
+static void xf_ymodem_sim_ring_put(
+    uint8_t *p_buf, uint32_t cap, uint32_t pos, const uint8_t *p_src, uint32_t len)
+{
+    uint32_t n = min(len, cap - pos);
+
+    xf_memcpy(&p_buf[pos], p_src, n);
+    xf_memcpy(p_buf, p_src + n, len - n);
+}
+
+static void xf_ymodem_sim_ring_get(
+    const uint8_t *p_buf, uint32_t cap, uint32_t pos, uint8_t *p_dst, uint32_t len)
+{
+    uint32_t n = min(len, cap - pos);
+
+    xf_memcpy(p_dst, &p_buf[pos], n);
+    xf_memcpy(p_dst + n, p_buf, len - n);
+}
+
+static uint64_t xf_ymodem_sim_rand(xf_ymodem_sim_dir_t *p_dir)
+{
+    /* xorshift64* */
+    p_dir->rng ^= p_dir->rng >> 12;
+    p_dir->rng ^= p_dir->rng << 25;
+    p_dir->rng ^= p_dir->rng >> 27;
+    return p_dir->rng * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief 几何分布: 每次试验以概率 p 发生，返回下一次发生前不发生的次数。
+ *        按间隔抽样，误码率很低时不必逐位掷骰子。
+ */
+static uint64_t xf_ymodem_sim_geom(xf_ymodem_sim_dir_t *p_dir, double p)
+{
+    double u;
+    double k;
+
+    if (p <= 0.0) {
+        return XF_YMODEM_SIM_NEVER;
+    }
+    if (p >= 1.0) {
+        return 0;
+    }
+    /* (0, 1] 上的均匀分布 */
+    u = (double)((xf_ymodem_sim_rand(p_dir) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    k = floor(log(u) / log1p(-p));
+
+    return (k < (double)XF_YMODEM_SIM_NEVER) ? (uint64_t)k : XF_YMODEM_SIM_NEVER;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file xf_ymodem_sim.h
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem 内存链路模拟器: 在虚拟时钟上连接一对使用阻塞接口的收发端，
+ *        模拟波特率、单向延迟、接收 FIFO 深度、随机位翻转、突发误码及丢字节。
+ * @version 1.0
+ * @date 2025-01-06
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 两端各自运行在一个协程(ucontext)中，同一时刻只有一端在运行:
+ * 一端在 read/write/delay_ms 中需要等待时让出，调度器把虚拟时钟推进到
+ * 最早能被唤醒的一端的时刻再恢复它。两端的计算不耗费虚拟时间。
+ * 因此结果只取决于配置及随机种子，与主机负载无关，且远快于实时。
+ */
+
+#ifndef __XF_YMODEM_SIM_H__
+#define __XF_YMODEM_SIM_H__
+
+/* ==================== [Includes] ========================================== */
+
+#include <ucontext.h>
+
+#include "xf_utils.h"
+#include "xf_ymodem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ==================== [Defines] =========================================== */
+
+/**
+ * @brief 每端协程的栈大小。
+ */
+#if !defined(XF_YMODEM_SIM_STACK_SIZE)
+#   define XF_YMODEM_SIM_STACK_SIZE     (256 * 1024)
+#endif
+
+/**
+ * @brief 默认链路: 921600 8N1, 无延迟，无误码，接收缓冲不限，发送缓冲 1K.
+ */
+#define XF_YMODEM_SIM_LINK_CFG_DEFAULT() \
+    { \
+        .baudrate       = 921600, \
+        .bits_per_byte  = 10, \
+        .latency_us     = 0, \
+        .fifo_size      = 0, \
+        .tx_fifo_size   = 1024, \
+        .rx_idle_chars  = 2, \
+        .ber            = 0.0, \
+        .burst_rate     = 0.0, \
+        .burst_len      = 0, \
+        .drop_rate      = 0.0, \
+    }
+
+/* ==================== [Typedefs] ========================================== */
+
+/**
+ * @brief 一个方向的链路配置。
+ */
+typedef struct _xf_ymodem_sim_link_cfg_t {
+    uint32_t    baudrate;           /*!< 波特率，必须大于 0 */
+    uint8_t     bits_per_byte;      /*!< 每字节线路位数，含起始、停止位，8N1 为 10 */
+    uint32_t    latency_us;         /*!< 单向延迟: 字节发完后经过此时间到达对端 */
+    /**
+     * @brief 接收端缓冲(FIFO 或驱动的环形缓冲)大小，0 为不限。
+     * 已到达但未被读取的字节达到此值后，之后到达的字节被丢弃(溢出)。
+     */
+    uint32_t    fifo_size;
+    /**
+     * @brief 发送缓冲大小: write 在尚未发出的字节多于此值时等待，0 为等到全部发出。
+     * ymodem-g 等不等待应答的模式依靠它限速。
+     */
+    uint32_t    tx_fifo_size;
+    /**
+     * @brief 接收空闲超时，单位为字符时间(同 UART 的 IDLE 中断):
+     * read 在收满 size 字节，或已收到数据后线路空闲超过此时间时返回。
+     * 0 时收到第一个字节即返回。
+     */
+    uint32_t    rx_idle_chars;
+    double      ber;                /*!< 误码率: 每个数据位独立翻转的概率 */
+    double      burst_rate;         /*!< 每字节开始一次突发误码的概率 */
+    uint32_t    burst_len;          /*!< 突发误码破坏的连续字节数 */
+    double      drop_rate;          /*!< 每字节丢失的概率(仍占用线路时间) */
+} xf_ymodem_sim_link_cfg_t;
+
+/**
+ * @brief 一个方向的统计。
+ */
+typedef struct _xf_ymodem_sim_stat_t {
+    uint64_t    tx_bytes;           /*!< 写入链路的字节数 */
+    uint64_t    rx_bytes;           /*!< 被 read 读走的字节数 */
+    uint64_t    flush_bytes;        /*!< 被 flush 丢弃的字节数 */
+    uint64_t    bit_flips;          /*!< 随机翻转的位数 */
+    uint64_t    bursts;             /*!< 突发误码次数 */
+    uint64_t    drop_bytes;         /*!< 随机丢失的字节数 */
+    uint64_t    overrun_bytes;      /*!< 接收缓冲溢出丢弃的字节数 */
+    uint64_t    busy_ns;            /*!< 线路忙(正在发送)的累计时间 */
+} xf_ymodem_sim_stat_t;
+
+/**
+ * @brief 一端的入口，在协程中运行；返回即结束该端。
+ */
+typedef void (*xf_ymodem_sim_entry_t)(void *user_data);
+
+/**
+ * @brief 线路上一段连续到达(间隔一个字节时间)的字节，私有。
+ */
+typedef struct _xf_ymodem_sim_seg_t {
+    uint64_t    arrive_ns;          /*!< 第一个字节到达的时刻 */
+    uint32_t    len;
+} xf_ymodem_sim_seg_t;
+
+/**
+ * @brief 单向链路，私有。
+ */
+typedef struct _xf_ymodem_sim_dir_t {
+    xf_ymodem_sim_link_cfg_t cfg;
+    xf_ymodem_sim_stat_t stat;
+    uint64_t    byte_ns;            /*!< 一个字节的线路时间 */
+    uint64_t    tx_end_ns;          /*!< 已写入的最后一个字节发完的时刻 */
+    uint64_t    rng;                /*!< xorshift64* 状态 */
+    uint64_t    ber_skip;           /*!< 距下一个翻转位还有多少位 */
+    uint64_t    burst_skip;         /*!< 距下一次突发误码还有多少字节 */
+    uint64_t    drop_skip;          /*!< 距下一个丢失字节还有多少字节 */
+    uint32_t    burst_left;         /*!< 当前突发误码还要破坏的字节数 */
+    /* 线路上的字节，按连续到达的段记录到达时刻 */
+    uint8_t    *p_wire;
+    uint32_t    wire_cap;
+    uint32_t    wire_rd;
+    uint32_t    wire_num;
+    xf_ymodem_sim_seg_t *p_seg;
+    uint32_t    seg_cap;
+    uint32_t    seg_rd;
+    uint32_t    seg_num;
+    /* 已到达、未读取的字节 */
+    uint8_t    *p_fifo;
+    uint32_t    fifo_cap;
+    uint32_t    fifo_rd;
+    uint32_t    fifo_num;
+} xf_ymodem_sim_dir_t;
+
+/**
+ * @brief 一端，私有。
+ */
+typedef struct _xf_ymodem_sim_end_t {
+    struct _xf_ymodem_sim_t *p_sim;
+    xf_ymodem_sim_entry_t entry;
+    void       *user_data;
+    ucontext_t  ctx;
+    void       *p_stack;
+    uint8_t     idx;                /*!< 0 为 A 端，1 为 B 端；A 端写入 dir[0] */
+    uint8_t     state;
+    uint32_t    read_size;          /*!< 等待读取时请求的字节数 */
+    uint64_t    wake_ns;            /*!< 等待的截止时刻 */
+} xf_ymodem_sim_end_t;
+
+/**
+ * @brief 模拟器。
+ */
+typedef struct _xf_ymodem_sim_t {
+    xf_ymodem_sim_dir_t dir[2];     /*!< dir[0]: A 到 B, dir[1]: B 到 A; 只读取 stat */
+    xf_ymodem_sim_end_t end[2];
+    uint64_t    now_ns;             /*!< 虚拟时钟 */
+    ucontext_t  sched_ctx;
+} xf_ymodem_sim_t;
+
+/* ==================== [Global Prototypes] ================================= */
+
+/**
+ * @brief 初始化模拟器。
+ *
+ * @param p_sim                 模拟器指针。
+ * @param p_a_to_b              A 端到 B 端的链路配置，NULL 时使用默认配置。
+ * @param p_b_to_a              B 端到 A 端的链路配置，NULL 时与 p_a_to_b 相同。
+ * @param seed                  随机种子，相同的种子及配置得到相同的结果。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_sim_init(
+    xf_ymodem_sim_t *p_sim,
+    const xf_ymodem_sim_link_cfg_t *p_a_to_b, const xf_ymodem_sim_link_cfg_t *p_b_to_a,
+    uint64_t seed);
+
+/**
+ * @brief 释放模拟器占用的内存。
+ *
+ * @param p_sim                 模拟器指针。
+ */
+void xf_ymodem_sim_deinit(xf_ymodem_sim_t *p_sim);
+
+/**
+ * @brief 运行两端直到都返回。每个模拟器只能运行一次。
+ *
+ * @param p_sim                 模拟器指针。
+ * @param entry_a               A 端入口。
+ * @param user_data_a           传给 entry_a 的用户数据。
+ * @param entry_b               B 端入口。
+ * @param user_data_b           传给 entry_b 的用户数据。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_ERR_NO_MEM         内存不足
+ */
+xf_err_t xf_ymodem_sim_run(
+    xf_ymodem_sim_t *p_sim,
+    xf_ymodem_sim_entry_t entry_a, void *user_data_a,
+    xf_ymodem_sim_entry_t entry_b, void *user_data_b);
+
+/**
+ * @brief 取得模拟链路的 ops, 两端共用: 回调按当前运行的一端读写对应方向。
+ *        只能在 xf_ymodem_sim_run() 运行的入口中使用。now_ms 为虚拟时钟。
+ *        需要 user_parse 或 user_file_info 时复制一份再填写。
+ *
+ * @return const xf_ymodem_ops_t* ops.
+ */
+const xf_ymodem_ops_t *xf_ymodem_sim_get_ops(void);
+
+/**
+ * @brief 取得虚拟时钟，单位 us.
+ *
+ * @param p_sim                 模拟器指针。
+ * @return uint64_t             从 xf_ymodem_sim_run() 开始经过的虚拟时间。
+ */
+uint64_t xf_ymodem_sim_now_us(const xf_ymodem_sim_t *p_sim);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* __XF_YMODEM_SIM_H__ */
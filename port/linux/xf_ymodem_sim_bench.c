@@ -0,0 +1,599 @@
+/**
+ * @file xf_ymodem_sim_bench.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 端到端吞吐基准: 在模拟链路上按包长、波特率、延迟、误码率的组合逐个运行完整收发，
+ *        输出 CSV 或 JSON, 用于比较不同版本的性能。
+ * @version 1.0
+ * @date 2025-01-07
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 用法: xf_ymodem_sim_bench [选项]
+ *      -s <KiB>            每个用例的文件长度，默认 1024
+ *      -F <list>           包数据段长，默认 128,1024,2048,4096,8192
+ *      -b <list>           波特率，默认 115200,921600,4000000
+ *      -l <list>           单向延迟(us), 默认 0,1000,10000
+ *      -e <list>           误码率，默认 0,1e-6,1e-5
+ *      -d <list>           丢字节率，默认 0
+ *      -a <list>           每包的应用处理时间(ms): 发送端填充每包前、接收端每交付一包后等待，默认 0
+ *      -x <list>           两端额外的 xf_ymodem_t.flags, 默认 0
+ *      -t <ms> -n <num>    timeout_ms 及 retry_num, 默认 1000 及 10
+ *      -r <seed>           随机种子，默认 1
+ *      -j                  输出 JSON, 默认 CSV
+ *      -o <file>           输出到文件，默认标准输出
+ * <list> 以逗号分隔。误码对两个方向都生效。
+ * 不指定 -F/-b/-l/-e/-d/-a/-x 时，默认矩阵之后还运行滑动窗口的丢字节用例:
+ * 1K 包 x 3 种波特率 x 3 种延迟 x 丢字节率 1e-5,4e-5 x flags 0 与 XF_YMODEM_FLAG_WINDOW.
+ *
+ * 每行(每个对象)的字段:
+ *      frame, baud, latency_us, ber, drop_rate, app_ms, flags, seed     用例
+ *      ok                  文件完整且内容一致，两端均正常结束
+ *      file_bytes          文件长度
+ *      virtual_s           虚拟耗时
+ *      goodput_Bps         接收端交付的文件字节数 / virtual_s
+ *      efficiency          goodput_Bps / 线路原始速率(baud / bits_per_byte)
+ *      tx_wire_bytes       发送端写入链路的字节数(含包头、CRC 及重发)
+ *      rx_wire_bytes       接收端写入链路的字节数(应答)
+ *      packets             发送端发出的数据包数(含起始帧)
+ *      retransmits         其中重发的包数
+ *      naks                接收端发出的 NAK 数(含每个文件结束时对第一个 EOT 的 NAK)
+ *      cpu_s, cpu_ms_per_mib   主机 CPU 时间(两端及模拟器)及每 MiB 文件的 CPU 时间
+ * 除 CPU 时间外，结果只取决于用例及种子，可以直接比较两个版本的输出。
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xf_ymodem_sim.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define BENCH_FILE_KIB_DEFAULT          (1024)
+#define BENCH_LIST_MAX                  (16)
+#define BENCH_HANDSHAKE_TRY_NUM         (3)
+#define BENCH_NAME                      "bench.bin"
+
+/* ==================== [Typedefs] ========================================== */
+
+/* 一个维度的取值 */
+typedef struct _bench_list_t {
+    double      val[BENCH_LIST_MAX];
+    uint32_t    num;
+} bench_list_t;
+
+/* 一组用例: 各维度取值的所有组合 */
+typedef struct _bench_matrix_t {
+    bench_list_t    frames;
+    bench_list_t    bauds;
+    bench_list_t    latencies;
+    bench_list_t    bers;
+    bench_list_t    drops;
+    bench_list_t    app_delays;
+    bench_list_t    flags;
+} bench_matrix_t;
+
+/* 一端 */
+typedef struct _bench_end_t {
+    xf_ymodem_t ym;
+    xf_err_t    xf_ret;
+    uint64_t    bytes;              /*!< 接收端: 已交付并校验的字节数 */
+    uint8_t     ok;
+} bench_end_t;
+
+/* 包计数，由包装后的 write 统计 */
+typedef struct _bench_cnt_t {
+    uint64_t    packets;
+    uint64_t    retransmits;
+    uint64_t    naks;
+    uint32_t    pn_map[256 / 32];   /*!< 最近半圈内已发出的包号 */
+    uint8_t     ext_pending;        /*!< 已写扩展包头，下一次写入从包号开始 */
+} bench_cnt_t;
+
+/* 一个用例及结果 */
+typedef struct _bench_case_t {
+    uint32_t    frame;
+    uint32_t    baud;
+    uint32_t    latency_us;
+    double      ber;
+    double      drop_rate;
+    uint32_t    app_ms;
+    uint8_t     ok;
+    double      virtual_s;
+    double      goodput;
+    double      efficiency;
+    uint64_t    tx_wire_bytes;
+    uint64_t    rx_wire_bytes;
+    bench_cnt_t cnt;
+    double      cpu_s;
+} bench_case_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static int bench_matrix_run(FILE *p_out, const bench_matrix_t *p_mat,
+                            uint32_t *p_case_num, uint32_t *p_fail_num);
+static int bench_run(bench_case_t *p_case);
+static void bench_output(FILE *p_out, const bench_case_t *p_case, uint8_t is_first);
+static void bench_sender(void *user_data);
+static void bench_receiver(void *user_data);
+static void bench_end_init(bench_end_t *p_end, uint32_t buf_size, const xf_ymodem_ops_t *p_ops);
+static int32_t bench_tx_write(const void *src, uint32_t size, uint32_t timeout_ms);
+static int32_t bench_rx_write(const void *src, uint32_t size, uint32_t timeout_ms);
+static void bench_count_packet(uint8_t pn);
+static int bench_parse_list(const char *p_str, bench_list_t *p_list);
+static void bench_fill(uint8_t *p_dst, uint64_t offset, uint32_t size);
+static int bench_check(const uint8_t *p_src, uint64_t offset, uint32_t size);
+static double bench_cpu_s(void);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_sim_bench";
+
+static uint8_t      s_pattern[65536];
+static uint64_t     s_file_len;
+static uint32_t     s_flags;            /*!< 当前用例两端额外的 flags */
+static uint32_t     s_timeout_ms    = 1000;
+static uint32_t     s_retry_num     = 10;
+static uint64_t     s_seed          = 1;
+static uint8_t      s_json          = false;
+static uint32_t     s_app_ms;           /*!< 当前用例每包的应用处理时间 */
+
+/* 收发两端的 ops: 在模拟链路的 ops 上包装 write 以统计包数 */
+static xf_ymodem_ops_t  s_tx_ops;
+static xf_ymodem_ops_t  s_rx_ops;
+static bench_cnt_t      s_cnt;
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    bench_matrix_t  mats[]      = {
+        {
+            .frames     = {{128, 1024, 2048, 4096, 8192}, 5},
+            .bauds      = {{115200, 921600, 4000000}, 3},
+            .latencies  = {{0, 1000, 10000}, 3},
+            .bers       = {{0, 1e-6, 1e-5}, 3},
+            .drops      = {{0}, 1},
+            .app_delays = {{0}, 1},
+            .flags      = {{0}, 1},
+        },
+        {
+            /* 滑动窗口在丢字节后重新对齐，与停等比较 */
+            .frames     = {{1024}, 1},
+            .bauds      = {{115200, 921600, 4000000}, 3},
+            .latencies  = {{0, 1000, 10000}, 3},
+            .bers       = {{0}, 1},
+            .drops      = {{1e-5, 4e-5}, 2},
+            .app_delays = {{0}, 1},
+            .flags      = {{0, XF_YMODEM_FLAG_WINDOW}, 2},
+        },
+    };
+    bench_matrix_t *p_mat       = &mats[0];
+    uint32_t        mat_num     = ARRAY_SIZE(mats);
+    FILE           *p_out       = stdout;
+    const char     *p_path      = NULL;
+    uint32_t        fail_num    = 0;
+    uint32_t        case_num    = 0;
+    uint32_t        i;
+    int             opt;
+    int             err         = 0;
+
+    s_file_len = (uint64_t)BENCH_FILE_KIB_DEFAULT * 1024;
+    while ((opt = getopt(argc, argv, "s:F:b:l:e:d:a:x:t:n:r:jo:")) != -1) {
+        switch (opt) {
+        case 's': s_file_len    = strtoull(optarg, NULL, 0) * 1024;     break;
+        case 'F': err          |= bench_parse_list(optarg, &p_mat->frames);     mat_num = 1; break;
+        case 'b': err          |= bench_parse_list(optarg, &p_mat->bauds);      mat_num = 1; break;
+        case 'l': err          |= bench_parse_list(optarg, &p_mat->latencies);  mat_num = 1; break;
+        case 'e': err          |= bench_parse_list(optarg, &p_mat->bers);       mat_num = 1; break;
+        case 'd': err          |= bench_parse_list(optarg, &p_mat->drops);      mat_num = 1; break;
+        case 'a': err          |= bench_parse_list(optarg, &p_mat->app_delays); mat_num = 1; break;
+        case 'x': err          |= bench_parse_list(optarg, &p_mat->flags);      mat_num = 1; break;
+        case 't': s_timeout_ms  = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'n': s_retry_num   = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'r': s_seed        = strtoull(optarg, NULL, 0);            break;
+        case 'j': s_json        = true;                                 break;
+        case 'o': p_path        = optarg;                               break;
+        default:  err           = -1;                                   break;
+        }
+    }
+    if ((err != 0) || (optind != argc)) {
+        fprintf(stderr, "usage: %s [-s KiB] [-F frames] [-b bauds] [-l latencies_us]\n"
+                "       [-e bers] [-d drop_rates] [-a app_delays_ms] [-x flags_list]\n"
+                "       [-t timeout_ms] [-n retry] [-r seed] [-j] [-o file]\n", argv[0]);
+        return 2;
+    }
+    if ((s_file_len == 0) || (s_file_len > INT32_MAX)) {
+        XF_LOGE(TAG, "file length must be 1..%d bytes", (int)INT32_MAX);
+        return 2;
+    }
+    if (p_path != NULL) {
+        p_out = fopen(p_path, "w");
+        if (NULL == p_out) {
+            XF_LOGE(TAG, "open %s failed", p_path);
+            return 2;
+        }
+    }
+
+    srand(1);
+    for (i = 0; i < sizeof(s_pattern); i++) {
+        s_pattern[i] = (uint8_t)rand();
+    }
+
+    s_tx_ops        = *xf_ymodem_sim_get_ops();
+    s_tx_ops.write  = bench_tx_write;
+    s_rx_ops        = *xf_ymodem_sim_get_ops();
+    s_rx_ops.write  = bench_rx_write;
+
+    for (i = 0; (i < mat_num) && (err == 0); i++) {
+        err = bench_matrix_run(p_out, &mats[i], &case_num, &fail_num);
+    }
+
+    if (s_json) {
+        fprintf(p_out, "%s]\n", (case_num > 0) ? "\n" : "[");
+    }
+    if (p_out != stdout) {
+        fclose(p_out);
+    }
+    if (fail_num > 0) {
+        XF_LOGE(TAG, "%u of %u cases failed", (unsigned)fail_num, (unsigned)case_num);
+    }
+
+    return (err != 0) ? 2 : ((fail_num > 0) ? 1 : 0);
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static int bench_matrix_run(FILE *p_out, const bench_matrix_t *p_mat,
+                            uint32_t *p_case_num, uint32_t *p_fail_num)
+{
+    bench_case_t    bc;
+    uint32_t        i_f, i_b, i_l, i_e, i_d, i_a, i_x;
+
+    for (i_f = 0; i_f < p_mat->frames.num; i_f++) {
+        for (i_b = 0; i_b < p_mat->bauds.num; i_b++) {
+            for (i_l = 0; i_l < p_mat->latencies.num; i_l++) {
+                for (i_e = 0; i_e < p_mat->bers.num; i_e++) {
+                    for (i_d = 0; i_d < p_mat->drops.num; i_d++) {
+                        for (i_a = 0; i_a < p_mat->app_delays.num; i_a++) {
+                            for (i_x = 0; i_x < p_mat->flags.num; i_x++) {
+                                xf_memset(&bc, 0, sizeof(bc));
+                                bc.frame        = (uint32_t)p_mat->frames.val[i_f];
+                                bc.baud         = (uint32_t)p_mat->bauds.val[i_b];
+                                bc.latency_us   = (uint32_t)p_mat->latencies.val[i_l];
+                                bc.ber          = p_mat->bers.val[i_e];
+                                bc.drop_rate    = p_mat->drops.val[i_d];
+                                bc.app_ms       = (uint32_t)p_mat->app_delays.val[i_a];
+                                s_flags         = (uint32_t)p_mat->flags.val[i_x];
+                                if (bench_run(&bc) != 0) {
+                                    XF_LOGE(TAG, "invalid case: frame %u, baud %u",
+                                            (unsigned)bc.frame, (unsigned)bc.baud);
+                                    return -1;
+                                }
+                                bench_output(p_out, &bc, (0 == *p_case_num));
+                                fflush(p_out);
+                                (*p_case_num)++;
+                                *p_fail_num += (bc.ok) ? 0 : 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int bench_run(bench_case_t *p_case)
+{
+    xf_ymodem_sim_link_cfg_t cfg = XF_YMODEM_SIM_LINK_CFG_DEFAULT();
+    xf_ymodem_sim_t sim;
+    bench_end_t tx          = {0};
+    bench_end_t rx          = {0};
+    uint32_t    buf_size    = p_case->frame + XF_YMODEM_PROT_SEG_SIZE;
+    double      cpu;
+
+    if ((p_case->frame < XF_YMODEM_SOH_DATA_SIZE) || (0 == p_case->baud)) {
+        return -1;
+    }
+    cfg.baudrate    = p_case->baud;
+    cfg.latency_us  = p_case->latency_us;
+    cfg.ber         = p_case->ber;
+    cfg.drop_rate   = p_case->drop_rate;
+    if (xf_ymodem_sim_init(&sim, &cfg, NULL, s_seed) != XF_OK) {
+        return -1;
+    }
+    bench_end_init(&tx, buf_size, &s_tx_ops);
+    bench_end_init(&rx, buf_size, &s_rx_ops);
+#if XF_YMODEM_RTO_IS_ENABLE
+    tx.ym.baudrate  = cfg.baudrate;
+    rx.ym.baudrate  = cfg.baudrate;
+#endif
+    xf_memset(&s_cnt, 0, sizeof(s_cnt));
+    s_app_ms = p_case->app_ms;
+
+    cpu = bench_cpu_s();
+    xf_ymodem_sim_run(&sim, bench_sender, &tx, bench_receiver, &rx);
+    p_case->cpu_s   = bench_cpu_s() - cpu;
+
+    p_case->ok              = tx.ok && rx.ok;
+    p_case->virtual_s       = (double)sim.now_ns * 1e-9;
+    p_case->goodput         = (p_case->virtual_s > 0) ? (rx.bytes / p_case->virtual_s) : 0.0;
+    /* 线路的原始速率(每秒字节数) */
+    p_case->efficiency      = p_case->goodput / ((double)cfg.baudrate / cfg.bits_per_byte);
+    p_case->tx_wire_bytes   = sim.dir[0].stat.tx_bytes;
+    p_case->rx_wire_bytes   = sim.dir[1].stat.tx_bytes;
+    p_case->cnt             = s_cnt;
+
+    xf_ymodem_sim_deinit(&sim);
+    free(tx.ym.p_buf);
+    free(tx.ym.p_buf_alt);
+    free(rx.ym.p_buf);
+    free(rx.ym.p_buf_alt);
+
+    return 0;
+}
+
+static void bench_output(FILE *p_out, const bench_case_t *p_case, uint8_t is_first)
+{
+    double mib = (double)s_file_len / (1024.0 * 1024.0);
+
+    if (s_json) {
+        fprintf(p_out, "%s{\"frame\": %u, \"baud\": %u, \"latency_us\": %u, \"ber\": %g, "
+                "\"drop_rate\": %g, \"app_ms\": %u, \"flags\": %u, \"seed\": %llu, \"ok\": %s, "
+                "\"file_bytes\": %llu, \"virtual_s\": %.6f, \"goodput_Bps\": %.1f, "
+                "\"efficiency\": %.4f, \"tx_wire_bytes\": %llu, \"rx_wire_bytes\": %llu, "
+                "\"packets\": %llu, \"retransmits\": %llu, \"naks\": %llu, "
+                "\"cpu_s\": %.6f, \"cpu_ms_per_mib\": %.3f}",
+                (is_first) ? "[\n  " : ",\n  ",
+                (unsigned)p_case->frame, (unsigned)p_case->baud, (unsigned)p_case->latency_us,
+                p_case->ber, p_case->drop_rate, (unsigned)p_case->app_ms,
+                (unsigned)s_flags, (unsigned long long)s_seed,
+                (p_case->ok) ? "true" : "false",
+                (unsigned long long)s_file_len, p_case->virtual_s, p_case->goodput,
+                p_case->efficiency,
+                (unsigned long long)p_case->tx_wire_bytes,
+                (unsigned long long)p_case->rx_wire_bytes,
+                (unsigned long long)p_case->cnt.packets,
+                (unsigned long long)p_case->cnt.retransmits,
+                (unsigned long long)p_case->cnt.naks,
+                p_case->cpu_s, p_case->cpu_s * 1000.0 / mib);
+        return;
+    }
+
+    if (is_first) {
+        fprintf(p_out, "frame,baud,latency_us,ber,drop_rate,app_ms,flags,seed,ok,file_bytes,"
+                "virtual_s,goodput_Bps,efficiency,tx_wire_bytes,rx_wire_bytes,"
+                "packets,retransmits,naks,cpu_s,cpu_ms_per_mib\n");
+    }
+    fprintf(p_out, "%u,%u,%u,%g,%g,%u,%u,%llu,%d,%llu,%.6f,%.1f,%.4f,%llu,%llu,%llu,%llu,%llu,"
+            "%.6f,%.3f\n",
+            (unsigned)p_case->frame, (unsigned)p_case->baud, (unsigned)p_case->latency_us,
+            p_case->ber, p_case->drop_rate, (unsigned)p_case->app_ms,
+            (unsigned)s_flags, (unsigned long long)s_seed,
+            (int)p_case->ok,
+            (unsigned long long)s_file_len, p_case->virtual_s, p_case->goodput,
+            p_case->efficiency,
+            (unsigned long long)p_case->tx_wire_bytes,
+            (unsigned long long)p_case->rx_wire_bytes,
+            (unsigned long long)p_case->cnt.packets,
+            (unsigned long long)p_case->cnt.retransmits,
+            (unsigned long long)p_case->cnt.naks,
+            p_case->cpu_s, p_case->cpu_s * 1000.0 / mib);
+}
+
+static void bench_sender(void *user_data)
+{
+    bench_end_t            *p_end       = (bench_end_t *)user_data;
+    xf_ymodem_t            *p_ym        = &p_end->ym;
+    xf_ymodem_file_info_t   file_info   = {0};
+    xf_err_t                xf_ret      = XF_OK;
+    uint8_t                *p_buf       = NULL;
+    uint32_t                buf_size    = 0;
+    int                     i;
+
+    file_info.p_name_buf    = BENCH_NAME;
+    file_info.buf_size      = sizeof(BENCH_NAME) - 1;
+    file_info.file_len      = (int32_t)s_file_len;
+
+    for (i = 0; i < BENCH_HANDSHAKE_TRY_NUM; i++) {
+        xf_ret = xf_ymodem_send_handshake(p_ym, &file_info);
+        if (xf_ret == XF_OK) {
+            break;
+        }
+    }
+    while ((xf_ret == XF_OK)
+            && ((xf_ret = xf_ymodem_send_get_buf_and_len(p_ym, &p_buf, &buf_size)) == XF_OK)) {
+        if (s_app_ms > 0) {
+            /* 从存储中读出本包 */
+            p_ym->ops->delay_ms(s_app_ms);
+        }
+        bench_fill(p_buf, p_ym->file_len_transmitted, buf_size);
+        xf_ret = xf_ymodem_send_data(p_ym);
+    }
+    if ((xf_ret == XF_ERR_RESOURCE) && (p_ym->state == XF_YMODEM_SEND_FILE_END)) {
+        /* 批量发送: 只有一个文件，随即结束批次 */
+        xf_ret = xf_ymodem_send_finish(p_ym);
+        xf_ret = (xf_ret == XF_OK) ? XF_ERR_RESOURCE : xf_ret;
+    }
+
+    p_end->xf_ret   = xf_ret;
+    p_end->ok       = (xf_ret == XF_ERR_RESOURCE) && (p_ym->error_code == XF_YMODEM_OK);
+}
+
+static void bench_receiver(void *user_data)
+{
+    bench_end_t            *p_end       = (bench_end_t *)user_data;
+    xf_ymodem_t            *p_ym        = &p_end->ym;
+    xf_ymodem_file_info_t   file_info   = {0};
+    char                    file_name[32];
+    xf_err_t                xf_ret      = XF_OK;
+    uint8_t                *p_data      = NULL;
+    uint32_t                data_size   = 0;
+    uint8_t                 match       = true;
+    int                     i;
+
+    file_info.p_name_buf    = file_name;
+    file_info.buf_size      = sizeof(file_name);
+
+    for (i = 0; i < BENCH_HANDSHAKE_TRY_NUM; i++) {
+        xf_ret = xf_ymodem_recv_handshake(p_ym, &file_info);
+        if (xf_ret != XF_ERR_TIMEOUT) {
+            break;
+        }
+    }
+    while ((xf_ret == XF_OK)
+            && ((xf_ret = xf_ymodem_recv_data(p_ym, &p_data, &data_size)) == XF_OK)) {
+        if ((p_end->bytes + data_size > s_file_len)
+                || (bench_check(p_data, p_end->bytes, data_size) != 0)) {
+            match = false;
+        }
+        p_end->bytes += data_size;
+        if (s_app_ms > 0) {
+            /* 写入存储 */
+            p_ym->ops->delay_ms(s_app_ms);
+        }
+        if (p_ym->p_buf_alt != NULL) {
+            xf_ymodem_recv_release(p_ym, p_data);
+        }
+    }
+
+    p_end->xf_ret   = xf_ret;
+    p_end->ok       = (xf_ret == XF_ERR_RESOURCE) && (p_ym->error_code == XF_YMODEM_OK)
+                      && match && (p_end->bytes == s_file_len);
+}
+
+static void bench_end_init(bench_end_t *p_end, uint32_t buf_size, const xf_ymodem_ops_t *p_ops)
+{
+    uint32_t flags = s_flags;
+
+    if (buf_size > XF_YMODEM_STX_PACKET_SIZE) {
+        flags |= XF_YMODEM_FLAG_LARGE_FRAME;
+    }
+    if ((flags & XF_YMODEM_FLAG_WINDOW)
+            && (buf_size < (XF_YMODEM_WINDOW_MAX_SEL + 1) * XF_YMODEM_STX_PACKET_SIZE)) {
+        /* 滑动窗口把 p_buf 切分为 1K 包的槽，接收端另需一个空闲槽 */
+        buf_size = (XF_YMODEM_WINDOW_MAX_SEL + 1) * XF_YMODEM_STX_PACKET_SIZE;
+    }
+    p_end->ym.p_buf         = (uint8_t *)malloc(buf_size);
+    p_end->ym.buf_size      = buf_size;
+    p_end->ym.flags         = flags;
+    p_end->ym.timeout_ms    = s_timeout_ms;
+    p_end->ym.retry_num     = s_retry_num;
+    p_end->ym.ops           = p_ops;
+    /* 早应答及流水发送需要第二缓冲区 */
+    if (flags & (XF_YMODEM_FLAG_EARLY_ACK | XF_YMODEM_FLAG_PIPELINE)) {
+        p_end->ym.p_buf_alt = (uint8_t *)malloc(buf_size);
+    }
+}
+
+/**
+ * @brief 发送端的 write: 数据包由一次 write 写出(扩展包为包头 + 数据段长及其余部分两次)，
+ *        按包号统计发出及重发的包数。
+ */
+static int32_t bench_tx_write(const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    const uint8_t *p_src = (const uint8_t *)src;
+
+    if (s_cnt.ext_pending) {
+        s_cnt.ext_pending = false;
+        bench_count_packet(p_src[0]);
+    } else if (size == 1) {
+        if (XF_YMODEM_EOT == p_src[0]) {
+            /* 之后的起始帧重新从包号 0 开始 */
+            xf_memset(s_cnt.pn_map, 0, sizeof(s_cnt.pn_map));
+        }
+    } else if ((XF_YMODEM_STX_EXT == p_src[0])
+               && (XF_YMODEM_HEADER_SIZE + XF_YMODEM_EXT_LEN_SIZE == size)) {
+        s_cnt.ext_pending = true;
+    } else if (size > XF_YMODEM_PN_IDX) {
+        bench_count_packet(p_src[XF_YMODEM_PN_IDX]);
+    }
+
+    return xf_ymodem_sim_get_ops()->write(src, size, timeout_ms);
+}
+
+static int32_t bench_rx_write(const void *src, uint32_t size, uint32_t timeout_ms)
+{
+    /* 应答逐字节写出，滑动窗口时之后跟包号 */
+    if ((size <= 2) && (XF_YMODEM_NAK == ((const uint8_t *)src)[0])) {
+        s_cnt.naks++;
+    }
+
+    return xf_ymodem_sim_get_ops()->write(src, size, timeout_ms);
+}
+
+/**
+ * @brief 包号只有 8 位: 记录最近半圈内发出过的包号，再次出现即为重发。
+ */
+static void bench_count_packet(uint8_t pn)
+{
+    uint8_t old = (uint8_t)(pn + 128);
+
+    s_cnt.packets++;
+    if (s_cnt.pn_map[pn / 32] & (1UL << (pn % 32))) {
+        s_cnt.retransmits++;
+        return;
+    }
+    s_cnt.pn_map[pn / 32]  |= (1UL << (pn % 32));
+    s_cnt.pn_map[old / 32] &= ~(1UL << (old % 32));
+}
+
+static int bench_parse_list(const char *p_str, bench_list_t *p_list)
+{
+    char *p_end;
+
+    p_list->num = 0;
+    while (*p_str != '\0') {
+        if (p_list->num >= BENCH_LIST_MAX) {
+            return -1;
+        }
+        p_list->val[p_list->num] = strtod(p_str, &p_end);
+        if ((p_end == p_str) || ((*p_end != ',') && (*p_end != '\0'))) {
+            return -1;
+        }
+        p_list->num++;
+        p_str = (*p_end == ',') ? (p_end + 1) : p_end;
+    }
+
+    return (p_list->num > 0) ? 0 : -1;
+}
+
+/* 文件内容: 64K 的随机表与偏移的高位异或，错位的整块也能发现 */
+static void bench_fill(uint8_t *p_dst, uint64_t offset, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        p_dst[i] = s_pattern[(offset + i) & 0xFFFF] ^ (uint8_t)((offset + i) >> 16);
+    }
+}
+
+static int bench_check(const uint8_t *p_src, uint64_t offset, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        if (p_src[i] != (uint8_t)(s_pattern[(offset + i) & 0xFFFF] ^ (uint8_t)((offset + i) >> 16))) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static double bench_cpu_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
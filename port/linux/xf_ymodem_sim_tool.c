@@ -0,0 +1,461 @@
+/**
+ * @file xf_ymodem_sim_tool.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief 在模拟链路上运行一次完整的收发，打印虚拟耗时、有效吞吐及链路统计。
+ * @version 1.0
+ * @date 2025-01-06
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ * 用法: xf_ymodem_sim_tool [选项]
+ *      -s <KiB>            文件长度，默认 16384 (16 MiB)
+ *      -F <bytes>          包数据段长 128/1024/2048/4096/8192, 大于 1K 时两端设置 XF_YMODEM_FLAG_LARGE_FRAME
+ *      -x <flags>          两端额外的 xf_ymodem_t.flags
+ *      -t <ms> -n <num>    timeout_ms 及 retry_num, 默认 1000 及 10
+ *      -b <baud>           波特率，默认 921600
+ *      -l <us>             单向延迟
+ *      -q <bytes>          接收缓冲大小，0 为不限
+ *      -w <bytes>          发送缓冲大小
+ *      -e <ber>            误码率，如 1e-6
+ *      -u <rate> -k <len>  每字节开始突发误码的概率及突发长度
+ *      -d <rate>           每字节丢失的概率
+ *      -r <seed>           随机种子
+ *      -T <file>           把跟踪事件写入文件(需要 XF_YMODEM_TRACE_ENABLE)，
+ *                          由 port/linux/xf_ymodem_trace.py 解码，会话号 0 为发送端、1 为接收端
+ *      -C tx:<file>|rx:<file>  记录发送端或接收端的链路操作(xf_ymodem_capture, 虚拟时间)，
+ *                          由 xf_ymodem_replay_tool 回放
+ * 误码对两个方向都生效(应答也可能出错)。
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "xf_ymodem_sim.h"
+#include "xf_ymodem_capture.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define TOOL_FILE_KIB_DEFAULT           (16 * 1024)
+#define TOOL_HANDSHAKE_TRY_NUM          (3)
+#define TOOL_NAME                       "sim.bin"
+
+/* ==================== [Typedefs] ========================================== */
+
+/* 一端 */
+typedef struct _tool_end_t {
+    xf_ymodem_t ym;
+    xf_err_t    xf_ret;
+    uint64_t    bytes;              /*!< 接收端: 已交付并校验的字节数 */
+    uint8_t     ok;
+} tool_end_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static void tool_sender(void *user_data);
+static void tool_receiver(void *user_data);
+static void tool_end_init(tool_end_t *p_end, uint32_t buf_size, uint32_t flags,
+                          uint32_t timeout_ms, uint32_t retry_num);
+static void tool_fill(uint8_t *p_dst, uint64_t offset, uint32_t size);
+static int tool_check(const uint8_t *p_src, uint64_t offset, uint32_t size);
+static double tool_now_s(void);
+static double tool_cpu_s(void);
+static uint64_t tool_sim_now_us(void);
+#if XF_YMODEM_STATS_IS_ENABLE
+static void tool_show_stats(const char *p_name, const xf_ymodem_stats_t *p_stats);
+#endif
+#if XF_YMODEM_TRACE_IS_ENABLE
+static void tool_trace_drain(void);
+#endif
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_sim_tool";
+
+static uint8_t  s_pattern[65536];
+static uint64_t s_file_len;
+static xf_ymodem_sim_t *sp_sim;
+#if XF_YMODEM_TRACE_IS_ENABLE
+static FILE    *s_trace_fp;
+static uint32_t s_trace_pos;
+#endif
+
+/* ==================== [Global Functions] ================================== */
+
+int main(int argc, char *argv[])
+{
+    xf_ymodem_sim_link_cfg_t cfg = XF_YMODEM_SIM_LINK_CFG_DEFAULT();
+    xf_ymodem_sim_t sim;
+    tool_end_t  tx          = {0};
+    tool_end_t  rx          = {0};
+    uint64_t    seed        = 1;
+    uint32_t    frame       = XF_YMODEM_STX_1K_DATA_SIZE;
+    uint32_t    flags       = 0;
+    uint32_t    timeout_ms  = 1000;
+    uint32_t    retry_num   = 10;
+    double      wall;
+    double      cpu;
+    double      sim_s;
+    double      wire_bps;
+    const char *p_trace     = NULL;
+    const char *p_capture   = NULL;
+    xf_ymodem_capture_t cap = {0};
+    tool_end_t *p_cap_end   = NULL;
+    uint32_t    i;
+    int         opt;
+
+    s_file_len = (uint64_t)TOOL_FILE_KIB_DEFAULT * 1024;
+    while ((opt = getopt(argc, argv, "s:F:x:t:n:b:l:q:w:e:u:k:d:r:T:C:")) != -1) {
+        switch (opt) {
+        case 's': s_file_len        = strtoull(optarg, NULL, 0) * 1024;     break;
+        case 'F': frame             = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'x': flags             = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 't': timeout_ms        = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'n': retry_num         = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'b': cfg.baudrate      = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'l': cfg.latency_us    = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'q': cfg.fifo_size     = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'w': cfg.tx_fifo_size  = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'e': cfg.ber           = strtod(optarg, NULL);                 break;
+        case 'u': cfg.burst_rate    = strtod(optarg, NULL);                 break;
+        case 'k': cfg.burst_len     = (uint32_t)strtoul(optarg, NULL, 0);   break;
+        case 'd': cfg.drop_rate     = strtod(optarg, NULL);                 break;
+        case 'r': seed              = strtoull(optarg, NULL, 0);            break;
+        case 'T': p_trace           = optarg;                               break;
+        case 'C': p_capture         = optarg;                               break;
+        default:
+            fprintf(stderr, "usage: %s [-s KiB] [-F frame] [-x flags] [-t timeout_ms] [-n retry]\n"
+                    "       [-b baud] [-l latency_us] [-q rx_fifo] [-w tx_fifo]\n"
+                    "       [-e ber] [-u burst_rate] [-k burst_len] [-d drop_rate] [-r seed] [-T trace_file]\n"
+                    "       [-C tx:capture_file|rx:capture_file]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if ((s_file_len == 0) || (s_file_len > INT32_MAX)) {
+        XF_LOGE(TAG, "file length must be 1..%d bytes", (int)INT32_MAX);
+        return 2;
+    }
+    if (frame > XF_YMODEM_STX_1K_DATA_SIZE) {
+        flags |= XF_YMODEM_FLAG_LARGE_FRAME;
+    }
+
+    srand(1);
+    for (i = 0; i < sizeof(s_pattern); i++) {
+        s_pattern[i] = (uint8_t)rand();
+    }
+
+    tool_end_init(&tx, frame + XF_YMODEM_PROT_SEG_SIZE, flags, timeout_ms, retry_num);
+    tool_end_init(&rx, frame + XF_YMODEM_PROT_SEG_SIZE, flags, timeout_ms, retry_num);
+#if XF_YMODEM_RTO_IS_ENABLE
+    tx.ym.baudrate  = cfg.baudrate;
+    rx.ym.baudrate  = cfg.baudrate;
+#endif
+    if (xf_ymodem_sim_init(&sim, &cfg, NULL, seed) != XF_OK) {
+        XF_LOGE(TAG, "invalid link config");
+        return 2;
+    }
+    if (p_trace != NULL) {
+#if XF_YMODEM_TRACE_IS_ENABLE
+        s_trace_fp = fopen(p_trace, "wb");
+        if (s_trace_fp == NULL) {
+            XF_LOGE(TAG, "open %s failed", p_trace);
+            return 2;
+        }
+        tx.ym.trace_id = 0;
+        rx.ym.trace_id = 1;
+#else
+        XF_LOGE(TAG, "-T needs XF_YMODEM_TRACE_ENABLE");
+        return 2;
+#endif
+    }
+    if (p_capture != NULL) {
+        if ((strncmp(p_capture, "tx:", 3) != 0) && (strncmp(p_capture, "rx:", 3) != 0)) {
+            XF_LOGE(TAG, "-C needs tx:<file> or rx:<file>");
+            return 2;
+        }
+        /* 以虚拟时钟记录，回放工具看到的时间与模拟结果一致 */
+        p_cap_end   = (p_capture[0] == 't') ? &tx : &rx;
+        sp_sim      = &sim;
+        cap.now_us  = tool_sim_now_us;
+        if ((xf_ymodem_capture_open(&cap, &p_capture[3], p_cap_end->ym.ops, &p_cap_end->ym,
+                                    (p_cap_end == &tx)) != XF_OK)
+                || ((p_cap_end->ym.ops = xf_ymodem_capture_get_ops(&cap)) == NULL)) {
+            return 2;
+        }
+    }
+
+    wall    = tool_now_s();
+    cpu     = tool_cpu_s();
+    if (xf_ymodem_sim_run(&sim, tool_sender, &tx, tool_receiver, &rx) != XF_OK) {
+        XF_LOGE(TAG, "run failed");
+        return 1;
+    }
+    wall    = tool_now_s() - wall;
+    cpu     = tool_cpu_s() - cpu;
+
+    /* 线路的原始速率(每秒字节数)，吞吐与之相比即为效率 */
+    sim_s       = (double)sim.now_ns * 1e-9;
+    wire_bps    = (double)cfg.baudrate / cfg.bits_per_byte;
+    XF_LOGI(TAG, "result:     %s, tx %s/%d, rx %s/%d",
+            (tx.ok && rx.ok) ? "ok" : "FAIL",
+            xf_err_to_name(tx.xf_ret), (int)tx.ym.error_code,
+            xf_err_to_name(rx.xf_ret), (int)rx.ym.error_code);
+    XF_LOGI(TAG, "file:       %llu bytes, frame %u, flags 0x%x",
+            (unsigned long long)s_file_len, (unsigned)frame, (unsigned)flags);
+    XF_LOGI(TAG, "virtual:    %.3f s, goodput %.1f KB/s, efficiency %.1f%%",
+            sim_s, (sim_s > 0) ? (rx.bytes / 1024.0 / sim_s) : 0.0,
+            (sim_s > 0) ? (100.0 * rx.bytes / sim_s / wire_bps) : 0.0);
+    XF_LOGI(TAG, "host:       %.3f s wall, %.3f s cpu, %.0fx real time",
+            wall, cpu, (wall > 0) ? (sim_s / wall) : 0.0);
+    for (i = 0; i < ARRAY_SIZE(sim.dir); i++) {
+        XF_LOGI(TAG, "%s: tx %llu, rx %llu, flushed %llu, flips %llu, bursts %llu, "
+                "dropped %llu, overrun %llu",
+                (0 == i) ? "tx->rx     " : "rx->tx     ",
+                (unsigned long long)sim.dir[i].stat.tx_bytes,
+                (unsigned long long)sim.dir[i].stat.rx_bytes,
+                (unsigned long long)sim.dir[i].stat.flush_bytes,
+                (unsigned long long)sim.dir[i].stat.bit_flips,
+                (unsigned long long)sim.dir[i].stat.bursts,
+                (unsigned long long)sim.dir[i].stat.drop_bytes,
+                (unsigned long long)sim.dir[i].stat.overrun_bytes);
+    }
+#if XF_YMODEM_STATS_IS_ENABLE
+    tool_show_stats("sender     ", &tx.ym.stats);
+    tool_show_stats("receiver   ", &rx.ym.stats);
+#endif
+
+#if XF_YMODEM_TRACE_IS_ENABLE
+    if (s_trace_fp != NULL) {
+        tool_trace_drain();
+        fclose(s_trace_fp);
+    }
+#endif
+    if (p_cap_end != NULL) {
+        XF_LOGI(TAG, "capture:    %s, %llu records, %llu reads (%llu timed out), %llu writes",
+                (p_cap_end == &tx) ? "sender" : "receiver",
+                (unsigned long long)cap.stat.records, (unsigned long long)cap.stat.reads,
+                (unsigned long long)cap.stat.read_timeouts, (unsigned long long)cap.stat.writes);
+        xf_ymodem_capture_close(&cap);
+    }
+
+    xf_ymodem_sim_deinit(&sim);
+    free(tx.ym.p_buf);
+    free(tx.ym.p_buf_alt);
+    free(rx.ym.p_buf);
+    free(rx.ym.p_buf_alt);
+
+    return (tx.ok && rx.ok) ? 0 : 1;
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static void tool_end_init(tool_end_t *p_end, uint32_t buf_size, uint32_t flags,
+                          uint32_t timeout_ms, uint32_t retry_num)
+{
+    if ((flags & XF_YMODEM_FLAG_WINDOW)
+            && (buf_size < (XF_YMODEM_WINDOW_MAX_SEL + 1) * XF_YMODEM_STX_PACKET_SIZE)) {
+        /* 滑动窗口把 p_buf 切分为 1K 包的槽，接收端另需一个空闲槽 */
+        buf_size = (XF_YMODEM_WINDOW_MAX_SEL + 1) * XF_YMODEM_STX_PACKET_SIZE;
+    }
+    p_end->ym.p_buf         = (uint8_t *)malloc(buf_size);
+    p_end->ym.buf_size      = buf_size;
+    p_end->ym.flags         = flags;
+    p_end->ym.timeout_ms    = timeout_ms;
+    p_end->ym.retry_num     = retry_num;
+    p_end->ym.ops           = xf_ymodem_sim_get_ops();
+    /* 早应答及流水发送需要第二缓冲区 */
+    if (flags & (XF_YMODEM_FLAG_EARLY_ACK | XF_YMODEM_FLAG_PIPELINE)) {
+        p_end->ym.p_buf_alt = (uint8_t *)malloc(buf_size);
+    }
+}
+
+static void tool_sender(void *user_data)
+{
+    tool_end_t             *p_end       = (tool_end_t *)user_data;
+    xf_ymodem_t            *p_ym        = &p_end->ym;
+    xf_ymodem_file_info_t   file_info   = {0};
+    xf_err_t                xf_ret      = XF_OK;
+    uint8_t                *p_buf       = NULL;
+    uint32_t                buf_size    = 0;
+    int                     i;
+
+    file_info.p_name_buf    = TOOL_NAME;
+    file_info.buf_size      = sizeof(TOOL_NAME) - 1;
+    file_info.file_len      = (int32_t)s_file_len;
+
+    for (i = 0; i < TOOL_HANDSHAKE_TRY_NUM; i++) {
+        xf_ret = xf_ymodem_send_handshake(p_ym, &file_info);
+        if (xf_ret == XF_OK) {
+            break;
+        }
+    }
+    while ((xf_ret == XF_OK)
+            && ((xf_ret = xf_ymodem_send_get_buf_and_len(p_ym, &p_buf, &buf_size)) == XF_OK)) {
+        tool_fill(p_buf, p_ym->file_len_transmitted, buf_size);
+        xf_ret = xf_ymodem_send_data(p_ym);
+#if XF_YMODEM_TRACE_IS_ENABLE
+        tool_trace_drain();
+#endif
+    }
+    if ((xf_ret == XF_ERR_RESOURCE) && (p_ym->state == XF_YMODEM_SEND_FILE_END)) {
+        /* 批量发送: 只有一个文件，随即结束批次 */
+        xf_ret = xf_ymodem_send_finish(p_ym);
+        xf_ret = (xf_ret == XF_OK) ? XF_ERR_RESOURCE : xf_ret;
+    }
+
+    p_end->xf_ret   = xf_ret;
+    p_end->ok       = (xf_ret == XF_ERR_RESOURCE) && (p_ym->error_code == XF_YMODEM_OK);
+}
+
+static void tool_receiver(void *user_data)
+{
+    tool_end_t             *p_end       = (tool_end_t *)user_data;
+    xf_ymodem_t            *p_ym        = &p_end->ym;
+    xf_ymodem_file_info_t   file_info   = {0};
+    char                    file_name[32];
+    xf_err_t                xf_ret      = XF_OK;
+    uint8_t                *p_data      = NULL;
+    uint32_t                data_size   = 0;
+    uint8_t                 match       = true;
+    int                     i;
+
+    file_info.p_name_buf    = file_name;
+    file_info.buf_size      = sizeof(file_name);
+
+    for (i = 0; i < TOOL_HANDSHAKE_TRY_NUM; i++) {
+        xf_ret = xf_ymodem_recv_handshake(p_ym, &file_info);
+        if (xf_ret != XF_ERR_TIMEOUT) {
+            break;
+        }
+    }
+    while ((xf_ret == XF_OK)
+            && ((xf_ret = xf_ymodem_recv_data(p_ym, &p_data, &data_size)) == XF_OK)) {
+        if ((p_end->bytes + data_size > s_file_len)
+                || (tool_check(p_data, p_end->bytes, data_size) != 0)) {
+            match = false;
+        }
+        p_end->bytes += data_size;
+        if (p_ym->p_buf_alt != NULL) {
+            xf_ymodem_recv_release(p_ym, p_data);
+        }
+#if XF_YMODEM_TRACE_IS_ENABLE
+        tool_trace_drain();
+#endif
+    }
+
+    p_end->xf_ret   = xf_ret;
+    p_end->ok       = (xf_ret == XF_ERR_RESOURCE) && (p_ym->error_code == XF_YMODEM_OK)
+                      && match && (p_end->bytes == s_file_len);
+}
+
+/* 文件内容: 64K 的随机表与偏移的高位异或，错位的整块也能发现 */
+static void tool_fill(uint8_t *p_dst, uint64_t offset, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        p_dst[i] = s_pattern[(offset + i) & 0xFFFF] ^ (uint8_t)((offset + i) >> 16);
+    }
+}
+
+static int tool_check(const uint8_t *p_src, uint64_t offset, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        if (p_src[i] != (uint8_t)(s_pattern[(offset + i) & 0xFFFF] ^ (uint8_t)((offset + i) >> 16))) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static double tool_now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double tool_cpu_s(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec * 1e-6
+           + (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec * 1e-6;
+}
+
+static uint64_t tool_sim_now_us(void)
+{
+    return xf_ymodem_sim_now_us(sp_sim);
+}
+
+#if XF_YMODEM_STATS_IS_ENABLE
+static void tool_show_stats(const char *p_name, const xf_ymodem_stats_t *p_stats)
+{
+    char        line[256];
+    int         len         = 0;
+    uint32_t    i;
+
+    XF_LOGI(TAG, "%s: wire tx %u, rx %u, payload %u, retransmits %u, nak tx %u, rx %u",
+            p_name, (unsigned)p_stats->tx_bytes, (unsigned)p_stats->rx_bytes,
+            (unsigned)p_stats->payload_bytes, (unsigned)p_stats->retransmits,
+            (unsigned)p_stats->tx_nak, (unsigned)p_stats->rx_nak);
+    XF_LOGI(TAG, "%s: crc %u, pn %u, header %u, dup %u, timeouts %u, resyncs %u, can tx %u, rx %u",
+            p_name, (unsigned)p_stats->crc_errors, (unsigned)p_stats->pn_errors,
+            (unsigned)p_stats->header_errors, (unsigned)p_stats->duplicates,
+            (unsigned)p_stats->timeouts, (unsigned)p_stats->resyncs,
+            (unsigned)p_stats->tx_can, (unsigned)p_stats->rx_can);
+
+    /* 包长档位: 发出/收到 */
+    for (i = 0; i < XF_YMODEM_STATS_FRAME_LVL_NUM; i++) {
+        if ((p_stats->tx_frames[i] | p_stats->rx_frames[i]) != 0) {
+            len += snprintf(&line[len], sizeof(line) - len, " %uB:%u/%u",
+                            (unsigned)((i == 0) ? 128 : (1024U << (i - 1))),
+                            (unsigned)p_stats->tx_frames[i], (unsigned)p_stats->rx_frames[i]);
+        }
+    }
+    XF_LOGI(TAG, "%s: frames tx/rx%s", p_name, (len > 0) ? line : " -");
+
+    /* 往返时间: 以 2^i us 为下限的桶 */
+    len = 0;
+    for (i = 0; i < XF_YMODEM_STATS_RTT_BUCKET_NUM; i++) {
+        if ((p_stats->rtt_hist[i] != 0) && (len < (int)sizeof(line) - 32)) {
+            len += snprintf(&line[len], sizeof(line) - len, " %uus:%u",
+                            (unsigned)(1U << i), (unsigned)p_stats->rtt_hist[i]);
+        }
+    }
+    XF_LOGI(TAG, "%s: rtt%s", p_name, (len > 0) ? line : " -");
+}
+#endif
+
+#if XF_YMODEM_TRACE_IS_ENABLE
+/*
+    两端轮流运行，每次调用后取出跟踪环中的新事件，原样(本机字节序)写入文件。
+    一次调用中的事件多于 XF_YMODEM_TRACE_SIZE 时较早的被覆盖，解码时显示为序号不连续。
+ */
+static void tool_trace_drain(void)
+{
+    xf_ymodem_trace_ev_t    ev[64];
+    uint32_t                n;
+
+    if (s_trace_fp == NULL) {
+        return;
+    }
+    do {
+        n = xf_ymodem_trace_read(&s_trace_pos, ev, ARRAY_SIZE(ev));
+        fwrite(ev, sizeof(ev[0]), n, s_trace_fp);
+    } while (n == ARRAY_SIZE(ev));
+}
+#endif
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+xf_ymodem 跟踪事件解码(XF_YMODEM_TRACE_ENABLE)。
+
+输入为以下两种之一，自动识别:
+  - xf_ymodem_trace_read() 读出的 xf_ymodem_trace_ev_t 原样写入的二进制文件
+    (如 xf_ymodem_sim_tool -T)，默认小端，大端目标加 --be;
+  - 含 xf_ymodem_trace_dump() 输出的 "YMTR <32 位十六进制>" 行的日志，其他行忽略。
+
+用法:
+  xf_ymodem_trace.py trace.bin
+  xf_ymodem_trace.py --id 1 uart.log
+  xf_ymodem_trace.py - < uart.log
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+# 与 xf_ymodem_types.h 保持一致
+
+EV_SIZE = 16
+
+TYPES = {
+    0: "NONE",
+    1: "STATE",
+    2: "FILE",
+    3: "TX",
+    4: "RX",
+    5: "TX-CTL",
+    6: "RX-CTL",
+    7: "ERR",
+}
+
+STATES = [
+    "NONE",
+    "RECV_REQUEST_FILE_INFO",
+    "RECV_FILE_INFO_AVAILABLE",
+    "RECV_REQUEST_FILE_DATA",
+    "RECV_STREAM_FILE_DATA",
+    "RECV_GOT_EOT1",
+    "RECV_GOT_EOT2",
+    "RECV_FEEDBACK_EOT2",
+    "RECV_NEXT_FILE_INFO",
+    "RECV_END",
+    "SEND_FILE_INFO",
+    "SEND_FILE_DATA",
+    "SEND_STREAM_FILE_DATA",
+    "SEND_EOT1",
+    "SEND_EOT2",
+    "SEND_NULL_FILE_INFO",
+    "SEND_FILE_END",
+    "SEND_END",
+]
+
+CHARS = {
+    0x01: "SOH",
+    0x02: "STX",
+    0x04: "EOT",
+    0x06: "ACK",
+    0x0a: "STX_2K",
+    0x0b: "STX_4K",
+    0x0c: "STX_8K",
+    0x0d: "STX_EXT",
+    0x15: "NAK",
+    0x18: "CAN",
+    0x43: "C",
+    0x46: "F",
+    0x47: "G",
+    0x57: "W",
+}
+
+ERRS = {
+    1: "TIMEOUT",
+    2: "CRC",
+    3: "PN",
+    4: "HEADER",
+    5: "DUP",
+    6: "RESYNC",
+    7: "CAN",
+    8: "RETRY",
+    9: "ABORT",
+}
+
+YM_ERRS = [
+    "OK",
+    "INVALID_FILE_NAME",
+    "NO_DATA",
+    "PN",
+    "CRC",
+    "CAN",
+    "NAK_RETRY",
+    "HEADER",
+]
+
+
+def name(table, val):
+    if isinstance(table, list):
+        return table[val] if val < len(table) else "%d" % val
+    return table.get(val, "0x%02x" % val)
+
+
+def ym_err(val):
+    return name(YM_ERRS, val)
+
+
+def parse_bin(data, big_endian):
+    fmt = (">" if big_endian else "<") + "IIBBBBI"
+    for off in range(0, len(data) - EV_SIZE + 1, EV_SIZE):
+        yield struct.unpack_from(fmt, data, off)
+
+
+def parse_text(text):
+    # 字段依次为 seq, ts_us, type, id, a, b, arg, 与字节序无关
+    for m in re.finditer(r"YMTR ([0-9a-fA-F]{32})", text):
+        h = m.group(1)
+        yield (int(h[0:8], 16), int(h[8:16], 16),
+               int(h[16:18], 16), int(h[18:20], 16),
+               int(h[20:22], 16), int(h[22:24], 16), int(h[24:32], 16))
+
+
+def describe(typ, a, b, arg):
+    if typ == 1:
+        return "%s -> %s" % (name(STATES, a), name(STATES, b))
+    if typ == 2:
+        return "%s, file_len %d" % ("send" if a else "recv",
+                                   struct.unpack("<i", struct.pack("<I", arg))[0])
+    if typ in (3, 4):
+        return "%s pn %02x len %d" % (name(CHARS, a), b, arg)
+    if typ in (5, 6):
+        if a in (0x06, 0x15) and b != 0:
+            return "%s pn %02x" % (name(CHARS, a), b)
+        return name(CHARS, a)
+    if typ == 7:
+        err = name(ERRS, a)
+        if a == 1:
+            return "%s, %d bytes of packet" % (err, arg)
+        if a == 2:
+            return "%s pn %02x, packet 0x%04x, calculated 0x%04x" % (
+                err, b, arg >> 16, arg & 0xffff)
+        if a == 3:
+            return "%s pn %02x, expected/npn %02x" % (err, b, arg & 0xff)
+        if a == 4:
+            return "%s header 0x%02x" % (err, b)
+        if a == 5:
+            return "%s pn %02x" % (err, b)
+        if a in (8, 9):
+            return "%s, error_code %s" % (err, ym_err(arg))
+        return err
+    return "a %02x b %02x arg %08x" % (a, b, arg)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="decode xf_ymodem trace events")
+    ap.add_argument("file", help="binary trace or log with YMTR lines, - for stdin")
+    ap.add_argument("--be", action="store_true", help="binary trace from a big-endian target")
+    ap.add_argument("--id", type=int, default=None, help="only show events of this trace_id")
+    args = ap.parse_args()
+
+    if args.file == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.file, "rb") as f:
+            data = f.read()
+
+    if b"YMTR " in data:
+        events = parse_text(data.decode("ascii", "replace"))
+    else:
+        events = parse_bin(data, args.be)
+
+    t0 = None
+    last_seq = None
+    lost = 0
+    for seq, ts, typ, ev_id, a, b, arg in events:
+        if seq == 0:
+            continue
+        if (last_seq is not None) and (seq != ((last_seq + 1) & 0xffffffff)):
+            gap = (seq - last_seq - 1) & 0xffffffff
+            lost += gap
+            print("-- %d events lost --" % gap)
+        last_seq = seq
+        if t0 is None:
+            t0 = ts
+        if (args.id is not None) and (ev_id != args.id):
+            continue
+        # 时间戳为 32 位 us, 约 71 分钟回绕一次
+        t = ((ts - t0) & 0xffffffff) / 1e6
+        print("%12.6f %8d [%d] %-6s %s" % (t, seq, ev_id, name(TYPES, typ),
+                                           describe(typ, a, b, arg)))
+    if lost:
+        print("-- %d events lost in total --" % lost, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -20,10 +20,40 @@
 
 /* ==================== [Static Prototypes] ================================= */
 
+static int32_t xf_ymodem_port_read(
+    xf_ymodem_t *p_ym, uint8_t *p_dst, uint32_t size, uint32_t timeout_ms);
+static xf_err_t xf_ymodem_ev_to_err(xf_ymodem_t *p_ym, xf_ymodem_nb_event_t ev);
+
+#if XF_YMODEM_RTO_IS_ENABLE
+static uint32_t xf_ymodem_rto_tx_us(const xf_ymodem_t *p_ym, uint32_t len);
+#endif
+
 /* ==================== [Static Variables] ================================== */
 
 static const char *const TAG = "xf_ymodem";
 
+/* 各档位包长的数据段长及包头，见 xf_ymodem_t.frame_lvl */
+static const uint32_t sc_frame_lvl_data_size[] = {
+    XF_YMODEM_SOH_DATA_SIZE,
+    XF_YMODEM_STX_1K_DATA_SIZE,
+    XF_YMODEM_STX_2K_DATA_SIZE,
+    XF_YMODEM_STX_4K_DATA_SIZE,
+    XF_YMODEM_STX_8K_DATA_SIZE,
+    XF_YMODEM_STX_16K_DATA_SIZE,
+    XF_YMODEM_STX_32K_DATA_SIZE,
+    XF_YMODEM_STX_64K_DATA_SIZE,
+};
+static const uint8_t sc_frame_lvl_header[] = {
+    XF_YMODEM_SOH,
+    XF_YMODEM_STX_1K,
+    XF_YMODEM_STX_2K,
+    XF_YMODEM_STX_4K,
+    XF_YMODEM_STX_8K,
+    XF_YMODEM_STX_EXT,
+    XF_YMODEM_STX_EXT,
+    XF_YMODEM_STX_EXT,
+};
+
 /* ==================== [Macros] ============================================ */
 
 #if XF_YMODEM_DEBUG_IS_ENABLE
@@ -57,8 +87,8 @@ static const char *const TAG = "xf_ymodem";
 #   define xf_strnlen(s, maxlen)    xf_strlen(s)
 #endif
 
-#if !defined(xf_strncpy)
-#   define xf_strncpy(d, s, len)    strncpy(d, s, len)
+#if !defined(xf_memmove)
+#   define xf_memmove(d, s, len)    memmove(d, s, len)
 #endif
 
 /* ==================== [Global Functions] ================================== */
@@ -86,7 +116,8 @@ xf_err_t xf_ymodem_check(xf_ymodem_t *p_ym)
             || (p_ym->ops->write == NULL)
             || (p_ym->ops->flush == NULL)
             || (p_ym->ops->delay_ms == NULL)
-            /* user_parse, user_file_info 允许为 NULL */
+            /* user_parse, user_file_info, now_ms 允许为 NULL */
+            || ((p_ym->ops->wait_readable != NULL) && (p_ym->ops->now_ms == NULL))
        ) {
         YM_LOGD(TAG, "p_ym->ops:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
         return XF_ERR_INVALID_ARG;
@@ -98,59 +129,20 @@ xf_err_t xf_ymodem_check(xf_ymodem_t *p_ym)
 xf_err_t xf_ymodem_recv_handshake(
     xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info)
 {
-    xf_err_t xf_ret         = XF_OK;
-
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
     XF_CHECK(NULL == p_info, XF_ERR_INVALID_ARG,
              TAG, "p_info:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
-    p_ym->state = XF_YMODEM_NONE;
-
-    /* 请求文件信息 */
-    xf_ret = xf_ymodem_recv_request_file_info(p_ym);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
-
-    /* 解析文件信息 */
-    xf_ret = xf_ymodem_parse_file_info(p_ym, p_info);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
-
-    return xf_ret;
-}
-
-xf_err_t xf_ymodem_recv_request_file_info(xf_ymodem_t *p_ym)
-{
-    xf_err_t xf_ret = XF_OK;
-
-    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
-             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
-
-    p_ym->file_len_transmitted = 0;
-
-    xf_ymodem_flush_read(p_ym);
-
-    /* 发送 C, 请求发送端发送包含文件名及长度的起始帧 */
-    xf_ymodem_putc(p_ym, XF_YMODEM_C);
-    xf_ret = xf_ymodem_recv_get_packet(p_ym);
-    if (xf_ret != XF_OK) {
-        // YM_LOGD(TAG, "recv_packet:%s", xf_err_to_name(xf_ret));
-        return xf_ret;
-    }
-
-    if ((p_ym->state != XF_YMODEM_RECV_GOT_EOT1)
-            || (p_ym->state != XF_YMODEM_RECV_GOT_EOT2)
-            || (p_ym->state != XF_YMODEM_RECV_FEEDBACK_EOT2)
-       ) {
-        xf_ymodem_putc(p_ym, XF_YMODEM_ACK);
+    if (p_ym->state == XF_YMODEM_RECV_NEXT_FILE_INFO) {
+        /* 批量传输: 下一个文件的起始帧已在 xf_ymodem_recv_data() 中收到并应答 */
+        xf_ymodem_nb_recv_accept(p_ym, p_info);
+    } else {
+        /* 请求并解析文件信息 */
+        xf_ymodem_nb_recv_begin(p_ym, p_info, true);
     }
 
-    p_ym->state = XF_YMODEM_RECV_FILE_INFO_AVAILABLE;
-
-    return xf_ret;
+    return xf_ymodem_ev_to_err(p_ym, xf_ymodem_nb_run(p_ym));
 }
 
 xf_err_t xf_ymodem_flush_read(xf_ymodem_t *p_ym)
@@ -160,110 +152,75 @@ xf_err_t xf_ymodem_flush_read(xf_ymodem_t *p_ym)
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
+    /* 只丢弃线路上的残留数据，缓冲区总会被下一包覆盖，不需要清零 */
+#if XF_YMODEM_RX_CACHE_IS_ENABLE
+    p_ym->rx_rd = 0;
+    p_ym->rx_wr = 0;
+#endif
     p_ym->ops->flush();
-    xf_memset((char *)p_ym->p_buf, 0, p_ym->buf_size);
 
     return xf_ret;
 }
 
-xf_err_t xf_ymodem_recv_get_packet(xf_ymodem_t *p_ym)
+int32_t xf_ymodem_read(
+    xf_ymodem_t *p_ym, uint8_t *p_dst, uint32_t size, uint32_t timeout_ms)
 {
-    xf_err_t    xf_ret          = XF_OK;
-
-    uint8_t     check_header    = true; /*!< 是否需要检查包头 */
-
-    int32_t     rlen            = 0; /*!< p_ym->ops->read 返回值，可能是负数 */
-    int32_t     expect_len      = 0; /*!< 预期接收长度 */
-
-    int32_t     retry           = 0;
-    int32_t     retry_for_check = 0;
-
-    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
-             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
-
-    if (p_ym->tx_ack == true) {
-        xf_ymodem_putc(p_ym, XF_YMODEM_ACK);
-        p_ym->tx_ack = false;
-    }
-
-    retry_for_check     = p_ym->retry_num + 1;
-
-l_retry_for_check_error:;
-l_retry_for_eot2:;
-
-    check_header        = true;
-    retry               = p_ym->retry_num + 1;
-    p_ym->packet_len    = 0;
-    p_ym->data_len      = 0;
-    expect_len          = 1; /*!< 先收包头 */
-
-    while (retry > 0) {
-        retry--;
-        rlen = p_ym->ops->read(
-                   p_ym->p_buf  + p_ym->packet_len,
-                   expect_len   - p_ym->packet_len,
-                   p_ym->timeout_ms);
-        if (rlen <= 0) {
-            continue;
-        }
-
-        retry               = p_ym->retry_num + 1; /*!< 成功时重置计数 */
-        p_ym->packet_len   += rlen;
-
-        if ((check_header) && (p_ym->packet_len >= 1)) {
-            check_header = false;
-            xf_ret = xf_ymodem_recv_check_packet_header(p_ym);
-            if (xf_ret != XF_OK) {
-                goto l_xf_ret;
-            }
-            if (p_ym->data_len > 0) {
-                expect_len = XF_YMODEM_PROT_SEG_SIZE + p_ym->data_len;
+    int32_t     rlen            = 0;
+#if XF_YMODEM_RX_CACHE_IS_ENABLE
+    uint32_t    len             = 0;
+
+    if (p_ym->rx_rd >= p_ym->rx_wr) {
+        if (size >= XF_YMODEM_RX_CACHE_SIZE_SEL) {
+            /* 大包的数据段直接读入 p_pkt, 不经过缓存多拷贝一次 */
+            rlen = xf_ymodem_port_read(p_ym, p_dst, size, timeout_ms);
+            if (rlen > 0) {
+                XF_YMODEM_STAT_ADD(p_ym, rx_bytes, rlen);
+                XF_YMODEM_RTO_ANSWERED(p_ym);
             }
-        } /* check_header */
-
-        if (p_ym->packet_len >= expect_len) {
-            break;
+            return rlen;
         }
-    }
-
-    if (p_ym->packet_len < expect_len) {
-        p_ym->error_code    = XF_YMODEM_ERR_NO_DATA;
-        xf_ret              = XF_ERR_TIMEOUT;
-        goto l_xf_ret;
-    }
-
-    xf_ymodem_show_packet(p_ym->p_buf, p_ym->data_len);
-
-    /* 检查数据正确性 */
-    if (p_ym->data_len > 0) {
-        xf_ret = xf_ymodem_check_packet(p_ym);
-        if (xf_ret != XF_OK) {
-            if (retry_for_check > 0) {
-                retry_for_check--;
-                xf_ymodem_flush_read(p_ym);
-                p_ym->ops->delay_ms(p_ym->timeout_ms);
-                /* 发 NAK 让发送端重发 */
-                xf_ymodem_putc(p_ym, XF_YMODEM_NAK);
-                xf_ymodem_flush_read(p_ym);
-                goto l_retry_for_check_error;
-            }
-            goto l_xf_ret;
+        /*
+            缓存只在取空后才补充，所以总是从头写入，不需要处理回绕。
+            一次读取可能带回包头、数据段及之后的应答或下一包，留给后续调用。
+         */
+        rlen = xf_ymodem_port_read(p_ym, p_ym->rx_cache, XF_YMODEM_RX_CACHE_SIZE_SEL, timeout_ms);
+        if (rlen <= 0) {
+            return rlen;
         }
+        XF_YMODEM_STAT_ADD(p_ym, rx_bytes, rlen);
+        XF_YMODEM_RTO_ANSWERED(p_ym);
+        p_ym->rx_rd = 0;
+        p_ym->rx_wr = (uint32_t)rlen;
     }
 
-    if (p_ym->state == XF_YMODEM_RECV_GOT_EOT1) {
-        xf_ymodem_putc(p_ym, XF_YMODEM_NAK);
-        goto l_retry_for_eot2;
-    } else if (p_ym->state == XF_YMODEM_RECV_GOT_EOT2) {
-        xf_ymodem_putc(p_ym, XF_YMODEM_ACK);
-        p_ym->state = XF_YMODEM_RECV_FEEDBACK_EOT2;
+    len = min(size, p_ym->rx_wr - p_ym->rx_rd);
+    xf_memcpy(p_dst, &p_ym->rx_cache[p_ym->rx_rd], len);
+    p_ym->rx_rd += len;
+
+    return (int32_t)len;
+#else
+    rlen = xf_ymodem_port_read(p_ym, p_dst, size, timeout_ms);
+    if (rlen > 0) {
+        XF_YMODEM_STAT_ADD(p_ym, rx_bytes, rlen);
+        XF_YMODEM_RTO_ANSWERED(p_ym);
     }
+    return rlen;
+#endif
+}
 
-    p_ym->error_code    = XF_YMODEM_OK;
+uint32_t xf_ymodem_budget_ms(xf_ymodem_t *p_ym)
+{
+    uint64_t    budget_ms       = 0;
 
-l_xf_ret:;
+    /* 回绕后按有符号差比较，预算不能超过 INT32_MAX */
+    budget_ms = (uint64_t)p_ym->timeout_ms * ((uint64_t)p_ym->retry_num + 1);
+#if XF_YMODEM_RTO_IS_ENABLE
+    /* 已知波特率时另加一个最大的包在线路上的发送时间 */
+    budget_ms += (xf_ymodem_rto_tx_us(p_ym, p_ym->buf_size) + 999) / 1000;
+#endif
+    budget_ms = min(budget_ms, (uint64_t)INT32_MAX);
 
-    return xf_ret;
+    return (uint32_t)budget_ms;
 }
 
 xf_err_t xf_ymodem_recv_check_packet_header(xf_ymodem_t *p_ym)
@@ -278,7 +235,7 @@ xf_err_t xf_ymodem_recv_check_packet_header(xf_ymodem_t *p_ym)
         FIXME esp32 上，开 -Og 优化。
         在 xshell 发 CAN 过来时有概率修改 p_ym->p_buf 指针成 0x08081818。
      */
-    ch = p_ym->p_buf[XF_YMODEM_HEADER_IDX];
+    ch = p_ym->p_pkt[XF_YMODEM_HEADER_IDX];
     switch (ch) {
     case XF_YMODEM_SOH: {
         p_ym->data_len = XF_YMODEM_SOH_DATA_SIZE;
@@ -295,20 +252,15 @@ xf_err_t xf_ymodem_recv_check_packet_header(xf_ymodem_t *p_ym)
     case XF_YMODEM_STX_8K: {
         p_ym->data_len = XF_YMODEM_STX_8K_DATA_SIZE;
     } break;
-    case XF_YMODEM_EOT: {
-        p_ym->data_len      = 0;
-        if (p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA) {
-            p_ym->state = XF_YMODEM_RECV_GOT_EOT1;
-        } else if (p_ym->state == XF_YMODEM_RECV_GOT_EOT1) {
-            p_ym->state = XF_YMODEM_RECV_GOT_EOT2;
+    case XF_YMODEM_STX_EXT: {
+        /* 数据段长随后由 xf_ymodem_recv_ext_len_parse() 解析，只接受协商过的扩展包 */
+        p_ym->data_len = 0;
+        if (p_ym->frame_max <= XF_YMODEM_STX_8K_DATA_SIZE) {
+            YM_LOGD(TAG, "recv(%02X) Not Negotiated", (int)ch);
+            xf_ret = XF_FAIL;
+            goto l_xf_ret;
         }
     } break;
-    case XF_YMODEM_CAN: {
-        p_ym->data_len      = 0;
-        p_ym->error_code    = XF_YMODEM_ERR_CAN;
-        xf_ret              = XF_ERR_RESOURCE;
-        goto l_xf_ret;
-    }
     default: {
         YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
         p_ym->data_len      = 0;
@@ -317,7 +269,14 @@ xf_err_t xf_ymodem_recv_check_packet_header(xf_ymodem_t *p_ym)
     }
     }
 
-    if (XF_YMODEM_PROT_SEG_SIZE + p_ym->data_len > p_ym->buf_size) {
+    if (p_ym->state == XF_YMODEM_RECV_GOT_EOT1) {
+        /* 之前的 EOT 是在线路上出错的包头，发送端仍在发送数据包 */
+        p_ym->state = XF_YMODEM_RECV_REQUEST_FILE_DATA;
+    }
+
+    if ((XF_YMODEM_PROT_SEG_SIZE + p_ym->data_len > p_ym->buf_size)
+            /* 滑动窗口的每个槽只容纳 1K 包 */
+            || ((XF_YMODEM_WIN_SIZE(p_ym) > 0) && (p_ym->data_len > XF_YMODEM_STX_1K_DATA_SIZE))) {
         YM_LOGD(TAG, "p_ym->data_len(%d) Not Supported", (int)p_ym->data_len);
         xf_ret = XF_FAIL;
         goto l_xf_ret;
@@ -327,6 +286,106 @@ l_xf_ret:;
     return xf_ret;
 }
 
+xf_err_t xf_ymodem_recv_ext_len_parse(xf_ymodem_t *p_ym, const uint8_t *p_buf)
+{
+    uint32_t    data_len        = 0;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    data_len = xf_ymodem_ext_len_from_bytes(p_buf);
+    if ((data_len == 0) || (data_len > p_ym->frame_max)
+            || (XF_YMODEM_PROT_SEG_SIZE + data_len > p_ym->buf_size)) {
+        YM_LOGD(TAG, "ext data_len(%d) Not Supported", (int)data_len);
+        return XF_FAIL;
+    }
+
+    /* 数据段长字段也计入 crc, 出错的长度不会被当作数据接收 */
+    p_ym->data_len  = data_len;
+    p_ym->crc16     = xf_ymodem_crc16(p_ym->crc16, p_buf, XF_YMODEM_EXT_LEN_SIZE);
+
+    return XF_OK;
+}
+
+uint32_t xf_ymodem_recv_scan(xf_ymodem_t *p_ym)
+{
+    uint8_t    *p_pkt           = p_ym->p_pkt;
+    uint32_t    len             = p_ym->packet_len;
+    uint32_t    pn_idx          = 0; /*!< 候选包头后包号的位置，扩展包在数据段长之后 */
+    /*
+        没有候选包头时一次读取一个最短的包: 出错包的剩余部分加上重发包至少有这么长，
+        不会等待到超时，也不会读到重发包之后。
+     */
+    uint32_t    need            = XF_YMODEM_SOH_PACKET_SIZE;
+    uint32_t    data_len        = 0;
+    uint32_t    i;
+    uint8_t     lvl;
+
+    for (i = 0; i < len; i++) {
+        /* 包头: 本端可以接收的数据包 */
+        for (lvl = 0; lvl < ARRAY_SIZE(sc_frame_lvl_header); lvl++) {
+            if (sc_frame_lvl_header[lvl] == p_pkt[i]) {
+                break;
+            }
+        }
+        if (lvl >= ARRAY_SIZE(sc_frame_lvl_header)) {
+            continue;
+        }
+        if (p_pkt[i] == XF_YMODEM_STX_EXT) {
+            if ((p_ym->frame_max <= XF_YMODEM_STX_8K_DATA_SIZE)
+                    || (XF_YMODEM_WIN_SIZE(p_ym) > 0)) {
+                continue;
+            }
+            pn_idx = XF_YMODEM_PN_IDX + XF_YMODEM_EXT_LEN_SIZE;
+            if (i + pn_idx <= len) {
+                data_len = xf_ymodem_ext_len_from_bytes(&p_pkt[i + XF_YMODEM_PN_IDX]);
+                if ((data_len == 0) || (data_len > p_ym->frame_max)
+                        || (XF_YMODEM_PROT_SEG_SIZE + data_len > p_ym->buf_size)) {
+                    continue;
+                }
+            }
+        } else {
+            if ((XF_YMODEM_PROT_SEG_SIZE + sc_frame_lvl_data_size[lvl] > p_ym->buf_size)
+                    /* 滑动窗口的每个槽只容纳 1K 包 */
+                    || ((XF_YMODEM_WIN_SIZE(p_ym) > 0)
+                        && (sc_frame_lvl_data_size[lvl] > XF_YMODEM_STX_1K_DATA_SIZE))) {
+                continue;
+            }
+            pn_idx = XF_YMODEM_PN_IDX;
+        }
+        /* 包号及反码: 必须是可能等待中的包，已到达的部分不符时继续查找 */
+        if ((i + pn_idx < len) && !xf_ymodem_recv_pn_expected(p_ym, p_pkt[i + pn_idx])) {
+            continue;
+        }
+        if ((i + pn_idx + 1 < len) && ((p_pkt[i + pn_idx] ^ p_pkt[i + pn_idx + 1]) != 0xFF)) {
+            continue;
+        }
+        need = pn_idx + 2;
+        break;
+    }
+
+    /* 丢弃候选包头之前的字节 */
+    if (i > 0) {
+        xf_memmove(p_pkt, &p_pkt[i], len - i);
+        p_ym->packet_len = len - i;
+    }
+
+    return (need > p_ym->packet_len) ? (need - p_ym->packet_len) : 0;
+}
+
+bool xf_ymodem_recv_pn_expected(xf_ymodem_t *p_ym, uint8_t pn)
+{
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    if (p_ym->win_size > 0) {
+        /* 窗口内的包，或已交付但对方没收到应答的包 */
+        return ((uint8_t)(pn - p_ym->win_base) < p_ym->win_size)
+               || ((uint8_t)(p_ym->win_base - pn) <= p_ym->win_size);
+    }
+#endif
+    /* 停等: 正在等待的包，或应答丢失后重发的上一包 */
+    return (pn == p_ym->packet_num) || (pn == (uint8_t)(p_ym->packet_num - 1));
+}
+
 xf_err_t xf_ymodem_check_packet(xf_ymodem_t *p_ym)
 {
     xf_err_t    xf_ret          = XF_OK;
@@ -343,22 +402,26 @@ xf_err_t xf_ymodem_check_packet(xf_ymodem_t *p_ym)
     }
 
     /* 检查序列号 */
-    if ((p_ym->p_buf[XF_YMODEM_PN_IDX] ^ p_ym->p_buf[XF_YMODEM_NPN_IDX]) != 0xFF) {
+    if ((p_ym->p_pkt[XF_YMODEM_PN_IDX] ^ p_ym->p_pkt[XF_YMODEM_NPN_IDX]) != 0xFF) {
         YM_LOGD(TAG, "packet num error");
+        XF_YMODEM_STAT_INC(p_ym, pn_errors);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_PN,
+                        p_ym->p_pkt[XF_YMODEM_PN_IDX], p_ym->p_pkt[XF_YMODEM_NPN_IDX]);
         p_ym->error_code = XF_YMODEM_ERR_PN;
         xf_ret = XF_ERR_INVALID_CHECK;
     }
 
-    /* 检查 crc */
-    crc16_cal = xf_ymodem_crc16(
-                    XF_YMODEM_CRC_START_VAL_DEFAULT,
-                    &p_ym->p_buf[XF_YMODEM_DATA_IDX], p_ym->data_len);
-    crc16_hi = p_ym->p_buf[XF_YMODEM_DATA_IDX + p_ym->data_len + 0];
-    crc16_lo = p_ym->p_buf[XF_YMODEM_DATA_IDX + p_ym->data_len + 1];
+    /* 检查 crc, 数据段的 crc 已在接收过程中累计，见 xf_ymodem_nb.c */
+    crc16_cal = p_ym->crc16;
+    crc16_hi = p_ym->p_pkt[XF_YMODEM_DATA_IDX + p_ym->data_len + 0];
+    crc16_lo = p_ym->p_pkt[XF_YMODEM_DATA_IDX + p_ym->data_len + 1];
     crc16_expect = (((crc16_hi & 0xFF) << 8U)) | ((crc16_lo & 0xFF));
     if (crc16_expect != crc16_cal) {
         YM_LOGD(TAG, "crc error, expect(0x%04x), calculated(0x%04x)",
                 (int)crc16_expect, (int)crc16_cal);
+        XF_YMODEM_STAT_INC(p_ym, crc_errors);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_CRC,
+                        p_ym->p_pkt[XF_YMODEM_PN_IDX], ((uint32_t)crc16_expect << 16) | crc16_cal);
         p_ym->error_code = XF_YMODEM_ERR_CRC;
         xf_ret = XF_ERR_INVALID_CHECK;
     }
@@ -401,13 +464,13 @@ xf_err_t xf_ymodem_parse_file_info(
     buf_idx                 = XF_YMODEM_DATA_IDX;
 
     /* 文件名 */
-    if (p_ym->p_buf[buf_idx] == '\0') {
-        YM_LOGD(TAG, "p_ym->p_buf[buf_idx]==\\0");
+    if (p_ym->p_pkt[buf_idx] == '\0') {
+        YM_LOGD(TAG, "p_ym->p_pkt[buf_idx]==\\0");
         p_ym->error_code    = XF_YMODEM_ERR_INVALID_FILE_NAME;
         xf_ret              = XF_FAIL;
         goto l_xf_ret;
     }
-    file_name_actual_len    = xf_strnlen((const char *)&p_ym->p_buf[buf_idx], p_ym->data_len);
+    file_name_actual_len    = xf_strnlen((const char *)&p_ym->p_pkt[buf_idx], p_ym->data_len);
     if (file_name_actual_len >= p_ym->data_len) {
         YM_LOGD(TAG, "file_name_actual_len(%d)>=p_ym->data_len(%d)",
                 (int)file_name_actual_len, (int)p_ym->data_len);
@@ -418,21 +481,21 @@ xf_err_t xf_ymodem_parse_file_info(
     cpy_len                 = min(p_info->buf_size - 1, /*!< 留一个 '\0' */
                                   file_name_actual_len);
     if (p_info->p_name_buf) {
-        xf_strncpy(p_info->p_name_buf, (const char *)&p_ym->p_buf[buf_idx], cpy_len);
+        xf_memcpy(p_info->p_name_buf, &p_ym->p_pkt[buf_idx], cpy_len);
         p_info->p_name_buf[cpy_len]     = '\0';
     }
     buf_idx += file_name_actual_len;    /*!< 跳过文件名 */
     buf_idx++;                          /*!< 跳过 '\0' */
 
     /* 可能没有文件长度 */
-    if (p_ym->p_buf[buf_idx] == '\0') {
+    if (p_ym->p_pkt[buf_idx] == '\0') {
         file_len = -1;
         goto l_skip_parse_len;
     }
 
     /* 文件长度 */
-    file_len_str_actual_len = xf_strnlen((const char *)&p_ym->p_buf[buf_idx], p_ym->data_len - buf_idx);
-    xf_ret = xf_ymodem_str_to_u32(&p_ym->p_buf[buf_idx], file_len_str_actual_len, (uint32_t *)&file_len);
+    file_len_str_actual_len = xf_strnlen((const char *)&p_ym->p_pkt[buf_idx], p_ym->data_len - buf_idx);
+    xf_ret = xf_ymodem_str_to_u32(&p_ym->p_pkt[buf_idx], file_len_str_actual_len, (uint32_t *)&file_len);
     if (xf_ret != XF_OK) {
         YM_LOGD(TAG, "xf_ymodem_str_to_u32:%s", xf_err_to_name(xf_ret));
         return xf_ret;
@@ -440,13 +503,21 @@ xf_err_t xf_ymodem_parse_file_info(
     buf_idx += file_len_str_actual_len; /*!< 跳过文件名 */
     buf_idx++;                          /*!< 跳过 '\0' */
 
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    /* 滑动窗口扩展 */
+    xf_ymodem_recv_window_parse(p_ym, &buf_idx);
+#endif
+    /* 非标包长扩展 */
+    xf_ymodem_recv_frame_parse(p_ym, &buf_idx);
+
 l_skip_parse_len:;
     p_info->file_len    = file_len;
     p_ym->file_len      = file_len;
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_FILE, 0, 0, file_len);
 
-    if ((p_ym->ops->user_parse) && (buf_idx < (p_ym->data_len - 1))) {
+    if ((p_ym->ops) && (p_ym->ops->user_parse) && (buf_idx < (p_ym->data_len - 1))) {
         p_ym->ops->user_parse(
-            &p_ym->p_buf[buf_idx], p_ym->data_len - buf_idx, p_ym->user_data);
+            &p_ym->p_pkt[buf_idx], p_ym->data_len - buf_idx, p_ym->user_data);
     }
 
 l_xf_ret:;
@@ -457,7 +528,7 @@ xf_err_t xf_ymodem_recv_data(
     xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size)
 {
     xf_err_t xf_ret         = XF_OK;
-    int32_t retry;
+    xf_ymodem_nb_event_t ev = XF_YMODEM_NB_EV_NONE;
 
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
@@ -466,137 +537,117 @@ xf_err_t xf_ymodem_recv_data(
     XF_CHECK(NULL == p_buf_size, XF_ERR_INVALID_ARG,
              TAG, "p_buf_size:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
-    retry = p_ym->retry_num + 1;
-    while (retry > 0) {
-        retry--;
-        /* 获取文件数据 */
-        xf_ret = xf_ymodem_recv_get_file_data(p_ym);
-        if ((xf_ret == XF_OK)
-                || (xf_ret == XF_ERR_RESOURCE) /*!< 对方已取消 */
-           ) {
-            break;
-        }
-        /* XF_ERR_TIMEOUT 时重试 */
-    }
+    /* 双缓冲时选择用户未持有的缓冲区 */
+    xf_ret = xf_ymodem_recv_select_buf(p_ym);
     if (xf_ret != XF_OK) {
         return xf_ret;
     }
 
-    /* 已经接收到了两次结束信号，当前文件已传输完毕 */
-    if (p_ym->state == XF_YMODEM_RECV_FEEDBACK_EOT2) {
-        xf_ret = xf_ymodem_recv_end(p_ym);
-        if (xf_ret == XF_OK) {
-            p_ym->state = XF_YMODEM_RECV_END;
-            return XF_ERR_RESOURCE;
-        } else {
-            return xf_ret;
-        }
+    if (p_ym->state == XF_YMODEM_RECV_FILE_INFO_AVAILABLE) {
+        /* 首次请求文件数据 */
+        xf_ymodem_nb_recv_request(p_ym);
+    } else if (p_ym->nb_held) {
+        /* 上一包已交给用户，继续接收 */
+        xf_ymodem_nb_resume(p_ym);
+    } else {
+        YM_LOGD(TAG, "p_ym->state:%d", (int)p_ym->state);
+        return XF_ERR_INVALID_STATE;
     }
 
-    /* 传出文件数据指针 */
-    xf_ret = xf_ymodem_recv_get_data_ptr(p_ym, pp_data_buf, p_buf_size);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
+    /* 当前文件传输完毕后继续接收下一个文件的起始帧或空起始帧 */
+    do {
+        ev = xf_ymodem_nb_run(p_ym);
+    } while (ev == XF_YMODEM_NB_EV_FILE_END);
+
+    if (ev != XF_YMODEM_NB_EV_DATA) {
+        return xf_ymodem_ev_to_err(p_ym, ev);
     }
 
+    /* 传出文件数据指针 */
+    *pp_data_buf    = &p_ym->p_pkt[XF_YMODEM_DATA_IDX];
+    *p_buf_size     = p_ym->nb_data_len;
+
     return xf_ret;
 }
 
-xf_err_t xf_ymodem_recv_get_file_data(xf_ymodem_t *p_ym)
+xf_err_t xf_ymodem_recv_release(xf_ymodem_t *p_ym, const uint8_t *p_data_buf)
 {
-    xf_err_t xf_ret = XF_OK;
-
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
-
-    xf_ymodem_flush_read(p_ym);
-
-    if (p_ym->state == XF_YMODEM_RECV_FILE_INFO_AVAILABLE) {
-        /* 首次请求文件数据信息时需要发送 C */
-        xf_ymodem_putc(p_ym, XF_YMODEM_C);
-        p_ym->state = XF_YMODEM_RECV_REQUEST_FILE_DATA;
-    }
-
-    xf_ret = xf_ymodem_recv_get_packet(p_ym);
-    if (xf_ret != XF_OK) {
-        YM_LOGD(TAG, "recv_packet:%s", xf_err_to_name(xf_ret));
-        return xf_ret;
+    XF_CHECK(NULL == p_data_buf, XF_ERR_INVALID_ARG,
+             TAG, "p_data_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    if ((p_data_buf >= p_ym->p_buf)
+            && (p_data_buf < p_ym->p_buf + p_ym->buf_size)) {
+        p_ym->buf_held[0] = false;
+    } else if ((p_ym->p_buf_alt != NULL)
+               && (p_data_buf >= p_ym->p_buf_alt)
+               && (p_data_buf < p_ym->p_buf_alt + p_ym->buf_size)) {
+        p_ym->buf_held[1] = false;
+    } else {
+        YM_LOGD(TAG, "p_data_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+        return XF_ERR_INVALID_ARG;
     }
 
-    if (p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA) {
-        /* 下一次接收前要发送应答 */
-        p_ym->tx_ack = true;
-    }
+    return XF_OK;
+}
 
-    return xf_ret;
+bool xf_ymodem_recv_is_double_buf(xf_ymodem_t *p_ym)
+{
+    return ((p_ym->p_buf_alt != NULL)
+            && (p_ym->flags & XF_YMODEM_FLAG_EARLY_ACK)
+            && (XF_YMODEM_WIN_SIZE(p_ym) == 0));
 }
 
-xf_err_t xf_ymodem_recv_end(xf_ymodem_t *p_ym)
+xf_err_t xf_ymodem_recv_select_buf(xf_ymodem_t *p_ym)
 {
-    xf_err_t xf_ret = XF_OK;
+    uint8_t    *p_other         = NULL;
+    uint8_t     other_idx       = 0;
 
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
-    xf_ymodem_flush_read(p_ym);
-
-    xf_ymodem_putc(p_ym, XF_YMODEM_C);
-    xf_ret = xf_ymodem_recv_get_packet(p_ym);
-    if (xf_ret != XF_OK) {
-        YM_LOGD(TAG, "recv_packet:%s", xf_err_to_name(xf_ret));
-        return xf_ret;
+    if (!xf_ymodem_recv_is_double_buf(p_ym)) {
+        p_ym->p_pkt = p_ym->p_buf;
+        return XF_OK;
     }
 
-    xf_ymodem_putc(p_ym, XF_YMODEM_ACK);
-#if XF_YMODEM_XSHELL_IS_ENABLE
-    /* 对于 xshell 需要多发一个 O 才能结束 */
-    xf_ymodem_putc(p_ym, 'O');
-#endif
-
-    p_ym->state = XF_YMODEM_NONE;
+    /* 优先换到另一个缓冲区，用户可能仍在处理上一包 */
+    other_idx   = (p_ym->p_pkt == p_ym->p_buf) ? 1 : 0;
+    p_other     = (other_idx == 0) ? p_ym->p_buf : p_ym->p_buf_alt;
+    if (!p_ym->buf_held[other_idx]) {
+        p_ym->p_pkt = p_other;
+        return XF_OK;
+    }
+    if (!p_ym->buf_held[other_idx ^ 1]) {
+        return XF_OK;
+    }
 
-    return xf_ret;
+    YM_LOGD(TAG, "both buffers are held by the user");
+    return XF_ERR_BUSY;
 }
 
-xf_err_t xf_ymodem_recv_get_data_ptr(
-    xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size)
+xf_err_t xf_ymodem_cancel(xf_ymodem_t *p_ym)
 {
-    xf_err_t xf_ret             = XF_OK;
-    uint32_t file_remain_len    = 0;
+    const uint8_t  *p_data      = NULL;
+    uint32_t        len         = 0;
+    int32_t         wlen        = 0;
 
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
-    XF_CHECK(NULL == pp_data_buf, XF_ERR_INVALID_ARG,
-             TAG, "pp_data_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
-    XF_CHECK(NULL == p_buf_size, XF_ERR_INVALID_ARG,
-             TAG, "p_buf_size:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
-
-    *pp_data_buf = &p_ym->p_buf[XF_YMODEM_DATA_IDX];
 
-    file_remain_len = p_ym->file_len - p_ym->file_len_transmitted;
+    xf_ymodem_nb_cancel(p_ym);
 
-    if (p_ym->data_len <= file_remain_len) {
-        /* 如果本包数据段长度小于剩余文件剩余的长度 -> 本包收到完整一包数据 */
-        p_ym->file_len_transmitted += p_ym->data_len;
-        *p_buf_size                = p_ym->data_len;
-    } else {
-        /* 否则本包只有部分数据有效 */
-        p_ym->file_len_transmitted += file_remain_len;
-        *p_buf_size                = file_remain_len;
+    /* 立即发出 CAN */
+    while ((len = xf_ymodem_nb_tx_peek(p_ym, &p_data)) > 0) {
+        wlen = p_ym->ops->write(p_data, len, p_ym->timeout_ms);
+        if (wlen <= 0) {
+            break;
+        }
+        xf_ymodem_nb_tx_consume(p_ym, (uint32_t)wlen);
     }
 
-    return xf_ret;
-}
-
-xf_err_t xf_ymodem_cancel(xf_ymodem_t *p_ym)
-{
-    xf_err_t xf_ret = XF_OK;
-    xf_ymodem_putc(p_ym, XF_YMODEM_CAN);
-    xf_ymodem_putc(p_ym, XF_YMODEM_CAN);
-    xf_ymodem_putc(p_ym, XF_YMODEM_CAN);
-    xf_ymodem_putc(p_ym, XF_YMODEM_CAN);
-    xf_ymodem_putc(p_ym, XF_YMODEM_CAN);
-    return xf_ret;
+    return XF_OK;
 }
 
 /* send */
@@ -605,121 +656,39 @@ xf_err_t xf_ymodem_send_handshake(
     xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info)
 {
     xf_err_t    xf_ret      = XF_OK;
-    uint8_t     ch          = 0;
 
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
     XF_CHECK(NULL == p_info, XF_ERR_INVALID_ARG,
              TAG, "p_info:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
-    p_ym->packet_num    = 0;
-    p_ym->state         = XF_YMODEM_NONE;
-
-    /* 获取第 1 个 C */
-    xf_ret = xf_ymodem_getc(p_ym, &ch);
-    if (xf_ret != XF_OK) {
-        YM_LOGD(TAG, "no data");
-        return xf_ret;
-    }
-    if (ch != XF_YMODEM_C) {
-        YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
-        xf_ret = XF_FAIL;
-        return xf_ret;
-    }
-
-    /* 准备文件信息 */
-    xf_ret = xf_ymodem_prepare_file_info(p_ym, p_info);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
-
-    /* 准备包协议 */
-    xf_ret = xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
-
-    /* 发送起始帧 */
-    xf_ret = xf_ymodem_send_packet(p_ym);
+    /* 收到 C 或 G 后发送起始帧，直到接收端请求文件数据 */
+    xf_ret = xf_ymodem_nb_send_begin(p_ym, p_info, true);
     if (xf_ret != XF_OK) {
         return xf_ret;
     }
 
-    p_ym->packet_num++;
-    p_ym->state         = XF_YMODEM_SEND_FILE_INFO;
-
-    if (p_ym->state == XF_YMODEM_SEND_FILE_INFO) {
-        /* 获取第 1 次 ACK */
-        xf_ret = xf_ymodem_getc(p_ym, &ch);
-        if (xf_ret != XF_OK) {
-            YM_LOGD(TAG, "xf_ret:%s", xf_err_to_name(xf_ret));
-            return xf_ret;
-        }
-        if (ch != XF_YMODEM_ACK) {
-            YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
-            return xf_ret;
-        }
-        /* 获取第 2 次 C */
-        xf_ret = xf_ymodem_getc(p_ym, &ch);
-        if (xf_ret != XF_OK) {
-            return xf_ret;
-        }
-        if (ch != XF_YMODEM_C) {
-            YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
-            return xf_ret;
-        }
-        p_ym->state = XF_YMODEM_SEND_FILE_DATA;
-    }
-
-    return xf_ret;
+    return xf_ymodem_ev_to_err(p_ym, xf_ymodem_nb_run(p_ym));
 }
 
-xf_err_t xf_ymodem_getc(xf_ymodem_t *p_ym, uint8_t *p_ch)
+xf_err_t xf_ymodem_send_finish(xf_ymodem_t *p_ym)
 {
-    xf_err_t    xf_ret          = XF_OK;
-    int32_t     rlen            = 0;
-    int32_t     retry           = 0;
+    xf_ymodem_nb_event_t ev = XF_YMODEM_NB_EV_NONE;
 
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(p_ym->state != XF_YMODEM_SEND_FILE_END, XF_ERR_INVALID_STATE,
+             TAG, "p_ym->state:%d", (int)p_ym->state);
 
-    retry = p_ym->retry_num + 1;
-    while (retry > 0) {
-        retry--;
-        rlen = p_ym->ops->read(p_ch, 1, p_ym->timeout_ms);
-        if (rlen > 0) {
-            break;
-        }
-    }
-
-    if (rlen < 1) {
-        p_ym->error_code    = XF_YMODEM_ERR_NO_DATA;
-        xf_ret              = XF_ERR_TIMEOUT;
-    }
-
-#if XF_YMODEM_DEBUG_IS_ENABLE
-    if (rlen >= 1) {
-        ym_printf("\t\t\t\t");
-        switch (*p_ch) {
-        case XF_YMODEM_C:
-            ym_printf("C\r\n");
-            break;
-        case XF_YMODEM_CAN:
-            ym_printf("CAN\r\n");
-            break;
-        case XF_YMODEM_NAK:
-            ym_printf("NAK\r\n");
-            break;
-        case XF_YMODEM_ACK:
-            ym_printf("ACK\r\n");
-            break;
-        default:
-            break;
-        }
+    /* 等待 C 后发送空起始帧 */
+    xf_ymodem_nb_send_next(p_ym, NULL);
+    ev = xf_ymodem_nb_run(p_ym);
+    if (ev == XF_YMODEM_NB_EV_END) {
+        /* 会话正常结束 */
+        return XF_OK;
     }
-#endif /*XF_YMODEM_DEBUG_IS_ENABLE*/
 
-    return xf_ret;
+    return xf_ymodem_ev_to_err(p_ym, ev);
 }
 
 xf_err_t xf_ymodem_send_get_packet_data_len(
@@ -735,7 +704,40 @@ xf_err_t xf_ymodem_send_get_packet_data_len(
 
     remaining_len = p_ym->file_len - p_ym->file_len_transmitted;
 
-    if (p_ym->buf_size >= XF_YMODEM_STX_8K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE) {
+    data_len_max = xf_ymodem_send_data_len_max(p_ym);
+
+    /* 自适应包长，ymodem-g 及滑动窗口没有逐包的 NAK, 不调整 */
+    if ((p_ym->flags & XF_YMODEM_FLAG_ADAPTIVE)
+            && (p_ym->state == XF_YMODEM_SEND_FILE_DATA)
+            && (XF_YMODEM_WIN_SIZE(p_ym) == 0)) {
+        data_len_max = min(data_len_max, sc_frame_lvl_data_size[p_ym->frame_lvl]);
+    }
+
+    if (remaining_len >= data_len_max) {
+        data_len = data_len_max;
+    } else {
+        data_len = remaining_len;
+    }
+    *p_data_len     = data_len;
+    p_ym->data_len  = data_len;
+
+    return xf_ret;
+}
+
+uint32_t xf_ymodem_send_data_len_max(xf_ymodem_t *p_ym)
+{
+    uint32_t    data_len_max    = 0;
+
+    if (XF_YMODEM_WIN_SIZE(p_ym) > 0) {
+        /* 滑动窗口的每个槽只容纳 1K 包 */
+        data_len_max = XF_YMODEM_STX_1K_DATA_SIZE;
+    } else if (p_ym->buf_size >= XF_YMODEM_STX_64K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE) {
+        data_len_max = XF_YMODEM_STX_64K_DATA_SIZE;
+    } else if (p_ym->buf_size >= XF_YMODEM_STX_32K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE) {
+        data_len_max = XF_YMODEM_STX_32K_DATA_SIZE;
+    } else if (p_ym->buf_size >= XF_YMODEM_STX_16K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE) {
+        data_len_max = XF_YMODEM_STX_16K_DATA_SIZE;
+    } else if (p_ym->buf_size >= XF_YMODEM_STX_8K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE) {
         data_len_max = XF_YMODEM_STX_8K_DATA_SIZE;
     } else if (p_ym->buf_size >= XF_YMODEM_STX_4K_DATA_SIZE + XF_YMODEM_PROT_SEG_SIZE) {
         data_len_max = XF_YMODEM_STX_4K_DATA_SIZE;
@@ -749,15 +751,8 @@ xf_err_t xf_ymodem_send_get_packet_data_len(
         YM_LOGD(TAG, "p_ym->buf_size(%d) Not Supported", (int)p_ym->buf_size);
     }
 
-    if (remaining_len >= data_len_max) {
-        data_len = data_len_max;
-    } else {
-        data_len = remaining_len;
-    }
-    *p_data_len     = data_len;
-    p_ym->data_len  = data_len;
-
-    return xf_ret;
+    /* 非标包长需要接收端同意 */
+    return min(data_len_max, p_ym->frame_max);
 }
 
 xf_err_t xf_ymodem_send_get_buf_and_len(
@@ -772,7 +767,7 @@ xf_err_t xf_ymodem_send_get_buf_and_len(
     XF_CHECK(NULL == p_buf_size, XF_ERR_INVALID_ARG,
              TAG, "p_buf_size:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
-    *pp_data_buf = &p_ym->p_buf[XF_YMODEM_DATA_IDX];
+    *pp_data_buf = &p_ym->p_pkt[XF_YMODEM_DATA_IDX];
 
     xf_ret = xf_ymodem_send_get_packet_data_len(p_ym, p_buf_size);
 
@@ -781,153 +776,63 @@ xf_err_t xf_ymodem_send_get_buf_and_len(
 
 xf_err_t xf_ymodem_send_data(xf_ymodem_t *p_ym)
 {
-    xf_err_t    xf_ret          = XF_OK;
-    uint8_t     ch              = 0;
-    int32_t     retry_for_nak   = 0;
-
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((p_ym->state != XF_YMODEM_SEND_FILE_DATA)
+             && (p_ym->state != XF_YMODEM_SEND_STREAM_FILE_DATA), XF_ERR_INVALID_STATE,
+             TAG, "p_ym->state:%d", (int)p_ym->state);
 
-    retry_for_nak       = p_ym->retry_num + 1;
+    /* 数据长度来自 xf_ymodem_send_get_buf_and_len() */
+    p_ym->nb_data_len = p_ym->data_len;
+    xf_ymodem_nb_send_packet(p_ym);
 
-    xf_ret = xf_ymodem_send_regular_packet_data(p_ym, p_ym->data_len);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
+    return xf_ymodem_ev_to_err(p_ym, xf_ymodem_nb_run(p_ym));
+}
 
-    /* 准备包协议 */
-    xf_ret = xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
+bool xf_ymodem_send_is_pipeline(xf_ymodem_t *p_ym)
+{
+    return ((p_ym->p_buf_alt != NULL)
+            && (p_ym->flags & XF_YMODEM_FLAG_PIPELINE));
+}
 
-l_retry_for_nak:;
-    /* 发送 */
-    xf_ret = xf_ymodem_send_packet(p_ym);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
+void xf_ymodem_send_adapt(xf_ymodem_t *p_ym, bool is_nak)
+{
+    uint8_t     lvl_max         = 0;
 
-    /* 获取 ACK 或 NAK */
-    xf_ret = xf_ymodem_getc(p_ym, &ch);
-    if (xf_ret != XF_OK) {
-        return xf_ret;
-    }
-    switch (ch) {
-    case XF_YMODEM_NAK: {
-        retry_for_nak--;
-        YM_LOGD(TAG, "The peer receives the packet with an error.");
-        if (retry_for_nak > 0) {
-            goto l_retry_for_nak;
-        }
-        YM_LOGD(TAG, "The NAK retransmit counter has reached its maximum count.");
-        p_ym->error_code    = XF_YMODEM_ERR_NAK_RETRY;
-        xf_ret              = XF_ERR_RESOURCE;
-        goto l_xf_ret;
+    if (!(p_ym->flags & XF_YMODEM_FLAG_ADAPTIVE)) {
+        return;
     }
-    case XF_YMODEM_ACK: {
-        p_ym->packet_num++;
-        p_ym->file_len_transmitted += p_ym->data_len;
-    } break;
-    case XF_YMODEM_CAN: {
-        p_ym->error_code    = XF_YMODEM_ERR_CAN;
-        xf_ret              = XF_ERR_RESOURCE;
-        goto l_xf_ret;
-    }
-    default: {
-        YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
-        xf_ret              = XF_FAIL;
-        goto l_xf_ret;
-    }
-    }
-
-    if (p_ym->file_len_transmitted >= p_ym->file_len) {
-        /* 传输完毕 */
-        p_ym->state = XF_YMODEM_SEND_EOT1;
 
-l_retry_for_eot:;
-        if ((p_ym->state == XF_YMODEM_SEND_EOT1)
-                || (p_ym->state == XF_YMODEM_SEND_EOT2)
-           ) {
-            xf_ymodem_putc(p_ym, XF_YMODEM_EOT);
-        }
-        /* 获取 ACK 或 NAK */
-        xf_ret = xf_ymodem_getc(p_ym, &ch);
-        if (xf_ret != XF_OK) {
-            return xf_ret;
-        }
-        switch (ch) {
-        case XF_YMODEM_NAK: {
-            if (p_ym->state != XF_YMODEM_SEND_EOT1) {
-                YM_LOGD(TAG, "The peer has sent an error signal(%02X).", (int)ch);
-                p_ym->error_code    = XF_YMODEM_ERR_HEADER;
-                xf_ret              = XF_FAIL;
-                goto l_xf_ret;
-            }
-            p_ym->state = XF_YMODEM_SEND_EOT2;
-            goto l_retry_for_eot;
-        }
-        case XF_YMODEM_ACK: {
-            if (p_ym->state == XF_YMODEM_SEND_EOT2) {
-                p_ym->state = XF_YMODEM_SEND_NULL_FILE_INFO;
-                goto l_retry_for_eot;
-            } else if (p_ym->state == XF_YMODEM_SEND_NULL_FILE_INFO) {
-                p_ym->file_len              = 0;
-                p_ym->file_len_transmitted  = 0;
-                xf_ymodem_flush_read(p_ym);
-                p_ym->state         = XF_YMODEM_SEND_END;
-                p_ym->error_code    = XF_YMODEM_OK;
-                xf_ret              = XF_ERR_RESOURCE;
-                goto l_xf_ret;
-            }
-            YM_LOGD(TAG, "The peer has sent an error signal(%02X).", (int)ch);
-            p_ym->error_code    = XF_YMODEM_ERR_HEADER;
-            xf_ret              = XF_FAIL;
-            goto l_xf_ret;
+    /*
+        AIMD:
+            每个 NAK 包长减半(降一档)；
+            连续 XF_YMODEM_ADAPT_INC_ACKS 包无 NAK 后包长加倍(升一档)，
+            包长越大，升档前需要无误传输的字节数越多。
+        只调整之后准备的包，正在重发的包长度不变。
+     */
+    if (is_nak) {
+        if (p_ym->frame_lvl > 0) {
+            p_ym->frame_lvl--;
         }
-        case XF_YMODEM_C: {
-            if (p_ym->state != XF_YMODEM_SEND_NULL_FILE_INFO) {
-                YM_LOGD(TAG, "The peer has sent an error signal(%02X).", (int)ch);
-                p_ym->error_code    = XF_YMODEM_ERR_HEADER;
-                xf_ret              = XF_FAIL;
-                goto l_xf_ret;
-            }
-
-            /* 准备空包 */
-            p_ym->p_buf[XF_YMODEM_HEADER_IDX] = XF_YMODEM_SOH;
-            p_ym->packet_num = 0;
-            xf_memset((char *)&p_ym->p_buf[XF_YMODEM_DATA_IDX],
-                      0, XF_YMODEM_SOH_DATA_SIZE);
-            p_ym->data_len = XF_YMODEM_SOH_DATA_SIZE;
-            p_ym->packet_len = p_ym->data_len + XF_YMODEM_PROT_SEG_SIZE;
-
-            /* 准备包协议 */
-            xf_ret = xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
-            if (xf_ret != XF_OK) {
-                xf_ret              = XF_FAIL;
-                goto l_xf_ret;
-            }
-
-            /* 发送 */
-            xf_ret = xf_ymodem_send_packet(p_ym);
-            if (xf_ret != XF_OK) {
-                xf_ret              = XF_FAIL;
-                goto l_xf_ret;
-            }
+        p_ym->ack_cnt = 0;
+        return;
+    }
 
-            /* 等待之后一次应答 */
-            goto l_retry_for_eot;
-        }
-        default: {
-            YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
-            xf_ret              = XF_FAIL;
-            goto l_xf_ret;
-        }
-        } /* switch */
+    p_ym->ack_cnt++;
+    if (p_ym->ack_cnt < XF_YMODEM_ADAPT_INC_ACKS) {
+        return;
     }
+    p_ym->ack_cnt = 0;
 
-l_xf_ret:;
-    return xf_ret;
+    /* 最大档位受 buf_size 及协商结果限制 */
+    while (((uint32_t)(lvl_max + 1) < ARRAY_SIZE(sc_frame_lvl_data_size))
+            && (sc_frame_lvl_data_size[lvl_max + 1] <= xf_ymodem_send_data_len_max(p_ym))) {
+        lvl_max++;
+    }
+    if (p_ym->frame_lvl < lvl_max) {
+        p_ym->frame_lvl++;
+        YM_LOGD(TAG, "frame size: %d", (int)sc_frame_lvl_data_size[p_ym->frame_lvl]);
+    }
 }
 
 xf_err_t xf_ymodem_send_regular_packet_data(
@@ -936,25 +841,20 @@ xf_err_t xf_ymodem_send_regular_packet_data(
     xf_err_t    xf_ret          = XF_OK;
     uint8_t     header          = 0;
     uint32_t    pad_len         = 0;
+    uint32_t    lvl             = 0;
 
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
-    if ((0 < data_len) && (data_len <= XF_YMODEM_SOH_DATA_SIZE)) {
-        p_ym->data_len      = XF_YMODEM_SOH_DATA_SIZE;
-        header              = XF_YMODEM_SOH;
-    } else if ((XF_YMODEM_SOH_DATA_SIZE < data_len) && (data_len <= XF_YMODEM_STX_1K_DATA_SIZE)) {
-        p_ym->data_len      = XF_YMODEM_STX_1K_DATA_SIZE;
-        header              = XF_YMODEM_STX_1K;
-    } else if ((XF_YMODEM_STX_1K_DATA_SIZE < data_len) && (data_len <= XF_YMODEM_STX_2K_DATA_SIZE)) {
-        p_ym->data_len      = XF_YMODEM_STX_2K_DATA_SIZE;
-        header              = XF_YMODEM_STX_2K;
-    } else if ((XF_YMODEM_STX_2K_DATA_SIZE < data_len) && (data_len <= XF_YMODEM_STX_4K_DATA_SIZE)) {
-        p_ym->data_len      = XF_YMODEM_STX_4K_DATA_SIZE;
-        header              = XF_YMODEM_STX_8K;
-    } else if ((XF_YMODEM_STX_4K_DATA_SIZE < data_len) && (data_len <= XF_YMODEM_STX_8K_DATA_SIZE)) {
-        p_ym->data_len      = XF_YMODEM_STX_8K_DATA_SIZE;
-        header              = XF_YMODEM_SOH;
+    /* 选择能容纳 data_len 的最小包长 */
+    for (lvl = 0; lvl < ARRAY_SIZE(sc_frame_lvl_data_size); lvl++) {
+        if (data_len <= sc_frame_lvl_data_size[lvl]) {
+            break;
+        }
+    }
+    if ((0 < data_len) && (lvl < ARRAY_SIZE(sc_frame_lvl_data_size))) {
+        p_ym->data_len      = sc_frame_lvl_data_size[lvl];
+        header              = sc_frame_lvl_header[lvl];
     } else {
         YM_LOGD(TAG, "p_ym->data_len(%d) Not Supported", (int)p_ym->data_len);
     }
@@ -963,58 +863,59 @@ xf_err_t xf_ymodem_send_regular_packet_data(
         YM_LOGD(TAG, "p_ym->packet_len(%d) Not Supported", (int)p_ym->packet_len);
     }
 
-    p_ym->p_buf[XF_YMODEM_HEADER_IDX]   = header;
+    p_ym->p_pkt[XF_YMODEM_HEADER_IDX]   = header;
 
     /* 填充无效值 */
     pad_len = p_ym->data_len - data_len;
     if (pad_len > 0) {
         xf_memset(
-            (char *)&p_ym->p_buf[XF_YMODEM_DATA_IDX + data_len],
+            (char *)&p_ym->p_pkt[XF_YMODEM_DATA_IDX + data_len],
             XF_YMODEM_PAD_VAL, pad_len);
     }
 
     return xf_ret;
 }
 
-xf_err_t xf_ymodem_send_packet(xf_ymodem_t *p_ym)
+void xf_ymodem_ext_len_to_bytes(uint32_t data_len, uint8_t *p_buf)
 {
-    xf_err_t    xf_ret          = XF_OK;
-    int32_t     wlen            = 0;
-
-    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
-             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
-
-    wlen = p_ym->ops->write(p_ym->p_buf, p_ym->packet_len, p_ym->timeout_ms);
-    if (wlen != p_ym->packet_len) {
-        xf_ret = XF_FAIL;
-    }
-
-    xf_ymodem_show_packet(p_ym->p_buf, p_ym->data_len);
+    p_buf[0] = (uint8_t)(data_len >> 24);
+    p_buf[1] = (uint8_t)(data_len >> 16);
+    p_buf[2] = (uint8_t)(data_len >> 8);
+    p_buf[3] = (uint8_t)(data_len);
+}
 
-    return xf_ret;
+uint32_t xf_ymodem_ext_len_from_bytes(const uint8_t *p_buf)
+{
+    return ((uint32_t)p_buf[0] << 24) | ((uint32_t)p_buf[1] << 16)
+           | ((uint32_t)p_buf[2] << 8) | ((uint32_t)p_buf[3]);
 }
 
 xf_err_t xf_ymodem_send_prepare_packet_protocol_segment(xf_ymodem_t *p_ym)
 {
     xf_err_t    xf_ret          = XF_OK;
-    uint16_t    crc16           = 0;
+    uint16_t    crc16           = XF_YMODEM_CRC_START_VAL_DEFAULT;
     uint8_t     crc16_hi        = 0;
     uint8_t     crc16_lo        = 0;
+    uint8_t     ext_len[XF_YMODEM_EXT_LEN_SIZE];
 
     XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
              TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
 
-    p_ym->p_buf[XF_YMODEM_PN_IDX]       = p_ym->packet_num;
-    p_ym->p_buf[XF_YMODEM_NPN_IDX]      = ~p_ym->packet_num;
+    p_ym->p_pkt[XF_YMODEM_PN_IDX]       = p_ym->packet_num;
+    p_ym->p_pkt[XF_YMODEM_NPN_IDX]      = ~p_ym->packet_num;
 
+    if (p_ym->p_pkt[XF_YMODEM_HEADER_IDX] == XF_YMODEM_STX_EXT) {
+        /* 扩展包的数据段长字段也计入 crc */
+        xf_ymodem_ext_len_to_bytes(p_ym->data_len, ext_len);
+        crc16 = xf_ymodem_crc16(crc16, ext_len, sizeof(ext_len));
+    }
     crc16 = xf_ymodem_crc16(
-                XF_YMODEM_CRC_START_VAL_DEFAULT,
-                &p_ym->p_buf[XF_YMODEM_DATA_IDX], p_ym->data_len);
+                crc16, &p_ym->p_pkt[XF_YMODEM_DATA_IDX], p_ym->data_len);
     crc16_hi = (crc16 >> 8) & 0xFF;
     crc16_lo = (crc16) & 0xFF;
 
-    p_ym->p_buf[XF_YMODEM_DATA_IDX + p_ym->data_len + 0] = crc16_hi;
-    p_ym->p_buf[XF_YMODEM_DATA_IDX + p_ym->data_len + 1] = crc16_lo;
+    p_ym->p_pkt[XF_YMODEM_DATA_IDX + p_ym->data_len + 0] = crc16_hi;
+    p_ym->p_pkt[XF_YMODEM_DATA_IDX + p_ym->data_len + 1] = crc16_lo;
 
     return xf_ret;
 }
@@ -1057,10 +958,9 @@ xf_err_t xf_ymodem_prepare_file_info(
     file_name_actual_len = xf_strnlen(
                                (const char *)p_info->p_name_buf,
                                XF_YMODEM_SOH_DATA_SIZE - 1);
-    xf_strncpy((char *)&p_ym->p_buf[buf_idx],
-               p_info->p_name_buf, file_name_actual_len);
+    xf_memcpy(&p_ym->p_pkt[buf_idx], p_info->p_name_buf, file_name_actual_len);
     buf_idx += file_name_actual_len;
-    p_ym->p_buf[buf_idx] = '\0';
+    p_ym->p_pkt[buf_idx] = '\0';
     buf_idx++;
     if (buf_idx >= (XF_YMODEM_PT_DATA - 1)) {
         xf_ret              = XF_FAIL;
@@ -1069,7 +969,7 @@ xf_err_t xf_ymodem_prepare_file_info(
 
     xf_ret = xf_ymodem_u32_to_str(
                  (uint32_t)p_info->file_len, DECIMAL,
-                 &p_ym->p_buf[buf_idx], XF_YMODEM_PT_DATA - buf_idx,
+                 &p_ym->p_pkt[buf_idx], XF_YMODEM_PT_DATA - buf_idx,
                  &file_len_str_actual_len);
     if (xf_ret != XF_OK) {
         goto l_xf_ret;
@@ -1077,12 +977,26 @@ xf_err_t xf_ymodem_prepare_file_info(
     buf_idx                += file_len_str_actual_len;
     /* xf_ymodem_u32_to_str 内已经附加了 '\0' */
 
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    /* 滑动窗口扩展，标准接收端只解析到文件长度 */
+    xf_ret = xf_ymodem_send_window_prepare(p_ym, &buf_idx);
+    if (xf_ret != XF_OK) {
+        goto l_xf_ret;
+    }
+#endif
+    /* 非标包长扩展 */
+    xf_ret = xf_ymodem_send_frame_prepare(p_ym, &buf_idx);
+    if (xf_ret != XF_OK) {
+        goto l_xf_ret;
+    }
+
     p_ym->file_len = p_info->file_len;
     p_ym->file_len_transmitted = 0;
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_FILE, 1, 0, p_info->file_len);
 
-    if ((p_ym->ops->user_file_info) && (buf_idx < (XF_YMODEM_PT_DATA - 1))) {
+    if ((p_ym->ops) && (p_ym->ops->user_file_info) && (buf_idx < (XF_YMODEM_PT_DATA - 1))) {
         buf_idx += p_ym->ops->user_file_info(
-                       &p_ym->p_buf[buf_idx],
+                       &p_ym->p_pkt[buf_idx],
                        XF_YMODEM_PT_DATA - buf_idx,
                        p_ym->user_data);
     }
@@ -1092,10 +1006,10 @@ xf_err_t xf_ymodem_prepare_file_info(
     }
 
     if (buf_idx < (XF_YMODEM_PT_DATA - 1)) {
-        xf_memset((char *)&p_ym->p_buf[buf_idx], 0, XF_YMODEM_PT_DATA - buf_idx);
+        xf_memset((char *)&p_ym->p_pkt[buf_idx], 0, XF_YMODEM_PT_DATA - buf_idx);
     }
 
-    p_ym->p_buf[XF_YMODEM_HEADER_IDX] = XF_YMODEM_SOH;
+    p_ym->p_pkt[XF_YMODEM_HEADER_IDX] = XF_YMODEM_SOH;
     p_ym->data_len = XF_YMODEM_SOH_DATA_SIZE;
     p_ym->packet_len = p_ym->data_len + XF_YMODEM_PROT_SEG_SIZE;
 
@@ -1103,25 +1017,332 @@ l_xf_ret:;
     return xf_ret;
 }
 
-/* send */
+/* large frame */
+
+/*
+    非标包长扩展(两端都设置 XF_YMODEM_FLAG_LARGE_FRAME 时):
+
+    SENDER                                  RECEIVER
+                                            C
+    SOH 00 FF name\0 len\0 "xfym f=8192"\0 ... CRC CRC
+                                            ACK
+                                            F hdr ~hdr      (标准接收端没有这一步)
+                                            C
+    STX_4K 01 FE Data[4096] CRC CRC         (hdr 为两端都能容纳的最大包长的包头)
+    ...
 
-uint16_t xf_ymodem_crc16(uint16_t crc_start, const uint8_t *buf, uint32_t len)
+    两端都能容纳 16K 以上的包时使用扩展包，F 之后还有以 1K 为单位的包长:
+                                            F 0D F2 n ~n    (n = 16, 32, 64)
+    STX_EXT len[4] 01 FE Data[len] CRC CRC  (len 为大端，计入 crc)
+
+    发送端未收到 F 时最大发送 1K 包，与标准接收端兼容。
+    协商出滑动窗口时包长固定为 1K, 接收端不发送 F.
+ */
+
+uint8_t xf_ymodem_frame_lvl_max(xf_ymodem_t *p_ym)
 {
-    uint16_t crc = crc_start;
-    int i;
-    while (len--) {
-        crc = crc ^ *buf++ << 8;
-        for (i = 0; i < 8; i++) {
-            if (crc & 0x8000) {
-                crc = crc << 1 ^ 0x1021;
-            } else {
-                crc = crc << 1;
-            }
+    uint8_t lvl = ARRAY_SIZE(sc_frame_lvl_data_size) - 1;
+
+    while ((lvl >= 2)
+            && (p_ym->buf_size < sc_frame_lvl_data_size[lvl] + XF_YMODEM_PROT_SEG_SIZE)) {
+        lvl--;
+    }
+
+    return (lvl >= 2) ? lvl : 0;
+}
+
+xf_err_t xf_ymodem_recv_frame_parse(xf_ymodem_t *p_ym, uint32_t *p_buf_idx)
+{
+    xf_err_t    xf_ret          = XF_OK;
+    uint32_t    buf_idx         = *p_buf_idx;
+    uint32_t    tag_len         = sizeof(XF_YMODEM_FRAME_TAG) - 1;
+    uint32_t    ext_len         = 0;
+    uint32_t    data_len_max    = 0;
+    uint8_t     lvl             = 0;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    if ((buf_idx + tag_len >= p_ym->data_len)
+            || (xf_memcmp(&p_ym->p_pkt[buf_idx], XF_YMODEM_FRAME_TAG, tag_len) != 0)) {
+        /* 对方没有提供扩展 */
+        return xf_ret;
+    }
+    ext_len = xf_strnlen((const char *)&p_ym->p_pkt[buf_idx], p_ym->data_len - buf_idx);
+    xf_ret  = xf_ymodem_str_to_u32(&p_ym->p_pkt[buf_idx + tag_len], ext_len - tag_len, &data_len_max);
+    *p_buf_idx = buf_idx + ext_len + 1; /*!< 跳过扩展及 '\0', 剩余部分交给 user_parse */
+    if (xf_ret != XF_OK) {
+        return xf_ret;
+    }
+
+    if (!(p_ym->flags & XF_YMODEM_FLAG_LARGE_FRAME) || (XF_YMODEM_WIN_SIZE(p_ym) > 0)) {
+        return xf_ret;
+    }
+    /* 选择两端都能容纳的最大包长 */
+    lvl = xf_ymodem_frame_lvl_max(p_ym);
+    while ((lvl >= 2) && (sc_frame_lvl_data_size[lvl] > data_len_max)) {
+        lvl--;
+    }
+    if (lvl < 2) {
+        return xf_ret;
+    }
+
+    p_ym->frame_max = sc_frame_lvl_data_size[lvl];
+    YM_LOGD(TAG, "frame max:%d", (int)p_ym->frame_max);
+
+    return xf_ret;
+}
+
+uint32_t xf_ymodem_recv_frame_req(xf_ymodem_t *p_ym, uint8_t *p_req)
+{
+    uint32_t    len             = 0;
+    uint8_t     lvl             = 0;
+
+    if (p_ym->frame_max <= XF_YMODEM_STX_1K_DATA_SIZE) {
+        return len;
+    }
+
+    /* 接受非标包长: F + 最大包长的包头 + 反码 */
+    for (lvl = 2; sc_frame_lvl_data_size[lvl] < p_ym->frame_max; lvl++) {}
+    p_req[len++] = XF_YMODEM_F;
+    p_req[len++] = sc_frame_lvl_header[lvl];
+    p_req[len++] = (uint8_t)~sc_frame_lvl_header[lvl];
+    if (sc_frame_lvl_header[lvl] == XF_YMODEM_STX_EXT) {
+        /* 扩展包还需要以 1K 为单位的包长 + 反码 */
+        p_req[len++] = (uint8_t)(p_ym->frame_max / XF_YMODEM_STX_1K_DATA_SIZE);
+        p_req[len++] = (uint8_t)~(p_ym->frame_max / XF_YMODEM_STX_1K_DATA_SIZE);
+    }
+
+    return len;
+}
+
+xf_err_t xf_ymodem_send_frame_prepare(xf_ymodem_t *p_ym, uint32_t *p_buf_idx)
+{
+    xf_err_t    xf_ret          = XF_OK;
+    uint32_t    buf_idx         = *p_buf_idx;
+    uint32_t    tag_len         = sizeof(XF_YMODEM_FRAME_TAG) - 1;
+    uint32_t    str_len         = 0;
+    uint8_t     lvl             = 0;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    lvl = xf_ymodem_frame_lvl_max(p_ym);
+    if (!(p_ym->flags & XF_YMODEM_FLAG_LARGE_FRAME) || (lvl == 0)) {
+        return xf_ret;
+    }
+    if (buf_idx + tag_len >= XF_YMODEM_DATA_IDX + XF_YMODEM_SOH_DATA_SIZE - 1) {
+        /* 文件名太长，放不下扩展，最大发送 1K 包 */
+        return xf_ret;
+    }
+
+    xf_memcpy(&p_ym->p_pkt[buf_idx], XF_YMODEM_FRAME_TAG, tag_len);
+    xf_ret = xf_ymodem_u32_to_str(
+                 sc_frame_lvl_data_size[lvl], DECIMAL, &p_ym->p_pkt[buf_idx + tag_len],
+                 XF_YMODEM_DATA_IDX + XF_YMODEM_SOH_DATA_SIZE - (buf_idx + tag_len),
+                 &str_len);
+    if (xf_ret != XF_OK) {
+        /* 同上 */
+        p_ym->p_pkt[buf_idx] = '\0';
+        return XF_OK;
+    }
+    *p_buf_idx = buf_idx + tag_len + str_len;
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_send_frame_init(xf_ymodem_t *p_ym, const uint8_t *p_hdr)
+{
+    xf_err_t    xf_ret          = XF_OK;
+    uint32_t    hdr_len         = 2;
+    uint8_t     lvl             = 0;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_hdr, XF_ERR_INVALID_ARG,
+             TAG, "p_hdr:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    /* 包头 + 反码，扩展包还有包长 + 反码 */
+    if (p_hdr[0] == XF_YMODEM_STX_EXT) {
+        hdr_len = 4;
+    }
+
+    /* 只接受不超过本端提议的包长 */
+    for (lvl = xf_ymodem_frame_lvl_max(p_ym); lvl >= 2; lvl--) {
+        if ((sc_frame_lvl_header[lvl] == p_hdr[0])
+                && ((p_hdr[0] != XF_YMODEM_STX_EXT)
+                    || (sc_frame_lvl_data_size[lvl] == p_hdr[2] * XF_YMODEM_STX_1K_DATA_SIZE))) {
+            break;
         }
     }
-    return crc;
+    if (!(p_ym->flags & XF_YMODEM_FLAG_LARGE_FRAME)
+            || ((p_hdr[0] ^ p_hdr[1]) != 0xFF)
+            || ((hdr_len == 4) && ((p_hdr[2] ^ p_hdr[3]) != 0xFF))
+            || (lvl < 2)) {
+        YM_LOGD(TAG, "frame header(%02X) Not Supported", (int)p_hdr[0]);
+        p_ym->error_code = XF_YMODEM_ERR_HEADER;
+        return XF_FAIL;
+    }
+
+    p_ym->frame_max = sc_frame_lvl_data_size[lvl];
+    YM_LOGD(TAG, "frame max:%d", (int)p_ym->frame_max);
+
+    return xf_ret;
 }
 
+#if XF_YMODEM_WINDOW_IS_ENABLE
+
+/* window */
+
+/*
+    滑动窗口扩展(两端都设置 XF_YMODEM_FLAG_WINDOW 时):
+
+    SENDER                                  RECEIVER
+                                            C
+    SOH 00 FF name\0 len\0 "xfym w=8"\0 ... CRC CRC
+                                            ACK
+                                            W n ~n          (标准接收端此处为 C)
+    STX 01 FE Data[1024] CRC CRC
+    STX 02 FD Data[1024] CRC CRC
+    ...(最多 n 包未应答)
+                                            ACK 01 FE
+                                            NAK 02 FD       (只重发出错的包)
+    STX 02 FD Data[1024] CRC CRC
+                                            ACK 02 FD
+    ...
+    EOT                                     (与标准流程相同)
+
+    数据包固定不超过 1K, p_buf 按 XF_YMODEM_STX_PACKET_SIZE 切分成槽:
+    发送端每个未应答的包占一个槽; 接收端缓存乱序到达的包，按序交付给用户。
+ */
+
+uint8_t xf_ymodem_window_max(xf_ymodem_t *p_ym, bool is_recv)
+{
+    uint32_t win = p_ym->buf_size / XF_YMODEM_STX_PACKET_SIZE;
+
+    /* 接收端需要一个空闲槽接收下一包 */
+    if (is_recv && (win > 0)) {
+        win--;
+    }
+    win = min(win, XF_YMODEM_WINDOW_MAX_SEL);
+
+    return (win >= 2) ? (uint8_t)win : 0;
+}
+
+uint8_t *xf_ymodem_window_slot(xf_ymodem_t *p_ym, uint32_t slot)
+{
+    return &p_ym->p_buf[slot * XF_YMODEM_STX_PACKET_SIZE];
+}
+
+xf_err_t xf_ymodem_recv_window_parse(xf_ymodem_t *p_ym, uint32_t *p_buf_idx)
+{
+    xf_err_t    xf_ret          = XF_OK;
+    uint32_t    buf_idx         = *p_buf_idx;
+    uint32_t    tag_len         = sizeof(XF_YMODEM_WINDOW_TAG) - 1;
+    uint32_t    ext_len         = 0;
+    uint32_t    win             = 0;
+    uint32_t    i;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    if ((buf_idx + tag_len >= p_ym->data_len)
+            || (xf_memcmp(&p_ym->p_pkt[buf_idx], XF_YMODEM_WINDOW_TAG, tag_len) != 0)) {
+        /* 对方没有提供扩展 */
+        return xf_ret;
+    }
+    ext_len = xf_strnlen((const char *)&p_ym->p_pkt[buf_idx], p_ym->data_len - buf_idx);
+    xf_ret  = xf_ymodem_str_to_u32(&p_ym->p_pkt[buf_idx + tag_len], ext_len - tag_len, &win);
+    *p_buf_idx = buf_idx + ext_len + 1; /*!< 跳过扩展及 '\0', 剩余部分交给 user_parse */
+    if (xf_ret != XF_OK) {
+        return xf_ret;
+    }
+
+    /* ymodem-g 不需要窗口 */
+    if (!(p_ym->flags & XF_YMODEM_FLAG_WINDOW) || (p_ym->req_ch != XF_YMODEM_C)) {
+        return xf_ret;
+    }
+    win = min(win, xf_ymodem_window_max(p_ym, true));
+    if (win < 2) {
+        return xf_ret;
+    }
+
+    p_ym->win_size  = (uint8_t)win;
+    p_ym->win_base  = 1;
+    p_ym->win_mask  = 0;
+    p_ym->win_nak   = 0;
+    for (i = 0; i <= win; i++) {
+        p_ym->win_map[i] = (uint8_t)i;
+    }
+    YM_LOGD(TAG, "window:%d", (int)win);
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_send_window_prepare(xf_ymodem_t *p_ym, uint32_t *p_buf_idx)
+{
+    xf_err_t    xf_ret          = XF_OK;
+    uint32_t    buf_idx         = *p_buf_idx;
+    uint32_t    tag_len         = sizeof(XF_YMODEM_WINDOW_TAG) - 1;
+    uint32_t    str_len         = 0;
+    uint8_t     win             = 0;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    win = xf_ymodem_window_max(p_ym, false);
+    if (!(p_ym->flags & XF_YMODEM_FLAG_WINDOW) || (win == 0)) {
+        return xf_ret;
+    }
+    if (buf_idx + tag_len >= XF_YMODEM_DATA_IDX + XF_YMODEM_SOH_DATA_SIZE - 1) {
+        /* 文件名太长，放不下扩展，按标准 ymodem 传输 */
+        return xf_ret;
+    }
+
+    xf_memcpy(&p_ym->p_pkt[buf_idx], XF_YMODEM_WINDOW_TAG, tag_len);
+    xf_ret = xf_ymodem_u32_to_str(
+                 win, DECIMAL, &p_ym->p_pkt[buf_idx + tag_len],
+                 XF_YMODEM_DATA_IDX + XF_YMODEM_SOH_DATA_SIZE - (buf_idx + tag_len),
+                 &str_len);
+    if (xf_ret != XF_OK) {
+        /* 同上 */
+        p_ym->p_pkt[buf_idx] = '\0';
+        return XF_OK;
+    }
+    *p_buf_idx = buf_idx + tag_len + str_len;
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_send_window_init(xf_ymodem_t *p_ym, uint8_t win, uint8_t nwin)
+{
+    xf_err_t    xf_ret          = XF_OK;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    /* 只接受不超过本端提议的窗口 */
+    if (!(p_ym->flags & XF_YMODEM_FLAG_WINDOW)
+            || ((win ^ nwin) != 0xFF)
+            || (win < 2) || (win > xf_ymodem_window_max(p_ym, false))) {
+        YM_LOGD(TAG, "window(%d) Not Supported", (int)win);
+        p_ym->error_code = XF_YMODEM_ERR_HEADER;
+        return XF_FAIL;
+    }
+
+    p_ym->win_size  = win;
+    p_ym->win_head  = 0;
+    p_ym->win_tail  = 0;
+    p_ym->win_mask  = 0;
+    p_ym->win_nak   = 0;
+    p_ym->p_pkt     = xf_ymodem_window_slot(p_ym, 0);
+    YM_LOGD(TAG, "window:%d", (int)win);
+
+    return xf_ret;
+}
+
+#endif /* XF_YMODEM_WINDOW_IS_ENABLE */
+
 bool xf_ymodem_is_hex(char ch)
 {
     if (((ch >= '0') && (ch <= '9'))
@@ -1222,79 +1443,239 @@ xf_err_t xf_ymodem_u32_to_str(
     return XF_OK;
 }
 
-xf_err_t xf_ymodem_show_packet(uint8_t *packet, uint32_t packet_size)
+#if XF_YMODEM_STATS_IS_ENABLE || XF_YMODEM_TRACE_IS_ENABLE || XF_YMODEM_RTO_IS_ENABLE
+
+uint32_t xf_ymodem_now_us(const xf_ymodem_t *p_ym)
 {
-    if (packet == NULL) {
-        return XF_ERR_INVALID_ARG;
+    /* 与链路同一时钟，模拟链路的虚拟时间下往返时间才有意义 */
+    if ((p_ym->ops != NULL) && (p_ym->ops->now_ms != NULL)) {
+        return p_ym->ops->now_ms() * 1000U;
     }
-#if XF_YMODEM_DEBUG_IS_ENABLE
-    switch (packet[0]) {
-    case XF_YMODEM_SOH:
-        ym_printf("SOH ");
-        break;
-    case XF_YMODEM_STX:
-        ym_printf("STX ");
-        break;
-    case XF_YMODEM_EOT:
-        ym_printf("EOT ");
-        break;
-    case XF_YMODEM_ACK:
-        ym_printf("ACK ");
-        break;
-    case XF_YMODEM_NAK:
-        ym_printf("NAK ");
-        break;
-    case XF_YMODEM_CAN:
-        ym_printf("CAN ");
-        break;
-    default:
-        break;
+
+    return XF_YMODEM_NOW_US();
+}
+
+#endif
+
+#if XF_YMODEM_STATS_IS_ENABLE
+
+xf_err_t xf_ymodem_stats_reset(xf_ymodem_t *p_ym)
+{
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    xf_memset(&p_ym->stats, 0, sizeof(p_ym->stats));
+
+    return XF_OK;
+}
+
+void xf_ymodem_stats_frame(uint32_t *p_frames, uint32_t data_len)
+{
+    uint8_t     lvl             = 0;
+
+    /* 扩展包的数据段长不一定是 2 的幂，计入不超过它的最大档位 */
+    while (((uint32_t)(lvl + 1) < ARRAY_SIZE(sc_frame_lvl_data_size))
+            && (sc_frame_lvl_data_size[lvl + 1] <= data_len)) {
+        lvl++;
+    }
+    p_frames[lvl]++;
+}
+
+void xf_ymodem_stats_rtt_start(xf_ymodem_t *p_ym)
+{
+    p_ym->stats_t0          = xf_ymodem_now_us(p_ym);
+    p_ym->stats_t0_valid    = true;
+}
+
+void xf_ymodem_stats_rtt_end(xf_ymodem_t *p_ym)
+{
+    uint32_t    rtt_us          = 0;
+    uint8_t     idx             = 0;
+
+    /* 只记录一次: 重复的应答没有对应的发送时刻 */
+    if (!p_ym->stats_t0_valid) {
+        return;
     }
-    if (packet_size > 3) {
-        ym_printf("%02X %02X Data[%d] CRC CRC\r\n", packet[1], packet[2], (int)packet_size);
+    p_ym->stats_t0_valid = false;
+
+    rtt_us = xf_ymodem_now_us(p_ym) - p_ym->stats_t0;
+    while ((rtt_us > 1) && (idx < (XF_YMODEM_STATS_RTT_BUCKET_NUM - 1))) {
+        rtt_us >>= 1;
+        idx++;
+    }
+    p_ym->stats.rtt_hist[idx]++;
+}
+
+#endif /* XF_YMODEM_STATS_IS_ENABLE */
+
+#if XF_YMODEM_RTO_IS_ENABLE
+
+/*
+    自适应等待: Jacobson/Karels 算法，与 TCP 的 RTO 相同(RFC 6298)。
+    往返时间为发出包或控制字符到收到回应的第一个字节，减去发出的字节在线路上的发送时间，
+    因此不同包长的样本可以一起平滑；等待时再加上在途及待收字节的发送时间。
+ */
+
+void xf_ymodem_rto_sent(xf_ymodem_t *p_ym, uint32_t len)
+{
+    if (!(p_ym->flags & XF_YMODEM_FLAG_ADAPTIVE_TIMEOUT)) {
+        return;
+    }
+    p_ym->rto_t0        = xf_ymodem_now_us(p_ym);
+    p_ym->rto_tx_len    = len;
+    /* 超时后的回应可能属于之前的任何一次发送，直到收到下一次回应都不取样(Karn) */
+    p_ym->rto_t0_valid  = !p_ym->rto_backoff;
+}
+
+void xf_ymodem_rto_answered(xf_ymodem_t *p_ym)
+{
+    uint32_t    rtt_us          = 0;
+    uint32_t    tx_us           = 0;
+    int32_t     err             = 0;
+
+    if (!(p_ym->flags & XF_YMODEM_FLAG_ADAPTIVE_TIMEOUT) || (p_ym->rto_tx_len == 0)) {
+        return;
+    }
+    rtt_us              = xf_ymodem_now_us(p_ym) - p_ym->rto_t0;
+    tx_us               = xf_ymodem_rto_tx_us(p_ym, p_ym->rto_tx_len);
+    rtt_us              = (rtt_us > tx_us) ? (rtt_us - tx_us) : 0;
+    p_ym->rto_tx_len    = 0;
+    if (!p_ym->rto_t0_valid) {
+        /* 保留加倍后的等待时间，下一次发送重新取样 */
+        p_ym->rto_backoff = false;
+        return;
+    }
+
+    if (p_ym->rto_srtt == 0) {
+        /* 第一个样本: srtt = r, rttvar = r / 2 */
+        p_ym->rto_srtt      = (rtt_us << 3) | 1;
+        p_ym->rto_rttvar    = rtt_us << 1;
     } else {
-        ym_printf("\r\n");
+        /* srtt += (r - srtt) / 8, rttvar += (|r - srtt| - rttvar) / 4 */
+        err                 = (int32_t)rtt_us - (int32_t)(p_ym->rto_srtt >> 3);
+        p_ym->rto_srtt      = (uint32_t)((int32_t)p_ym->rto_srtt + err) | 1;
+        err                 = (err < 0) ? -err : err;
+        p_ym->rto_rttvar    = (uint32_t)((int32_t)p_ym->rto_rttvar + err
+                                         - (int32_t)(p_ym->rto_rttvar >> 2));
+    }
+    /* rto = srtt + 4 * rttvar */
+    p_ym->rto_us        = (p_ym->rto_srtt >> 3) + p_ym->rto_rttvar;
+    p_ym->rto_backoff   = false;
+}
+
+uint32_t xf_ymodem_rto_wait_ms(xf_ymodem_t *p_ym, uint32_t len)
+{
+    uint64_t    wait_us         = (uint64_t)p_ym->timeout_ms * 1000;
+
+    if (!(p_ym->flags & XF_YMODEM_FLAG_ADAPTIVE_TIMEOUT)) {
+        return p_ym->timeout_ms;
     }
-#endif
-    return 0;
+    /* 往返部分不超过 timeout_ms; 字节在线路上的发送时间另加，慢速链路上的大包不会因此超时 */
+    if ((p_ym->rto_us != 0) && (p_ym->rto_us < wait_us)) {
+        wait_us = (p_ym->rto_us > (uint32_t)XF_YMODEM_RTO_MIN_MS_SEL * 1000)
+                  ? p_ym->rto_us : min((uint64_t)XF_YMODEM_RTO_MIN_MS_SEL * 1000, wait_us);
+    }
+    wait_us += xf_ymodem_rto_tx_us(p_ym, p_ym->rto_tx_len + len);
+
+    return (uint32_t)min((wait_us + 999) / 1000, (uint64_t)UINT32_MAX);
 }
 
-xf_err_t xf_ymodem_putc(xf_ymodem_t *p_ym, uint8_t ch)
+uint32_t xf_ymodem_rto_drain_ms(xf_ymodem_t *p_ym, uint32_t len)
 {
-    int32_t wlen = 0;
+    /* 不知道波特率时无法估计剩余部分的发送时间，仍等待 timeout_ms */
+    if (p_ym->baudrate == 0) {
+        return p_ym->timeout_ms;
+    }
 
-    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
-             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    return xf_ymodem_rto_wait_ms(p_ym, len);
+}
 
-    if (ch == XF_YMODEM_EOT) {
-        ym_printf("EOT\r\n");
-        wlen = p_ym->ops->write(&ch, 1, p_ym->timeout_ms);
-        return (wlen == 1) ? XF_OK : XF_FAIL;
+bool xf_ymodem_rto_timeout(xf_ymodem_t *p_ym)
+{
+    if (!(p_ym->flags & XF_YMODEM_FLAG_ADAPTIVE_TIMEOUT)) {
+        return true;
+    }
+    /* 在途的字节已在这次等待中发完，之后的等待不再计入其发送时间 */
+    p_ym->rto_tx_len    = min(p_ym->rto_tx_len, 1);
+    p_ym->rto_backoff   = true;
+    p_ym->rto_t0_valid  = false;
+    if ((p_ym->rto_us == 0) || (p_ym->rto_us >= p_ym->timeout_ms * 1000)) {
+        return true;
     }
+    p_ym->rto_us        = (uint32_t)min((uint64_t)p_ym->rto_us * 2, (uint64_t)p_ym->timeout_ms * 1000);
 
-#if XF_YMODEM_DEBUG_IS_ENABLE
-    ym_printf("\t\t\t\t");
-    switch (ch) {
-    case XF_YMODEM_ACK: {
-        ym_printf("ACK\r\n");
-    } break;
-    case XF_YMODEM_NAK: {
-        ym_printf("NAK\r\n");
-    } break;
-    case XF_YMODEM_CAN: {
-        ym_printf("CAN\r\n");
+    return false;
+}
+
+#endif /* XF_YMODEM_RTO_IS_ENABLE */
+
+/* ==================== [Static Functions] ================================== */
+
+/* 调用 ops->read; 有 wait_readable 时由它阻塞等待，read 只取走已到达的数据 */
+static int32_t xf_ymodem_port_read(
+    xf_ymodem_t *p_ym, uint8_t *p_dst, uint32_t size, uint32_t timeout_ms)
+{
+    int32_t     ret             = 0;
+
+    if ((p_ym->ops->wait_readable != NULL) && (p_ym->ops->now_ms != NULL)) {
+        ret = p_ym->ops->wait_readable(p_ym->ops->now_ms() + timeout_ms);
+        if (ret <= 0) {
+            return ret;
+        }
+        timeout_ms = 0;
+    }
+
+    return p_ym->ops->read(p_dst, size, timeout_ms);
+}
+
+static xf_err_t xf_ymodem_ev_to_err(xf_ymodem_t *p_ym, xf_ymodem_nb_event_t ev)
+{
+    /* 阻塞接口的返回值，与非阻塞内核的事件一一对应 */
+    switch (ev) {
+    case XF_YMODEM_NB_EV_FILE_INFO: {
+        /* 批量传输: 收到下一个文件的起始帧，由 xf_ymodem_recv_handshake() 解析 */
+        return (p_ym->state == XF_YMODEM_RECV_NEXT_FILE_INFO) ? XF_ERR_NOT_FINISHED : XF_OK;
+    }
+    case XF_YMODEM_NB_EV_DATA:
+    case XF_YMODEM_NB_EV_SEND_READY: {
+        return XF_OK;
+    }
+    case XF_YMODEM_NB_EV_FILE_END:
+    case XF_YMODEM_NB_EV_END: {
+        return XF_ERR_RESOURCE;
+    }
+    case XF_YMODEM_NB_EV_ERROR: {
+        switch (p_ym->error_code) {
+        case XF_YMODEM_ERR_NO_DATA: {
+            return XF_ERR_TIMEOUT;
+        }
+        case XF_YMODEM_ERR_PN:
+        case XF_YMODEM_ERR_CRC: {
+            return XF_ERR_INVALID_CHECK;
+        }
+        case XF_YMODEM_ERR_CAN:
+        case XF_YMODEM_ERR_NAK_RETRY: {
+            return XF_ERR_RESOURCE;
+        }
+        default: {
+        } break;
+        }
     } break;
-    case XF_YMODEM_C: {
-        ym_printf("C\r\n");
+    default: {
     } break;
-    default:
-        ym_printf("%c\r\n", ch);
-        break;
     }
-#endif  /*XF_YMODEM_DEBUG_IS_ENABLE*/
 
-    wlen = p_ym->ops->write(&ch, 1, p_ym->timeout_ms);
-    return (wlen == 1) ? XF_OK : XF_FAIL;
+    return XF_FAIL;
 }
 
-/* ==================== [Static Functions] ================================== */
+#if XF_YMODEM_RTO_IS_ENABLE
+/* len 字节在线路上的发送时间(us)，每字节 10 位；baudrate 未知时为 0 */
+static uint32_t xf_ymodem_rto_tx_us(const xf_ymodem_t *p_ym, uint32_t len)
+{
+    if (p_ym->baudrate == 0) {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t)len * 10 * 1000000 / p_ym->baudrate);
+}
+#endif
@@ -55,6 +55,13 @@ xf_err_t xf_ymodem_check(xf_ymodem_t *p_ym);
 /**
  * @brief xf_ymodem 请求接收文件。
  * 
+ * @note xf_ymodem_recv_data() 返回 XF_ERR_NOT_FINISHED 后调用时，
+ *       直接解析已收到的下一个文件的起始帧，不再请求。
+ * @note xf_ymodem_t.flags 含 XF_YMODEM_FLAG_YMODEM_G 时，每次调用交替以 G 和 C 请求起始帧。
+ *       发送端响应 G 时本次传输使用 ymodem-g: 发送端连续发送数据包，接收端不逐包应答，
+ *       任何校验错误都会以 CAN 取消传输(xf_ymodem_recv_data() 返回 XF_ERR_RESOURCE)。
+ *       仅用于 USB-CDC, TCP 透传等可靠链路。
+ * 
  * @param p_ym                  xf_ymodem 对象指针。
  * @param[out] p_file_info      成功时，传出发送端发来的文件信息。
  * @return xf_err_t 
@@ -90,6 +97,10 @@ xf_err_t xf_ymodem_recv_handshake(
  *      - XF_OK                 成功收到数据
  *      - XF_ERR_RESOURCE       对方已取消或接收完毕，见 @ref xf_ymodem_t.error_code
  *      - XF_ERR_TIMEOUT        指定时间内未接收到数据
+ *      - XF_ERR_NOT_FINISHED   当前文件已接收完毕，且对方(批量传输)接着发来了下一个文件的起始帧，
+ *                              此时调用 xf_ymodem_recv_handshake() 获取下一个文件的信息
+ *      - XF_ERR_BUSY           双缓冲时两个缓冲区都未归还，见 xf_ymodem_recv_release()
+ *      - XF_ERR_INVALID_STATE  尚未成功调用 xf_ymodem_recv_handshake(), 或本次接收已经结束
  *      - XF_ERR_INVALID_ARG    无效参数
  *      - XF_FAIL               失败
  * 
@@ -110,9 +121,41 @@ xf_err_t xf_ymodem_recv_handshake(
 xf_err_t xf_ymodem_recv_data(
     xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size);
 
+/**
+ * @brief xf_ymodem 接收端归还数据缓冲区。
+ *
+ * @note 仅在 xf_ymodem_t.p_buf_alt 不为 NULL 且 xf_ymodem_t.flags 含
+ *       XF_YMODEM_FLAG_EARLY_ACK(早应答 + 双缓冲)时需要调用。
+ *       此时 xf_ymodem_recv_data() 传出的缓冲区由用户持有，xf_ymodem 在另一个缓冲区中接收下一包；
+ *       两个缓冲区都未归还时 xf_ymodem_recv_data() 返回 XF_ERR_BUSY.
+ * @note 可以在其他任务中调用(如写 flash 的任务写完后归还)。
+ *
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param p_data_buf            xf_ymodem_recv_data() 传出的数据缓冲区指针。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数，或 p_data_buf 不属于 p_buf, p_buf_alt
+ *
+ * @code{c}
+ * p_ym->p_buf_alt  = s_ym_buf_alt;    // 与 s_ym_buf 同样大小
+ * p_ym->flags     |= XF_YMODEM_FLAG_EARLY_ACK;
+ * while (1) {
+ *     xf_ret = xf_ymodem_recv_data(p_ym, &p_buf, &buf_size);
+ *     if (xf_ret != XF_OK) {
+ *         break;
+ *     }
+ *     // 交给其他任务处理，处理完后由其调用 xf_ymodem_recv_release(p_ym, p_buf)
+ *     app_post_to_flash_task(p_buf, buf_size);
+ * }
+ * @endcode
+ */
+xf_err_t xf_ymodem_recv_release(xf_ymodem_t *p_ym, const uint8_t *p_data_buf);
+
 /**
  * @brief xf_ymodem 请求发送文件。
  * 
+ * @note 接收端以 G 请求时自动使用 ymodem-g 流式发送，见 XF_YMODEM_SEND_STREAM_FILE_DATA.
+ * 
  * @param p_ym                  xf_ymodem 对象指针。
  * @param p_file_info           需要发送的文件的信息。
  * @return xf_err_t 
@@ -143,6 +186,12 @@ xf_err_t xf_ymodem_send_handshake(
  *                              稍后由用户填充。
  * @param p_buf_size            传出本包缓冲区大小，单位字节。
  *                              用户需要向传出的缓冲区指针填充 *p_buf_size 字节。
+ * @note 默认总是使用允许的最大包长: 两端都设置 XF_YMODEM_FLAG_LARGE_FRAME 时为两端 buf_size
+ *       均可容纳的最大包长(最大 64K, 16K 以上为扩展包)，否则最大为 1K.
+ *       xf_ymodem_t.flags 含 XF_YMODEM_FLAG_ADAPTIVE 时
+ *       从 1K 开始，每收到一个 NAK 包长减半(最小 128 字节)，连续多包无 NAK 后包长加倍
+ *       (最大为上述允许的包长)，因此每包的 *p_buf_size 可能不同。
+ *       ymodem-g 及滑动窗口下不调整。
  * @return xf_err_t 
  *      - XF_OK                 成功传出指针及所需的字节数
  *      - XF_ERR_INVALID_ARG    无效参数
@@ -173,6 +222,17 @@ xf_err_t xf_ymodem_send_get_buf_and_len(
  * @brief xf_ymodem 发送数据。
  * 
  * @note 调用 xf_ymodem_send_get_buf_and_len() 获取缓冲区并填充完毕后调用此函数发送。
+ * @note xf_ymodem_t.p_buf_alt 不为 NULL 且 xf_ymodem_t.flags 含 XF_YMODEM_FLAG_PIPELINE 时为流水发送:
+ *       本函数先等待上一包的应答(收到 NAK 时从上一包的缓冲区重发)，
+ *       再发出本包并立即返回，不等待本包应答；
+ *       用户随后通过 xf_ymodem_send_get_buf_and_len() 取得另一个缓冲区填充下一包，
+ *       填充期间本包在线路上传输并等待应答。最后一包会等待应答及结束流程后才返回。
+ *       此时 xf_ymodem_t.file_len_transmitted 包含已发出但未应答的数据长度。
+ * @note 两端都设置 XF_YMODEM_FLAG_WINDOW(需开启 XF_YMODEM_WINDOW_ENABLE)且 p_buf 可容纳
+ *       至少 2 个 1K 包时协商滑动窗口: 发送端最多有 xf_ymodem_t.win_size 个未应答的包，
+ *       接收端按包号应答，只重发出错的包。此时本函数只在窗口已满或最后一包时等待应答，
+ *       xf_ymodem_t.file_len_transmitted 同样包含已发出但未应答的数据长度。
+ *       对方不支持时(如 xshell, lrzsz)自动按标准 ymodem 传输。
  * 
  * @param p_ym                  xf_ymodem 对象指针。
  * @return xf_err_t 
@@ -184,6 +244,36 @@ xf_err_t xf_ymodem_send_get_buf_and_len(
  */
 xf_err_t xf_ymodem_send_data(xf_ymodem_t *p_ym);
 
+/**
+ * @brief xf_ymodem 批量发送结束，发送空起始帧结束会话。
+ * 
+ * @note 仅用于 xf_ymodem_t.flags 含 XF_YMODEM_FLAG_BATCH 的发送端。
+ *       此时每个文件发送完毕后 xf_ymodem_send_data() 返回 XF_ERR_RESOURCE,
+ *       xf_ymodem_t.state 为 XF_YMODEM_SEND_FILE_END, 不发送空起始帧，
+ *       用户可以直接调用 xf_ymodem_send_handshake() 发送下一个文件，无需新的会话。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_STATE  当前文件未发送完毕
+ *      - XF_ERR_TIMEOUT        指定时间内未接收到接收端请求或应答
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_FAIL               失败
+ * 
+ * @code{c}
+ * p_ym->flags |= XF_YMODEM_FLAG_BATCH;
+ * for (i = 0; i < file_num; i++) {
+ *     xf_ret = xf_ymodem_send_handshake(p_ym, &file_info[i]);
+ *     // ... 循环 xf_ymodem_send_get_buf_and_len(), xf_ymodem_send_data()
+ *     if (p_ym->state != XF_YMODEM_SEND_FILE_END) {
+ *         break;
+ *     }
+ * }
+ * xf_ret = xf_ymodem_send_finish(p_ym);
+ * @endcode
+ */
+xf_err_t xf_ymodem_send_finish(xf_ymodem_t *p_ym);
+
 /**
  * @brief xf_ymodem 取消传输。
  * 
@@ -193,6 +283,248 @@ xf_err_t xf_ymodem_send_data(xf_ymodem_t *p_ym);
  */
 xf_err_t xf_ymodem_cancel(xf_ymodem_t *p_ym);
 
+#if XF_YMODEM_STATS_IS_ENABLE
+/**
+ * @brief 清零会话统计 xf_ymodem_t.stats.
+ *
+ * 统计在收发过程中随时更新，任何时候都可以直接读取 p_ym->stats,
+ * 例如传输失败后与 xf_ymodem_t.error_code 一起上报。
+ *
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @return xf_err_t
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_stats_reset(xf_ymodem_t *p_ym);
+#endif
+
+#if XF_YMODEM_TRACE_IS_ENABLE
+/**
+ * @brief 从跟踪环中读取事件。
+ *
+ * 所有会话共用一个 XF_YMODEM_TRACE_SIZE_NUM 个事件的环，写入时不加锁、不阻塞，
+ * 可以在传输进行中从其他任务读取。读取慢于写入时最旧的事件被覆盖，
+ * 此时 *p_pos 跳过被覆盖的事件，可以由 xf_ymodem_trace_ev_t.seq 的不连续看出。
+ *
+ * @param[in,out] p_pos         读取位置，首次读取时置 0, 之后保持上次返回的值。
+ * @param[out] p_ev             事件缓冲区。
+ * @param num                   p_ev 可容纳的事件数。
+ * @return uint32_t             读到的事件数，0 表示没有新事件。
+ */
+uint32_t xf_ymodem_trace_read(
+    uint32_t *p_pos, xf_ymodem_trace_ev_t *p_ev, uint32_t num);
+
+/**
+ * @brief 以 xf_log_printf() 输出跟踪环中的全部事件，每个事件一行 "YMTR <32 位十六进制>",
+ *        由 port/linux/xf_ymodem_trace.py 解码。
+ *
+ * 用于传输失败后把现场通过日志串口带回，不应在传输进行中调用。
+ */
+void xf_ymodem_trace_dump(void);
+#endif
+
+/*
+    非阻塞内核: 不调用 ops 的收发函数，由用户喂入收到的字节、取走待发送的字节及事件，并用自己的时钟驱动超时。
+    一个任务或事件循环可以同时服务多条链路。
+    同一会话的各个 xf_ymodem_nb_*() 修改同一 xf_ymodem_t, 内部不加锁，须在同一上下文中调用;
+    在中断中收到的字节应先放入用户自己的队列，再由该上下文取出喂入。
+    阻塞接口(xf_ymodem_recv_*(), xf_ymodem_send_*())也由本内核实现，
+    支持同样的 flags(ymodem-g, 滑动窗口、非标包长等)。
+
+    典型的事件循环:
+        xf_ymodem_nb_tick(p_ym, now_ms);
+        n = xf_ymodem_nb_tx_peek(p_ym, &p_tx);      // 有待发送的字节时写出
+        xf_ymodem_nb_tx_consume(p_ym, write(p_tx, n));
+        xf_ymodem_nb_feed(p_ym, rx, rx_len);        // 返回已处理的字节数，有事件时停止处理
+        while ((ev = xf_ymodem_nb_poll(p_ym)) != XF_YMODEM_NB_EV_NONE) { ... }
+        等待可读，最长 xf_ymodem_nb_timeout(p_ym) ms
+ */
+
+/**
+ * @brief 非阻塞内核: 开始接收会话，排队发送第一个 C(或 G).
+ * 
+ * @param p_ym                  xf_ymodem 对象指针，需要初始化 p_buf, buf_size,
+ *                              retry_num, timeout_ms, 可选 p_buf_alt, flags; ops 可以为 NULL.
+ * @param p_info                收到起始帧时传出文件信息，会话期间必须有效。
+ * @param now_ms                当前时间，单位 ms, 允许回绕。
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_nb_recv_start(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, uint32_t now_ms);
+
+/**
+ * @brief 非阻塞内核: 开始发送会话，等待接收端的 C(或 G).
+ * 
+ * @param p_ym                  xf_ymodem 对象指针，同 xf_ymodem_nb_recv_start().
+ * @param p_info                第一个文件的信息，收到 C 之前必须有效。
+ * @param now_ms                当前时间，单位 ms.
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_nb_send_start(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, uint32_t now_ms);
+
+/**
+ * @brief 非阻塞内核: 喂入收到的字节。
+ * 
+ * @note 有待取出的事件或待发送的字节时不再处理，返回值可能小于 size,
+ *       用户需要先 xf_ymodem_nb_poll() 及发送，再喂入剩余部分。
+ *       触发事件的字节总会被处理。
+ * @note 接收端收到的数据包在 p_buf 中原地交付，下一次喂入前有效。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param p_src                 收到的字节，可以是 xf_ymodem_nb_rx_buf() 传出的缓冲区。
+ * @param size                  字节数。
+ * @return uint32_t             已处理的字节数。
+ */
+uint32_t xf_ymodem_nb_feed(xf_ymodem_t *p_ym, const uint8_t *p_src, uint32_t size);
+
+/**
+ * @brief 非阻塞内核: 获取可以直接写入当前包的缓冲区，减少一次拷贝。
+ * 
+ * @note 只在接收数据包的中途有效，写入后以同一指针调用 xf_ymodem_nb_feed().
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param[out] pp_buf           传出 p_buf 中当前包剩余部分的起始位置。
+ * @return uint32_t             当前包还需要的字节数，0 表示没有可直接写入的缓冲区。
+ */
+uint32_t xf_ymodem_nb_rx_buf(xf_ymodem_t *p_ym, uint8_t **pp_buf);
+
+/**
+ * @brief 非阻塞内核: 获取待发送的字节。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param[out] pp_data          传出待发送字节的指针，调用 xf_ymodem_nb_tx_consume() 前有效。
+ * @return uint32_t             待发送的字节数，0 表示没有。
+ */
+uint32_t xf_ymodem_nb_tx_peek(xf_ymodem_t *p_ym, const uint8_t **pp_data);
+
+/**
+ * @brief 非阻塞内核: 标记已发出的字节，允许部分发送。
+ * 
+ * @note 全部发出后才开始计算等待对方的超时。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param size                  已发出的字节数，不大于 xf_ymodem_nb_tx_peek() 的返回值。
+ */
+void xf_ymodem_nb_tx_consume(xf_ymodem_t *p_ym, uint32_t size);
+
+/**
+ * @brief 非阻塞内核: 取出一个事件。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @return xf_ymodem_nb_event_t 事件，没有时为 XF_YMODEM_NB_EV_NONE.
+ */
+xf_ymodem_nb_event_t xf_ymodem_nb_poll(xf_ymodem_t *p_ym);
+
+/**
+ * @brief 非阻塞内核: 更新时间并处理超时(重发请求、NAK 或数据包，重试耗尽时出错)。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param now_ms                当前时间，单位 ms, 允许回绕。
+ */
+void xf_ymodem_nb_tick(xf_ymodem_t *p_ym, uint32_t now_ms);
+
+/**
+ * @brief 非阻塞内核: 距下一次超时的时间，用于 poll/epoll 等的等待时间。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @return uint32_t             相对最近一次 xf_ymodem_nb_tick() 的 ms 数，
+ *                              没有等待中的超时时为 XF_YMODEM_NB_WAIT_FOREVER.
+ */
+uint32_t xf_ymodem_nb_timeout(xf_ymodem_t *p_ym);
+
+/**
+ * @brief 非阻塞内核: 接收端获取 XF_YMODEM_NB_EV_DATA 事件的数据。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param[out] pp_data_buf      传出数据指针(指向 p_buf 内)，下一次 xf_ymodem_nb_feed() 前有效。
+ * @param[out] p_buf_size       传出有效数据长，已去除最后一包的填充。
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_nb_recv_get_data(
+    xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size);
+
+/**
+ * @brief 非阻塞内核: 发送端获取 XF_YMODEM_NB_EV_SEND_READY 事件后需要填充的缓冲区。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param[out] pp_data_buf      传出数据缓冲区，用户从 file_len_transmitted 处填充。
+ * @param[out] p_buf_size       传出需要填充的字节数。
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_STATE  当前不需要数据
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_nb_send_get_buf(
+    xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size);
+
+/**
+ * @brief 非阻塞内核: 填充完毕，排队发送本包。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_STATE  当前不需要数据
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_nb_send_commit(xf_ymodem_t *p_ym);
+
+/**
+ * @brief 非阻塞内核: 发送端收到 XF_YMODEM_NB_EV_FILE_END 后发送下一个文件或结束会话。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @param p_info                下一个文件的信息；为 NULL 时发送空起始帧，应答后产生 XF_YMODEM_NB_EV_END.
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_STATE  当前文件未发送完毕
+ *      - XF_ERR_INVALID_ARG    无效参数
+ *      - XF_FAIL               文件信息无法放入起始帧
+ */
+xf_err_t xf_ymodem_nb_send_next(xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info);
+
+/**
+ * @brief 非阻塞内核: 取消传输，丢弃待发送的字节并排队发送 CAN, 会话结束，不产生事件。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针。
+ * @return xf_err_t 
+ *      - XF_OK                 成功
+ *      - XF_ERR_INVALID_ARG    无效参数
+ */
+xf_err_t xf_ymodem_nb_cancel(xf_ymodem_t *p_ym);
+
+/**
+ * @brief 以阻塞方式驱动非阻塞内核，直到产生一个事件。
+ * 
+ * @note 通过 ops->write 发出所有待发送的字节，再通过 ops->read 读取并喂入，
+ *       读取超时时按 timeout 推进内核的时间; 有 ops->now_ms 时每次读取后按其推进，
+ *       此时 start 的 now_ms 参数须取自 ops->now_ms(). 数据包的剩余部分直接读入 p_buf.
+ *       发送待发送的字节后再返回事件，所以接收端的应答在用户处理数据前已经发出。
+ * 
+ * @param p_ym                  xf_ymodem 对象指针，需要 ops->read, ops->write, ops->flush, ops->delay_ms.
+ * @return xf_ymodem_nb_event_t 事件；会话已结束或在等待用户(如 XF_YMODEM_NB_EV_SEND_READY 后)
+ *                              时为 XF_YMODEM_NB_EV_NONE.
+ * 
+ * @code{c}
+ * xf_ymodem_nb_recv_start(p_ym, &file_info, 0);
+ * while (1) {
+ *     ev = xf_ymodem_nb_run(p_ym);
+ *     if (ev == XF_YMODEM_NB_EV_DATA) {
+ *         xf_ymodem_nb_recv_get_data(p_ym, &p_data, &data_len);
+ *         // 处理数据
+ *     } else if ((ev == XF_YMODEM_NB_EV_END) || (ev == XF_YMODEM_NB_EV_ERROR)) {
+ *         break;
+ *     }
+ * }
+ * @endcode
+ */
+xf_ymodem_nb_event_t xf_ymodem_nb_run(xf_ymodem_t *p_ym);
+
 /* ==================== [Macros] ============================================ */
 
 #ifdef __cplusplus
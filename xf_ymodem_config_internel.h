@@ -34,6 +34,93 @@ extern "C" {
 #define XF_YMODEM_DEBUG_IS_ENABLE (0)
 #endif
 
+#define XF_YMODEM_CRC_BACKEND_BITWISE   (0)     /*!< 逐位计算，ROM 占用最小 */
+#define XF_YMODEM_CRC_BACKEND_TABLE     (1)     /*!< 256 项查表 */
+#define XF_YMODEM_CRC_BACKEND_SLICING4  (2)     /*!< slicing-by-4 */
+#define XF_YMODEM_CRC_BACKEND_SLICING8  (3)     /*!< slicing-by-8 */
+
+#if (!defined(XF_YMODEM_CRC_BACKEND))
+#define XF_YMODEM_CRC_BACKEND_SEL       XF_YMODEM_CRC_BACKEND_TABLE
+#elif ((XF_YMODEM_CRC_BACKEND) == XF_YMODEM_CRC_BACKEND_BITWISE) \
+        || ((XF_YMODEM_CRC_BACKEND) == XF_YMODEM_CRC_BACKEND_TABLE) \
+        || ((XF_YMODEM_CRC_BACKEND) == XF_YMODEM_CRC_BACKEND_SLICING4) \
+        || ((XF_YMODEM_CRC_BACKEND) == XF_YMODEM_CRC_BACKEND_SLICING8)
+#define XF_YMODEM_CRC_BACKEND_SEL       (XF_YMODEM_CRC_BACKEND)
+#else
+#error "XF_YMODEM_CRC_BACKEND: unknown crc16 backend"
+#endif
+
+/* 仅 x86-64 上的 gcc/clang 支持 pclmul 加速 */
+#if ((!defined(XF_YMODEM_CRC_CLMUL_ENABLE) || (XF_YMODEM_CRC_CLMUL_ENABLE)) \
+        && defined(__x86_64__) && defined(__GNUC__))
+#define XF_YMODEM_CRC_CLMUL_IS_ENABLE (1)
+#else
+#define XF_YMODEM_CRC_CLMUL_IS_ENABLE (0)
+#endif
+
+#if (!defined(XF_YMODEM_WINDOW_ENABLE) || (XF_YMODEM_WINDOW_ENABLE) || defined(__DOXYGEN__))
+#define XF_YMODEM_WINDOW_IS_ENABLE (1)
+#else
+#define XF_YMODEM_WINDOW_IS_ENABLE (0)
+#endif
+
+#if (!defined(XF_YMODEM_WINDOW_MAX))
+#define XF_YMODEM_WINDOW_MAX_SEL        (8)
+#elif ((XF_YMODEM_WINDOW_MAX) >= 2) && ((XF_YMODEM_WINDOW_MAX) <= 32)
+#define XF_YMODEM_WINDOW_MAX_SEL        (XF_YMODEM_WINDOW_MAX)
+#else
+#error "XF_YMODEM_WINDOW_MAX: must be in [2, 32]"
+#endif
+
+#if (!defined(XF_YMODEM_RX_CACHE_ENABLE) || (XF_YMODEM_RX_CACHE_ENABLE) || defined(__DOXYGEN__))
+#define XF_YMODEM_RX_CACHE_IS_ENABLE (1)
+#else
+#define XF_YMODEM_RX_CACHE_IS_ENABLE (0)
+#endif
+
+#if (!defined(XF_YMODEM_RX_CACHE_SIZE))
+#define XF_YMODEM_RX_CACHE_SIZE_SEL     (1029)  /*!< 一个 1K 包 */
+#elif ((XF_YMODEM_RX_CACHE_SIZE) >= 16) && ((XF_YMODEM_RX_CACHE_SIZE) <= 65536)
+#define XF_YMODEM_RX_CACHE_SIZE_SEL     (XF_YMODEM_RX_CACHE_SIZE)
+#else
+#error "XF_YMODEM_RX_CACHE_SIZE: must be in [16, 65536]"
+#endif
+
+#if (!defined(XF_YMODEM_STATS_ENABLE) || (XF_YMODEM_STATS_ENABLE) || defined(__DOXYGEN__))
+#define XF_YMODEM_STATS_IS_ENABLE (1)
+#else
+#define XF_YMODEM_STATS_IS_ENABLE (0)
+#endif
+
+#if (!defined(XF_YMODEM_TRACE_ENABLE) || (XF_YMODEM_TRACE_ENABLE) || defined(__DOXYGEN__))
+#define XF_YMODEM_TRACE_IS_ENABLE (1)
+#else
+#define XF_YMODEM_TRACE_IS_ENABLE (0)
+#endif
+
+#if (!defined(XF_YMODEM_TRACE_SIZE))
+#define XF_YMODEM_TRACE_SIZE_SEL        (128)
+#elif ((XF_YMODEM_TRACE_SIZE) >= 16) && ((XF_YMODEM_TRACE_SIZE) <= 65536) \
+        && (((XF_YMODEM_TRACE_SIZE) & ((XF_YMODEM_TRACE_SIZE) - 1)) == 0)
+#define XF_YMODEM_TRACE_SIZE_SEL        (XF_YMODEM_TRACE_SIZE)
+#else
+#error "XF_YMODEM_TRACE_SIZE: must be a power of 2 in [16, 65536]"
+#endif
+
+#if (!defined(XF_YMODEM_RTO_ENABLE) || (XF_YMODEM_RTO_ENABLE) || defined(__DOXYGEN__))
+#define XF_YMODEM_RTO_IS_ENABLE (1)
+#else
+#define XF_YMODEM_RTO_IS_ENABLE (0)
+#endif
+
+#if (!defined(XF_YMODEM_RTO_MIN_MS))
+#define XF_YMODEM_RTO_MIN_MS_SEL        (20)
+#elif ((XF_YMODEM_RTO_MIN_MS) >= 1) && ((XF_YMODEM_RTO_MIN_MS) <= 60000)
+#define XF_YMODEM_RTO_MIN_MS_SEL        (XF_YMODEM_RTO_MIN_MS)
+#else
+#error "XF_YMODEM_RTO_MIN_MS: must be in [1, 60000]"
+#endif
+
 /* ==================== [Typedefs] ========================================== */
 
 /* ==================== [Global Prototypes] ================================= */
@@ -17,19 +17,56 @@
 #include "xf_utils.h"
 #include "xf_ymodem_types.h"
 
+#if XF_YMODEM_STATS_IS_ENABLE || XF_YMODEM_TRACE_IS_ENABLE || XF_YMODEM_RTO_IS_ENABLE
+#include "xf_sys.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* ==================== [Defines] =========================================== */
 
+#if XF_YMODEM_WINDOW_IS_ENABLE
+/* 起始帧中文件长度之后的扩展字段: "xfym w=<窗口大小>" */
+#   define XF_YMODEM_WINDOW_TAG         "xfym w="
+#   define XF_YMODEM_WIN_SIZE(p_ym)     ((p_ym)->win_size)
+#else
+#   define XF_YMODEM_WIN_SIZE(p_ym)     (0)
+#endif
+
+/* 起始帧中文件长度之后的扩展字段: "xfym f=<最大数据段长>" */
+#define XF_YMODEM_FRAME_TAG             "xfym f="
+
+/* 自适应包长: 连续多少包无 NAK 应答后增大一档包长 */
+#define XF_YMODEM_ADAPT_INC_ACKS        (8)
+/* 自适应包长: 初始档位(1K) */
+#define XF_YMODEM_ADAPT_LVL_INIT        (1)
+
+#if XF_YMODEM_STATS_IS_ENABLE || XF_YMODEM_TRACE_IS_ENABLE || XF_YMODEM_RTO_IS_ENABLE
+/* 没有 ops->now_ms 时，统计及自适应等待的往返时间、跟踪事件时间戳使用的时钟(us)，可以在编译选项中替换 */
+#   if !defined(XF_YMODEM_NOW_US)
+#       define XF_YMODEM_NOW_US()               ((uint32_t)xf_sys_time_get_us())
+#   endif
+#endif
+
+/* 接收端请求非标包长: F + 包头 + 反码(+ 扩展包以 1K 为单位的包长 + 反码) */
+#define XF_YMODEM_FRAME_REQ_SIZE        (5)
+
 /* ==================== [Typedefs] ========================================== */
 
 /* ==================== [Global Prototypes] ================================= */
 
 /* 以下是内部接口，用户通常不需要使用 */
 
+/* 使用 XF_YMODEM_CRC_BACKEND 选择的实现计算 crc16 */
 uint16_t xf_ymodem_crc16(uint16_t crc_start, const uint8_t *buf, uint32_t len);
+/* 逐位计算的参考实现，任何配置下均可用，用于校验其他实现 */
+uint16_t xf_ymodem_crc16_bitwise(uint16_t crc_start, const uint8_t *buf, uint32_t len);
+#if XF_YMODEM_CRC_CLMUL_IS_ENABLE
+/* 当前 cpu 是否支持 pclmul 加速(支持时 xf_ymodem_crc16 对长数据自动使用) */
+bool xf_ymodem_crc16_clmul_is_supported(void);
+#endif
 
 bool xf_ymodem_is_hex(char ch);
 uint32_t xf_ymodem_convert_hex(char ch);
@@ -40,50 +77,189 @@ xf_err_t xf_ymodem_str_to_u32(
 xf_err_t xf_ymodem_u32_to_str(
     uint32_t u32_val, uint32_t radix,
     uint8_t *p_buf, uint32_t buf_size, uint32_t *p_len);
-xf_err_t xf_ymodem_show_packet(uint8_t *packet, uint32_t packet_size);
-
-xf_err_t xf_ymodem_putc(xf_ymodem_t *p_ym, uint8_t ch);
 
+/* 校验包号及 crc, 数据段的 crc 需要已累计在 p_ym->crc16 中 */
 xf_err_t xf_ymodem_check_packet(xf_ymodem_t *p_ym);
 xf_err_t xf_ymodem_recv_check_packet_header(xf_ymodem_t *p_ym);
+/* 解析扩展包的数据段长，设置 p_ym->data_len 并以此作为 crc 起始 */
+xf_err_t xf_ymodem_recv_ext_len_parse(xf_ymodem_t *p_ym, const uint8_t *p_buf);
+/*
+    快速重新同步: 丢弃 p_pkt 中不可能是等待中的包(见 xf_ymodem_recv_pn_expected())开头的字节，
+    返回候选包还需要接收的字节数，为 0 时 p_pkt 以包头、(扩展包数据段长、)包号及反码开始。
+    滑动窗口收到错位的包头时也用它重新对齐。
+ */
+uint32_t xf_ymodem_recv_scan(xf_ymodem_t *p_ym);
+/* 包号是否可能是正在等待的包，或应答丢失后重发的已交付的包 */
+bool xf_ymodem_recv_pn_expected(xf_ymodem_t *p_ym, uint8_t pn);
 
+/* 丢弃线路上(及读缓存中)的残留数据，用于出错后重新同步 */
 xf_err_t xf_ymodem_flush_read(xf_ymodem_t *p_ym);
+/* 所有读取的入口，返回值同 xf_ymodem_ops_t.read; 启用读缓存时从缓存中取出 */
+int32_t xf_ymodem_read(
+    xf_ymodem_t *p_ym, uint8_t *p_dst, uint32_t size, uint32_t timeout_ms);
+/* 一次操作(收一包、等一个应答)的时限: timeout_ms * (retry_num + 1), 另加最大的包在线路上的发送时间 */
+uint32_t xf_ymodem_budget_ms(xf_ymodem_t *p_ym);
 
-xf_err_t xf_ymodem_recv_get_packet(xf_ymodem_t *p_ym);
-
-xf_err_t xf_ymodem_recv_request_file_info(xf_ymodem_t *p_ym);
 xf_err_t xf_ymodem_parse_file_info(
     xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info);
 
-xf_err_t xf_ymodem_recv_get_file_data(xf_ymodem_t *p_ym);
-
-/* 获取数据指针(p_ym->p_buf + offset_internal)，减少一次拷贝 */
-xf_err_t xf_ymodem_recv_get_data_ptr(
-    xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size);
-
-xf_err_t xf_ymodem_recv_end(xf_ymodem_t *p_ym);
+/* 是否为早应答 + 双缓冲接收 */
+bool xf_ymodem_recv_is_double_buf(xf_ymodem_t *p_ym);
+/* 选择本次接收使用的缓冲区(p_ym->p_pkt)，两个缓冲区均被用户持有时返回 XF_ERR_BUSY */
+xf_err_t xf_ymodem_recv_select_buf(xf_ymodem_t *p_ym);
 
 /* send */
 
-xf_err_t xf_ymodem_getc(xf_ymodem_t *p_ym, uint8_t *p_ch);
-
-xf_err_t xf_ymodem_send_packet(xf_ymodem_t *p_ym);
+/* 扩展包数据段长字段(大端) */
+void xf_ymodem_ext_len_to_bytes(uint32_t data_len, uint8_t *p_buf);
+uint32_t xf_ymodem_ext_len_from_bytes(const uint8_t *p_buf);
 
 xf_err_t xf_ymodem_send_get_packet_data_len(
     xf_ymodem_t *p_ym, uint32_t *p_data_len);
+/* 本端 buf_size 及协商结果允许的最大数据段长 */
+uint32_t xf_ymodem_send_data_len_max(xf_ymodem_t *p_ym);
 
 xf_err_t xf_ymodem_send_regular_packet_data(
     xf_ymodem_t *p_ym, uint32_t data_len);
 
-xf_err_t xf_ymodem_send_packet(xf_ymodem_t *p_ym);
-
 xf_err_t xf_ymodem_send_prepare_packet_protocol_segment(xf_ymodem_t *p_ym);
 
+/* 自适应包长: 按一次应答(is_nak 为 true 时是 NAK)调整 p_ym->frame_lvl */
+void xf_ymodem_send_adapt(xf_ymodem_t *p_ym, bool is_nak);
+
+/* 是否为流水发送 */
+bool xf_ymodem_send_is_pipeline(xf_ymodem_t *p_ym);
+
+#if XF_YMODEM_WINDOW_IS_ENABLE
+/* window */
+
+/* 本端 p_buf 可容纳的窗口大小，不足 2 时返回 0 */
+uint8_t xf_ymodem_window_max(xf_ymodem_t *p_ym, bool is_recv);
+/* 窗口中第 slot 个槽 */
+uint8_t *xf_ymodem_window_slot(xf_ymodem_t *p_ym, uint32_t slot);
+
+/* 解析起始帧中的窗口扩展字段，*p_buf_idx 跳过该字段 */
+xf_err_t xf_ymodem_recv_window_parse(xf_ymodem_t *p_ym, uint32_t *p_buf_idx);
+
+/* 在起始帧中填充窗口扩展字段 */
+xf_err_t xf_ymodem_send_window_prepare(xf_ymodem_t *p_ym, uint32_t *p_buf_idx);
+/* 收到接收端的 W + 窗口大小 + 反码后初始化窗口 */
+xf_err_t xf_ymodem_send_window_init(xf_ymodem_t *p_ym, uint8_t win, uint8_t nwin);
+#endif
+
+/* large frame */
+
+/* 本端 buf_size 可容纳的非标包最大档位(见 xf_ymodem_t.frame_lvl)，不足 2K 时返回 0 */
+uint8_t xf_ymodem_frame_lvl_max(xf_ymodem_t *p_ym);
+/* 解析起始帧中的包长扩展字段，*p_buf_idx 跳过该字段 */
+xf_err_t xf_ymodem_recv_frame_parse(xf_ymodem_t *p_ym, uint32_t *p_buf_idx);
+/* 接收端: 在 p_req 中填充请求非标包长的 F 序列(最多 XF_YMODEM_FRAME_REQ_SIZE 字节)，返回长度，不需要时为 0 */
+uint32_t xf_ymodem_recv_frame_req(xf_ymodem_t *p_ym, uint8_t *p_req);
+/* 在起始帧中填充包长扩展字段 */
+xf_err_t xf_ymodem_send_frame_prepare(xf_ymodem_t *p_ym, uint32_t *p_buf_idx);
+/* 收到接收端的 F 及其后最大包长的包头(扩展包还有以 1K 为单位的包长)后设置 p_ym->frame_max */
+xf_err_t xf_ymodem_send_frame_init(xf_ymodem_t *p_ym, const uint8_t *p_hdr);
+
 xf_err_t xf_ymodem_prepare_file_info(
     xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info);
 
+/* nb: 阻塞接口(xf_ymodem_recv_*()/xf_ymodem_send_*())经由以下入口驱动非阻塞内核，blocking 为 true */
+
+/* 开始接收会话，请求第一个文件的起始帧 */
+void xf_ymodem_nb_recv_begin(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, bool blocking);
+/* 批量传输: 解析已收到的下一个文件的起始帧并开始接收其数据 */
+xf_err_t xf_ymodem_nb_recv_accept(xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info);
+/* 起始帧已交付，请求文件数据(C 或 G, 以及 F/W 协商) */
+void xf_ymodem_nb_recv_request(xf_ymodem_t *p_ym);
+/* 用户取走了上一包(或上一个事件)，继续收发 */
+void xf_ymodem_nb_resume(xf_ymodem_t *p_ym);
+/* 开始发送会话(或批量传输的下一个文件)，等待请求字符后发送起始帧 */
+xf_err_t xf_ymodem_nb_send_begin(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, bool blocking);
+/* 发送 p_pkt 中已填充 nb_data_len 字节数据的包 */
+void xf_ymodem_nb_send_packet(xf_ymodem_t *p_ym);
+
+#if XF_YMODEM_STATS_IS_ENABLE
+/* stats */
+
+/* 按数据段长所属的包长档位计数一个包，p_frames 为 stats.tx_frames 或 stats.rx_frames */
+void xf_ymodem_stats_frame(uint32_t *p_frames, uint32_t data_len);
+/* 等待应答的包已发出 */
+void xf_ymodem_stats_rtt_start(xf_ymodem_t *p_ym);
+/* 收到应答，记录往返时间 */
+void xf_ymodem_stats_rtt_end(xf_ymodem_t *p_ym);
+#endif
+
+#if XF_YMODEM_STATS_IS_ENABLE || XF_YMODEM_TRACE_IS_ENABLE || XF_YMODEM_RTO_IS_ENABLE
+/* 会话的时钟(us): 有 ops->now_ms 时取自它(精度为 ms)，否则为 XF_YMODEM_NOW_US() */
+uint32_t xf_ymodem_now_us(const xf_ymodem_t *p_ym);
+#endif
+
+#if XF_YMODEM_TRACE_IS_ENABLE
+/* trace */
+
+/* 写入一个事件，p_ym->state 与上次记录的不同时先写入 XF_YMODEM_TRACE_STATE */
+void xf_ymodem_trace_put(
+    xf_ymodem_t *p_ym, uint8_t type, uint8_t a, uint8_t b, uint32_t arg);
+#endif
+
+#if XF_YMODEM_RTO_IS_ENABLE
+/* rto */
+
+/* 已发出 len 字节，之后收到的第一个字节是对它的回应 */
+void xf_ymodem_rto_sent(xf_ymodem_t *p_ym, uint32_t len);
+/* 收到回应，以发出到收到的时间更新平滑往返时间 */
+void xf_ymodem_rto_answered(xf_ymodem_t *p_ym);
+/* 等待 len 字节(及在途的已发出字节)的时间(ms) */
+uint32_t xf_ymodem_rto_wait_ms(xf_ymodem_t *p_ym, uint32_t len);
+/* 出错后等待对方发完最多 len 字节的剩余部分的时间(ms)，需要 baudrate */
+uint32_t xf_ymodem_rto_drain_ms(xf_ymodem_t *p_ym, uint32_t len);
+/* 等待超时: 加倍之后的等待时间；返回此次超时是否计入重试次数 */
+bool xf_ymodem_rto_timeout(xf_ymodem_t *p_ym);
+#endif
+
 /* ==================== [Macros] ============================================ */
 
+/* 统计，关闭 XF_YMODEM_STATS_ENABLE 时不产生任何代码 */
+#if XF_YMODEM_STATS_IS_ENABLE
+#   define XF_YMODEM_STAT_ADD(p_ym, field, n)   ((p_ym)->stats.field += (uint32_t)(n))
+#   define XF_YMODEM_STAT_INC(p_ym, field)      ((p_ym)->stats.field++)
+#   define XF_YMODEM_STAT_FRAME(p_ym, field, data_len) \
+                                                xf_ymodem_stats_frame((p_ym)->stats.field, (data_len))
+#   define XF_YMODEM_STAT_RTT_START(p_ym)       xf_ymodem_stats_rtt_start(p_ym)
+#   define XF_YMODEM_STAT_RTT_END(p_ym)         xf_ymodem_stats_rtt_end(p_ym)
+#else
+#   define XF_YMODEM_STAT_ADD(p_ym, field, n)   ((void)0)
+#   define XF_YMODEM_STAT_INC(p_ym, field)      ((void)0)
+#   define XF_YMODEM_STAT_FRAME(p_ym, field, data_len) ((void)0)
+#   define XF_YMODEM_STAT_RTT_START(p_ym)       ((void)0)
+#   define XF_YMODEM_STAT_RTT_END(p_ym)         ((void)0)
+#endif
+
+/* 跟踪，关闭 XF_YMODEM_TRACE_ENABLE 时不产生任何代码 */
+#if XF_YMODEM_TRACE_IS_ENABLE
+#   define XF_YMODEM_TRACE(p_ym, type, a, b, arg) \
+        xf_ymodem_trace_put((p_ym), (uint8_t)(type), (uint8_t)(a), (uint8_t)(b), (uint32_t)(arg))
+#else
+#   define XF_YMODEM_TRACE(p_ym, type, a, b, arg) ((void)0)
+#endif
+
+/* 自适应等待，关闭 XF_YMODEM_RTO_ENABLE 时总是等待 timeout_ms, 每次超时都计入重试次数 */
+#if XF_YMODEM_RTO_IS_ENABLE
+#   define XF_YMODEM_RTO_SENT(p_ym, len)        xf_ymodem_rto_sent((p_ym), (uint32_t)(len))
+#   define XF_YMODEM_RTO_ANSWERED(p_ym)         xf_ymodem_rto_answered(p_ym)
+#   define XF_YMODEM_RTO_WAIT_MS(p_ym, len)     xf_ymodem_rto_wait_ms((p_ym), (uint32_t)(len))
+#   define XF_YMODEM_RTO_DRAIN_MS(p_ym, len)    xf_ymodem_rto_drain_ms((p_ym), (uint32_t)(len))
+#   define XF_YMODEM_RTO_TIMEOUT(p_ym)          xf_ymodem_rto_timeout(p_ym)
+#else
+#   define XF_YMODEM_RTO_SENT(p_ym, len)        ((void)0)
+#   define XF_YMODEM_RTO_ANSWERED(p_ym)         ((void)0)
+#   define XF_YMODEM_RTO_WAIT_MS(p_ym, len)     ((void)(len), (p_ym)->timeout_ms)
+#   define XF_YMODEM_RTO_DRAIN_MS(p_ym, len)    ((void)(len), (p_ym)->timeout_ms)
+#   define XF_YMODEM_RTO_TIMEOUT(p_ym)          (true)
+#endif
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,2531 @@
+/**
+ * @file xf_ymodem_nb.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem 非阻塞内核(喂入字节、取出待发送字节及事件、由用户时钟驱动超时)。
+ *        阻塞接口(xf_ymodem_recv_data() 等)也由 xf_ymodem_nb_run() 驱动本内核。
+ * @version 1.0
+ * @date 2025-01-02
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_ymodem.h"
+#include "xf_ymodem_internel.h"
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_YMODEM_NB_CAN_SEND_NUM       (5)     /*!< 取消时发送的 CAN 个数 */
+
+/* ==================== [Typedefs] ========================================== */
+
+/* xf_ymodem_t.nb_wait: 等待对方的输入 */
+typedef enum _xf_ymodem_nb_wait_t {
+    XF_YMODEM_NB_WAIT_NONE = 0,                 /*!< 不等待对方(等待用户，或会话已结束) */
+    XF_YMODEM_NB_WAIT_PKT,                      /*!< 接收端: 等待数据包或 EOT */
+    XF_YMODEM_NB_WAIT_DRAIN,                    /*!< 接收端: 出错后等待发送端发完本包，之后 NAK */
+    XF_YMODEM_NB_WAIT_GETC,                     /*!< 发送端: 等待请求字符或应答 */
+    XF_YMODEM_NB_WAIT_WIN,                      /*!< 发送端: 滑动窗口已满，等待应答 */
+} xf_ymodem_nb_wait_t;
+
+/* xf_ymodem_t.nb_rx_ph: 接收端当前包的阶段 */
+typedef enum _xf_ymodem_nb_rx_ph_t {
+    XF_YMODEM_NB_RX_HEADER = 0,                 /*!< 等待包头(快速重新同步时在数据流中查找) */
+    XF_YMODEM_NB_RX_CAN,                        /*!< 收到一个 CAN, 等待第二个 */
+    XF_YMODEM_NB_RX_EXT,                        /*!< 扩展包的数据段长 */
+    XF_YMODEM_NB_RX_BODY,                       /*!< 包号及之后的部分 */
+} xf_ymodem_nb_rx_ph_t;
+
+/* xf_ymodem_nb_seg_t.type: 发出后的处理 */
+typedef enum _xf_ymodem_nb_seg_type_t {
+    XF_YMODEM_NB_SEG_CTL = 0,                   /*!< 控制字符，发出后开始计算等待回应的时间 */
+    XF_YMODEM_NB_SEG_PN,                        /*!< 滑动窗口接收端的应答 + 包号 + 反码 */
+    XF_YMODEM_NB_SEG_PKT,                       /*!< 数据包，发出后开始计算往返时间 */
+    XF_YMODEM_NB_SEG_RESEND,                    /*!< 滑动窗口重发的数据包 */
+    XF_YMODEM_NB_SEG_EXT_HDR,                   /*!< 扩展包的包头 + 数据段长 */
+    XF_YMODEM_NB_SEG_FLUSH,                     /*!< 丢弃线路上的残留数据，
+                                                 *   只由 xf_ymodem_nb_run() 执行 */
+} xf_ymodem_nb_seg_type_t;
+
+/* ==================== [Static Prototypes] ================================= */
+
+static void xf_ymodem_nb_reset(xf_ymodem_t *p_ym, uint32_t now_ms);
+static void xf_ymodem_nb_clear(xf_ymodem_t *p_ym, bool blocking);
+static uint32_t xf_ymodem_nb_feed_bytes(xf_ymodem_t *p_ym, const uint8_t *p_src, uint32_t size);
+static bool xf_ymodem_nb_is_recv(xf_ymodem_t *p_ym);
+static bool xf_ymodem_nb_is_busy(xf_ymodem_t *p_ym);
+static bool xf_ymodem_nb_is_held(xf_ymodem_t *p_ym);
+static bool xf_ymodem_nb_limit_reached(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_arm(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_event(xf_ymodem_t *p_ym, uint8_t ev);
+static void xf_ymodem_nb_fail(xf_ymodem_t *p_ym, xf_ymodem_err_t error_code, bool send_can);
+static void xf_ymodem_nb_cancelled(xf_ymodem_t *p_ym);
+
+static xf_ymodem_nb_seg_t *xf_ymodem_nb_seg_head(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_seg_put(
+    xf_ymodem_t *p_ym, const uint8_t *p_data, uint32_t len, uint8_t type);
+static void xf_ymodem_nb_seg_copy(
+    xf_ymodem_t *p_ym, const uint8_t *p_data, uint32_t len, uint8_t type);
+static void xf_ymodem_nb_seg_done(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_putc(xf_ymodem_t *p_ym, uint8_t ch);
+static void xf_ymodem_nb_put_packet(
+    xf_ymodem_t *p_ym, const uint8_t *p_packet, uint32_t packet_len, uint8_t type);
+static void xf_ymodem_nb_flush(xf_ymodem_t *p_ym);
+
+static void xf_ymodem_nb_recv_request_info(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_wait(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_restart(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_rearm(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_data_seen(xf_ymodem_t *p_ym);
+static uint32_t xf_ymodem_nb_recv_feed(xf_ymodem_t *p_ym, const uint8_t *p_src, uint32_t size);
+static void xf_ymodem_nb_recv_eot(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_header(xf_ymodem_t *p_ym, bool ext_ready);
+static void xf_ymodem_nb_recv_body(xf_ymodem_t *p_ym, uint32_t old_len);
+static void xf_ymodem_nb_recv_packet(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_timeout(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_round_end(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_error(xf_ymodem_t *p_ym, xf_err_t xf_ret);
+static void xf_ymodem_nb_recv_drained(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_exit(xf_ymodem_t *p_ym, xf_err_t xf_ret);
+static void xf_ymodem_nb_recv_round(xf_ymodem_t *p_ym, xf_err_t xf_ret);
+static void xf_ymodem_nb_recv_got(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_deliver(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_eot_done(xf_ymodem_t *p_ym);
+#if XF_YMODEM_WINDOW_IS_ENABLE
+static void xf_ymodem_nb_putc_pn(xf_ymodem_t *p_ym, uint8_t ch, uint8_t pn);
+static void xf_ymodem_nb_recv_window_next(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_recv_window_got(xf_ymodem_t *p_ym, xf_err_t xf_ret);
+#endif
+
+static xf_err_t xf_ymodem_nb_send_file_info(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_getc(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_wait_ack(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_ready(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_ch(xf_ymodem_t *p_ym, uint8_t ch);
+static void xf_ymodem_nb_send_collect(xf_ymodem_t *p_ym, uint8_t ch, uint8_t need);
+static void xf_ymodem_nb_send_collected(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_answer(xf_ymodem_t *p_ym, uint8_t ch);
+static void xf_ymodem_nb_send_info_answer(xf_ymodem_t *p_ym, uint8_t ch);
+static void xf_ymodem_nb_send_data_answer(xf_ymodem_t *p_ym, uint8_t ch);
+static void xf_ymodem_nb_send_eot_answer(xf_ymodem_t *p_ym, uint8_t ch);
+static void xf_ymodem_nb_send_getc_timeout(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_getc_idle(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_pipe(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_account(xf_ymodem_t *p_ym);
+static bool xf_ymodem_nb_send_is_done(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_eot_start(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_eot(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_file_end(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_end(xf_ymodem_t *p_ym);
+#if XF_YMODEM_WINDOW_IS_ENABLE
+static void xf_ymodem_nb_send_window_after(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_window_next(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_window_ch(xf_ymodem_t *p_ym, uint8_t ch);
+static void xf_ymodem_nb_send_window_answer(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_window_timeout(xf_ymodem_t *p_ym);
+static void xf_ymodem_nb_send_window_resend(xf_ymodem_t *p_ym, uint32_t cnt);
+#endif
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_nb";
+
+/* ==================== [Macros] ============================================ */
+
+#if XF_YMODEM_DEBUG_IS_ENABLE
+#   define YM_LOGD(tag, format, ...)    xf_log_printf("%s[%s:%d(%s)]: " format "\r\n", tag, __FILE__, __LINE__, __func__, ##__VA_ARGS__)
+#else
+#   define YM_LOGD(tag, format, ...)
+#endif /* XF_YMODEM_DEBUG_IS_ENABLE */
+
+#if !defined(min)
+#   define min(x, y)                (((x) < (y)) ? (x) : (y))
+#endif
+
+#if !defined(xf_memmove)
+#   define xf_memmove(d, s, len)    memmove(d, s, len)
+#endif
+
+/* 时间允许回绕: a 是否不早于 b */
+#define XF_YMODEM_NB_TIME_AFTER_EQ(a, b)    ((int32_t)((uint32_t)(a) - (uint32_t)(b)) >= 0)
+
+/* 是否有待发送的字节 */
+#define XF_YMODEM_NB_TX_PENDING(p_ym)       ((p_ym)->nb_seg_rd != (p_ym)->nb_seg_wr)
+
+/* ==================== [Global Functions] ================================== */
+
+xf_err_t xf_ymodem_nb_recv_start(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, uint32_t now_ms)
+{
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_info, XF_ERR_INVALID_ARG,
+             TAG, "p_info:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((NULL == p_ym->p_buf) || (p_ym->buf_size < XF_YMODEM_SOH_PACKET_SIZE),
+             XF_ERR_INVALID_ARG,
+             TAG, "p_ym->p_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    xf_ymodem_nb_reset(p_ym, now_ms);
+    xf_ymodem_nb_recv_begin(p_ym, p_info, false);
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_nb_send_start(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, uint32_t now_ms)
+{
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_info, XF_ERR_INVALID_ARG,
+             TAG, "p_info:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((NULL == p_ym->p_buf) || (p_ym->buf_size < XF_YMODEM_SOH_PACKET_SIZE),
+             XF_ERR_INVALID_ARG,
+             TAG, "p_ym->p_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    xf_ymodem_nb_reset(p_ym, now_ms);
+    xf_ymodem_nb_send_begin(p_ym, p_info, false);
+
+    return XF_OK;
+}
+
+uint32_t xf_ymodem_nb_feed(xf_ymodem_t *p_ym, const uint8_t *p_src, uint32_t size)
+{
+    uint32_t    len             = 0;
+
+    if ((NULL == p_ym) || (NULL == p_src)) {
+        return 0;
+    }
+
+    len = xf_ymodem_nb_feed_bytes(p_ym, p_src, size);
+    if (len > 0) {
+        XF_YMODEM_STAT_ADD(p_ym, rx_bytes, len);
+        XF_YMODEM_RTO_ANSWERED(p_ym);
+    }
+
+    return len;
+}
+
+uint32_t xf_ymodem_nb_rx_buf(xf_ymodem_t *p_ym, uint8_t **pp_buf)
+{
+    if ((NULL == p_ym) || (NULL == pp_buf) || xf_ymodem_nb_is_busy(p_ym)) {
+        return 0;
+    }
+
+    if (!xf_ymodem_nb_is_recv(p_ym)) {
+        /* 发送端: F 或 W 之后的参数，滑动窗口应答的包号及反码 */
+        if ((p_ym->nb_hs_need == 0) || (p_ym->nb_hs[0] == XF_YMODEM_F)) {
+            return 0;
+        }
+        *pp_buf = &p_ym->nb_hs[p_ym->nb_hs_len];
+        return p_ym->nb_hs_need - p_ym->nb_hs_len;
+    }
+
+    if (p_ym->nb_wait != XF_YMODEM_NB_WAIT_PKT) {
+        return 0;
+    }
+    if (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_EXT) {
+        *pp_buf = &p_ym->nb_ext[p_ym->nb_hs_len];
+        return XF_YMODEM_EXT_LEN_SIZE - p_ym->nb_hs_len;
+    }
+    if ((p_ym->nb_scan) || (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_BODY)) {
+        *pp_buf = &p_ym->p_pkt[p_ym->packet_len];
+        return p_ym->nb_rx_len - p_ym->packet_len;
+    }
+
+    return 0;
+}
+
+uint32_t xf_ymodem_nb_tx_peek(xf_ymodem_t *p_ym, const uint8_t **pp_data)
+{
+    xf_ymodem_nb_seg_t *p_seg   = NULL;
+
+    if ((NULL == p_ym) || (NULL == pp_data)) {
+        return 0;
+    }
+
+    /* 用户自己管理线路，丢弃残留数据的标记直接跳过 */
+    while (((p_seg = xf_ymodem_nb_seg_head(p_ym)) != NULL)
+            && (p_seg->type == XF_YMODEM_NB_SEG_FLUSH)) {
+        xf_ymodem_nb_seg_done(p_ym);
+    }
+    if (NULL == p_seg) {
+        return 0;
+    }
+
+    *pp_data = &p_seg->p_data[p_ym->nb_seg_off];
+    return p_seg->len - p_ym->nb_seg_off;
+}
+
+void xf_ymodem_nb_tx_consume(xf_ymodem_t *p_ym, uint32_t size)
+{
+    xf_ymodem_nb_seg_t *p_seg   = NULL;
+    uint32_t    len             = 0;
+
+    if (NULL == p_ym) {
+        return;
+    }
+
+    while ((size > 0) && ((p_seg = xf_ymodem_nb_seg_head(p_ym)) != NULL)) {
+        if (p_seg->type == XF_YMODEM_NB_SEG_FLUSH) {
+            xf_ymodem_nb_seg_done(p_ym);
+            continue;
+        }
+        len                 = min(size, p_seg->len - p_ym->nb_seg_off);
+        p_ym->nb_seg_off   += len;
+        size               -= len;
+        XF_YMODEM_STAT_ADD(p_ym, tx_bytes, len);
+        if (p_ym->nb_seg_off < p_seg->len) {
+            break;
+        }
+        xf_ymodem_nb_seg_done(p_ym);
+    }
+}
+
+xf_ymodem_nb_event_t xf_ymodem_nb_poll(xf_ymodem_t *p_ym)
+{
+    xf_ymodem_nb_event_t ev = XF_YMODEM_NB_EV_NONE;
+
+    /* 事件在之前排队的字节全部发出后才交给用户 */
+    if ((NULL == p_ym) || XF_YMODEM_NB_TX_PENDING(p_ym)) {
+        return ev;
+    }
+
+    ev = (xf_ymodem_nb_event_t)p_ym->nb_event;
+    p_ym->nb_event = XF_YMODEM_NB_EV_NONE;
+
+    return ev;
+}
+
+void xf_ymodem_nb_tick(xf_ymodem_t *p_ym, uint32_t now_ms)
+{
+    if (NULL == p_ym) {
+        return;
+    }
+
+    p_ym->nb_now = now_ms;
+
+    if (xf_ymodem_nb_is_held(p_ym) && !xf_ymodem_nb_is_busy(p_ym)) {
+        xf_ymodem_nb_resume(p_ym);
+    }
+
+    /* 有未发出的字节或未取出的事件时，超时由用户造成，不计入重试 */
+    if (!p_ym->nb_armed || xf_ymodem_nb_is_busy(p_ym)
+            || !XF_YMODEM_NB_TIME_AFTER_EQ(now_ms, p_ym->nb_deadline)) {
+        return;
+    }
+    p_ym->nb_armed = false;
+
+    switch (p_ym->nb_wait) {
+    case XF_YMODEM_NB_WAIT_PKT: {
+        xf_ymodem_nb_recv_timeout(p_ym);
+    } break;
+    case XF_YMODEM_NB_WAIT_DRAIN: {
+        xf_ymodem_nb_recv_drained(p_ym);
+    } break;
+    case XF_YMODEM_NB_WAIT_GETC: {
+        xf_ymodem_nb_send_getc_timeout(p_ym);
+    } break;
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    case XF_YMODEM_NB_WAIT_WIN: {
+        xf_ymodem_nb_send_window_timeout(p_ym);
+    } break;
+#endif
+    default: {
+    } break;
+    }
+}
+
+uint32_t xf_ymodem_nb_timeout(xf_ymodem_t *p_ym)
+{
+    if (NULL == p_ym) {
+        return XF_YMODEM_NB_WAIT_FOREVER;
+    }
+    if (xf_ymodem_nb_is_held(p_ym)) {
+        /* 交付的数据已取出，下一次 xf_ymodem_nb_tick() 继续接收 */
+        return 0;
+    }
+    if (!p_ym->nb_armed) {
+        return XF_YMODEM_NB_WAIT_FOREVER;
+    }
+    if (XF_YMODEM_NB_TIME_AFTER_EQ(p_ym->nb_now, p_ym->nb_deadline)) {
+        return 0;
+    }
+
+    return p_ym->nb_deadline - p_ym->nb_now;
+}
+
+xf_err_t xf_ymodem_nb_recv_get_data(
+    xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size)
+{
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == pp_data_buf, XF_ERR_INVALID_ARG,
+             TAG, "pp_data_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_buf_size, XF_ERR_INVALID_ARG,
+             TAG, "p_buf_size:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    *pp_data_buf    = &p_ym->p_pkt[XF_YMODEM_DATA_IDX];
+    *p_buf_size     = p_ym->nb_data_len;
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_nb_send_get_buf(
+    xf_ymodem_t *p_ym, uint8_t **pp_data_buf, uint32_t *p_buf_size)
+{
+    xf_err_t    xf_ret          = XF_OK;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == pp_data_buf, XF_ERR_INVALID_ARG,
+             TAG, "pp_data_buf:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(NULL == p_buf_size, XF_ERR_INVALID_ARG,
+             TAG, "p_buf_size:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(!p_ym->nb_ready, XF_ERR_INVALID_STATE,
+             TAG, "p_ym->state:%d", (int)p_ym->state);
+
+    *pp_data_buf = &p_ym->p_pkt[XF_YMODEM_DATA_IDX];
+
+    xf_ret = xf_ymodem_send_get_packet_data_len(p_ym, p_buf_size);
+    p_ym->nb_data_len = *p_buf_size;
+
+    return xf_ret;
+}
+
+xf_err_t xf_ymodem_nb_send_commit(xf_ymodem_t *p_ym)
+{
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((!p_ym->nb_ready) || (p_ym->nb_data_len == 0), XF_ERR_INVALID_STATE,
+             TAG, "p_ym->state:%d", (int)p_ym->state);
+
+    xf_ymodem_nb_send_packet(p_ym);
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_nb_send_next(xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info)
+{
+    uint8_t     ch              = 0;
+
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK(p_ym->state != XF_YMODEM_SEND_FILE_END, XF_ERR_INVALID_STATE,
+             TAG, "p_ym->state:%d", (int)p_ym->state);
+
+    if (p_info != NULL) {
+        return xf_ymodem_nb_send_begin(p_ym, p_info, p_ym->nb_blocking);
+    }
+
+    /* 等待 C 后发送空起始帧，C 可能已经在 XF_YMODEM_SEND_FILE_END 时收到 */
+    ch          = p_ym->nb_step;
+    p_ym->p_pkt = p_ym->p_buf;
+    p_ym->state = XF_YMODEM_SEND_NULL_FILE_INFO;
+    xf_ymodem_nb_send_eot_start(p_ym);
+    if (ch != 0) {
+        xf_ymodem_nb_send_answer(p_ym, ch);
+    }
+
+    return XF_OK;
+}
+
+xf_err_t xf_ymodem_nb_cancel(xf_ymodem_t *p_ym)
+{
+    XF_CHECK(NULL == p_ym, XF_ERR_INVALID_ARG,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_CAN, true);
+    p_ym->nb_event = XF_YMODEM_NB_EV_NONE;
+
+    return XF_OK;
+}
+
+xf_ymodem_nb_event_t xf_ymodem_nb_run(xf_ymodem_t *p_ym)
+{
+    xf_ymodem_nb_event_t ev = XF_YMODEM_NB_EV_NONE;
+    xf_ymodem_nb_seg_t *p_seg       = NULL;
+    uint8_t        *p_rx            = NULL;
+    uint8_t         ch              = 0;
+    uint8_t         drained         = false; /*!< 已取出发出本包前到达的应答 */
+    uint32_t        len             = 0;
+    uint32_t        wait_ms         = 0;
+    int32_t         rwlen           = 0;
+
+    XF_CHECK(NULL == p_ym, XF_YMODEM_NB_EV_NONE,
+             TAG, "p_ym:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+    XF_CHECK((NULL == p_ym->ops) || (NULL == p_ym->ops->read) || (NULL == p_ym->ops->write)
+             || (NULL == p_ym->ops->flush) || (NULL == p_ym->ops->delay_ms),
+             XF_YMODEM_NB_EV_NONE,
+             TAG, "p_ym->ops:%s", xf_err_to_name(XF_ERR_INVALID_ARG));
+
+    while (1) {
+        if (xf_ymodem_nb_is_held(p_ym) && !xf_ymodem_nb_is_busy(p_ym)) {
+            xf_ymodem_nb_resume(p_ym);
+        }
+
+        /* 先发出应答等，再交付事件 */
+        p_seg = xf_ymodem_nb_seg_head(p_ym);
+        if (p_seg != NULL) {
+            if (p_seg->type == XF_YMODEM_NB_SEG_FLUSH) {
+                xf_ymodem_flush_read(p_ym);
+                xf_ymodem_nb_seg_done(p_ym);
+                continue;
+            }
+            /* 每段单独写出，扩展包的包头与其余部分分两次 */
+            len     = p_seg->len - p_ym->nb_seg_off;
+            rwlen   = p_ym->ops->write(&p_seg->p_data[p_ym->nb_seg_off], len, p_ym->timeout_ms);
+            if (rwlen <= 0) {
+                xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_NO_DATA, false);
+                p_ym->nb_seg_rd = p_ym->nb_seg_wr;
+                xf_ymodem_nb_seg_done(p_ym);
+                return xf_ymodem_nb_poll(p_ym);
+            }
+            if (p_ym->ops->now_ms != NULL) {
+                p_ym->nb_now = p_ym->ops->now_ms();
+            }
+            xf_ymodem_nb_tx_consume(p_ym, (uint32_t)rwlen);
+            continue;
+        }
+
+        /*
+            ymodem-g 及滑动窗口发出本包后不等待应答，返回前不阻塞地取出已到达的应答:
+            ymodem-g 只可能收到 CAN, 只检查一个字节。
+         */
+        if ((!drained) && (p_ym->nb_event == XF_YMODEM_NB_EV_SEND_READY)
+                && ((p_ym->state == XF_YMODEM_SEND_STREAM_FILE_DATA)
+                    || (XF_YMODEM_WIN_SIZE(p_ym) > 0))) {
+            len = xf_ymodem_nb_rx_buf(p_ym, &p_rx);
+            if (len == 0) {
+                p_rx    = &ch;
+                len     = 1;
+            }
+            rwlen   = xf_ymodem_read(p_ym, p_rx, len, 0);
+            drained = (rwlen <= 0) || (p_ym->state == XF_YMODEM_SEND_STREAM_FILE_DATA);
+            if (rwlen > 0) {
+                xf_ymodem_nb_feed_bytes(p_ym, p_rx, (uint32_t)rwlen);
+            }
+            continue;
+        }
+
+        ev = xf_ymodem_nb_poll(p_ym);
+        if (ev != XF_YMODEM_NB_EV_NONE) {
+            return ev;
+        }
+
+        wait_ms = xf_ymodem_nb_timeout(p_ym);
+        if (wait_ms == XF_YMODEM_NB_WAIT_FOREVER) {
+            /* 会话已结束或在等待用户 */
+            return XF_YMODEM_NB_EV_NONE;
+        }
+
+        if (p_ym->nb_wait == XF_YMODEM_NB_WAIT_DRAIN) {
+            /* 等待发送端发完出错的包，期间到达的数据之后一并丢弃 */
+            if (wait_ms > 0) {
+                p_ym->ops->delay_ms(wait_ms);
+            }
+            xf_ymodem_nb_tick(p_ym, (p_ym->ops->now_ms != NULL)
+                              ? p_ym->ops->now_ms() : (p_ym->nb_now + wait_ms));
+            continue;
+        }
+
+        /* 数据包的剩余部分直接读入 p_pkt, 否则逐字节读取(启用读缓存时从缓存中取出) */
+        len = xf_ymodem_nb_rx_buf(p_ym, &p_rx);
+        if (len == 0) {
+            p_rx    = &ch;
+            len     = 1;
+        }
+        rwlen = (wait_ms > 0) ? xf_ymodem_read(p_ym, p_rx, len, wait_ms) : 0;
+        if (rwlen > 0) {
+            if (p_ym->ops->now_ms != NULL) {
+                p_ym->nb_now = p_ym->ops->now_ms();
+            }
+            xf_ymodem_nb_feed_bytes(p_ym, p_rx, (uint32_t)rwlen);
+        }
+        if (p_ym->ops->now_ms != NULL) {
+            /* 按实际经过的时间推进，断续到达的数据也会计时 */
+            xf_ymodem_nb_tick(p_ym, p_ym->ops->now_ms());
+        } else if (rwlen <= 0) {
+            /* 没有时钟，读取超时即视为已经过 wait_ms */
+            xf_ymodem_nb_tick(p_ym, p_ym->nb_now + wait_ms);
+        }
+    }
+}
+
+/* 以下供阻塞接口使用，见 xf_ymodem_internel.h */
+
+void xf_ymodem_nb_recv_begin(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, bool blocking)
+{
+    xf_ymodem_nb_clear(p_ym, blocking);
+    p_ym->nb_p_info             = p_info;
+    p_ym->buf_held[0]           = false;
+    p_ym->buf_held[1]           = false;
+    p_ym->frame_max             = XF_YMODEM_STX_1K_DATA_SIZE;
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    p_ym->win_size              = 0;
+#endif
+    p_ym->p_pkt                 = p_ym->p_buf;
+    p_ym->state                 = XF_YMODEM_RECV_REQUEST_FILE_INFO;
+
+    xf_ymodem_nb_recv_request_info(p_ym);
+}
+
+xf_err_t xf_ymodem_nb_recv_accept(xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info)
+{
+    xf_err_t    xf_ret          = XF_OK;
+
+    p_ym->buf_held[0]           = false;
+    p_ym->buf_held[1]           = false;
+    p_ym->frame_max             = XF_YMODEM_STX_1K_DATA_SIZE;
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    p_ym->win_size              = 0;
+#endif
+    p_ym->file_len_transmitted  = 0;
+    p_ym->state                 = XF_YMODEM_RECV_FILE_INFO_AVAILABLE;
+
+    /* 解析文件信息，同时协商滑动窗口及非标包长 */
+    xf_ret = xf_ymodem_parse_file_info(p_ym, p_info);
+    if (xf_ret != XF_OK) {
+        YM_LOGD(TAG, "parse_file_info:%s", xf_err_to_name(xf_ret));
+        xf_ymodem_nb_fail(p_ym, (p_ym->error_code != XF_YMODEM_OK)
+                          ? p_ym->error_code : XF_YMODEM_ERR_INVALID_FILE_NAME,
+                          !p_ym->nb_blocking);
+        return xf_ret;
+    }
+
+    p_ym->nb_wait   = XF_YMODEM_NB_WAIT_NONE;
+    p_ym->nb_armed  = false;
+    xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_FILE_INFO);
+    if (!p_ym->nb_blocking) {
+        /* 非阻塞时不等用户，直接请求文件数据 */
+        xf_ymodem_nb_recv_request(p_ym);
+    }
+
+    return xf_ret;
+}
+
+void xf_ymodem_nb_recv_request(xf_ymodem_t *p_ym)
+{
+    uint8_t     req[XF_YMODEM_FRAME_REQ_SIZE];
+    uint32_t    req_len         = 0;
+    uint32_t    i;
+
+    p_ym->nb_round = 0;
+
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    if (p_ym->win_size > 0) {
+        /* 以 W + 窗口大小 + 反码代替 C, 接受滑动窗口并请求文件数据 */
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_W);
+        xf_ymodem_nb_putc(p_ym, p_ym->win_size);
+        xf_ymodem_nb_putc(p_ym, (uint8_t)~p_ym->win_size);
+        p_ym->state         = XF_YMODEM_RECV_REQUEST_FILE_DATA;
+        p_ym->nb_win_retry  = p_ym->retry_num + 1;
+        xf_ymodem_nb_recv_window_next(p_ym);
+        return;
+    }
+#endif
+
+    /*
+        收包前不再逐包清空: 停等时线路上只有本包，清空只会丢掉快速发送端的包头。
+        只在请求文件数据前丢弃重复的起始帧，其余在出错后重新同步时清空。
+     */
+    xf_ymodem_nb_flush(p_ym);
+    /* 接受非标包长: F + 最大包长的包头 + 反码 [+ 扩展包以 1K 为单位的包长 + 反码] */
+    req_len = xf_ymodem_recv_frame_req(p_ym, req);
+    for (i = 0; i < req_len; i++) {
+        xf_ymodem_nb_putc(p_ym, req[i]);
+    }
+    /* 首次请求文件数据信息时需要发送 C(ymodem-g 时为 G) */
+    p_ym->packet_num    = 1;
+    xf_ymodem_nb_putc(p_ym, p_ym->req_ch);
+    p_ym->state         = (p_ym->req_ch == XF_YMODEM_G)
+                          ? XF_YMODEM_RECV_STREAM_FILE_DATA
+                          : XF_YMODEM_RECV_REQUEST_FILE_DATA;
+    xf_ymodem_nb_recv_wait(p_ym);
+}
+
+void xf_ymodem_nb_resume(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_held   = false;
+    p_ym->nb_round  = 0;
+
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    if (p_ym->win_size > 0) {
+        p_ym->nb_win_retry = p_ym->retry_num + 1;
+        xf_ymodem_nb_recv_window_next(p_ym);
+        return;
+    }
+#endif
+    xf_ymodem_nb_recv_wait(p_ym);
+}
+
+xf_err_t xf_ymodem_nb_send_begin(
+    xf_ymodem_t *p_ym, xf_ymodem_file_info_t *p_info, bool blocking)
+{
+    uint8_t     ch              = 0;
+
+    /* 批量发送: 上一个文件结束后已经收到请求下一个起始帧的 C */
+    ch = (p_ym->state == XF_YMODEM_SEND_FILE_END) ? p_ym->nb_step : 0;
+
+    xf_ymodem_nb_clear(p_ym, blocking);
+    p_ym->nb_p_info     = p_info;
+    p_ym->packet_num    = 0;
+    p_ym->state         = XF_YMODEM_NONE;
+    p_ym->p_pkt         = p_ym->p_buf;
+    p_ym->p_pend        = NULL;
+    p_ym->req_ch        = XF_YMODEM_C;
+    p_ym->frame_max     = XF_YMODEM_STX_1K_DATA_SIZE;
+    p_ym->frame_lvl     = XF_YMODEM_ADAPT_LVL_INIT;
+    p_ym->ack_cnt       = 0;
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    p_ym->win_size      = 0;
+#endif
+
+    if (ch != 0) {
+        return xf_ymodem_nb_send_file_info(p_ym);
+    }
+
+    /* 收到 C 或 G 后发送起始帧 */
+    xf_ymodem_nb_send_getc(p_ym);
+
+    return XF_OK;
+}
+
+void xf_ymodem_nb_send_packet(xf_ymodem_t *p_ym)
+{
+    /* 包头、填充 */
+    xf_ymodem_send_regular_packet_data(p_ym, p_ym->nb_data_len);
+    p_ym->nb_ready = false;
+
+    if (p_ym->state == XF_YMODEM_SEND_STREAM_FILE_DATA) {
+        /* ymodem-g 不等待应答 */
+        xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
+        xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+        p_ym->packet_num++;
+        xf_ymodem_nb_send_account(p_ym);
+        if (xf_ymodem_nb_send_is_done(p_ym)) {
+            xf_ymodem_nb_send_eot_start(p_ym);
+        } else {
+            p_ym->nb_wait = XF_YMODEM_NB_WAIT_NONE;
+            xf_ymodem_nb_send_ready(p_ym);
+        }
+        return;
+    }
+
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    if (p_ym->win_size > 0) {
+        /* 不等待本包应答 */
+        xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
+        xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+        p_ym->packet_num++;
+        p_ym->win_head++;
+        xf_ymodem_nb_send_account(p_ym);
+        xf_ymodem_nb_send_window_after(p_ym);
+        return;
+    }
+#endif
+
+    if (xf_ymodem_send_is_pipeline(p_ym)) {
+        /*
+            流水发送:
+                用户填充本包(B)时，上一包(A)已经发出并在等待应答；
+                先取得 A 的应答(NAK 时从 A 重发)，再发出 B 并立即请求下一包，
+                用户随即在 A 的缓冲区中填充下一包。
+            每个时刻线路上最多只有一个未应答的包，与标准接收端兼容。
+         */
+        if (p_ym->p_pend == NULL) {
+            xf_ymodem_nb_send_pipe(p_ym);
+            return;
+        }
+        p_ym->nb_held = true;
+        if (p_ym->nb_blocking) {
+            /* 阻塞接口在用户填充期间没有读取，重新开始等待 A 的应答 */
+            xf_ymodem_nb_send_wait_ack(p_ym);
+        }
+        return;
+    }
+
+    /* 停等: 获取 ACK 或 NAK 后再请求下一包 */
+    xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
+    xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+    xf_ymodem_nb_send_wait_ack(p_ym);
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static void xf_ymodem_nb_reset(xf_ymodem_t *p_ym, uint32_t now_ms)
+{
+    p_ym->p_pkt                 = p_ym->p_buf;
+    p_ym->packet_num            = 0;
+    p_ym->packet_len            = 0;
+    p_ym->data_len              = 0;
+    p_ym->file_len              = 0;
+    p_ym->file_len_transmitted  = 0;
+    p_ym->error_code            = XF_YMODEM_OK;
+    p_ym->state                 = XF_YMODEM_NONE;
+    p_ym->req_ch                = XF_YMODEM_C;
+    p_ym->frame_max             = XF_YMODEM_STX_1K_DATA_SIZE;
+    p_ym->frame_lvl             = XF_YMODEM_ADAPT_LVL_INIT;
+    p_ym->ack_cnt               = 0;
+    p_ym->p_pend                = NULL;
+    p_ym->tx_ack                = false;
+    p_ym->buf_held[0]           = false;
+    p_ym->buf_held[1]           = false;
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    p_ym->win_size              = 0;
+#endif
+#if XF_YMODEM_RX_CACHE_IS_ENABLE
+    p_ym->rx_rd                 = 0;
+    p_ym->rx_wr                 = 0;
+#endif
+    p_ym->nb_now                = now_ms;
+}
+
+static void xf_ymodem_nb_clear(xf_ymodem_t *p_ym, bool blocking)
+{
+    if ((blocking) && (p_ym->ops->now_ms != NULL)) {
+        p_ym->nb_now = p_ym->ops->now_ms();
+    }
+    p_ym->nb_p_info             = NULL;
+    p_ym->nb_deadline           = p_ym->nb_now;
+    p_ym->nb_limit              = p_ym->nb_now;
+    p_ym->nb_rx_len             = 0;
+    p_ym->nb_data_len           = 0;
+    p_ym->nb_seg_off            = 0;
+    p_ym->nb_retry              = 0;
+    p_ym->nb_win_retry          = 0;
+    p_ym->nb_idle               = 0;
+    p_ym->nb_round              = 0;
+    p_ym->nb_seg_rd             = 0;
+    p_ym->nb_seg_wr             = 0;
+    p_ym->nb_ctl_wr             = 0;
+    p_ym->nb_hs_len             = 0;
+    p_ym->nb_hs_need            = 0;
+    p_ym->nb_rx_ph              = XF_YMODEM_NB_RX_HEADER;
+    p_ym->nb_event              = XF_YMODEM_NB_EV_NONE;
+    p_ym->nb_wait               = XF_YMODEM_NB_WAIT_NONE;
+    p_ym->nb_armed              = false;
+    p_ym->nb_can                = false;
+    p_ym->nb_step               = 0;
+    p_ym->nb_scan               = false;
+    p_ym->nb_idle_nak           = false;
+    p_ym->nb_blocking           = blocking;
+    p_ym->nb_held               = false;
+    p_ym->nb_ready              = false;
+    p_ym->nb_tx_full            = false;
+}
+
+static uint32_t xf_ymodem_nb_feed_bytes(xf_ymodem_t *p_ym, const uint8_t *p_src, uint32_t size)
+{
+    uint32_t    idx             = 0;
+
+    if ((p_ym->state == XF_YMODEM_RECV_END) || (p_ym->state == XF_YMODEM_SEND_END)) {
+        /* 会话已结束，丢弃 */
+        return size;
+    }
+
+    if (xf_ymodem_nb_is_held(p_ym) && !xf_ymodem_nb_is_busy(p_ym)) {
+        xf_ymodem_nb_resume(p_ym);
+    }
+
+    if (xf_ymodem_nb_is_recv(p_ym)) {
+        if (p_ym->nb_wait == XF_YMODEM_NB_WAIT_DRAIN) {
+            /* 出错包的剩余部分 */
+            return size;
+        }
+        return xf_ymodem_nb_recv_feed(p_ym, p_src, size);
+    }
+
+    while ((idx < size) && !xf_ymodem_nb_is_busy(p_ym)
+            && (p_ym->state != XF_YMODEM_SEND_END)) {
+        xf_ymodem_nb_send_ch(p_ym, p_src[idx++]);
+    }
+
+    return idx;
+}
+
+static bool xf_ymodem_nb_is_recv(xf_ymodem_t *p_ym)
+{
+    return ((p_ym->state >= XF_YMODEM_RECV_REQUEST_FILE_INFO)
+            && (p_ym->state <= XF_YMODEM_RECV_END));
+}
+
+static bool xf_ymodem_nb_is_busy(xf_ymodem_t *p_ym)
+{
+    /* 发送端取出 SEND_READY 之前仍然处理到达的应答 */
+    return (XF_YMODEM_NB_TX_PENDING(p_ym)
+            || ((p_ym->nb_event != XF_YMODEM_NB_EV_NONE)
+                && (p_ym->nb_event != XF_YMODEM_NB_EV_SEND_READY)));
+}
+
+static bool xf_ymodem_nb_is_held(xf_ymodem_t *p_ym)
+{
+    /* 接收端已交付数据，等待用户取走后继续接收 */
+    return ((p_ym->nb_held) && xf_ymodem_nb_is_recv(p_ym));
+}
+
+static bool xf_ymodem_nb_limit_reached(xf_ymodem_t *p_ym)
+{
+    /* 阻塞接口没有 ops->now_ms 时时间只在读取超时时推进，不限制 */
+    if ((p_ym->nb_blocking) && (p_ym->ops->now_ms == NULL)) {
+        return false;
+    }
+
+    return XF_YMODEM_NB_TIME_AFTER_EQ(p_ym->nb_now, p_ym->nb_limit);
+}
+
+static void xf_ymodem_nb_arm(xf_ymodem_t *p_ym)
+{
+    uint32_t    wait_ms         = 0;
+    int32_t     left_ms         = 0;
+    uint8_t     limited         = true;
+
+    /* 全部发出后才开始等待对方，大包在慢速链路上的发送时间不计入超时 */
+    if ((p_ym->nb_wait == XF_YMODEM_NB_WAIT_NONE)
+            || (p_ym->nb_wait == XF_YMODEM_NB_WAIT_DRAIN)
+            || XF_YMODEM_NB_TX_PENDING(p_ym)) {
+        return;
+    }
+
+    switch (p_ym->nb_wait) {
+    case XF_YMODEM_NB_WAIT_PKT: {
+        if ((p_ym->nb_rx_ph == XF_YMODEM_NB_RX_EXT) || (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_CAN)) {
+            wait_ms = p_ym->timeout_ms;
+            limited = false;
+        } else {
+            wait_ms = XF_YMODEM_RTO_WAIT_MS(p_ym, p_ym->nb_rx_len - p_ym->packet_len);
+        }
+    } break;
+    case XF_YMODEM_NB_WAIT_GETC: {
+        if (p_ym->nb_can) {
+            /* 单个 CAN 之后的字节 */
+            wait_ms = p_ym->timeout_ms;
+            limited = false;
+        } else {
+            wait_ms = XF_YMODEM_RTO_WAIT_MS(p_ym, 1);
+        }
+    } break;
+    default: {
+        wait_ms = p_ym->timeout_ms;
+        limited = false;
+    } break;
+    }
+
+    /* 断续到达的数据会重新计时，但不能无限延长本次等待，见 xf_ymodem_budget_ms() */
+    if ((limited) && !((p_ym->nb_blocking) && (p_ym->ops->now_ms == NULL))) {
+        left_ms = (int32_t)(p_ym->nb_limit - p_ym->nb_now);
+        wait_ms = (left_ms > 0) ? min(wait_ms, (uint32_t)left_ms) : 0;
+    }
+
+    p_ym->nb_deadline   = p_ym->nb_now + wait_ms;
+    p_ym->nb_armed      = true;
+}
+
+static void xf_ymodem_nb_event(xf_ymodem_t *p_ym, uint8_t ev)
+{
+    p_ym->nb_event = ev;
+}
+
+static void xf_ymodem_nb_fail(xf_ymodem_t *p_ym, xf_ymodem_err_t error_code, bool send_can)
+{
+    uint32_t    i;
+
+    YM_LOGD(TAG, "fail:%d", (int)error_code);
+
+    p_ym->error_code    = (error_code != XF_YMODEM_OK) ? error_code : XF_YMODEM_ERR_HEADER;
+    p_ym->nb_wait       = XF_YMODEM_NB_WAIT_NONE;
+    p_ym->nb_armed      = false;
+    p_ym->nb_hs_need    = 0;
+    p_ym->nb_held       = false;
+    p_ym->nb_ready      = false;
+    xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_ERROR);
+
+    if (send_can) {
+        XF_YMODEM_STAT_INC(p_ym, tx_can);
+        p_ym->nb_seg_rd     = 0;
+        p_ym->nb_seg_wr     = 0;
+        p_ym->nb_seg_off    = 0;
+        p_ym->nb_ctl_wr     = 0;
+        for (i = 0; i < XF_YMODEM_NB_CAN_SEND_NUM; i++) {
+            xf_ymodem_nb_putc(p_ym, XF_YMODEM_CAN);
+        }
+    }
+
+    p_ym->state = xf_ymodem_nb_is_recv(p_ym) ? XF_YMODEM_RECV_END : XF_YMODEM_SEND_END;
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_ABORT, 0, p_ym->error_code);
+}
+
+static void xf_ymodem_nb_cancelled(xf_ymodem_t *p_ym)
+{
+    YM_LOGD(TAG, "The peer has cancelled.");
+    XF_YMODEM_STAT_INC(p_ym, rx_can);
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_CAN, 0, 0);
+    xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_CAN, false);
+}
+
+/* tx */
+
+static xf_ymodem_nb_seg_t *xf_ymodem_nb_seg_head(xf_ymodem_t *p_ym)
+{
+    if (p_ym->nb_tx_full) {
+        /* 队列溢出时丢了一段，之后的字节已无法组成正确的协议流，取消本次传输 */
+        p_ym->nb_tx_full = false;
+        xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_TX_FULL, true);
+    }
+
+    if (!XF_YMODEM_NB_TX_PENDING(p_ym)) {
+        return NULL;
+    }
+
+    return &p_ym->nb_seg[p_ym->nb_seg_rd];
+}
+
+static void xf_ymodem_nb_seg_put(
+    xf_ymodem_t *p_ym, const uint8_t *p_data, uint32_t len, uint8_t type)
+{
+    xf_ymodem_nb_seg_t *p_seg   = NULL;
+
+    if (p_ym->nb_seg_wr >= ARRAY_SIZE(p_ym->nb_seg)) {
+        /* 在下一次取出队首时结束会话，见 xf_ymodem_nb_seg_head() */
+        YM_LOGD(TAG, "tx queue full");
+        p_ym->nb_tx_full = true;
+        return;
+    }
+
+    p_seg           = &p_ym->nb_seg[p_ym->nb_seg_wr++];
+    p_seg->p_data   = p_data;
+    p_seg->len      = len;
+    p_seg->type     = type;
+    /* 发完后再开始等待，见 xf_ymodem_nb_seg_done() */
+    p_ym->nb_armed  = false;
+}
+
+static void xf_ymodem_nb_seg_copy(
+    xf_ymodem_t *p_ym, const uint8_t *p_data, uint32_t len, uint8_t type)
+{
+    if (p_ym->nb_ctl_wr + len > ARRAY_SIZE(p_ym->nb_ctl)) {
+        YM_LOGD(TAG, "tx queue full");
+        p_ym->nb_tx_full = true;
+        return;
+    }
+
+    xf_memcpy(&p_ym->nb_ctl[p_ym->nb_ctl_wr], p_data, len);
+    xf_ymodem_nb_seg_put(p_ym, &p_ym->nb_ctl[p_ym->nb_ctl_wr], len, type);
+    p_ym->nb_ctl_wr += (uint8_t)len;
+}
+
+static void xf_ymodem_nb_seg_done(xf_ymodem_t *p_ym)
+{
+    xf_ymodem_nb_seg_t *p_seg   = NULL;
+
+    p_seg = xf_ymodem_nb_seg_head(p_ym);
+    if (p_seg != NULL) {
+        switch (p_seg->type) {
+        case XF_YMODEM_NB_SEG_CTL: {
+            XF_YMODEM_RTO_SENT(p_ym, p_seg->len);
+        } break;
+        case XF_YMODEM_NB_SEG_PKT: {
+            XF_YMODEM_STAT_RTT_START(p_ym);
+            XF_YMODEM_RTO_SENT(p_ym, p_seg->len);
+        } break;
+        default: {
+        } break;
+        }
+        p_ym->nb_seg_rd++;
+    }
+    p_ym->nb_seg_off = 0;
+
+    if (!XF_YMODEM_NB_TX_PENDING(p_ym)) {
+        p_ym->nb_seg_rd = 0;
+        p_ym->nb_seg_wr = 0;
+        p_ym->nb_ctl_wr = 0;
+        xf_ymodem_nb_arm(p_ym);
+    }
+}
+
+static void xf_ymodem_nb_putc(xf_ymodem_t *p_ym, uint8_t ch)
+{
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_TX_CTL, ch, 0, 0);
+    if (ch == XF_YMODEM_NAK) {
+        XF_YMODEM_STAT_INC(p_ym, tx_nak);
+    }
+    xf_ymodem_nb_seg_copy(p_ym, &ch, 1, XF_YMODEM_NB_SEG_CTL);
+}
+
+static void xf_ymodem_nb_put_packet(
+    xf_ymodem_t *p_ym, const uint8_t *p_packet, uint32_t packet_len, uint8_t type)
+{
+    uint8_t     ext_hdr[XF_YMODEM_HEADER_SIZE + XF_YMODEM_EXT_LEN_SIZE];
+
+    XF_YMODEM_STAT_FRAME(p_ym, tx_frames, packet_len - XF_YMODEM_PROT_SEG_SIZE);
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_TX_FRAME, p_packet[XF_YMODEM_HEADER_IDX],
+                    p_packet[XF_YMODEM_PN_IDX], packet_len - XF_YMODEM_PROT_SEG_SIZE);
+
+    if (p_packet[XF_YMODEM_HEADER_IDX] == XF_YMODEM_STX_EXT) {
+        /* 扩展包: 包头 + 数据段长，之后是缓冲区中的包号及其余部分 */
+        ext_hdr[XF_YMODEM_HEADER_IDX] = XF_YMODEM_STX_EXT;
+        xf_ymodem_ext_len_to_bytes(
+            packet_len - XF_YMODEM_PROT_SEG_SIZE, &ext_hdr[XF_YMODEM_HEADER_SIZE]);
+        xf_ymodem_nb_seg_copy(p_ym, ext_hdr, sizeof(ext_hdr), XF_YMODEM_NB_SEG_EXT_HDR);
+        p_packet    += XF_YMODEM_HEADER_SIZE;
+        packet_len  -= XF_YMODEM_HEADER_SIZE;
+    }
+
+    xf_ymodem_nb_seg_put(p_ym, p_packet, packet_len, type);
+}
+
+static void xf_ymodem_nb_flush(xf_ymodem_t *p_ym)
+{
+    xf_ymodem_nb_seg_put(p_ym, NULL, 0, XF_YMODEM_NB_SEG_FLUSH);
+}
+
+/* recv */
+
+static void xf_ymodem_nb_recv_request_info(xf_ymodem_t *p_ym)
+{
+    p_ym->file_len_transmitted = 0;
+
+    xf_ymodem_nb_flush(p_ym);
+
+    if (p_ym->flags & XF_YMODEM_FLAG_YMODEM_G) {
+        /* 交替请求 G 与 C, 发送端不支持 ymodem-g 时仍能按标准流程传输 */
+        p_ym->req_ch = (p_ym->req_ch == XF_YMODEM_G) ? XF_YMODEM_C : XF_YMODEM_G;
+    } else {
+        p_ym->req_ch = XF_YMODEM_C;
+    }
+
+    /* 发送 C(或 G), 请求发送端发送包含文件名及长度的起始帧 */
+    xf_ymodem_nb_putc(p_ym, p_ym->req_ch);
+    xf_ymodem_nb_recv_wait(p_ym);
+}
+
+static void xf_ymodem_nb_recv_wait(xf_ymodem_t *p_ym)
+{
+    if (p_ym->tx_ack == true) {
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+        p_ym->tx_ack = false;
+    }
+
+    p_ym->nb_retry      = p_ym->retry_num + 1;
+    p_ym->nb_idle_nak   = false;
+    p_ym->nb_scan       = false;
+    xf_ymodem_nb_recv_restart(p_ym);
+}
+
+static void xf_ymodem_nb_recv_restart(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_rx_ph      = XF_YMODEM_NB_RX_HEADER;
+    p_ym->packet_len    = 0;
+    p_ym->data_len      = 0;
+    p_ym->crc16         = XF_YMODEM_CRC_START_VAL_DEFAULT;
+    p_ym->nb_rx_len     = 1; /*!< 先收包头 */
+    p_ym->nb_idle       = 0;
+    p_ym->nb_hs_len     = 0;
+    p_ym->nb_limit      = p_ym->nb_now + xf_ymodem_budget_ms(p_ym);
+    p_ym->nb_wait       = XF_YMODEM_NB_WAIT_PKT;
+    xf_ymodem_nb_arm(p_ym);
+}
+
+static void xf_ymodem_nb_recv_rearm(xf_ymodem_t *p_ym)
+{
+    if (xf_ymodem_nb_limit_reached(p_ym)) {
+        /* 到达截止时刻: 断续到达的数据会重新计时，但不能无限延长本次收包 */
+        XF_YMODEM_STAT_INC(p_ym, timeouts);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_TIMEOUT, 0, p_ym->packet_len);
+        xf_ymodem_nb_recv_round_end(p_ym);
+        return;
+    }
+    xf_ymodem_nb_arm(p_ym);
+}
+
+static void xf_ymodem_nb_recv_data_seen(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_idle       = 0; /*!< 成功时重置计数 */
+    p_ym->nb_idle_nak   = false;
+}
+
+static uint32_t xf_ymodem_nb_recv_feed(xf_ymodem_t *p_ym, const uint8_t *p_src, uint32_t size)
+{
+    uint32_t    idx             = 0;
+    uint32_t    len             = 0;
+    uint32_t    old_len         = 0;
+    uint8_t     ch              = 0;
+
+    while ((idx < size) && !xf_ymodem_nb_is_busy(p_ym)
+            && (p_ym->nb_wait == XF_YMODEM_NB_WAIT_PKT)) {
+        if ((p_ym->nb_scan) || (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_BODY)) {
+            /* 包的其余部分成块拷贝，已直接写入 p_pkt 的跳过拷贝 */
+            len = min(size - idx, p_ym->nb_rx_len - p_ym->packet_len);
+            if (&p_src[idx] != &p_ym->p_pkt[p_ym->packet_len]) {
+                xf_memcpy(&p_ym->p_pkt[p_ym->packet_len], &p_src[idx], len);
+            }
+            old_len             = p_ym->packet_len;
+            p_ym->packet_len   += len;
+            idx                += len;
+            xf_ymodem_nb_recv_data_seen(p_ym);
+            xf_ymodem_nb_recv_body(p_ym, old_len);
+            continue;
+        }
+
+        if (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_EXT) {
+            /* 扩展包的数据段长不存入 p_pkt, 数据仍从 XF_YMODEM_DATA_IDX 开始 */
+            len = min(size - idx, (uint32_t)(XF_YMODEM_EXT_LEN_SIZE - p_ym->nb_hs_len));
+            if (&p_src[idx] != &p_ym->nb_ext[p_ym->nb_hs_len]) {
+                xf_memcpy(&p_ym->nb_ext[p_ym->nb_hs_len], &p_src[idx], len);
+            }
+            p_ym->nb_hs_len    += (uint8_t)len;
+            idx                += len;
+            if (p_ym->nb_hs_len < XF_YMODEM_EXT_LEN_SIZE) {
+                xf_ymodem_nb_arm(p_ym);
+                continue;
+            }
+            xf_ymodem_nb_recv_header(p_ym, true);
+            continue;
+        }
+
+        ch = p_src[idx++];
+        xf_ymodem_nb_recv_data_seen(p_ym);
+
+        if (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_CAN) {
+            /* 取消需要连续两个 CAN, 单个 CAN 可能是在线路上出错的包头 */
+            p_ym->p_pkt[p_ym->packet_len++] = ch;
+            if (ch == XF_YMODEM_CAN) {
+                xf_ymodem_nb_cancelled(p_ym);
+                continue;
+            }
+            YM_LOGD(TAG, "single CAN");
+            XF_YMODEM_STAT_INC(p_ym, header_errors);
+            XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_HEADER, XF_YMODEM_CAN, 0);
+            xf_ymodem_nb_recv_error(p_ym, XF_FAIL);
+            continue;
+        }
+
+        if (ch == XF_YMODEM_EOT) {
+            xf_ymodem_nb_recv_eot(p_ym);
+            continue;
+        }
+        p_ym->p_pkt[XF_YMODEM_HEADER_IDX] = ch;
+        p_ym->packet_len = 1;
+        if (ch == XF_YMODEM_CAN) {
+            p_ym->nb_rx_ph = XF_YMODEM_NB_RX_CAN;
+            xf_ymodem_nb_arm(p_ym);
+            continue;
+        }
+        xf_ymodem_nb_recv_header(p_ym, false);
+    }
+
+    return idx;
+}
+
+static void xf_ymodem_nb_recv_eot(xf_ymodem_t *p_ym)
+{
+    switch (p_ym->state) {
+    case XF_YMODEM_RECV_REQUEST_FILE_DATA: {
+        /* 第一个 EOT: NAK, 等待第二个 */
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_RX_CTL, XF_YMODEM_EOT, 0, 0);
+        p_ym->state = XF_YMODEM_RECV_GOT_EOT1;
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_NAK);
+        xf_ymodem_nb_recv_restart(p_ym);
+    } break;
+    case XF_YMODEM_RECV_GOT_EOT1:
+    case XF_YMODEM_RECV_STREAM_FILE_DATA: {
+        /* 第二个 EOT(ymodem-g 只发送一次 EOT) */
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_RX_CTL, XF_YMODEM_EOT, 0, 0);
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+        p_ym->state         = XF_YMODEM_RECV_FEEDBACK_EOT2;
+        p_ym->error_code    = XF_YMODEM_OK;
+        xf_ymodem_nb_recv_eot_done(p_ym);
+    } break;
+    case XF_YMODEM_RECV_FEEDBACK_EOT2: {
+        /* 对第二个 EOT 的 ACK 丢失，发送端重发了 EOT */
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_RX_CTL, XF_YMODEM_EOT, 0, 0);
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+        xf_ymodem_nb_putc(p_ym, p_ym->req_ch);
+        xf_ymodem_nb_recv_restart(p_ym);
+    } break;
+    default: {
+        /* 请求起始帧时的 EOT 是上一次会话的残留，忽略 */
+        xf_ymodem_nb_recv_rearm(p_ym);
+    } break;
+    }
+}
+
+static void xf_ymodem_nb_recv_header(xf_ymodem_t *p_ym, bool ext_ready)
+{
+    xf_err_t    xf_ret          = XF_OK;
+
+    xf_ret = xf_ymodem_recv_check_packet_header(p_ym);
+    if (xf_ret != XF_OK) {
+        XF_YMODEM_STAT_INC(p_ym, header_errors);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_HEADER,
+                        p_ym->p_pkt[XF_YMODEM_HEADER_IDX], 0);
+        xf_ymodem_nb_recv_error(p_ym, XF_FAIL);
+        return;
+    }
+
+    if (p_ym->p_pkt[XF_YMODEM_HEADER_IDX] == XF_YMODEM_STX_EXT) {
+        if (!ext_ready) {
+            /* 扩展包的数据段长随后到达 */
+            p_ym->nb_rx_ph  = XF_YMODEM_NB_RX_EXT;
+            p_ym->nb_hs_len = 0;
+            xf_ymodem_nb_arm(p_ym);
+            return;
+        }
+        xf_ret = xf_ymodem_recv_ext_len_parse(p_ym, p_ym->nb_ext);
+        if (xf_ret != XF_OK) {
+            XF_YMODEM_STAT_INC(p_ym, header_errors);
+            XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_HEADER,
+                            XF_YMODEM_STX_EXT, 0);
+            xf_ymodem_nb_recv_error(p_ym, XF_FAIL);
+            return;
+        }
+    }
+
+    p_ym->nb_rx_ph  = XF_YMODEM_NB_RX_BODY;
+    p_ym->nb_rx_len = XF_YMODEM_PROT_SEG_SIZE + p_ym->data_len;
+    xf_ymodem_nb_recv_body(p_ym, 0);
+}
+
+static void xf_ymodem_nb_recv_body(xf_ymodem_t *p_ym, uint32_t old_len)
+{
+    uint32_t    need            = 0;
+    uint32_t    crc_idx         = 0;
+    uint32_t    crc_end         = 0;
+
+    if (p_ym->nb_scan) {
+        /* 查找时会丢弃 p_pkt 开头的字节 */
+        need            = xf_ymodem_recv_scan(p_ym);
+        p_ym->nb_rx_len = p_ym->packet_len + need;
+        if (need > 0) {
+            xf_ymodem_nb_recv_rearm(p_ym);
+            return;
+        }
+        /* 已找到重发包的开头，之后按正常流程接收 */
+        p_ym->nb_scan = false;
+        if (p_ym->p_pkt[XF_YMODEM_HEADER_IDX] == XF_YMODEM_STX_EXT) {
+            xf_memcpy(p_ym->nb_ext, &p_ym->p_pkt[XF_YMODEM_PN_IDX], XF_YMODEM_EXT_LEN_SIZE);
+            xf_memmove(&p_ym->p_pkt[XF_YMODEM_PN_IDX],
+                       &p_ym->p_pkt[XF_YMODEM_PN_IDX + XF_YMODEM_EXT_LEN_SIZE],
+                       p_ym->packet_len - XF_YMODEM_PN_IDX - XF_YMODEM_EXT_LEN_SIZE);
+            p_ym->packet_len   -= XF_YMODEM_EXT_LEN_SIZE;
+        }
+        xf_ymodem_nb_recv_header(p_ym, true);
+        return;
+    }
+
+    /*
+        每次收到数据就累计数据段的 crc, 而不是收完整包后再计算一遍，
+        这样 crc 尾随字节到达后几乎可以立即应答。
+     */
+    crc_idx = (old_len > XF_YMODEM_DATA_IDX) ? old_len : XF_YMODEM_DATA_IDX;
+    crc_end = min(p_ym->packet_len, XF_YMODEM_DATA_IDX + p_ym->data_len);
+    if (crc_end > crc_idx) {
+        p_ym->crc16 = xf_ymodem_crc16(p_ym->crc16, &p_ym->p_pkt[crc_idx], crc_end - crc_idx);
+    }
+
+    if (p_ym->packet_len < p_ym->nb_rx_len) {
+        xf_ymodem_nb_recv_rearm(p_ym);
+        return;
+    }
+    xf_ymodem_nb_recv_packet(p_ym);
+}
+
+static void xf_ymodem_nb_recv_packet(xf_ymodem_t *p_ym)
+{
+    /* 检查数据正确性 */
+    if (xf_ymodem_check_packet(p_ym) != XF_OK) {
+        xf_ymodem_nb_recv_error(p_ym, XF_ERR_INVALID_CHECK);
+        return;
+    }
+    XF_YMODEM_STAT_FRAME(p_ym, rx_frames, p_ym->data_len);
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_RX_FRAME, p_ym->p_pkt[XF_YMODEM_HEADER_IDX],
+                    p_ym->p_pkt[XF_YMODEM_PN_IDX], p_ym->data_len);
+
+    /* 检查包序: 停等时只可能收到期望的包，或应答丢失后重发的上一包 */
+    if ((p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA)
+            && (XF_YMODEM_WIN_SIZE(p_ym) == 0)
+            && (p_ym->p_pkt[XF_YMODEM_PN_IDX] != p_ym->packet_num)) {
+        p_ym->data_len      = 0;
+        p_ym->error_code    = XF_YMODEM_ERR_PN;
+        if ((p_ym->p_pkt[XF_YMODEM_PN_IDX] == (uint8_t)(p_ym->packet_num - 1))
+                && (p_ym->nb_retry > 0)) {
+            YM_LOGD(TAG, "duplicate packet");
+            XF_YMODEM_STAT_INC(p_ym, duplicates);
+            XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_DUP,
+                            p_ym->p_pkt[XF_YMODEM_PN_IDX], p_ym->packet_num);
+            p_ym->nb_retry--;
+            xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+            xf_ymodem_nb_recv_restart(p_ym);
+            return;
+        }
+        YM_LOGD(TAG, "packet num error");
+        XF_YMODEM_STAT_INC(p_ym, pn_errors);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_PN,
+                        p_ym->p_pkt[XF_YMODEM_PN_IDX], p_ym->packet_num);
+        xf_ymodem_nb_recv_error(p_ym, XF_ERR_INVALID_CHECK);
+        return;
+    }
+
+    p_ym->error_code = XF_YMODEM_OK;
+    xf_ymodem_nb_recv_got(p_ym);
+}
+
+static void xf_ymodem_nb_recv_timeout(xf_ymodem_t *p_ym)
+{
+    if (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_CAN) {
+        /* 单个 CAN 之后没有数据 */
+        YM_LOGD(TAG, "single CAN");
+        XF_YMODEM_STAT_INC(p_ym, header_errors);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_HEADER, XF_YMODEM_CAN, 0);
+        xf_ymodem_nb_recv_error(p_ym, XF_FAIL);
+        return;
+    }
+    if (p_ym->nb_rx_ph == XF_YMODEM_NB_RX_EXT) {
+        if (++p_ym->nb_idle < p_ym->retry_num + 1) {
+            xf_ymodem_nb_arm(p_ym);
+            return;
+        }
+        p_ym->error_code = XF_YMODEM_ERR_NO_DATA;
+        xf_ymodem_nb_recv_error(p_ym, XF_ERR_TIMEOUT);
+        return;
+    }
+
+    XF_YMODEM_STAT_INC(p_ym, timeouts);
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_TIMEOUT, 0, p_ym->packet_len);
+    if (XF_YMODEM_RTO_TIMEOUT(p_ym)) {
+        p_ym->nb_idle++; /*!< 短于 timeout_ms 的自适应等待不计入重试次数 */
+    }
+    if (p_ym->nb_scan) {
+        /* 线路已空闲仍未找到重发包，NAK 可能已丢失 */
+        xf_ymodem_nb_recv_error(p_ym, XF_ERR_TIMEOUT);
+        return;
+    }
+    if ((p_ym->packet_len > 0) || (p_ym->nb_idle >= p_ym->retry_num + 1)) {
+        /*
+            包中途线路空闲了 timeout_ms, 剩余部分不会再来(如丢了字节)，
+            发送端正在等待应答，按半包处理，不再等满重试次数。
+         */
+        xf_ymodem_nb_recv_round_end(p_ym);
+        return;
+    }
+    xf_ymodem_nb_recv_rearm(p_ym);
+}
+
+static void xf_ymodem_nb_recv_round_end(xf_ymodem_t *p_ym)
+{
+    p_ym->error_code = XF_YMODEM_ERR_NO_DATA;
+    if (p_ym->packet_len > 0) {
+        /* 半包 */
+        xf_ymodem_nb_recv_error(p_ym, XF_ERR_TIMEOUT);
+        return;
+    }
+    if ((!p_ym->nb_idle_nak) && (p_ym->nb_retry > 0)
+            && ((p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA)
+                || (p_ym->state == XF_YMODEM_RECV_GOT_EOT1))
+            && (XF_YMODEM_WIN_SIZE(p_ym) == 0)) {
+        /*
+            等满重试次数线路仍空闲: 上一个应答可能已丢失，发送端仍在等待
+            (发送端应答超时后会再等一轮)。NAK 一次让发送端重发，
+            重复的包识别后丢弃；此后仍空闲才返回超时。
+            只在等满之后才 NAK, 填充一包较慢的发送端不受影响。
+         */
+        YM_LOGD(TAG, "idle, NAK");
+        p_ym->nb_retry--;
+        p_ym->nb_idle_nak = true;
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_NAK);
+        xf_ymodem_nb_recv_restart(p_ym);
+        return;
+    }
+    xf_ymodem_nb_recv_exit(p_ym, XF_ERR_TIMEOUT);
+}
+
+static void xf_ymodem_nb_recv_error(xf_ymodem_t *p_ym, xf_err_t xf_ret)
+{
+    uint32_t    drain_len       = 0;
+    uint32_t    wait_ms         = 0;
+
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    if ((XF_YMODEM_WIN_SIZE(p_ym) > 0)
+            && (p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA)
+            && (p_ym->nb_retry > 0) && (p_ym->packet_len > 0)
+            && ((xf_ret == XF_FAIL)
+                || ((xf_ret == XF_ERR_INVALID_CHECK)
+                    && (((p_ym->p_pkt[XF_YMODEM_PN_IDX] ^ p_ym->p_pkt[XF_YMODEM_NPN_IDX]) != 0xFF)
+                        || !xf_ymodem_recv_pn_expected(p_ym, p_ym->p_pkt[XF_YMODEM_PN_IDX]))))
+       ) {
+        /*
+            滑动窗口: 包头错误或包号不可信多半是丢了字节后错位。
+            窗口按包号 NAK, 错位时没有可以 NAK 的包号；清空接收缓冲又会丢掉后续的包，
+            之后仍然错位。丢弃错位的包头，在已收到的数据中按包头及包号、反码查找下一包。
+         */
+        p_ym->nb_retry--;
+        XF_YMODEM_STAT_INC(p_ym, resyncs);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_RESYNC, 0, xf_ret);
+        p_ym->packet_len--;
+        xf_memmove(p_ym->p_pkt, &p_ym->p_pkt[1], p_ym->packet_len);
+        p_ym->nb_rx_ph      = XF_YMODEM_NB_RX_HEADER;
+        p_ym->nb_idle       = 0;
+        p_ym->nb_limit      = p_ym->nb_now + xf_ymodem_budget_ms(p_ym);
+        p_ym->data_len      = 0;
+        p_ym->crc16         = XF_YMODEM_CRC_START_VAL_DEFAULT;
+        p_ym->nb_scan       = true;
+        xf_ymodem_nb_recv_body(p_ym, 0);
+        return;
+    }
+#endif
+
+    if ((xf_ret == XF_FAIL)
+            && ((p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_INFO)
+                || (p_ym->state == XF_YMODEM_RECV_FEEDBACK_EOT2))) {
+        /* 等待起始帧时无法识别的字节多半是线路噪声或上一次会话的残留，丢弃后继续等待 */
+        p_ym->nb_rx_ph      = XF_YMODEM_NB_RX_HEADER;
+        p_ym->packet_len    = 0;
+        p_ym->data_len      = 0;
+        p_ym->crc16         = XF_YMODEM_CRC_START_VAL_DEFAULT;
+        p_ym->nb_rx_len     = 1;
+        xf_ymodem_nb_recv_rearm(p_ym);
+        return;
+    }
+
+    /*
+        出错后重新同步: 等待发送端发完本包，丢弃残留数据，再发 NAK 让发送端重发。
+        NAK 之后不能再清空，否则可能丢掉重发包的开头。
+        包头错误或半包只在数据阶段(发送端正在等待应答)时 NAK.
+     */
+    if ((p_ym->nb_retry > 0)
+            && (p_ym->state != XF_YMODEM_RECV_STREAM_FILE_DATA) /*!< ymodem-g 不重传 */
+            && (XF_YMODEM_WIN_SIZE(p_ym) == 0)  /*!< 滑动窗口按包号 NAK */
+            && ((xf_ret == XF_ERR_INVALID_CHECK)
+                || (p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA)
+                || (p_ym->state == XF_YMODEM_RECV_GOT_EOT1))
+       ) {
+        p_ym->nb_retry--;
+        XF_YMODEM_STAT_INC(p_ym, resyncs);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_RESYNC, 0, xf_ret);
+        if ((p_ym->flags & XF_YMODEM_FLAG_FAST_RESYNC)
+                && (p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA)) {
+            /* 立即 NAK, 本包的剩余部分在查找重发包时丢弃，不用等待线路空闲 */
+            xf_ymodem_nb_putc(p_ym, XF_YMODEM_NAK);
+            p_ym->nb_scan = true;
+            xf_ymodem_nb_recv_restart(p_ym);
+            return;
+        }
+        /*
+            半包超时说明线路已空闲，已知包长时只需等本包剩余部分；
+            包头错误时不知道包长，仍等待 timeout_ms.
+         */
+        if ((xf_ret != XF_ERR_TIMEOUT) && (p_ym->nb_rx_len <= 1)) {
+            wait_ms = p_ym->timeout_ms;
+        } else {
+            drain_len = ((xf_ret == XF_ERR_TIMEOUT) || (p_ym->nb_rx_len <= p_ym->packet_len))
+                        ? 0 : (p_ym->nb_rx_len - p_ym->packet_len);
+            wait_ms = XF_YMODEM_RTO_DRAIN_MS(p_ym, drain_len);
+        }
+        p_ym->nb_wait       = XF_YMODEM_NB_WAIT_DRAIN;
+        p_ym->nb_deadline   = p_ym->nb_now + wait_ms;
+        p_ym->nb_armed      = true;
+        return;
+    }
+
+    xf_ymodem_nb_recv_exit(p_ym, xf_ret);
+}
+
+static void xf_ymodem_nb_recv_drained(xf_ymodem_t *p_ym)
+{
+    xf_ymodem_nb_flush(p_ym);
+    xf_ymodem_nb_putc(p_ym, XF_YMODEM_NAK);
+    xf_ymodem_nb_recv_restart(p_ym);
+}
+
+static void xf_ymodem_nb_recv_exit(xf_ymodem_t *p_ym, xf_err_t xf_ret)
+{
+    xf_ymodem_err_t error_code  = XF_YMODEM_OK;
+
+    error_code = (xf_ret == XF_ERR_TIMEOUT) ? XF_YMODEM_ERR_NO_DATA : p_ym->error_code;
+
+    /*
+        ymodem-g 没有重传，数据流出错(包括收到半包后超时)后无法再对齐，只能取消。
+        一个字节都没收到时的超时允许重试。
+     */
+    if ((p_ym->state == XF_YMODEM_RECV_STREAM_FILE_DATA)
+            && !((xf_ret == XF_ERR_TIMEOUT) && (p_ym->packet_len == 0))) {
+        YM_LOGD(TAG, "stream error, cancel");
+        xf_ymodem_nb_fail(p_ym, p_ym->error_code, true);
+        return;
+    }
+
+    switch (p_ym->state) {
+    case XF_YMODEM_RECV_REQUEST_FILE_INFO:
+    case XF_YMODEM_RECV_FEEDBACK_EOT2: {
+        /* 阻塞接口由用户重试握手 */
+        if (p_ym->nb_blocking) {
+            xf_ymodem_nb_fail(p_ym, error_code, false);
+            return;
+        }
+        if (++p_ym->nb_round > p_ym->retry_num) {
+            XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_RETRY, 0, error_code);
+            xf_ymodem_nb_fail(p_ym, error_code, true);
+            return;
+        }
+        if (p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_INFO) {
+            xf_ymodem_nb_recv_request_info(p_ym);
+            return;
+        }
+        xf_ymodem_nb_putc(p_ym, p_ym->req_ch);
+        xf_ymodem_nb_recv_wait(p_ym);
+    } break;
+    default: {
+#if XF_YMODEM_WINDOW_IS_ENABLE
+        if (p_ym->win_size > 0) {
+            /* 滑动窗口按包号 NAK, 重试次数用完后再重新请求 */
+            xf_ymodem_nb_recv_window_got(p_ym, xf_ret);
+            return;
+        }
+#endif
+        xf_ymodem_nb_recv_round(p_ym, xf_ret);
+    } break;
+    }
+}
+
+static void xf_ymodem_nb_recv_round(xf_ymodem_t *p_ym, xf_err_t xf_ret)
+{
+    if (++p_ym->nb_round > p_ym->retry_num) {
+        xf_ymodem_nb_fail(p_ym, (xf_ret == XF_ERR_TIMEOUT)
+                          ? XF_YMODEM_ERR_NO_DATA : p_ym->error_code,
+                          !p_ym->nb_blocking);
+        return;
+    }
+    /* 超时时直接重试，其他错误先丢弃残留数据 */
+    if (xf_ret != XF_ERR_TIMEOUT) {
+        xf_ymodem_nb_flush(p_ym);
+    }
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    if (p_ym->win_size > 0) {
+        p_ym->nb_win_retry = p_ym->retry_num + 1;
+        xf_ymodem_nb_recv_window_next(p_ym);
+        return;
+    }
+#endif
+    xf_ymodem_nb_recv_wait(p_ym);
+}
+
+static void xf_ymodem_nb_recv_got(xf_ymodem_t *p_ym)
+{
+    switch (p_ym->state) {
+    case XF_YMODEM_RECV_REQUEST_FILE_INFO: {
+        /* ymodem-g 的起始帧不应答，直接以 G 请求文件数据 */
+        if (p_ym->req_ch != XF_YMODEM_G) {
+            xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+        }
+        if (p_ym->p_pkt[XF_YMODEM_DATA_IDX] == '\0') {
+            /* 空起始帧: 发送端没有文件 */
+            p_ym->state = XF_YMODEM_RECV_END;
+            p_ym->nb_wait = XF_YMODEM_NB_WAIT_NONE;
+            xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_END);
+            return;
+        }
+        xf_ymodem_nb_recv_accept(p_ym, p_ym->nb_p_info);
+    } break;
+    case XF_YMODEM_RECV_FEEDBACK_EOT2: {
+        if (p_ym->p_pkt[XF_YMODEM_DATA_IDX] != '\0') {
+            /* 不是空起始帧，而是批量传输中下一个文件的起始帧，ymodem-g 不应答 */
+            if (p_ym->req_ch != XF_YMODEM_G) {
+                xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+            }
+            p_ym->state = XF_YMODEM_RECV_NEXT_FILE_INFO;
+            if (!p_ym->nb_blocking) {
+                xf_ymodem_nb_recv_accept(p_ym, p_ym->nb_p_info);
+                return;
+            }
+            /* 阻塞接口由 xf_ymodem_recv_handshake() 解析 */
+            p_ym->nb_wait = XF_YMODEM_NB_WAIT_NONE;
+            xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_FILE_INFO);
+            return;
+        }
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+#if XF_YMODEM_XSHELL_IS_ENABLE
+        /* 对于 xshell 需要多发一个 O 才能结束 */
+        xf_ymodem_nb_putc(p_ym, 'O');
+#endif
+        p_ym->state     = XF_YMODEM_RECV_END;
+        p_ym->nb_wait   = XF_YMODEM_NB_WAIT_NONE;
+        xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_END);
+    } break;
+    default: {
+#if XF_YMODEM_WINDOW_IS_ENABLE
+        if (p_ym->win_size > 0) {
+            xf_ymodem_nb_recv_window_got(p_ym, XF_OK);
+            return;
+        }
+#endif
+        /* 下一个等待的包号，快速重新同步时据此查找重发包 */
+        p_ym->packet_num++;
+        if (p_ym->state == XF_YMODEM_RECV_REQUEST_FILE_DATA) {
+            if ((p_ym->flags & XF_YMODEM_FLAG_EARLY_ACK) || !p_ym->nb_blocking) {
+                /* 校验已通过，立即应答，让发送端在用户处理本包期间发送下一包 */
+                xf_ymodem_nb_putc(p_ym, XF_YMODEM_ACK);
+            } else {
+                /* 用户取走数据、下一次接收前再应答 */
+                p_ym->tx_ack = true;
+            }
+        }
+        xf_ymodem_nb_recv_deliver(p_ym);
+    } break;
+    }
+}
+
+static void xf_ymodem_nb_recv_deliver(xf_ymodem_t *p_ym)
+{
+    uint32_t    file_remain_len = 0;
+
+    file_remain_len = p_ym->file_len - p_ym->file_len_transmitted;
+    /* 最后一包只有部分数据有效 */
+    p_ym->nb_data_len = min(p_ym->data_len, file_remain_len);
+    p_ym->file_len_transmitted += p_ym->nb_data_len;
+    XF_YMODEM_STAT_ADD(p_ym, payload_bytes, p_ym->nb_data_len);
+
+    /* 双缓冲时该缓冲区交由用户持有，直到 xf_ymodem_recv_release() */
+    if ((p_ym->nb_blocking) && xf_ymodem_recv_is_double_buf(p_ym)) {
+        p_ym->buf_held[(p_ym->p_pkt == p_ym->p_buf) ? 0 : 1] = true;
+    }
+
+    /* 用户取走数据后由 xf_ymodem_nb_resume() 继续接收 */
+    p_ym->nb_wait   = XF_YMODEM_NB_WAIT_NONE;
+    p_ym->nb_armed  = false;
+    p_ym->nb_held   = true;
+    xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_DATA);
+}
+
+static void xf_ymodem_nb_recv_eot_done(xf_ymodem_t *p_ym)
+{
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    if (p_ym->win_size > 0) {
+        /* 窗口已全部交付，起始帧按停等接收 */
+        p_ym->p_pkt     = p_ym->p_buf;
+        p_ym->win_size  = 0;
+    }
+#endif
+
+    /* 请求下一个文件的起始帧或空起始帧 */
+    xf_ymodem_nb_flush(p_ym);
+    xf_ymodem_nb_putc(p_ym, p_ym->req_ch);
+    p_ym->nb_round = 0;
+    xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_FILE_END);
+    xf_ymodem_nb_recv_wait(p_ym);
+}
+
+#if XF_YMODEM_WINDOW_IS_ENABLE
+
+static void xf_ymodem_nb_putc_pn(xf_ymodem_t *p_ym, uint8_t ch, uint8_t pn)
+{
+    uint8_t     buf[3];
+
+    buf[0] = ch;
+    buf[1] = pn;
+    buf[2] = ~pn;
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_TX_CTL, ch, pn, 0);
+    xf_ymodem_nb_seg_copy(p_ym, buf, sizeof(buf), XF_YMODEM_NB_SEG_PN);
+    if (ch == XF_YMODEM_NAK) {
+        XF_YMODEM_STAT_INC(p_ym, tx_nak);
+    }
+}
+
+static void xf_ymodem_nb_recv_window_next(xf_ymodem_t *p_ym)
+{
+    xf_err_t    xf_ret          = XF_OK;
+    uint8_t     win             = p_ym->win_size;
+    uint8_t     slot            = 0;
+    uint8_t     i;
+
+    if (!(p_ym->win_mask & 1UL)) {
+        /* 在空闲槽中接收下一包 */
+        p_ym->p_pkt = xf_ymodem_window_slot(p_ym, p_ym->win_map[win]);
+        xf_ymodem_nb_recv_wait(p_ym);
+        return;
+    }
+
+    /*
+        交付窗口起始包。
+        上一次交付给用户的槽(空闲槽)在本次调用时已归还，交付后的槽成为新的空闲槽。
+     */
+    slot = p_ym->win_map[0];
+    for (i = 0; i < win; i++) {
+        p_ym->win_map[i] = p_ym->win_map[i + 1];
+    }
+    p_ym->win_map[win]  = slot;
+    p_ym->win_mask    >>= 1;
+    p_ym->win_nak     >>= 1;
+    p_ym->win_base++;
+
+    p_ym->p_pkt = xf_ymodem_window_slot(p_ym, slot);
+    xf_ret = xf_ymodem_recv_check_packet_header(p_ym);
+    if (xf_ret != XF_OK) {
+        /* 存入窗口前已检查过包头，不应出现 */
+        xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_HEADER, true);
+        return;
+    }
+    xf_ymodem_nb_recv_deliver(p_ym);
+}
+
+static void xf_ymodem_nb_recv_window_got(xf_ymodem_t *p_ym, xf_err_t xf_ret)
+{
+    uint8_t     win             = p_ym->win_size;
+    uint8_t     pn              = 0;
+    uint8_t     d               = 0;
+    uint8_t     slot            = 0;
+    uint8_t     i;
+
+    if (xf_ret == XF_ERR_TIMEOUT) {
+        /* 数据或应答全部丢失，重新请求窗口起始包 */
+        p_ym->win_nak = 1UL;
+        xf_ymodem_nb_putc_pn(p_ym, XF_YMODEM_NAK, p_ym->win_base);
+        p_ym->nb_win_retry--;
+        if ((p_ym->packet_len == 0) || (p_ym->nb_win_retry <= 0)) {
+            xf_ymodem_nb_recv_round(p_ym, xf_ret);
+            return;
+        }
+        /* 半包: 包中途丢了字节，发送端很快会重发 */
+        xf_ymodem_nb_recv_window_next(p_ym);
+        return;
+    }
+
+    if (xf_ret != XF_OK) {
+        pn = p_ym->p_pkt[XF_YMODEM_PN_IDX];
+        d  = (uint8_t)(pn - p_ym->win_base);
+        if ((xf_ret == XF_ERR_INVALID_CHECK)
+                && ((pn ^ p_ym->p_pkt[XF_YMODEM_NPN_IDX]) == 0xFF)) {
+            /* 包号正确但数据出错，只请求重发这一包；已交付的包出错时忽略 */
+            if (d < win) {
+                p_ym->win_nak |= (1UL << d);
+                xf_ymodem_nb_putc_pn(p_ym, XF_YMODEM_NAK, pn);
+            }
+        } else {
+            /* 重新对齐仍失败，丢弃已收到的数据 */
+            xf_ymodem_nb_flush(p_ym);
+        }
+        p_ym->nb_win_retry--;
+        if (p_ym->nb_win_retry <= 0) {
+            xf_ymodem_nb_recv_round(p_ym, xf_ret);
+            return;
+        }
+        xf_ymodem_nb_recv_window_next(p_ym);
+        return;
+    }
+
+    p_ym->nb_win_retry  = p_ym->retry_num + 1;
+    pn                  = p_ym->p_pkt[XF_YMODEM_PN_IDX];
+    d                   = (uint8_t)(pn - p_ym->win_base);
+    if (d < win) {
+        if (!(p_ym->win_mask & (1UL << d))) {
+            /* 存入窗口，原来的空槽作为新的空闲槽 */
+            slot                    = p_ym->win_map[d];
+            p_ym->win_map[d]        = p_ym->win_map[win];
+            p_ym->win_map[win]      = slot;
+            p_ym->win_mask         |= (1UL << d);
+        }
+        xf_ymodem_nb_putc_pn(p_ym, XF_YMODEM_ACK, pn);
+        /* 被跳过的包很可能已丢失，请求重发 */
+        for (i = 0; i < d; i++) {
+            if (!((p_ym->win_mask | p_ym->win_nak) & (1UL << i))) {
+                p_ym->win_nak |= (1UL << i);
+                xf_ymodem_nb_putc_pn(
+                    p_ym, XF_YMODEM_NAK, (uint8_t)(p_ym->win_base + i));
+            }
+        }
+    } else if ((uint8_t)(p_ym->win_base - pn) <= win) {
+        /* 已交付过的包: 对方没收到应答，再次应答 */
+        XF_YMODEM_STAT_INC(p_ym, duplicates);
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_DUP, pn, p_ym->win_base);
+        xf_ymodem_nb_putc_pn(p_ym, XF_YMODEM_ACK, pn);
+    }
+
+    xf_ymodem_nb_recv_window_next(p_ym);
+}
+
+#endif /* XF_YMODEM_WINDOW_IS_ENABLE */
+
+/* send */
+
+static xf_err_t xf_ymodem_nb_send_file_info(xf_ymodem_t *p_ym)
+{
+    xf_err_t    xf_ret          = XF_OK;
+
+    /* 准备文件信息及包协议 */
+    xf_ret = xf_ymodem_prepare_file_info(p_ym, p_ym->nb_p_info);
+    if (xf_ret != XF_OK) {
+        YM_LOGD(TAG, "prepare_file_info:%s", xf_err_to_name(xf_ret));
+        xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_INVALID_FILE_NAME, !p_ym->nb_blocking);
+        return xf_ret;
+    }
+    xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
+    xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+
+    /* 获取 ACK(ymodem-g 接收端不应答起始帧)及之后的 C 或 G */
+    p_ym->packet_num    = 1;
+    p_ym->state         = XF_YMODEM_SEND_FILE_INFO;
+    p_ym->nb_step       = 0;
+    p_ym->nb_retry      = p_ym->retry_num + 1;
+    xf_ymodem_nb_send_getc(p_ym);
+
+    return xf_ret;
+}
+
+static void xf_ymodem_nb_send_getc(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_idle   = 0;
+    p_ym->nb_limit  = p_ym->nb_now + xf_ymodem_budget_ms(p_ym);
+    p_ym->nb_wait   = XF_YMODEM_NB_WAIT_GETC;
+    xf_ymodem_nb_arm(p_ym);
+}
+
+static void xf_ymodem_nb_send_wait_ack(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_retry  = p_ym->retry_num + 1;
+    p_ym->nb_round  = 0;
+    xf_ymodem_nb_send_getc(p_ym);
+}
+
+static void xf_ymodem_nb_send_ready(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_ready = true;
+    xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_SEND_READY);
+}
+
+static void xf_ymodem_nb_send_ch(xf_ymodem_t *p_ym, uint8_t ch)
+{
+    if (p_ym->nb_hs_need > 0) {
+        /* F 之后的包头等逐个计入应答，W 之后的窗口大小及应答的包号不计入 */
+        if (p_ym->nb_hs[0] == XF_YMODEM_F) {
+            XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_RX_CTL, ch, 0, 0);
+        }
+        p_ym->nb_hs[p_ym->nb_hs_len++] = ch;
+        if ((p_ym->nb_hs_len == 2) && (p_ym->nb_hs[0] == XF_YMODEM_F)
+                && (ch == XF_YMODEM_STX_EXT)) {
+            /* 扩展包还有以 1K 为单位的包长 + 反码 */
+            p_ym->nb_hs_need = 5;
+        }
+        if (p_ym->nb_hs_len < p_ym->nb_hs_need) {
+            if (p_ym->nb_wait == XF_YMODEM_NB_WAIT_GETC) {
+                xf_ymodem_nb_send_getc(p_ym);
+            } else {
+                xf_ymodem_nb_arm(p_ym);
+            }
+            return;
+        }
+        p_ym->nb_hs_need = 0;
+        xf_ymodem_nb_send_collected(p_ym);
+        return;
+    }
+
+    switch (p_ym->state) {
+    case XF_YMODEM_SEND_STREAM_FILE_DATA: {
+        /* 接收端出错时只会发送 CAN */
+        if (ch == XF_YMODEM_CAN) {
+            xf_ymodem_nb_cancelled(p_ym);
+        }
+        return;
+    }
+    case XF_YMODEM_SEND_FILE_END: {
+        /* 请求下一个起始帧，留给 xf_ymodem_nb_send_next() */
+        if ((ch == XF_YMODEM_C) || (ch == XF_YMODEM_G)) {
+            p_ym->nb_step = ch;
+        }
+        return;
+    }
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    case XF_YMODEM_SEND_FILE_DATA: {
+        if (p_ym->win_size > 0) {
+            xf_ymodem_nb_send_window_ch(p_ym, ch);
+            return;
+        }
+    } break;
+#endif
+    default: {
+    } break;
+    }
+
+    if (p_ym->nb_wait != XF_YMODEM_NB_WAIT_GETC) {
+        /* 没有在等待对方，如流水发送在等待用户填充时已收到应答 */
+        if ((p_ym->state != XF_YMODEM_SEND_FILE_DATA) || (p_ym->p_pend == NULL)) {
+            return;
+        }
+    }
+
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_RX_CTL, ch, 0, 0);
+    if (ch == XF_YMODEM_NAK) {
+        XF_YMODEM_STAT_INC(p_ym, rx_nak);
+    }
+
+    if (p_ym->nb_can) {
+        p_ym->nb_can = false;
+        if (ch == XF_YMODEM_CAN) {
+            xf_ymodem_nb_cancelled(p_ym);
+            return;
+        }
+        /* 单个 CAN 可能是应答在线路上出错，其后的字节可能是真正的应答 */
+        YM_LOGD(TAG, "single CAN");
+        xf_ymodem_nb_send_answer(p_ym, ch);
+        return;
+    }
+    if (ch == XF_YMODEM_CAN) {
+        /* 取消需要连续两个 CAN */
+        p_ym->nb_can = true;
+        xf_ymodem_nb_arm(p_ym);
+        return;
+    }
+
+    xf_ymodem_nb_send_answer(p_ym, ch);
+}
+
+static void xf_ymodem_nb_send_collect(xf_ymodem_t *p_ym, uint8_t ch, uint8_t need)
+{
+    p_ym->nb_hs[0]      = ch;
+    p_ym->nb_hs_len     = 1;
+    p_ym->nb_hs_need    = need;
+}
+
+static void xf_ymodem_nb_send_collected(xf_ymodem_t *p_ym)
+{
+    switch (p_ym->nb_hs[0]) {
+    case XF_YMODEM_F: {
+        /* 接收端接受了非标包长，之后是 C 或 G */
+        if (xf_ymodem_send_frame_init(p_ym, &p_ym->nb_hs[1]) != XF_OK) {
+            xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_HEADER, !p_ym->nb_blocking);
+            return;
+        }
+        xf_ymodem_nb_send_getc(p_ym);
+    } break;
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    case XF_YMODEM_W: {
+        /* 接收端接受了滑动窗口扩展，之后与 C 相同 */
+        if (xf_ymodem_send_window_init(p_ym, p_ym->nb_hs[1], p_ym->nb_hs[2]) != XF_OK) {
+            xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_HEADER, !p_ym->nb_blocking);
+            return;
+        }
+        xf_ymodem_nb_send_info_answer(p_ym, XF_YMODEM_C);
+    } break;
+    default: {
+        if (p_ym->state == XF_YMODEM_SEND_FILE_DATA) {
+            xf_ymodem_nb_send_window_answer(p_ym);
+            return;
+        }
+        /* 接收端对重发数据包的迟到应答，丢弃其包序号后继续等待 EOT 的 NAK */
+        p_ym->nb_round = 0;
+        xf_ymodem_nb_send_getc(p_ym);
+    } break;
+#else
+    default: {
+    } break;
+#endif
+    }
+}
+
+static void xf_ymodem_nb_send_answer(xf_ymodem_t *p_ym, uint8_t ch)
+{
+    switch (p_ym->state) {
+    case XF_YMODEM_NONE: {
+        if ((ch == XF_YMODEM_C) || (ch == XF_YMODEM_G)) {
+            xf_ymodem_nb_send_file_info(p_ym);
+            return;
+        }
+        YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
+        if (p_ym->nb_blocking) {
+            xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_HEADER, false);
+            return;
+        }
+        /* 非阻塞时忽略线路噪声，继续等待 C */
+        xf_ymodem_nb_arm(p_ym);
+    } break;
+    case XF_YMODEM_SEND_FILE_INFO: {
+        xf_ymodem_nb_send_info_answer(p_ym, ch);
+    } break;
+    case XF_YMODEM_SEND_FILE_DATA: {
+        xf_ymodem_nb_send_data_answer(p_ym, ch);
+    } break;
+    case XF_YMODEM_SEND_EOT1:
+    case XF_YMODEM_SEND_EOT2:
+    case XF_YMODEM_SEND_NULL_FILE_INFO: {
+        xf_ymodem_nb_send_eot_answer(p_ym, ch);
+    } break;
+    default: {
+    } break;
+    }
+}
+
+static void xf_ymodem_nb_send_info_answer(xf_ymodem_t *p_ym, uint8_t ch)
+{
+    switch (ch) {
+    case XF_YMODEM_ACK: {
+        if (p_ym->nb_step != 0) {
+            break;
+        }
+        /* 获取第 2 次 C 或 G */
+        p_ym->nb_step = 1;
+        xf_ymodem_nb_send_getc(p_ym);
+        return;
+    }
+    case XF_YMODEM_F: {
+        /* 包头 + 反码，扩展包还有包长 + 反码 */
+        xf_ymodem_nb_send_collect(p_ym, ch, 3);
+        xf_ymodem_nb_send_getc(p_ym);
+        return;
+    }
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    case XF_YMODEM_W: {
+        /* 窗口大小 + 反码 */
+        xf_ymodem_nb_send_collect(p_ym, ch, 3);
+        xf_ymodem_nb_send_getc(p_ym);
+        return;
+    }
+#endif
+    case XF_YMODEM_C:
+    case XF_YMODEM_G: {
+        /* 接收端以 G 请求文件数据时使用 ymodem-g */
+        p_ym->req_ch    = ch;
+        p_ym->state     = (ch == XF_YMODEM_G)
+                          ? XF_YMODEM_SEND_STREAM_FILE_DATA
+                          : XF_YMODEM_SEND_FILE_DATA;
+        p_ym->nb_wait   = XF_YMODEM_NB_WAIT_NONE;
+        p_ym->nb_armed  = false;
+        xf_ymodem_nb_send_ready(p_ym);
+        return;
+    }
+    case XF_YMODEM_NAK: {
+        if ((p_ym->nb_step != 0) || (--p_ym->nb_retry <= 0)) {
+            break;
+        }
+        /* 起始帧出错，重发 */
+        XF_YMODEM_STAT_INC(p_ym, retransmits);
+        xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+        xf_ymodem_nb_send_getc(p_ym);
+        return;
+    }
+    default: {
+    } break;
+    }
+
+    YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
+    if (--p_ym->nb_retry > 0) {
+        xf_ymodem_nb_send_getc(p_ym);
+        return;
+    }
+    xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_HEADER, !p_ym->nb_blocking);
+}
+
+static void xf_ymodem_nb_send_data_answer(xf_ymodem_t *p_ym, uint8_t ch)
+{
+    const uint8_t  *p_packet    = NULL;
+    uint32_t        packet_len  = 0;
+
+    /* 流水发送时等待的是已发出的上一包 */
+    p_packet    = (p_ym->p_pend != NULL) ? p_ym->p_pend : p_ym->p_pkt;
+    packet_len  = (p_ym->p_pend != NULL) ? p_ym->pend_packet_len : p_ym->packet_len;
+
+    switch (ch) {
+    case XF_YMODEM_NAK: {
+        p_ym->nb_retry--;
+        YM_LOGD(TAG, "The peer receives the packet with an error.");
+        XF_YMODEM_STAT_RTT_END(p_ym);
+        xf_ymodem_send_adapt(p_ym, true);
+        if (p_ym->nb_retry > 0) {
+            /* 重发 */
+            XF_YMODEM_STAT_INC(p_ym, retransmits);
+            xf_ymodem_nb_put_packet(p_ym, p_packet, packet_len, XF_YMODEM_NB_SEG_PKT);
+            p_ym->nb_round = 0;
+            xf_ymodem_nb_send_getc(p_ym);
+            return;
+        }
+        YM_LOGD(TAG, "The NAK retransmit counter has reached its maximum count.");
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_RETRY, 0, XF_YMODEM_ERR_NAK_RETRY);
+        xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_NAK_RETRY, !p_ym->nb_blocking);
+    } break;
+    case XF_YMODEM_ACK: {
+        XF_YMODEM_STAT_RTT_END(p_ym);
+        xf_ymodem_send_adapt(p_ym, false);
+        p_ym->packet_num++;
+        if (p_ym->p_pend == NULL) {
+            /* 停等 */
+            xf_ymodem_nb_send_account(p_ym);
+        }
+        p_ym->p_pend = NULL;
+        if (p_ym->nb_held) {
+            /* 用户已填充下一包 */
+            p_ym->nb_held = false;
+            xf_ymodem_nb_send_pipe(p_ym);
+            return;
+        }
+        if (xf_ymodem_nb_send_is_done(p_ym)) {
+            /* 传输完毕 */
+            xf_ymodem_nb_send_eot_start(p_ym);
+            return;
+        }
+        p_ym->nb_wait   = XF_YMODEM_NB_WAIT_NONE;
+        p_ym->nb_armed  = false;
+        if (!xf_ymodem_send_is_pipeline(p_ym)) {
+            /* 流水发送在发出本包时已请求下一包 */
+            xf_ymodem_nb_send_ready(p_ym);
+        }
+    } break;
+    default: {
+        YM_LOGD(TAG, "recv(%02X) Not Supported", (int)ch);
+        if (--p_ym->nb_retry > 0) {
+            /* 应答在线路上出错，忽略；按应答丢失处理，接收端空闲后会 NAK */
+            p_ym->nb_round = 0;
+            xf_ymodem_nb_send_getc(p_ym);
+            return;
+        }
+        xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_HEADER, !p_ym->nb_blocking);
+    } break;
+    }
+}
+
+static void xf_ymodem_nb_send_eot_answer(xf_ymodem_t *p_ym, uint8_t ch)
+{
+    switch (ch) {
+    case XF_YMODEM_NAK: {
+        if ((p_ym->state == XF_YMODEM_SEND_EOT2) && (p_ym->req_ch != XF_YMODEM_G)
+                && (--p_ym->nb_retry > 0)) {
+            /* 第一个 EOT 丢失时接收端把第二个当作第一个，重发 */
+            xf_ymodem_nb_send_eot(p_ym);
+            return;
+        }
+        if ((p_ym->state == XF_YMODEM_SEND_NULL_FILE_INFO) && (p_ym->nb_step)
+                && (--p_ym->nb_retry > 0)) {
+            /* 空起始帧出错，重发 */
+            xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+            xf_ymodem_nb_send_eot(p_ym);
+            return;
+        }
+        if (p_ym->state != XF_YMODEM_SEND_EOT1) {
+            break;
+        }
+        p_ym->state = XF_YMODEM_SEND_EOT2;
+        xf_ymodem_nb_send_eot(p_ym);
+        return;
+    }
+    case XF_YMODEM_ACK: {
+#if XF_YMODEM_WINDOW_IS_ENABLE
+        if ((p_ym->win_size > 0) && (p_ym->state == XF_YMODEM_SEND_EOT1)) {
+            /* 接收端对重发数据包的迟到应答，之后是其包序号及反码 */
+            xf_ymodem_nb_send_collect(p_ym, ch, 3);
+            xf_ymodem_nb_send_getc(p_ym);
+            return;
+        }
+#endif
+        if (p_ym->state == XF_YMODEM_SEND_EOT2) {
+            if ((p_ym->flags & XF_YMODEM_FLAG_BATCH) || !p_ym->nb_blocking) {
+                /* 批量发送: 由用户决定发送下一个文件的起始帧还是空起始帧 */
+                xf_ymodem_nb_send_file_end(p_ym);
+                return;
+            }
+            p_ym->state = XF_YMODEM_SEND_NULL_FILE_INFO;
+            xf_ymodem_nb_send_eot(p_ym);
+            return;
+        }
+        if (p_ym->state == XF_YMODEM_SEND_NULL_FILE_INFO) {
+            xf_ymodem_nb_send_end(p_ym);
+            return;
+        }
+    } break;
+    case XF_YMODEM_C:
+    case XF_YMODEM_G: {
+        if (p_ym->state == XF_YMODEM_SEND_EOT2) {
+            /* 第二个 EOT 的 ACK 丢失，接收端已在请求起始帧 */
+            if ((p_ym->flags & XF_YMODEM_FLAG_BATCH) || !p_ym->nb_blocking) {
+                xf_ymodem_nb_send_file_end(p_ym);
+                p_ym->nb_step = ch;
+                return;
+            }
+            p_ym->state = XF_YMODEM_SEND_NULL_FILE_INFO;
+        }
+        if (p_ym->state != XF_YMODEM_SEND_NULL_FILE_INFO) {
+            break;
+        }
+
+        /* 准备空包 */
+        p_ym->p_pkt[XF_YMODEM_HEADER_IDX] = XF_YMODEM_SOH;
+        p_ym->packet_num = 0;
+        xf_memset((char *)&p_ym->p_pkt[XF_YMODEM_DATA_IDX],
+                  0, XF_YMODEM_SOH_DATA_SIZE);
+        p_ym->data_len = XF_YMODEM_SOH_DATA_SIZE;
+        p_ym->packet_len = p_ym->data_len + XF_YMODEM_PROT_SEG_SIZE;
+        xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
+        xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+        p_ym->nb_step = 1;
+
+        if (p_ym->req_ch == XF_YMODEM_G) {
+            /* ymodem-g 的空起始帧无需等待应答 */
+            xf_ymodem_nb_send_end(p_ym);
+            return;
+        }
+        /* 等待之后一次应答 */
+        xf_ymodem_nb_send_eot(p_ym);
+        return;
+    }
+    default: {
+    } break;
+    }
+
+    YM_LOGD(TAG, "The peer has sent an error signal(%02X).", (int)ch);
+    xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_HEADER, !p_ym->nb_blocking);
+}
+
+static void xf_ymodem_nb_send_getc_timeout(xf_ymodem_t *p_ym)
+{
+    if (p_ym->nb_can) {
+        /* 单个 CAN 之后没有数据，按出错的应答处理 */
+        p_ym->nb_can = false;
+        xf_ymodem_nb_send_answer(p_ym, XF_YMODEM_CAN);
+        return;
+    }
+
+    XF_YMODEM_STAT_INC(p_ym, timeouts);
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_TIMEOUT, 0, 0);
+    if (XF_YMODEM_RTO_TIMEOUT(p_ym)) {
+        p_ym->nb_idle++; /*!< 短于 timeout_ms 的自适应等待不计入重试次数 */
+    }
+    if ((p_ym->nb_idle < p_ym->retry_num + 1) && !xf_ymodem_nb_limit_reached(p_ym)) {
+        xf_ymodem_nb_arm(p_ym);
+        return;
+    }
+    xf_ymodem_nb_send_getc_idle(p_ym);
+}
+
+static void xf_ymodem_nb_send_getc_idle(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_hs_need = 0;
+
+    /* 应答丢失时接收端等满重试次数才会 NAK, 再等一轮 */
+    if ((p_ym->nb_round == 0)
+            && ((p_ym->state == XF_YMODEM_SEND_FILE_DATA)
+                || (((p_ym->state == XF_YMODEM_SEND_EOT1) || (p_ym->state == XF_YMODEM_SEND_EOT2))
+                    && (p_ym->req_ch != XF_YMODEM_G)))) {
+        p_ym->nb_round = 1;
+        xf_ymodem_nb_send_getc(p_ym);
+        return;
+    }
+
+    YM_LOGD(TAG, "no data");
+    xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_NO_DATA, !p_ym->nb_blocking);
+}
+
+static void xf_ymodem_nb_send_pipe(xf_ymodem_t *p_ym)
+{
+    /* 发送，不等待应答 */
+    xf_ymodem_send_prepare_packet_protocol_segment(p_ym);
+    xf_ymodem_nb_put_packet(p_ym, p_ym->p_pkt, p_ym->packet_len, XF_YMODEM_NB_SEG_PKT);
+    p_ym->p_pend            = p_ym->p_pkt;
+    p_ym->pend_packet_len   = p_ym->packet_len;
+    xf_ymodem_nb_send_account(p_ym);
+
+    /* 下一包使用另一个缓冲区 */
+    p_ym->p_pkt = (p_ym->p_pkt == p_ym->p_buf) ? p_ym->p_buf_alt : p_ym->p_buf;
+
+    xf_ymodem_nb_send_wait_ack(p_ym);
+    if (!xf_ymodem_nb_send_is_done(p_ym)) {
+        /* 最后一包没有下一包可以填充，等待应答后结束 */
+        xf_ymodem_nb_send_ready(p_ym);
+    }
+}
+
+static void xf_ymodem_nb_send_account(xf_ymodem_t *p_ym)
+{
+    XF_YMODEM_STAT_ADD(p_ym, payload_bytes,
+                       min(p_ym->data_len, (uint32_t)(p_ym->file_len - p_ym->file_len_transmitted)));
+    p_ym->file_len_transmitted += p_ym->data_len;
+}
+
+static bool xf_ymodem_nb_send_is_done(xf_ymodem_t *p_ym)
+{
+    return (p_ym->file_len_transmitted >= p_ym->file_len);
+}
+
+static void xf_ymodem_nb_send_eot_start(xf_ymodem_t *p_ym)
+{
+    p_ym->nb_retry  = p_ym->retry_num + 1;
+    p_ym->nb_step   = 0;
+
+    if (p_ym->state != XF_YMODEM_SEND_NULL_FILE_INFO) {
+        /* ymodem-g 只发送一次 EOT, 等待 ACK */
+        p_ym->state = (p_ym->req_ch == XF_YMODEM_G)
+                      ? XF_YMODEM_SEND_EOT2
+                      : XF_YMODEM_SEND_EOT1;
+    }
+    /* 否则由 xf_ymodem_nb_send_next() 调用，直接等待 C 后发送空起始帧 */
+
+    xf_ymodem_nb_send_eot(p_ym);
+}
+
+static void xf_ymodem_nb_send_eot(xf_ymodem_t *p_ym)
+{
+    if ((p_ym->state == XF_YMODEM_SEND_EOT1)
+            || (p_ym->state == XF_YMODEM_SEND_EOT2)) {
+        xf_ymodem_nb_putc(p_ym, XF_YMODEM_EOT);
+    }
+    p_ym->nb_round = 0;
+    xf_ymodem_nb_send_getc(p_ym);
+}
+
+static void xf_ymodem_nb_send_file_end(xf_ymodem_t *p_ym)
+{
+    p_ym->file_len              = 0;
+    p_ym->file_len_transmitted  = 0;
+    p_ym->state                 = XF_YMODEM_SEND_FILE_END;
+    p_ym->error_code            = XF_YMODEM_OK;
+    p_ym->nb_wait               = XF_YMODEM_NB_WAIT_NONE;
+    p_ym->nb_armed              = false;
+    p_ym->nb_step               = 0;
+    xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_FILE_END);
+}
+
+static void xf_ymodem_nb_send_end(xf_ymodem_t *p_ym)
+{
+    p_ym->file_len              = 0;
+    p_ym->file_len_transmitted  = 0;
+    xf_ymodem_nb_flush(p_ym);
+    p_ym->state                 = XF_YMODEM_SEND_END;
+    p_ym->error_code            = XF_YMODEM_OK;
+    p_ym->nb_wait               = XF_YMODEM_NB_WAIT_NONE;
+    p_ym->nb_armed              = false;
+    xf_ymodem_nb_event(p_ym, XF_YMODEM_NB_EV_END);
+}
+
+#if XF_YMODEM_WINDOW_IS_ENABLE
+
+static void xf_ymodem_nb_send_window_after(xf_ymodem_t *p_ym)
+{
+    /* 窗口已满，或最后一包已发出时等待应答 */
+    if (((p_ym->win_head - p_ym->win_tail) >= p_ym->win_size)
+            || (xf_ymodem_nb_send_is_done(p_ym) && (p_ym->win_head != p_ym->win_tail))) {
+        p_ym->nb_win_retry  = p_ym->retry_num + 1;
+        p_ym->nb_wait       = XF_YMODEM_NB_WAIT_WIN;
+        xf_ymodem_nb_arm(p_ym);
+        return;
+    }
+    xf_ymodem_nb_send_window_next(p_ym);
+}
+
+static void xf_ymodem_nb_send_window_next(xf_ymodem_t *p_ym)
+{
+    /* 下一包使用的槽 */
+    p_ym->p_pkt     = xf_ymodem_window_slot(p_ym, p_ym->win_head % p_ym->win_size);
+    p_ym->nb_wait   = XF_YMODEM_NB_WAIT_NONE;
+    p_ym->nb_armed  = false;
+
+    if (xf_ymodem_nb_send_is_done(p_ym)) {
+        /* 传输完毕，丢弃重复的应答后进入 EOT 流程 */
+        xf_ymodem_nb_flush(p_ym);
+        xf_ymodem_nb_send_eot_start(p_ym);
+        return;
+    }
+    xf_ymodem_nb_send_ready(p_ym);
+}
+
+static void xf_ymodem_nb_send_window_ch(xf_ymodem_t *p_ym, uint8_t ch)
+{
+    switch (ch) {
+    case XF_YMODEM_ACK:
+    case XF_YMODEM_NAK: {
+        /* 之后是包号及反码 */
+        xf_ymodem_nb_send_collect(p_ym, ch, 3);
+    } break;
+    case XF_YMODEM_CAN: {
+        xf_ymodem_nb_cancelled(p_ym);
+        return;
+    }
+    default: {
+        /* 噪声，忽略 */
+    } break;
+    }
+
+    if (p_ym->nb_wait == XF_YMODEM_NB_WAIT_WIN) {
+        xf_ymodem_nb_arm(p_ym);
+    }
+}
+
+static void xf_ymodem_nb_send_window_answer(xf_ymodem_t *p_ym)
+{
+    uint8_t     ch              = p_ym->nb_hs[0];
+    uint8_t     pn              = p_ym->nb_hs[1];
+    uint32_t    tail            = p_ym->win_tail;
+    uint32_t    d               = 0;
+
+    d = (uint8_t)(pn - (uint8_t)(p_ym->win_tail + 1)); /*!< 数据包从 1 开始编号 */
+    if (((pn ^ p_ym->nb_hs[2]) != 0xFF)
+            /* 不在窗口内，重复的应答 */
+            || (d >= (p_ym->win_head - p_ym->win_tail))) {
+        /* 应答损坏，忽略，由超时重发 */
+        goto l_wait;
+    }
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_RX_CTL, ch, pn, 0);
+    if (ch == XF_YMODEM_ACK) {
+        p_ym->win_mask |= (1UL << d);
+        while (p_ym->win_mask & 1UL) {
+            p_ym->win_mask >>= 1;
+            p_ym->win_tail++;
+            p_ym->win_nak = 0;
+        }
+        goto l_wait;
+    }
+    XF_YMODEM_STAT_INC(p_ym, rx_nak);
+    p_ym->win_nak++;
+    if (p_ym->win_nak > (p_ym->retry_num + 1) * p_ym->win_size) {
+        YM_LOGD(TAG, "The NAK retransmit counter has reached its maximum count.");
+        XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_RETRY, pn, XF_YMODEM_ERR_NAK_RETRY);
+        xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_NAK_RETRY, !p_ym->nb_blocking);
+        return;
+    }
+    xf_ymodem_nb_send_window_resend(p_ym, p_ym->win_tail + d);
+
+l_wait:;
+    if (p_ym->nb_wait != XF_YMODEM_NB_WAIT_WIN) {
+        return;
+    }
+    if (p_ym->win_tail != tail) {
+        p_ym->nb_win_retry = p_ym->retry_num + 1;
+    }
+    if (((p_ym->win_head - p_ym->win_tail) >= p_ym->win_size)
+            || (xf_ymodem_nb_send_is_done(p_ym) && (p_ym->win_head != p_ym->win_tail))) {
+        xf_ymodem_nb_arm(p_ym);
+        return;
+    }
+    xf_ymodem_nb_send_window_next(p_ym);
+}
+
+static void xf_ymodem_nb_send_window_timeout(xf_ymodem_t *p_ym)
+{
+    uint32_t    cnt;
+
+    XF_YMODEM_STAT_INC(p_ym, timeouts);
+    XF_YMODEM_TRACE(p_ym, XF_YMODEM_TRACE_ERR, XF_YMODEM_TRACE_ERR_TIMEOUT, 0, 0);
+    p_ym->nb_hs_need = 0;
+    if (--p_ym->nb_win_retry <= 0) {
+        xf_ymodem_nb_fail(p_ym, XF_YMODEM_ERR_NO_DATA, !p_ym->nb_blocking);
+        return;
+    }
+
+    /* 应答可能丢失，重发所有未应答的包 */
+    for (cnt = p_ym->win_tail; cnt != p_ym->win_head; cnt++) {
+        if (!(p_ym->win_mask & (1UL << (cnt - p_ym->win_tail)))) {
+            xf_ymodem_nb_send_window_resend(p_ym, cnt);
+        }
+    }
+    xf_ymodem_nb_arm(p_ym);
+}
+
+static void xf_ymodem_nb_send_window_resend(xf_ymodem_t *p_ym, uint32_t cnt)
+{
+    uint8_t    *p_packet        = NULL;
+    uint32_t    packet_len      = 0;
+
+    p_packet    = xf_ymodem_window_slot(p_ym, cnt % p_ym->win_size);
+    packet_len  = (p_packet[XF_YMODEM_HEADER_IDX] == XF_YMODEM_SOH)
+                  ? XF_YMODEM_SOH_PACKET_SIZE
+                  : XF_YMODEM_STX_PACKET_SIZE;
+    XF_YMODEM_STAT_INC(p_ym, retransmits);
+    xf_ymodem_nb_put_packet(p_ym, p_packet, packet_len, XF_YMODEM_NB_SEG_RESEND);
+}
+
+#endif /* XF_YMODEM_WINDOW_IS_ENABLE */
@@ -0,0 +1,159 @@
+/**
+ * @file xf_ymodem_trace.c
+ * @author catcatBlue (catcatblue@qq.com)
+ * @brief xf_ymodem 二进制事件跟踪环。
+ * @version 1.0
+ * @date 2025-01-02
+ *
+ * Copyright (c) 2025, CorAL. All rights reserved.
+ *
+ */
+
+/* ==================== [Includes] ========================================== */
+
+#include "xf_ymodem.h"
+#include "xf_ymodem_internel.h"
+
+#if XF_YMODEM_TRACE_IS_ENABLE
+
+/* ==================== [Defines] =========================================== */
+
+#define XF_YMODEM_TRACE_MASK            (XF_YMODEM_TRACE_SIZE_SEL - 1)
+/* 环中最旧的事件的序号 */
+#define XF_YMODEM_TRACE_OLDEST(head)    (((head) > XF_YMODEM_TRACE_SIZE_SEL) \
+                                            ? ((head) - XF_YMODEM_TRACE_SIZE_SEL) : 0)
+
+/*
+    写入者先用原子加法占用一个槽，填写内容后最后写入 seq(release),
+    读取者按 seq 判断槽中是否为期望的事件，因此写入者之间、写入者与读取者之间都不需要加锁。
+    没有 __atomic 内建函数的编译器退化为普通读写，只保证单个任务内使用时正确。
+ */
+#if defined(__GNUC__)
+#   define XF_YMODEM_TRACE_FETCH_INC(p) __atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
+#   define XF_YMODEM_TRACE_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#   define XF_YMODEM_TRACE_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#   define XF_YMODEM_TRACE_FENCE_REL()  __atomic_thread_fence(__ATOMIC_RELEASE)
+#   define XF_YMODEM_TRACE_FENCE_ACQ()  __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#else
+#   define XF_YMODEM_TRACE_FETCH_INC(p) ((*(volatile uint32_t *)(p))++)
+#   define XF_YMODEM_TRACE_STORE(p, v)  (*(volatile uint32_t *)(p) = (v))
+#   define XF_YMODEM_TRACE_LOAD(p)      (*(const volatile uint32_t *)(p))
+#   define XF_YMODEM_TRACE_FENCE_REL()  ((void)0)
+#   define XF_YMODEM_TRACE_FENCE_ACQ()  ((void)0)
+#endif
+
+/* ==================== [Typedefs] ========================================== */
+
+/* ==================== [Static Prototypes] ================================= */
+
+static void xf_ymodem_trace_write(
+    uint32_t ts_us, uint8_t type, uint8_t id, uint8_t a, uint8_t b, uint32_t arg);
+
+/* ==================== [Static Variables] ================================== */
+
+static const char *const TAG = "xf_ymodem_trace";
+
+static uint32_t s_trace_head = 0;   /*!< 已占用的事件数，下一个事件的序号 */
+static xf_ymodem_trace_ev_t s_trace_ring[XF_YMODEM_TRACE_SIZE_SEL];
+
+/* ==================== [Macros] ============================================ */
+
+/* ==================== [Global Functions] ================================== */
+
+void xf_ymodem_trace_put(
+    xf_ymodem_t *p_ym, uint8_t type, uint8_t a, uint8_t b, uint32_t arg)
+{
+    uint32_t ts_us = xf_ymodem_now_us(p_ym);
+
+    if (p_ym->state != p_ym->trace_state) {
+        xf_ymodem_trace_write(ts_us, XF_YMODEM_TRACE_STATE, p_ym->trace_id,
+                              p_ym->trace_state, p_ym->state, 0);
+        p_ym->trace_state = p_ym->state;
+    }
+    xf_ymodem_trace_write(ts_us, type, p_ym->trace_id, a, b, arg);
+}
+
+uint32_t xf_ymodem_trace_read(
+    uint32_t *p_pos, xf_ymodem_trace_ev_t *p_ev, uint32_t num)
+{
+    uint32_t head;
+    uint32_t pos;
+    uint32_t cnt = 0;
+    uint32_t seq;
+
+    if ((NULL == p_pos) || (NULL == p_ev)) {
+        return 0;
+    }
+
+    head = XF_YMODEM_TRACE_LOAD(&s_trace_head);
+    pos  = *p_pos;
+    if ((uint32_t)(head - pos) > XF_YMODEM_TRACE_SIZE_SEL) {
+        /* 已被覆盖(或 *p_pos 无效) */
+        pos = XF_YMODEM_TRACE_OLDEST(head);
+    }
+
+    while ((pos != head) && (cnt < num)) {
+        const xf_ymodem_trace_ev_t *p_slot = &s_trace_ring[pos & XF_YMODEM_TRACE_MASK];
+        seq = XF_YMODEM_TRACE_LOAD(&p_slot->seq);
+        if (seq != pos + 1) {
+            if ((int32_t)(seq - (pos + 1)) > 0) {
+                /* 读取期间被写入者追上，跳过被覆盖的事件 */
+                head = XF_YMODEM_TRACE_LOAD(&s_trace_head);
+                pos  = XF_YMODEM_TRACE_OLDEST(head);
+                continue;
+            }
+            /* 槽已被占用但还未写完，下次再读 */
+            break;
+        }
+        p_ev[cnt] = *p_slot;
+        /* 复制期间被覆盖时丢弃 */
+        XF_YMODEM_TRACE_FENCE_ACQ();
+        if (XF_YMODEM_TRACE_LOAD(&p_slot->seq) != seq) {
+            continue;
+        }
+        p_ev[cnt].seq = seq;
+        cnt++;
+        pos++;
+    }
+
+    *p_pos = pos;
+    return cnt;
+}
+
+void xf_ymodem_trace_dump(void)
+{
+    xf_ymodem_trace_ev_t ev;
+    uint32_t pos = 0;
+
+    XF_LOGI(TAG, "trace begin");
+    while (xf_ymodem_trace_read(&pos, &ev, 1) == 1) {
+        xf_log_printf("YMTR %08lx%08lx%02x%02x%02x%02x%08lx\r\n",
+                      (unsigned long)ev.seq, (unsigned long)ev.ts_us,
+                      (unsigned int)ev.type, (unsigned int)ev.id,
+                      (unsigned int)ev.a, (unsigned int)ev.b,
+                      (unsigned long)ev.arg);
+    }
+    XF_LOGI(TAG, "trace end");
+}
+
+/* ==================== [Static Functions] ================================== */
+
+static void xf_ymodem_trace_write(
+    uint32_t ts_us, uint8_t type, uint8_t id, uint8_t a, uint8_t b, uint32_t arg)
+{
+    uint32_t seq = XF_YMODEM_TRACE_FETCH_INC(&s_trace_head);
+    xf_ymodem_trace_ev_t *p_slot = &s_trace_ring[seq & XF_YMODEM_TRACE_MASK];
+
+    /* 先使槽失效，读取者不会把新旧内容拼在一起 */
+    XF_YMODEM_TRACE_STORE(&p_slot->seq, 0);
+    XF_YMODEM_TRACE_FENCE_REL();
+    p_slot->ts_us   = ts_us;
+    p_slot->type    = type;
+    p_slot->id      = id;
+    p_slot->a       = a;
+    p_slot->b       = b;
+    p_slot->arg     = arg;
+    XF_YMODEM_TRACE_STORE(&p_slot->seq, seq + 1);
+}
+
+#endif /* XF_YMODEM_TRACE_IS_ENABLE */
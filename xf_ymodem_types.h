@@ -30,11 +30,16 @@ extern "C" {
 #define XF_YMODEM_NAK                   0x15    /*!< 重传当前数据包请求命令 */
 #define XF_YMODEM_CAN                   0x18    /*!< 取消传输命令，连续发送 5 个该命令 */
 #define XF_YMODEM_C                     0x43    /*!< 字符 C */
+#define XF_YMODEM_G                     0x47    /*!< 字符 G, 请求 ymodem-g 流式传输 */
+#define XF_YMODEM_W                     0x57    /*!< 扩展, 字符 W, 接受滑动窗口，后跟窗口大小及其反码 */
+#define XF_YMODEM_F                     0x46    /*!< 扩展, 字符 F, 接受非标包长，后跟最大包长的包头及其反码 */
 
 #define XF_YMODEM_STX_1K                XF_YMODEM_STX
 #define XF_YMODEM_STX_2K                0x0a    /*!< 非标, 包数据长 2048 字节 */
 #define XF_YMODEM_STX_4K                0x0b    /*!< 非标, 包数据长 4096 字节  */
 #define XF_YMODEM_STX_8K                0x0c    /*!< 非标, 包数据长 8192 字节  */
+#define XF_YMODEM_STX_EXT               0x0d    /*!< 非标, 扩展包，包头后是 4 字节(大端)数据段长，
+                                                 *   最大 64K, 见 XF_YMODEM_FLAG_LARGE_FRAME */
 
 #define XF_YMODEM_PAD_VAL               (0x1a)  /*!< 填充值  */
 
@@ -47,6 +52,10 @@ extern "C" {
 #define XF_YMODEM_STX_2K_DATA_SIZE      (XF_YMODEM_STX_DATA_SIZE * 2)
 #define XF_YMODEM_STX_4K_DATA_SIZE      (XF_YMODEM_STX_DATA_SIZE * 4)
 #define XF_YMODEM_STX_8K_DATA_SIZE      (XF_YMODEM_STX_DATA_SIZE * 8)
+#define XF_YMODEM_STX_16K_DATA_SIZE     (XF_YMODEM_STX_DATA_SIZE * 16)
+#define XF_YMODEM_STX_32K_DATA_SIZE     (XF_YMODEM_STX_DATA_SIZE * 32)
+#define XF_YMODEM_STX_64K_DATA_SIZE     (XF_YMODEM_STX_DATA_SIZE * 64)
+#define XF_YMODEM_EXT_LEN_SIZE          (4)     /*!< 扩展包数据段长字段大小，不存入缓冲区 */
 
 /**
  * @brief 协议段大小。
@@ -76,13 +85,62 @@ extern "C" {
 
 #define XF_YMODEM_CRC_START_VAL_DEFAULT (0)     /*!< crc 默认起始值 */
 
+/**
+ * @brief xf_ymodem 可选功能标志，用于 xf_ymodem_t.flags.
+ */
+#define XF_YMODEM_FLAG_EARLY_ACK        (1UL << 0)  /*!< 接收端: 数据包校验通过后立即应答，
+                                                     *   见 xf_ymodem_recv_release() */
+#define XF_YMODEM_FLAG_PIPELINE         (1UL << 1)  /*!< 发送端: 配合 p_buf_alt 流水发送，
+                                                     *   见 xf_ymodem_send_data() */
+#define XF_YMODEM_FLAG_YMODEM_G         (1UL << 2)  /*!< 接收端: 请求 ymodem-g 流式传输，
+                                                     *   仅用于可靠链路，见 xf_ymodem_recv_handshake() */
+#define XF_YMODEM_FLAG_WINDOW           (1UL << 3)  /*!< 收发端: 协商滑动窗口扩展(XF_YMODEM_WINDOW_ENABLE)，
+                                                     *   对方不支持时按标准 ymodem 传输 */
+#define XF_YMODEM_FLAG_BATCH            (1UL << 4)  /*!< 发送端: 批量发送多个文件，每个文件结束后不发送空起始帧，
+                                                     *   见 xf_ymodem_send_finish() */
+#define XF_YMODEM_FLAG_ADAPTIVE         (1UL << 5)  /*!< 发送端: 按 NAK 情况自适应调整包长(128 字节到 buf_size 允许的最大包长)，
+                                                     *   见 xf_ymodem_send_get_buf_and_len() */
+#define XF_YMODEM_FLAG_LARGE_FRAME      (1UL << 6)  /*!< 收发端: 协商非标的 2K, 4K, 8K 包长及
+                                                     *   16K, 32K, 64K 扩展包，未协商时发送端最大使用 1K 包 */
+#define XF_YMODEM_FLAG_FAST_RESYNC      (1UL << 7)  /*!< 接收端: 停等时数据包出错立即 NAK, 并在数据流中查找
+                                                     *   包头及包号、反码均相符的重发包，不等待线路空闲 */
+#define XF_YMODEM_FLAG_ADAPTIVE_TIMEOUT (1UL << 8)  /*!< 收发端: 按测得的往返时间及 baudrate 决定每次等待的时间，
+                                                     *   不超过 timeout_ms(XF_YMODEM_RTO_ENABLE) */
+
+/**
+ * @brief xf_ymodem_nb_timeout() 的返回值，表示没有等待中的超时。
+ */
+#define XF_YMODEM_NB_WAIT_FOREVER       (UINT32_MAX)
+
+/**
+ * @brief 待发送队列的段数。
+ * 一次处理最多排入: 滑动窗口的应答及每个被跳过的包的 NAK, 或窗口内全部重发的包，另加若干控制字符。
+ */
+#define XF_YMODEM_NB_SEG_NUM            (XF_YMODEM_WINDOW_MAX_SEL + 8)
+
+/**
+ * @brief 统计中的包长档位数，同 xf_ymodem_t.frame_lvl: 128, 1K, 2K, 4K, 8K, 16K, 32K, 64K.
+ */
+#define XF_YMODEM_STATS_FRAME_LVL_NUM   (8)
+
+/**
+ * @brief 往返时间直方图的桶数。
+ * 第 i 个桶统计 [2^i, 2^(i+1)) us 的往返时间，第 0 个桶含 0 us, 最后一个桶含更长的时间(8 s 以上)。
+ */
+#define XF_YMODEM_STATS_RTT_BUCKET_NUM  (24)
+
+/**
+ * @brief 跟踪环中的事件数，见 xf_ymodem_trace_read().
+ */
+#define XF_YMODEM_TRACE_SIZE_NUM        (XF_YMODEM_TRACE_SIZE_SEL)
+
 /* ==================== [Typedefs] ========================================== */
 
 /**
  * @brief 对接 xf_ymodem 的操作。
  *
  * 必须实现: read, write, flush, delay_ms.
- * 可选的实现: user_parse, user_file_info.
+ * 可选的实现: user_parse, user_file_info, now_ms, wait_readable.
  *
  */
 typedef struct _xf_ymodem_ops_t {
@@ -95,6 +153,9 @@ typedef struct _xf_ymodem_ops_t {
      * @return int32_t      实际读取的字节数。
      *      - (<=0)         读取错误
      *      - (>0)          实际读取的字节数
+     * @note 允许少于 size 就返回。启用 XF_YMODEM_RX_CACHE_ENABLE 时，
+     *       xf_ymodem 按缓存大小批量读取，read 有数据到达就应返回，
+     *       只在没有数据时才等待 timeout_ms.
      */
     int32_t (*read)(void *dst, uint32_t size, uint32_t timeout_ms);
     /**
@@ -153,6 +214,38 @@ typedef struct _xf_ymodem_ops_t {
      * @param user_data         用户数据，见 xf_ymodem_t.user_data .
      */
     uint32_t (*user_file_info)(uint8_t *p_remaining_buf, uint32_t remaining_size, void *user_data);
+    /**
+     * @brief 单调时钟，单位 ms, 允许回绕。
+     *
+     * @note 此实现是可选的。
+     * @note 阻塞接口及 xf_ymodem_nb_run() 用它驱动非阻塞内核的超时，
+     *       传给 xf_ymodem_nb_recv_start() 等的 now_ms 须取自同一时钟。
+     *       实现后，每次开始接收一包(含出错重新同步后)都设置时限: timeout_ms * (retry_num + 1),
+     *       收到数据不再延长等待，对端断断续续地发送或持续发送乱码时，阻塞接口也能在有限时间内返回。
+     *       此时 timeout_ms * (retry_num + 1) 不能短于最大的包在线路上的发送时间，
+     *       启用 XF_YMODEM_RTO_ENABLE 且设置了 baudrate 时时限另加这段时间。
+     *       未实现时阻塞接口的时间只在 read 超时时推进，不限制收包的总时间。
+     * @note 实现后自适应等待及统计的往返时间、跟踪事件的时间戳也取自它(精度为 ms)，
+     *       模拟链路的虚拟时钟下与链路上的时间一致；否则使用 XF_YMODEM_NOW_US().
+     *
+     * @return uint32_t     当前时间。
+     */
+    uint32_t (*now_ms)(void);
+    /**
+     * @brief 阻塞直到有数据可读或到达截止时刻。
+     *
+     * @note 此实现是可选的，需要同时实现 now_ms.
+     * @note 实现后 xf_ymodem 先调用 wait_readable 等待，再以 timeout_ms 为 0 调用 read
+     *       取走已到达的数据，read 不需要自己轮询等待。
+     *       适合由接收中断或驱动唤醒的信号量、poll() 等实现。
+     *
+     * @param deadline_ms   截止时刻，与 now_ms 为同一时钟。
+     * @return int32_t
+     *      - (>0)          有数据可读
+     *      - (0)           到达截止时刻仍没有数据
+     *      - (<0)          错误
+     */
+    int32_t (*wait_readable)(uint32_t deadline_ms);
 } xf_ymodem_ops_t;
 
 /**
@@ -168,6 +261,7 @@ typedef enum _xf_ymodem_err_code_t {
     XF_YMODEM_ERR_CAN,                          /*!< 对方已取消 */
     XF_YMODEM_ERR_NAK_RETRY,                    /*!< NAK 重发数据包达到最大次数 */
     XF_YMODEM_ERR_HEADER,                       /*!< 接收端发送了错误信号 */
+    XF_YMODEM_ERR_TX_FULL,                      /*!< 非阻塞内核的待发送队列已满 */
 
     XF_YMODEM_ERR_MAX,                          /*!< 最大值 */
 } xf_ymodem_err_code_t;
@@ -191,12 +285,16 @@ typedef enum _xf_ymodem_state_code_t {
     XF_YMODEM_RECV_FILE_INFO_AVAILABLE,
     /* 1.1. 再次发送 C, 请求发送端发送文件内容 */
     XF_YMODEM_RECV_REQUEST_FILE_DATA,
+    /* 1.1. 再次发送 G, 发送端连续发送文件内容，不逐包应答(ymodem-g) */
+    XF_YMODEM_RECV_STREAM_FILE_DATA,
     /* 1.1. 首次接收到 EOT, 需要发送 NAK */
     XF_YMODEM_RECV_GOT_EOT1,
     /* 1.1. 再次接收到 EOT, 需要发送 ACK */
     XF_YMODEM_RECV_GOT_EOT2,
     /* 1.1. 需要发送 C 反馈 EOT2, 之后再收一包文件信息，如果是空包则无下一个文件 */
     XF_YMODEM_RECV_FEEDBACK_EOT2,
+    /* 1.1. 已收到并应答下一个文件的起始帧，等待 xf_ymodem_recv_handshake() 解析 */
+    XF_YMODEM_RECV_NEXT_FILE_INFO,
     /* 1.1. 接收流程已结束 */
     XF_YMODEM_RECV_END,
 
@@ -205,18 +303,108 @@ typedef enum _xf_ymodem_state_code_t {
     XF_YMODEM_SEND_FILE_INFO,
     /* 2.1. 需要传送文件数据，并接收 ACK 或 NAK */
     XF_YMODEM_SEND_FILE_DATA,
+    /* 2.1. 接收端以 G 请求，连续传送文件数据，不等待应答(ymodem-g) */
+    XF_YMODEM_SEND_STREAM_FILE_DATA,
     /* 2.1. 文件已传送完，已接收到 ACK, 需要发送 EOT 一次 */
     XF_YMODEM_SEND_EOT1,
     /* 2.1. 发送 EOT1 后收到 NAK, 需要再发 EOT 一次 */
     XF_YMODEM_SEND_EOT2,
     /* 2.1. 发送 EOT2 后收到 ACK, 需要接收 C 后发送空的起始帧 */
     XF_YMODEM_SEND_NULL_FILE_INFO,
+    /* 2.1. 批量发送时当前文件已发送完毕，可以发送下一个文件或结束 */
+    XF_YMODEM_SEND_FILE_END,
     /* 2.1. 已收到最后一次应答，发送流程结束 */
     XF_YMODEM_SEND_END,
 
     XF_YMODEM_MAX,
 } xf_ymodem_state_code_t;
 
+/**
+ * @brief xf_ymodem 会话统计(XF_YMODEM_STATS_ENABLE)，见 xf_ymodem_t.stats.
+ * 从 xf_ymodem_t 清零起跨文件、跨会话累计，需要时用 xf_ymodem_stats_reset() 清零。
+ */
+typedef struct _xf_ymodem_stats_t {
+    uint32_t    tx_bytes;           /*!< 写入链路的字节数 */
+    uint32_t    rx_bytes;           /*!< 从链路读到的字节数 */
+    uint32_t    payload_bytes;      /*!< 文件数据字节数(不含填充): 发送端为已发出的新数据，
+                                     *   接收端为已交付给用户的数据 */
+    uint32_t    tx_frames[XF_YMODEM_STATS_FRAME_LVL_NUM];   /*!< 按包长档位发出的包数，含起始帧及重发 */
+    uint32_t    rx_frames[XF_YMODEM_STATS_FRAME_LVL_NUM];   /*!< 按包长档位收到的正确的包数，含重复包 */
+    uint32_t    retransmits;        /*!< 发送端: 重发的数据包数 */
+    uint32_t    tx_nak;             /*!< 发出的 NAK 数 */
+    uint32_t    rx_nak;             /*!< 收到的 NAK 数 */
+    uint32_t    crc_errors;         /*!< 接收端: crc 错误的包数 */
+    uint32_t    pn_errors;          /*!< 接收端: 包号与反码不符，或不是等待中的包 */
+    uint32_t    header_errors;      /*!< 接收端: 无法识别或未协商的包头及数据段长 */
+    uint32_t    duplicates;         /*!< 接收端: 应答丢失后对方重发的包 */
+    uint32_t    timeouts;           /*!< 等待对方时 timeout_ms 内没有收到任何数据的次数 */
+    uint32_t    resyncs;            /*!< 接收端: 出错后重新同步(丢弃残留数据或查找重发包)并 NAK 的次数 */
+    uint32_t    tx_can;             /*!< 本端取消的次数 */
+    uint32_t    rx_can;             /*!< 被对方取消的次数 */
+    /**
+     * @brief 数据包发出(写完)到收到其应答(ACK 或 NAK)的时间，log2 直方图，
+     *        见 XF_YMODEM_STATS_RTT_BUCKET_NUM. 停等及流水发送时记录，滑动窗口及 ymodem-g 时不记录。
+     */
+    uint32_t    rtt_hist[XF_YMODEM_STATS_RTT_BUCKET_NUM];
+} xf_ymodem_stats_t;
+
+/**
+ * @brief 跟踪事件类型(XF_YMODEM_TRACE_ENABLE)，见 xf_ymodem_trace_ev_t.
+ */
+typedef enum _xf_ymodem_trace_type_t {
+    XF_YMODEM_TRACE_NONE = 0,           /*!< 空 */
+    XF_YMODEM_TRACE_STATE,              /*!< 状态变化: a 为原状态，b 为新状态(xf_ymodem_state_code_t) */
+    XF_YMODEM_TRACE_FILE,               /*!< 开始传输文件: a 为 0 接收 / 1 发送，arg 为文件长度 */
+    XF_YMODEM_TRACE_TX_FRAME,           /*!< 发出数据包(含起始帧及重发): a 为包头，b 为包号，arg 为数据段长 */
+    XF_YMODEM_TRACE_RX_FRAME,           /*!< 收到正确的数据包(含重复包): 同上 */
+    XF_YMODEM_TRACE_TX_CTL,             /*!< 发出控制字符: a 为字符，b 为滑动窗口应答的包号 */
+    XF_YMODEM_TRACE_RX_CTL,             /*!< 收到控制字符(含 EOT): 同上 */
+    XF_YMODEM_TRACE_ERR,                /*!< 错误: a 见 xf_ymodem_trace_err_t, b 及 arg 见各错误 */
+
+    XF_YMODEM_TRACE_TYPE_MAX,
+} xf_ymodem_trace_type_t;
+
+/**
+ * @brief XF_YMODEM_TRACE_ERR 事件的错误类型。
+ */
+typedef enum _xf_ymodem_trace_err_t {
+    XF_YMODEM_TRACE_ERR_NONE = 0,
+    XF_YMODEM_TRACE_ERR_TIMEOUT,        /*!< timeout_ms 内没有收到数据，arg 为本包已收到的字节数 */
+    XF_YMODEM_TRACE_ERR_CRC,            /*!< crc 错误: b 为包号，arg 为 (包中的 crc << 16) | 计算的 crc */
+    XF_YMODEM_TRACE_ERR_PN,             /*!< 包号与反码不符，或不是等待中的包: b 为包号，arg 为等待的包号 */
+    XF_YMODEM_TRACE_ERR_HEADER,         /*!< 无法识别或未协商的包头: b 为包头 */
+    XF_YMODEM_TRACE_ERR_DUP,            /*!< 对方重发的包: b 为包号 */
+    XF_YMODEM_TRACE_ERR_RESYNC,         /*!< 出错后重新同步并 NAK */
+    XF_YMODEM_TRACE_ERR_CAN,            /*!< 被对方取消 */
+    XF_YMODEM_TRACE_ERR_RETRY,          /*!< 重试次数用尽，arg 为随后设置的 xf_ymodem_t.error_code */
+    XF_YMODEM_TRACE_ERR_ABORT,          /*!< 会话因错误结束，arg 为 xf_ymodem_t.error_code */
+
+    XF_YMODEM_TRACE_ERR_MAX,
+} xf_ymodem_trace_err_t;
+
+/**
+ * @brief 跟踪事件(XF_YMODEM_TRACE_ENABLE)，16 字节。
+ * 由 port/linux/xf_ymodem_trace.py 解码。
+ */
+typedef struct _xf_ymodem_trace_ev_t {
+    uint32_t    seq;                /*!< 序号加 1, 从 1 开始连续递增，不连续处为被覆盖的事件 */
+    uint32_t    ts_us;              /*!< 时间戳(us)，有 ops->now_ms 时取自它，否则见 XF_YMODEM_NOW_US() */
+    uint8_t     type;               /*!< 见 xf_ymodem_trace_type_t */
+    uint8_t     id;                 /*!< xf_ymodem_t.trace_id */
+    uint8_t     a;
+    uint8_t     b;
+    uint32_t    arg;
+} xf_ymodem_trace_ev_t;
+
+/**
+ * @brief 非阻塞内核待发送队列中的一段，由 xf_ymodem_nb_tx_peek() 依次取出。
+ */
+typedef struct _xf_ymodem_nb_seg_t {
+    const uint8_t  *p_data;             /*!< 指向 p_buf 中的包或 xf_ymodem_t.nb_ctl 中的控制字符 */
+    uint32_t        len;                /*!< 字节数 */
+    uint8_t         type;               /*!< 发出后的处理，见 xf_ymodem_nb.c */
+} xf_ymodem_nb_seg_t;
+
 /**
  * @brief xf_ymodem 对象容器类型。
  */
@@ -235,10 +423,21 @@ typedef struct _xf_ymodem_t {
      *  - 最小大小: XF_YMODEM_SOH_PACKET_SIZE.
      *  - buf_size 大于等于 XF_YMODEM_PROT_SEG_SIZE + XF_YMODEM_STX_1K_DATA_SIZE(2K, 4K, 8K)
      *    时，接收模式下自动支持标准 1K(1024 bytes) 数据段长，或非标的 2K, 4K, 8K 包长。
-     *  - 如果不希望或发送非标的 2K, 4K, 8K 包长:
-     *    buf_size <= XF_YMODEM_STX_PACKET_SIZE
+     *  - 发送非标的 2K, 4K, 8K 包及 16K, 32K, 64K 扩展包需要两端都设置 XF_YMODEM_FLAG_LARGE_FRAME,
+     *    按两端 buf_size 均可容纳的最大包长发送；否则最大发送 1K 包。
      */
     uint32_t                buf_size;
+    /**
+     * @brief 第二缓冲区，可选，为 NULL 时不使用。大小必须与 buf_size 相同。
+     *  - 接收端且 flags 含 XF_YMODEM_FLAG_EARLY_ACK 时，xf_ymodem 交替使用 p_buf 与 p_buf_alt
+     *    接收数据包，用户持有上一包的数据指针期间即可接收下一包。
+     *    此时用户处理完数据后需要调用 xf_ymodem_recv_release() 归还缓冲区。
+     *  - 发送端且 flags 含 XF_YMODEM_FLAG_PIPELINE 时，xf_ymodem 交替使用 p_buf 与 p_buf_alt
+     *    发送数据包，一个缓冲区等待应答(及 NAK 重发)期间用户即可填充另一个。
+     *  - 滑动窗口(XF_YMODEM_FLAG_WINDOW)不使用 p_buf_alt, 而是把 p_buf 按
+     *    XF_YMODEM_STX_PACKET_SIZE 切分为多个槽。
+     */
+    uint8_t                *p_buf_alt;
     /**
      * @brief 每个操作的重试次数。为 N 时每个操作尝试 N + 1 次。
      */
@@ -256,6 +455,24 @@ typedef struct _xf_ymodem_t {
      * @brief 提供给 xf_ymodem 模块的操作。
      */
     const xf_ymodem_ops_t  *ops;
+    /**
+     * @brief 可选功能标志，见 XF_YMODEM_FLAG_EARLY_ACK 等。默认 0 时为标准 ymodem 行为。
+     */
+    uint32_t                flags;
+#if XF_YMODEM_TRACE_IS_ENABLE
+    /**
+     * @brief 跟踪事件中的会话号，多个会话同时运行时用于区分，见 xf_ymodem_trace_ev_t.id.
+     */
+    uint8_t                 trace_id;
+#endif
+#if XF_YMODEM_RTO_IS_ENABLE
+    /**
+     * @brief 线路波特率(每字节按 10 位计)，自适应等待时间(XF_YMODEM_FLAG_ADAPTIVE_TIMEOUT)
+     *        据此计入包在线路上的发送时间，ops->now_ms 的截止时刻也另加最大的包的发送时间。
+     *        为 0 时只按测得的往返时间。
+     */
+    uint32_t                baudrate;
+#endif
     /**
      * End of 用户初始化区
      * @}
@@ -267,7 +484,7 @@ typedef struct _xf_ymodem_t {
      * @{
      */
     /* private: */
-    uint32_t                packet_len; /*!< 当前包总长，含协议段等内容，可能为 1 */
+    uint32_t                packet_len; /*!< 当前包总长，含协议段等内容(不含扩展包的数据段长字段)，可能为 1 */
     uint32_t                data_len;   /*!< 当前包数据段长 */
     int32_t                 file_len;   /*!< 当前传输事务文件长度 */
     int32_t                 file_len_transmitted;   /*!< 当前传输事务文件已传输的长度，
@@ -277,12 +494,101 @@ typedef struct _xf_ymodem_t {
     uint8_t                 state;      /*!< xf_ymodem 当前状态码 */
     uint8_t                 packet_num; /*!< xf_ymodem 传输包号计数 */
     uint8_t                 tx_ack;     /*!< (用户无需读取)xf_ymodem 做接收端时发送应答信号标志 */
+    uint16_t                crc16;      /*!< (用户无需读取)接收时随数据到达累计的数据段 crc */
+    uint8_t                *p_pkt;      /*!< (用户无需读取)当前收发包使用的缓冲区，p_buf 或 p_buf_alt */
+    volatile uint8_t        buf_held[2];/*!< (用户无需读取)双缓冲时用户是否持有 p_buf, p_buf_alt */
+    uint8_t                *p_pend;     /*!< (用户无需读取)流水发送时已发出、等待应答的包，NULL 表示无 */
+    uint32_t                pend_packet_len;    /*!< (用户无需读取)p_pend 包总长 */
+    uint8_t                 req_ch;     /*!< 本次传输的请求字符 C 或 G, 为 G 时是 ymodem-g 流式传输 */
+    uint32_t                frame_max;  /*!< 协商后的最大数据段长，未协商时为 1K */
+    uint8_t                 frame_lvl;  /*!< 自适应包长: 当前包长档位，0 ~ 7 依次为 128, 1K, 2K, 4K, 8K, 16K, 32K, 64K */
+    uint8_t                 ack_cnt;    /*!< (用户无需读取)自适应包长: 连续无 NAK 应答的包数 */
+#if XF_YMODEM_WINDOW_IS_ENABLE
+    uint8_t                 win_size;   /*!< 协商后的滑动窗口大小，为 0 时为停等 */
+    uint8_t                 win_base;   /*!< (用户无需读取)接收端: 窗口起始包号 */
+    uint32_t                win_head;   /*!< (用户无需读取)发送端: 已发送的数据包计数 */
+    uint32_t                win_tail;   /*!< (用户无需读取)发送端: 已应答的数据包计数 */
+    uint32_t                win_mask;   /*!< (用户无需读取)发送端: 窗口内已应答位图; 接收端: 已收到位图 */
+    uint32_t                win_nak;    /*!< (用户无需读取)发送端: 无进展时的重发次数; 接收端: 已 NAK 位图 */
+    uint8_t                 win_map[XF_YMODEM_WINDOW_MAX_SEL + 1];  /*!< (用户无需读取)接收端:
+                                                                     *   窗口位置到 p_buf 中槽号的映射，
+                                                                     *   最后一项为空闲槽 */
+#endif
+#if XF_YMODEM_RX_CACHE_IS_ENABLE
+    uint32_t                rx_rd;      /*!< (用户无需读取)读缓存中下一个未取出的字节 */
+    uint32_t                rx_wr;      /*!< (用户无需读取)读缓存中有效数据的末尾 */
+    uint8_t                 rx_cache[XF_YMODEM_RX_CACHE_SIZE_SEL];  /*!< (用户无需读取)批量读取的缓存 */
+#endif
+    struct _xf_ymodem_file_info_t  *nb_p_info;  /*!< (用户无需读取)非阻塞: 接收端传出、发送端待发送的文件信息 */
+    uint32_t                nb_now;     /*!< (用户无需读取)非阻塞: 最近一次 xf_ymodem_nb_tick() 的时间 */
+    uint32_t                nb_deadline;/*!< (用户无需读取)非阻塞: 当前等待的截止时间 */
+    uint32_t                nb_limit;   /*!< (用户无需读取)非阻塞: 本次收包的时限，见 xf_ymodem_budget_ms() */
+    uint32_t                nb_rx_len;  /*!< (用户无需读取)非阻塞: p_pkt 中本包应收的字节数 */
+    uint32_t                nb_data_len;/*!< (用户无需读取)非阻塞: 本包的有效数据长 */
+    uint32_t                nb_seg_off; /*!< (用户无需读取)非阻塞: 队首段已取走的字节数 */
+    int32_t                 nb_retry;   /*!< (用户无需读取)非阻塞: 当前包或请求剩余的重试次数 */
+    int32_t                 nb_win_retry;   /*!< (用户无需读取)非阻塞: 滑动窗口无进展时剩余的重试次数 */
+    uint32_t                nb_idle;    /*!< (用户无需读取)非阻塞: 连续超时的次数 */
+    uint32_t                nb_round;   /*!< (用户无需读取)非阻塞: 接收端重新请求当前包的次数 */
+    xf_ymodem_nb_seg_t      nb_seg[XF_YMODEM_NB_SEG_NUM];   /*!< (用户无需读取)非阻塞: 待发送队列 */
+    uint8_t                 nb_ctl[XF_YMODEM_NB_SEG_NUM * 3];   /*!< (用户无需读取)非阻塞: 队列中的控制字符及扩展包包头 */
+    uint8_t                 nb_ext[XF_YMODEM_EXT_LEN_SIZE]; /*!< (用户无需读取)非阻塞: 扩展包的数据段长 */
+    uint8_t                 nb_hs[5];   /*!< (用户无需读取)非阻塞: 发送端收到的 F/W 协商序列 */
+    uint8_t                 nb_hs_len;  /*!< (用户无需读取)非阻塞: nb_hs 或 nb_ext 中已收到的字节数 */
+    uint8_t                 nb_hs_need; /*!< (用户无需读取)非阻塞: nb_hs 需要的字节数，0 表示不在协商中 */
+    uint8_t                 nb_seg_rd;  /*!< (用户无需读取)非阻塞: nb_seg 中下一个待发送的段 */
+    uint8_t                 nb_seg_wr;  /*!< (用户无需读取)非阻塞: nb_seg 中有效段的末尾 */
+    uint8_t                 nb_ctl_wr;  /*!< (用户无需读取)非阻塞: nb_ctl 中有效字节的末尾 */
+    uint8_t                 nb_rx_ph;   /*!< (用户无需读取)非阻塞: 接收端当前包的阶段 */
+    uint8_t                 nb_step;    /*!< (用户无需读取)非阻塞: 发送端 EOT 流程的进度，或已收到的请求字符 */
+    uint8_t                 nb_event;   /*!< (用户无需读取)非阻塞: 待取出的事件，见 xf_ymodem_nb_event_t */
+    uint8_t                 nb_wait;    /*!< (用户无需读取)非阻塞: 等待对方的输入: 无、请求字符、应答或数据包 */
+    uint8_t                 nb_armed;   /*!< (用户无需读取)非阻塞: nb_deadline 是否有效 */
+    uint8_t                 nb_can;     /*!< (用户无需读取)非阻塞: 连续收到的 CAN 个数 */
+    uint8_t                 nb_scan;    /*!< (用户无需读取)非阻塞: 快速重新同步，正在数据流中查找重发包 */
+    uint8_t                 nb_idle_nak;/*!< (用户无需读取)非阻塞: 本次空闲已经 NAK 过 */
+    uint8_t                 nb_held;    /*!< (用户无需读取)非阻塞: 已交付数据或待发送的包，等待用户 */
+    uint8_t                 nb_ready;   /*!< (用户无需读取)非阻塞: 发送端已交出缓冲区，等待 xf_ymodem_nb_send_commit() */
+    uint8_t                 nb_blocking;/*!< (用户无需读取)非阻塞: 由阻塞接口经 xf_ymodem_nb_run() 驱动 */
+    uint8_t                 nb_tx_full; /*!< (用户无需读取)非阻塞: 待发送队列曾溢出，见 XF_YMODEM_ERR_TX_FULL */
+#if XF_YMODEM_STATS_IS_ENABLE
+    xf_ymodem_stats_t       stats;      /*!< 会话统计，任何时候都可以读取 */
+    uint32_t                stats_t0;   /*!< (用户无需读取)等待应答的包发出的时刻(us) */
+    uint8_t                 stats_t0_valid; /*!< (用户无需读取)stats_t0 是否有效 */
+#endif
+#if XF_YMODEM_TRACE_IS_ENABLE
+    uint8_t                 trace_state;    /*!< (用户无需读取)最近一次记录的状态，状态变化时产生 XF_YMODEM_TRACE_STATE */
+#endif
+#if XF_YMODEM_RTO_IS_ENABLE
+    uint32_t                rto_srtt;   /*!< 平滑往返时间(us)的 8 倍，0 表示还没有样本 */
+    uint32_t                rto_rttvar; /*!< 往返时间平均偏差(us)的 4 倍 */
+    uint32_t                rto_us;     /*!< 当前的等待时间(us)，不含在途字节的发送时间，0 表示使用 timeout_ms */
+    uint32_t                rto_t0;     /*!< (用户无需读取)最近一次发送完成的时刻(us) */
+    uint32_t                rto_tx_len; /*!< (用户无需读取)最近一次发送的字节数，0 表示已收到回应 */
+    uint8_t                 rto_t0_valid;   /*!< (用户无需读取)rto_t0 可以产生样本，超时后的回应不能区分对应哪次发送 */
+    uint8_t                 rto_backoff;    /*!< (用户无需读取)上次有效样本后发生过超时 */
+#endif
     /**
      * End of xf_ymodem私有区
      * @}
      */
 } xf_ymodem_t;
 
+/**
+ * @brief 非阻塞内核的事件，见 xf_ymodem_nb_poll().
+ */
+typedef enum _xf_ymodem_nb_event_t {
+    XF_YMODEM_NB_EV_NONE = 0,                   /*!< 无事件 */
+    XF_YMODEM_NB_EV_FILE_INFO,                  /*!< 接收端: 收到起始帧，文件信息已写入
+                                                 *   xf_ymodem_nb_recv_start() 传入的 p_info */
+    XF_YMODEM_NB_EV_DATA,                       /*!< 接收端: 收到一包数据，见 xf_ymodem_nb_recv_get_data() */
+    XF_YMODEM_NB_EV_SEND_READY,                 /*!< 发送端: 可以填充下一包，见 xf_ymodem_nb_send_get_buf() */
+    XF_YMODEM_NB_EV_FILE_END,                   /*!< 收发端: 当前文件已传输完毕，
+                                                 *   发送端需要调用 xf_ymodem_nb_send_next() */
+    XF_YMODEM_NB_EV_END,                        /*!< 收发端: 会话正常结束 */
+    XF_YMODEM_NB_EV_ERROR,                      /*!< 收发端: 会话出错结束，见 xf_ymodem_t.error_code */
+} xf_ymodem_nb_event_t;
+
 /**
  * @brief xf_ymodem 起始帧文件信息。
  */